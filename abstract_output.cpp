@@ -8,6 +8,8 @@
 */
 
 #include "abstract_output.h"
+#include "main.h"
+#include "platform.h"
 
 namespace KWin
 {
@@ -118,4 +120,9 @@ QString AbstractOutput::serialNumber() const
     return QString();
 }
 
+RenderLoop *AbstractOutput::renderLoop() const
+{
+    return kwinApp()->platform()->renderLoop();
+}
+
 } // namespace KWin
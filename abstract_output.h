@@ -24,6 +24,8 @@ class OutputChangeSet;
 namespace KWin
 {
 
+class RenderLoop;
+
 class KWIN_EXPORT GammaRamp
 {
 public:
@@ -177,6 +179,14 @@ public:
      */
     virtual QString serialNumber() const;
 
+    /**
+     * Returns the RenderLoop that drives compositing of this output.
+     *
+     * Default implementation returns the render loop of the platform, i.e. the output
+     * is repainted in lockstep with all other outputs.
+     */
+    virtual RenderLoop *renderLoop() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted when the geometry of this output has changed.
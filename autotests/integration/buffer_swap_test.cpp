@@ -0,0 +1,70 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "platform.h"
+#include "renderloop.h"
+#include "screens.h"
+#include "wayland_server.h"
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_buffer_swap-0");
+
+class BufferSwapTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testSwapSeveralOutputs();
+};
+
+void BufferSwapTest::initTestCase()
+{
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+    QMetaObject::invokeMethod(kwinApp()->platform(), "setVirtualOutputs", Qt::DirectConnection, Q_ARG(int, 2));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QCOMPARE(screens()->count(), 2);
+    waylandServer()->initWorkspace();
+    QVERIFY(Compositor::self()->isActive());
+}
+
+void BufferSwapTest::testSwapSeveralOutputs()
+{
+    // This test verifies that the compositor keeps repainting if a backend swaps the buffers
+    // of every output that shares the render loop, but reports the completion of the frame
+    // only once, like the nested Wayland backend does.
+    RenderLoop *renderLoop = kwinApp()->platform()->renderLoop();
+    QSignalSpy frameRequestedSpy(renderLoop, &RenderLoop::frameRequested);
+    QVERIFY(frameRequestedSpy.isValid());
+
+    for (int i = 0; i < 3; ++i) {
+        for (int screen = 0; screen < screens()->count(); ++screen) {
+            Compositor::self()->aboutToSwapBuffers();
+        }
+        Compositor::self()->bufferSwapComplete();
+
+        frameRequestedSpy.clear();
+        Compositor::self()->addRepaintFull();
+        QVERIFY(frameRequestedSpy.wait());
+    }
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::BufferSwapTest)
+#include "buffer_swap_test.moc"
@@ -0,0 +1,279 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "abstract_client.h"
+#include "composite.h"
+#include "effect_builtins.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "frametracer.h"
+#include "platform.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
+#include "scene.h"
+#include "wayland_server.h"
+
+#include <KConfigGroup>
+
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
+#include <QPainter>
+
+using namespace KWin;
+using namespace KWayland::Client;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_compositing_benchmark-0");
+// The number of frames that are measured per scenario.
+static const int s_frameCount = 60;
+
+enum class DamagePattern {
+    Repaint, ///< The clients don't commit new buffers, the whole screen is repainted
+    Partial, ///< Each client damages a small rectangle moving across its buffer
+    Full, ///< Each client damages the whole buffer
+};
+Q_DECLARE_METATYPE(DamagePattern)
+
+/**
+ * The CompositingBenchmark measures how long the compositor takes to render frames with
+ * the OpenGL scene on the virtual platform. Each scenario shows a number of synthetic
+ * clients, lets them commit buffers according to a damage pattern and renders a fixed
+ * number of frames.
+ *
+ * Only the compositing cycles are measured, the time is taken from the FrameTracer, so
+ * painting and committing the client buffers doesn't count. The reported result is the
+ * mean time from the start of a compositing cycle until the scene has finished painting.
+ * The time spent in each stage of the compositing cycle is printed along with it.
+ */
+class CompositingBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void benchmarkCompositing_data();
+    void benchmarkCompositing();
+
+private:
+    struct Client
+    {
+        QSharedPointer<Surface> surface;
+        QSharedPointer<XdgShellSurface> shellSurface;
+        AbstractClient *client = nullptr;
+        QImage image;
+    };
+
+    bool setupScenario();
+    bool renderFrames(int count);
+
+    QVector<Client> m_clients;
+    DamagePattern m_damagePattern = DamagePattern::Repaint;
+    QString m_effect;
+    int m_frame = 0;
+};
+
+void CompositingBenchmark::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1920, 1080));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+
+    // Disable all effects, the benchmarks load the ones they need.
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    ScriptedEffectLoader loader;
+    const auto builtinNames = BuiltInEffects::availableEffectNames() << loader.listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+
+    Scene *scene = Compositor::self()->scene();
+    QVERIFY(scene);
+    QCOMPARE(scene->compositingType(), KWin::OpenGL2Compositing);
+}
+
+void CompositingBenchmark::init()
+{
+    // Frames are only rendered when the benchmark asks for them.
+    kwinApp()->platform()->renderLoop()->inhibit();
+
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void CompositingBenchmark::cleanup()
+{
+    Compositor::self()->setFrameTracingEnabled(false);
+    Compositor::self()->scene()->setStageTimingEnabled(false);
+    if (!m_effect.isEmpty()) {
+        static_cast<EffectsHandlerImpl *>(effects)->unloadEffect(m_effect);
+        m_effect.clear();
+    }
+    m_clients.clear();
+    Test::destroyWaylandConnection();
+
+    kwinApp()->platform()->renderLoop()->uninhibit();
+}
+
+bool CompositingBenchmark::setupScenario()
+{
+    QFETCH(int, clientCount);
+    QFETCH(QSize, bufferSize);
+    QFETCH(DamagePattern, damagePattern);
+    QFETCH(QString, effect);
+
+    m_damagePattern = damagePattern;
+    m_frame = 0;
+
+    for (int i = 0; i < clientCount; ++i) {
+        Client client;
+        client.surface.reset(Test::createSurface());
+        if (!client.surface) {
+            return false;
+        }
+        client.shellSurface.reset(Test::createXdgShellStableSurface(client.surface.data()));
+        if (!client.shellSurface) {
+            return false;
+        }
+        client.image = QImage(bufferSize, QImage::Format_ARGB32_Premultiplied);
+        client.image.fill(QColor::fromHsv((i * 36) % 360, 255, 255));
+        client.client = Test::renderAndWaitForShown(client.surface.data(), bufferSize, Qt::blue);
+        if (!client.client) {
+            return false;
+        }
+        // Spread the clients over the screen so that they partially overlap.
+        client.client->move(QPoint((i * 97) % 1600, (i * 61) % 800));
+        m_clients.append(client);
+    }
+
+    if (!effect.isEmpty()) {
+        if (!static_cast<EffectsHandlerImpl *>(effects)->loadEffect(effect)) {
+            return false;
+        }
+        m_effect = effect;
+    }
+
+    // Get the initial frames out of the way.
+    Compositor::self()->addRepaintFull();
+    return renderFrames(2);
+}
+
+bool CompositingBenchmark::renderFrames(int count)
+{
+    RenderLoop *renderLoop = kwinApp()->platform()->renderLoop();
+
+    for (int i = 0; i < count; ++i, ++m_frame) {
+        if (m_damagePattern == DamagePattern::Repaint) {
+            Compositor::self()->addRepaintFull();
+        } else {
+            QSignalSpy damagedSpy(m_clients.last().client, &Toplevel::damaged);
+            for (Client &client : m_clients) {
+                QRect damage = client.image.rect();
+                if (m_damagePattern == DamagePattern::Partial) {
+                    const QSize size(64, 64);
+                    damage = QRect(QPoint((m_frame * 16) % (client.image.width() - size.width()),
+                                          (m_frame * 8) % (client.image.height() - size.height())),
+                                   size);
+                }
+                QPainter painter(&client.image);
+                painter.fillRect(damage, QColor::fromHsv((m_frame * 7) % 360, 255, 255));
+                painter.end();
+
+                client.surface->attachBuffer(Test::waylandShmPool()->createBuffer(client.image));
+                client.surface->damage(damage);
+                client.surface->commit(Surface::CommitFlag::None);
+            }
+            Test::flushWaylandConnection();
+
+            // All clients share a connection, so the last one is processed last.
+            if (!damagedSpy.wait()) {
+                return false;
+            }
+        }
+
+        RenderLoopPrivate::get(renderLoop)->dispatch();
+    }
+
+    return true;
+}
+
+void CompositingBenchmark::benchmarkCompositing_data()
+{
+    QTest::addColumn<int>("clientCount");
+    QTest::addColumn<QSize>("bufferSize");
+    QTest::addColumn<DamagePattern>("damagePattern");
+    QTest::addColumn<QString>("effect");
+
+    const QString blur = BuiltInEffects::nameForEffect(BuiltInEffect::Blur);
+    QTest::newRow("1 client/repaint") << 1 << QSize(800, 600) << DamagePattern::Repaint << QString();
+    QTest::newRow("1 client/partial") << 1 << QSize(800, 600) << DamagePattern::Partial << QString();
+    QTest::newRow("1 fullscreen client/full") << 1 << QSize(1920, 1080) << DamagePattern::Full << QString();
+    QTest::newRow("10 clients/partial") << 10 << QSize(400, 300) << DamagePattern::Partial << QString();
+    QTest::newRow("10 clients/partial/blur") << 10 << QSize(400, 300) << DamagePattern::Partial << blur;
+}
+
+void CompositingBenchmark::benchmarkCompositing()
+{
+    QVERIFY(setupScenario());
+
+    Compositor::self()->setFrameTracingEnabled(true);
+    Scene *scene = Compositor::self()->scene();
+    scene->resetStageTimes();
+    scene->resetCounters();
+    scene->setStageTimingEnabled(true);
+    QVERIFY(renderFrames(s_frameCount));
+    scene->setStageTimingEnabled(false);
+
+    std::chrono::nanoseconds compositingTime = std::chrono::nanoseconds::zero();
+    int frameCount = 0;
+    const auto frames = FrameTracer::self()->frames();
+    for (const FrameTracer::Frame &frame : frames) {
+        if (frame.paintEnd != std::chrono::nanoseconds::zero()) {
+            compositingTime += frame.paintEnd - frame.begin;
+            ++frameCount;
+        }
+    }
+    QCOMPARE(frameCount, s_frameCount);
+
+    const QVector<QPair<const char *, Scene::Stage>> stages {
+        { "damage collection", Scene::Stage::DamageCollection },
+        { "pre-paint", Scene::Stage::PrePaint },
+        { "quad building", Scene::Stage::QuadBuilding },
+        { "occlusion", Scene::Stage::Occlusion },
+        { "texture upload", Scene::Stage::TextureUpload },
+        { "draw", Scene::Stage::Draw },
+    };
+    for (const auto &stage : stages) {
+        qInfo("%s: %lld ns per frame", stage.first,
+              static_cast<long long>(scene->stageTime(stage.second).count() / s_frameCount));
+    }
+    const QVector<QPair<const char *, Scene::Counter>> counters {
+        { "vertex uploads", Scene::Counter::VertexUploads },
+    };
+    for (const auto &counter : counters) {
+        qInfo("%s: %.1f per frame", counter.first,
+              qreal(scene->counter(counter.second)) / s_frameCount);
+    }
+
+    QTest::setBenchmarkResult(qreal(compositingTime.count()) / frameCount, QTest::WalltimeNanoseconds);
+}
+
+WAYLANDTEST_MAIN(CompositingBenchmark)
+#include "compositing_benchmark.moc"
@@ -18,6 +18,9 @@
 
 #include <KConfigGroup>
 
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
 using namespace KWin;
 static const QString s_socketName = QStringLiteral("wayland_test_kwin_scene_opengl-0");
 
@@ -106,3 +109,36 @@ void GenericSceneOpenGLTest::testRestart()
     // TODO: introduce frameRendered signal in SceneOpenGL
     QTest::qWait(100);
 }
+
+void GenericSceneOpenGLTest::testStaticWindowVertices()
+{
+    // this test verifies that painting a window that hasn't changed doesn't upload its vertices again
+    using namespace KWayland::Client;
+    QVERIFY(Test::setupWaylandConnection());
+    QScopedPointer<Surface> surface(Test::createSurface());
+    QScopedPointer<XdgShellSurface> shellSurface(Test::createXdgShellStableSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+
+    Scene *scene = KWin::Compositor::self()->scene();
+    QSignalSpy frameRenderedSpy(scene, &Scene::frameRendered);
+    QVERIFY(frameRenderedSpy.isValid());
+
+    // the first paint of the window uploads the vertices
+    KWin::Compositor::self()->addRepaintFull();
+    QVERIFY(frameRenderedSpy.wait());
+    scene->resetCounters();
+
+    // the second one draws the vertices uploaded before
+    KWin::Compositor::self()->addRepaintFull();
+    QVERIFY(frameRenderedSpy.wait());
+    QCOMPARE(scene->counter(Scene::Counter::VertexUploads), 0);
+
+    // a new size changes the window quads, so the vertices have to be uploaded again
+    QSignalSpy frameGeometryChangedSpy(client, &AbstractClient::frameGeometryChanged);
+    QVERIFY(frameGeometryChangedSpy.isValid());
+    Test::render(surface.data(), QSize(200, 100), Qt::red);
+    QVERIFY(frameGeometryChangedSpy.wait());
+    QVERIFY(frameRenderedSpy.wait());
+    QCOMPARE(scene->counter(Scene::Counter::VertexUploads), 1);
+}
@@ -23,6 +23,7 @@ private Q_SLOTS:
     void cleanup();
     void testRestart_data();
     void testRestart();
+    void testStaticWindowVertices();
 
 private:
     QByteArray m_envVariable;
@@ -0,0 +1,241 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "effect_builtins.h"
+#include "effectloader.h"
+#include "platform.h"
+#include "scene.h"
+#include "wayland_server.h"
+
+#include <kwinglplatform.h>
+#include <kwinglutils.h>
+
+#include <KConfigGroup>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_gl_program_cache-0");
+
+static const QByteArray s_vertexSource = QByteArrayLiteral(
+    "uniform mat4 modelViewProjectionMatrix;\n"
+    "attribute vec4 position;\n"
+    "void main() {\n"
+    "    gl_Position = modelViewProjectionMatrix * position;\n"
+    "}\n");
+
+static const QByteArray s_fragmentSource = QByteArrayLiteral(
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(1.0);\n"
+    "}\n");
+
+enum class Corruption {
+    Truncated,
+    Garbage,
+    UnknownFormat,
+};
+
+class GLProgramCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+
+    void testDriverDirectory();
+    void testCacheHit();
+    void testInvalidBinary_data();
+    void testInvalidBinary();
+
+private:
+    QString m_basePath;
+};
+
+static QStringList cachedPrograms(const QString &directory)
+{
+    return QDir(directory).entryList(QDir::Files);
+}
+
+/**
+ * Loads a shader whose sources are tagged with @p tag, so that each tag gets its own
+ * program binary.
+ */
+static bool loadShader(const QByteArray &tag)
+{
+    const QByteArray comment = QByteArrayLiteral("// ") + tag + QByteArrayLiteral("\n");
+    QScopedPointer<GLShader> shader(ShaderManager::instance()->loadShaderFromCode(comment + s_vertexSource,
+                                                                                  comment + s_fragmentSource));
+    return shader->isValid();
+}
+
+void GLProgramCacheTest::initTestCase()
+{
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+
+    // The binaries of another driver are stale.
+    m_basePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/kwin/glprograms/");
+    QDir(m_basePath).removeRecursively();
+    QVERIFY(QDir().mkpath(m_basePath + QStringLiteral("otherdriver")));
+    QFile staleProgram(m_basePath + QStringLiteral("otherdriver/program"));
+    QVERIFY(staleProgram.open(QIODevice::WriteOnly));
+    staleProgram.close();
+
+    // disable all effects - we don't want to have it interact with the rendering
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    ScriptedEffectLoader loader;
+    const auto builtinNames = BuiltInEffects::availableEffectNames() << loader.listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+    QVERIFY(Compositor::self()->scene());
+    QCOMPARE(Compositor::self()->scene()->compositingType(), OpenGL2Compositing);
+}
+
+void GLProgramCacheTest::init()
+{
+    QVERIFY(Compositor::self()->scene()->makeOpenGLContextCurrent());
+
+    // The built-in shaders have been loaded during the startup.
+    if (cachedPrograms(GLShader::programCacheDirectory()).isEmpty()) {
+        QSKIP("The driver doesn't support program binaries");
+    }
+}
+
+void GLProgramCacheTest::cleanupTestCase()
+{
+    QDir(m_basePath).removeRecursively();
+}
+
+void GLProgramCacheTest::testDriverDirectory()
+{
+    // The program binaries are stored in a directory that is specific to the driver,
+    // the binaries of other drivers are removed.
+    const QStringList directories = QDir(m_basePath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    const QString directory = GLShader::programCacheDirectory();
+    QCOMPARE(QFileInfo(directory).absolutePath(), QFileInfo(m_basePath + QStringLiteral("otherdriver")).absolutePath());
+    QCOMPARE(directories, QStringList{QFileInfo(directory).fileName()});
+}
+
+void GLProgramCacheTest::testCacheHit()
+{
+    const QString directory = GLShader::programCacheDirectory();
+    const QStringList programs = cachedPrograms(directory);
+    const int hits = GLShader::programCacheHits();
+
+    // The first load compiles the shader and stores the program binary.
+    QVERIFY(loadShader(QByteArrayLiteral("cache hit")));
+    const QStringList newPrograms = cachedPrograms(directory);
+    QCOMPARE(newPrograms.count(), programs.count() + 1);
+    QCOMPARE(GLShader::programCacheHits(), hits);
+
+    // The second load uses the stored binary.
+    QVERIFY(loadShader(QByteArrayLiteral("cache hit")));
+    QCOMPARE(GLShader::programCacheHits(), hits + 1);
+    QCOMPARE(cachedPrograms(directory), newPrograms);
+}
+
+void GLProgramCacheTest::testInvalidBinary_data()
+{
+    QTest::addColumn<QByteArray>("tag");
+    QTest::addColumn<Corruption>("corruption");
+
+    QTest::newRow("truncated") << QByteArrayLiteral("truncated") << Corruption::Truncated;
+    QTest::newRow("garbage") << QByteArrayLiteral("garbage") << Corruption::Garbage;
+    QTest::newRow("unknown format") << QByteArrayLiteral("unknown format") << Corruption::UnknownFormat;
+}
+
+void GLProgramCacheTest::testInvalidBinary()
+{
+    // This test verifies that the shader is compiled from source if the driver rejects
+    // the program binary, e.g. because the cache is corrupt or has been written by an
+    // older version of the driver.
+    QFETCH(QByteArray, tag);
+    QFETCH(Corruption, corruption);
+
+    const QString directory = GLShader::programCacheDirectory();
+    const QStringList programs = cachedPrograms(directory);
+    QVERIFY(loadShader(tag));
+
+    QStringList newPrograms = cachedPrograms(directory);
+    for (const QString &program : programs) {
+        newPrograms.removeOne(program);
+    }
+    QCOMPARE(newPrograms.count(), 1);
+
+    QFile file(directory + QLatin1Char('/') + newPrograms.first());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray data = file.readAll();
+    file.close();
+    QVERIFY(data.size() > int(sizeof(GLenum)));
+    switch (corruption) {
+    case Corruption::Truncated:
+        data.truncate(2);
+        break;
+    case Corruption::Garbage:
+        data.fill('\xAB', data.size());
+        break;
+    case Corruption::UnknownFormat: {
+        const GLenum format = 0xdead;
+        memcpy(data.data(), &format, sizeof(format));
+        break;
+    }
+    }
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QCOMPARE(file.write(data), qint64(data.size()));
+    file.close();
+
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    const int hits = GLShader::programCacheHits();
+    QVERIFY(loadShader(tag));
+    QCOMPARE(GLShader::programCacheHits(), hits);
+    // The error raised by the rejected binary doesn't leak out of the shader loading.
+    QCOMPARE(glGetError(), GLenum(GL_NO_ERROR));
+
+    // The rejected binary has been replaced by the freshly linked program.
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray storedData = file.readAll();
+    QVERIFY(storedData != data);
+    QVERIFY(storedData.size() > int(sizeof(GLenum)));
+    file.close();
+
+    QVERIFY(loadShader(tag));
+    QCOMPARE(GLShader::programCacheHits(), hits + 1);
+}
+
+}
+
+Q_DECLARE_METATYPE(KWin::Corruption)
+
+WAYLANDTEST_MAIN(KWin::GLProgramCacheTest)
+#include "gl_program_cache_test.moc"
@@ -0,0 +1,336 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "abstract_client.h"
+#include "deleted.h"
+#include "input.h"
+#include "inputhitindex.h"
+#include "platform.h"
+#include "screens.h"
+#include "unmanaged.h"
+#include "virtualdesktops.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_input_hit_index-0");
+
+class InputHitIndexTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testOverlappingWindows();
+    void testStackingOrderChange();
+    void testGeometryChange();
+    void testOutsideOfScreens();
+    void testLinearWalkParity();
+
+private:
+    struct Window
+    {
+        QSharedPointer<KWayland::Client::Surface> surface;
+        QSharedPointer<KWayland::Client::XdgShellSurface> shellSurface;
+        AbstractClient *client = nullptr;
+    };
+
+    AbstractClient *createWindow(const QRect &geometry);
+    bool comparesWithLinearWalk();
+
+    QVector<Window> m_windows;
+};
+
+/**
+ * Finds the window under @p pos the way InputRedirection::findToplevel() did before it
+ * used the InputHitIndex, by hit testing every window.
+ */
+static Toplevel *findToplevelLinearly(const QPoint &pos)
+{
+    const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
+    if (!isScreenLocked) {
+        const QList<Unmanaged *> &unmanaged = workspace()->unmanagedList();
+        for (Unmanaged *u : unmanaged) {
+            if (u->hitTest(pos)) {
+                return u;
+            }
+        }
+    }
+    const QList<Toplevel *> &stacking = workspace()->stackingOrder();
+    for (auto it = stacking.crbegin(); it != stacking.crend(); ++it) {
+        Toplevel *t = *it;
+        if (t->isDeleted()) {
+            continue;
+        }
+        if (AbstractClient *c = qobject_cast<AbstractClient *>(t)) {
+            if (!c->isOnCurrentActivity() || !c->isOnCurrentDesktop() || c->isMinimized() || c->isHiddenInternal()) {
+                continue;
+            }
+        }
+        if (!t->readyForPainting()) {
+            continue;
+        }
+        if (isScreenLocked && !t->isLockScreen() && !t->isInputMethod()) {
+            continue;
+        }
+        if (t->hitTest(pos)) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+void InputHitIndexTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    qRegisterMetaType<KWin::Deleted *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+    QMetaObject::invokeMethod(kwinApp()->platform(), "setVirtualOutputs", Qt::DirectConnection, Q_ARG(int, 2));
+
+    kwinApp()->setConfig(KSharedConfig::openConfig(QString(), KConfig::SimpleConfig));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QCOMPARE(screens()->count(), 2);
+    QCOMPARE(screens()->geometry(), QRect(0, 0, 2560, 1024));
+    waylandServer()->initWorkspace();
+
+    VirtualDesktopManager::self()->setCount(2);
+}
+
+void InputHitIndexTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+    VirtualDesktopManager::self()->setCurrent(1);
+}
+
+void InputHitIndexTest::cleanup()
+{
+    // Destroy the windows one after the other, so that none of them lingers in the next test.
+    for (Window &window : m_windows) {
+        AbstractClient *client = window.client;
+        window.shellSurface.reset();
+        window.surface.reset();
+        QVERIFY(Test::waitForWindowDestroyed(client));
+    }
+    m_windows.clear();
+    Test::destroyWaylandConnection();
+}
+
+AbstractClient *InputHitIndexTest::createWindow(const QRect &geometry)
+{
+    Window window;
+    window.surface.reset(Test::createSurface());
+    if (!window.surface) {
+        return nullptr;
+    }
+    window.shellSurface.reset(Test::createXdgShellStableSurface(window.surface.data()));
+    if (!window.shellSurface) {
+        return nullptr;
+    }
+    window.client = Test::renderAndWaitForShown(window.surface.data(), geometry.size(), Qt::blue);
+    if (!window.client) {
+        return nullptr;
+    }
+    window.client->move(geometry.topLeft());
+    if (window.client->frameGeometry() != geometry) {
+        return nullptr;
+    }
+    m_windows.append(window);
+    return window.client;
+}
+
+bool InputHitIndexTest::comparesWithLinearWalk()
+{
+    // Sample the screens and a margin around them in steps that don't line up with the cells.
+    const QRect area = screens()->geometry().adjusted(-50, -50, 50, 50);
+    for (int y = area.top(); y <= area.bottom(); y += 23) {
+        for (int x = area.left(); x <= area.right(); x += 23) {
+            const QPoint pos(x, y);
+            if (input()->findToplevel(pos) != findToplevelLinearly(pos)) {
+                qWarning() << "The window under" << pos << "differs from the linear walk";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void InputHitIndexTest::testOverlappingWindows()
+{
+    // this test creates three windows which overlap each other within a single cell
+    AbstractClient *window1 = createWindow(QRect(0, 0, 200, 200));
+    QVERIFY(window1);
+    AbstractClient *window2 = createWindow(QRect(100, 100, 200, 200));
+    QVERIFY(window2);
+    AbstractClient *window3 = createWindow(QRect(150, 150, 200, 200));
+    QVERIFY(window3);
+
+    InputHitIndex index;
+    const QVector<Toplevel *> expected{window3, window2, window1};
+    QCOMPARE(index.managedCandidates(QPoint(175, 175)), expected);
+    QCOMPARE(index.managedCandidates(QPoint(10, 10)), expected);
+    // the windows don't reach into the cells of the second screen
+    QVERIFY(index.managedCandidates(QPoint(2000, 800)).isEmpty());
+    QVERIFY(index.unmanagedCandidates(QPoint(175, 175)).isEmpty());
+
+    // the topmost window which contains the position wins
+    QCOMPARE(input()->findToplevel(QPoint(175, 175)), window3);
+    QCOMPARE(input()->findToplevel(QPoint(120, 120)), window2);
+    QCOMPARE(input()->findToplevel(QPoint(50, 50)), window1);
+    QCOMPARE(input()->findToplevel(QPoint(320, 320)), window3);
+    QCOMPARE(input()->findToplevel(QPoint(360, 360)), nullptr);
+    QCOMPARE(input()->findToplevel(QPoint(250, 20)), nullptr);
+}
+
+void InputHitIndexTest::testStackingOrderChange()
+{
+    AbstractClient *window1 = createWindow(QRect(0, 0, 200, 200));
+    QVERIFY(window1);
+    AbstractClient *window2 = createWindow(QRect(100, 100, 200, 200));
+    QVERIFY(window2);
+
+    InputHitIndex index;
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), (QVector<Toplevel *>{window2, window1}));
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), window2);
+
+    // raising the bottom window reorders the candidates
+    workspace()->raiseClient(window1);
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), (QVector<Toplevel *>{window1, window2}));
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), window1);
+
+    // and so does lowering it again
+    workspace()->lowerClient(window1);
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), (QVector<Toplevel *>{window2, window1}));
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), window2);
+
+    // a window which is moved to another desktop is no candidate anymore
+    window2->setDesktop(2);
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), QVector<Toplevel *>{window1});
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), window1);
+
+    // until that desktop becomes the current one
+    VirtualDesktopManager::self()->setCurrent(2);
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), QVector<Toplevel *>{window2});
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), window2);
+
+    // a destroyed window is removed from the index
+    VirtualDesktopManager::self()->setCurrent(1);
+    Window window = m_windows.takeFirst();
+    window.shellSurface.reset();
+    window.surface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(window1));
+    QVERIFY(index.managedCandidates(QPoint(150, 150)).isEmpty());
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), nullptr);
+}
+
+void InputHitIndexTest::testGeometryChange()
+{
+    AbstractClient *window1 = createWindow(QRect(0, 0, 200, 200));
+    QVERIFY(window1);
+    AbstractClient *window2 = createWindow(QRect(100, 100, 200, 200));
+    QVERIFY(window2);
+
+    InputHitIndex index;
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), (QVector<Toplevel *>{window2, window1}));
+    QVERIFY(index.managedCandidates(QPoint(700, 700)).isEmpty());
+
+    // moving the top window into another cell takes it out of the old one
+    window2->move(QPoint(600, 600));
+    QCOMPARE(index.managedCandidates(QPoint(150, 150)), QVector<Toplevel *>{window1});
+    QCOMPARE(index.managedCandidates(QPoint(700, 700)), QVector<Toplevel *>{window2});
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), window1);
+    QCOMPARE(input()->findToplevel(QPoint(700, 700)), window2);
+
+    // a window which spans both screens is a candidate in the cells of either screen
+    window1->move(QPoint(1200, 0));
+    QCOMPARE(index.managedCandidates(QPoint(1250, 100)), QVector<Toplevel *>{window1});
+    QCOMPARE(index.managedCandidates(QPoint(1350, 100)), QVector<Toplevel *>{window1});
+    QVERIFY(index.managedCandidates(QPoint(150, 150)).isEmpty());
+    QCOMPARE(input()->findToplevel(QPoint(150, 150)), nullptr);
+    QCOMPARE(input()->findToplevel(QPoint(1350, 100)), window1);
+
+    // a resized window is looked up in the cells it grew into
+    QSignalSpy frameGeometryChangedSpy(window1, &AbstractClient::frameGeometryChanged);
+    QVERIFY(frameGeometryChangedSpy.isValid());
+    Test::render(m_windows.first().surface.data(), QSize(400, 400), Qt::red);
+    QVERIFY(frameGeometryChangedSpy.wait());
+    QCOMPARE(window1->frameGeometry(), QRect(1200, 0, 400, 400));
+    QCOMPARE(index.managedCandidates(QPoint(1550, 350)), QVector<Toplevel *>{window1});
+    QCOMPARE(input()->findToplevel(QPoint(1550, 350)), window1);
+}
+
+void InputHitIndexTest::testOutsideOfScreens()
+{
+    AbstractClient *window1 = createWindow(QRect(0, 0, 200, 200));
+    QVERIFY(window1);
+    AbstractClient *window2 = createWindow(QRect(2460, 924, 200, 200));
+    QVERIFY(window2);
+
+    // positions outside of the screens fall back to all windows
+    InputHitIndex index;
+    QCOMPARE(index.managedCandidates(QPoint(-10, -10)), (QVector<Toplevel *>{window2, window1}));
+    QCOMPARE(index.managedCandidates(QPoint(2600, 1100)), (QVector<Toplevel *>{window2, window1}));
+    QCOMPARE(input()->findToplevel(QPoint(2600, 1100)), window2);
+    QCOMPARE(input()->findToplevel(QPoint(-10, -10)), nullptr);
+}
+
+void InputHitIndexTest::testLinearWalkParity()
+{
+    // the index must find the same windows as hit testing every window in stacking order
+    const QVector<QRect> geometries{
+        QRect(0, 0, 300, 200),
+        QRect(100, 50, 640, 480),
+        QRect(250, 250, 100, 100),
+        QRect(1000, 300, 600, 400),
+        QRect(1100, 400, 120, 90),
+        QRect(2000, 700, 500, 300),
+        QRect(2300, 900, 400, 250),
+        QRect(500, 600, 900, 350),
+    };
+    QVector<AbstractClient *> clients;
+    for (const QRect &geometry : geometries) {
+        AbstractClient *client = createWindow(geometry);
+        QVERIFY(client);
+        clients.append(client);
+    }
+    QVERIFY(comparesWithLinearWalk());
+
+    workspace()->raiseClient(clients[1]);
+    workspace()->lowerClient(clients[7]);
+    QVERIFY(comparesWithLinearWalk());
+
+    clients[3]->move(QPoint(1240, 500));
+    clients[5]->move(QPoint(-100, 800));
+    QVERIFY(comparesWithLinearWalk());
+
+    // minimized windows stay in the index, they're filtered out on lookup
+    clients[1]->minimize();
+    QVERIFY(clients[1]->isMinimized());
+    QVERIFY(comparesWithLinearWalk());
+
+    clients[4]->setDesktop(2);
+    QVERIFY(comparesWithLinearWalk());
+    VirtualDesktopManager::self()->setCurrent(2);
+    QVERIFY(comparesWithLinearWalk());
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::InputHitIndexTest)
+#include "input_hit_index_test.moc"
@@ -126,6 +126,7 @@ private Q_SLOTS:
     void testHideShowCursor();
     void testDefaultInputRegion();
     void testEmptyInputRegion();
+    void testCoalescedMotion();
 
 private:
     void render(KWayland::Client::Surface *surface, const QSize &size = QSize(100, 50));
@@ -176,6 +177,7 @@ void PointerInputTest::init()
 
 void PointerInputTest::cleanup()
 {
+    input()->pointer()->setMotionCoalescingEnabled(false);
     Test::destroyWaylandConnection();
 }
 
@@ -1674,6 +1676,62 @@ void PointerInputTest::testEmptyInputRegion()
     QVERIFY(Test::waitForWindowDestroyed(client));
 }
 
+void PointerInputTest::testCoalescedMotion()
+{
+    // This test verifies that motion from input devices is delivered once per frame when
+    // coalescing is enabled, and that other input events deliver the pending motion first.
+
+    using namespace KWayland::Client;
+    auto pointer = m_seat->createPointer(m_seat);
+    QVERIFY(pointer);
+    QVERIFY(pointer->isValid());
+    QSignalSpy enteredSpy(pointer, &Pointer::entered);
+    QVERIFY(enteredSpy.isValid());
+    QSignalSpy movedSpy(pointer, &Pointer::motion);
+    QVERIFY(movedSpy.isValid());
+
+    QScopedPointer<Surface> surface(Test::createSurface());
+    QVERIFY(!surface.isNull());
+    QScopedPointer<XdgShellSurface> shellSurface(Test::createXdgShellStableSurface(surface.data()));
+    QVERIFY(!shellSurface.isNull());
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+
+    quint32 timestamp = 1;
+    const QPoint origin = client->frameGeometry().topLeft();
+    kwinApp()->platform()->pointerMotion(origin + QPoint(10, 10), timestamp++);
+    QVERIFY(enteredSpy.wait());
+
+    // Only motion from libinput devices is coalesced, the device isn't accessed on the way
+    // to the clients though.
+    static char fakeDeviceData;
+    LibInput::Device *device = reinterpret_cast<LibInput::Device *>(&fakeDeviceData);
+    input()->pointer()->setMotionCoalescingEnabled(true);
+
+    // The cursor follows the device right away, the clients see the motion with the next frame.
+    input()->pointer()->processMotion(origin + QPoint(20, 10), timestamp++, device);
+    input()->pointer()->processMotion(origin + QPoint(30, 15), timestamp++, device);
+    input()->pointer()->processMotion(origin + QPoint(40, 20), timestamp++, device);
+    QCOMPARE(input()->pointer()->pos(), QPointF(origin + QPoint(40, 20)));
+    QCOMPARE(waylandServer()->seat()->pointerPos(), QPointF(origin + QPoint(10, 10)));
+
+    QVERIFY(movedSpy.wait());
+    QCOMPARE(movedSpy.count(), 1);
+    QCOMPARE(movedSpy.last().first().toPointF(), QPointF(40, 20));
+    QCOMPARE(waylandServer()->seat()->pointerPos(), QPointF(origin + QPoint(40, 20)));
+
+    // A button press must not overtake the pending motion.
+    input()->pointer()->processMotion(origin + QPoint(50, 25), timestamp++, device);
+    QCOMPARE(waylandServer()->seat()->pointerPos(), QPointF(origin + QPoint(40, 20)));
+    kwinApp()->platform()->pointerButtonPressed(BTN_LEFT, timestamp++);
+    QCOMPARE(waylandServer()->seat()->pointerPos(), QPointF(origin + QPoint(50, 25)));
+    kwinApp()->platform()->pointerButtonReleased(BTN_LEFT, timestamp++);
+
+    input()->pointer()->setMotionCoalescingEnabled(false);
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
 }
 
 WAYLANDTEST_MAIN(KWin::PointerInputTest)
@@ -0,0 +1,155 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../../libinput/eventqueue.h"
+
+#include <QThread>
+#include <QtTest>
+
+#include <memory>
+
+using namespace KWin::LibInput;
+using namespace std::chrono_literals;
+
+class TestLibinputEventQueue : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testOrder();
+    void testOverflow();
+    void testWrapAround();
+    void testThreads();
+};
+
+// The queue never dereferences the events, the entries are told apart by their timestamps.
+static bool push(EventQueue &queue, int value)
+{
+    return queue.push(nullptr, std::chrono::nanoseconds(value));
+}
+
+static int pop(EventQueue &queue)
+{
+    const EventQueue::Entry *entry = queue.peek();
+    if (!entry) {
+        return -1;
+    }
+    const int value = entry->timestamp.count();
+    queue.pop();
+    return value;
+}
+
+void TestLibinputEventQueue::testEmpty()
+{
+    EventQueue queue;
+    QVERIFY(!queue.peek());
+}
+
+void TestLibinputEventQueue::testOrder()
+{
+    EventQueue queue;
+    QVERIFY(push(queue, 1));
+    QVERIFY(push(queue, 2));
+    QVERIFY(push(queue, 3));
+
+    // peeking doesn't remove the entry
+    QVERIFY(queue.peek());
+    QCOMPARE(queue.peek()->timestamp, 1ns);
+    QCOMPARE(queue.peek()->timestamp, 1ns);
+
+    QCOMPARE(pop(queue), 1);
+    QCOMPARE(pop(queue), 2);
+    QVERIFY(push(queue, 4));
+    QCOMPARE(pop(queue), 3);
+    QCOMPARE(pop(queue), 4);
+    QVERIFY(!queue.peek());
+}
+
+void TestLibinputEventQueue::testOverflow()
+{
+    std::unique_ptr<EventQueue> queue = std::make_unique<EventQueue>();
+    for (int i = 0; i < int(EventQueue::capacity); ++i) {
+        QVERIFY(push(*queue, i));
+    }
+
+    // a full queue rejects new events and keeps the ones it has
+    QVERIFY(!push(*queue, -2));
+    QCOMPARE(queue->peek()->timestamp, 0ns);
+
+    // there is room again once the consumer has caught up
+    QCOMPARE(pop(*queue), 0);
+    QVERIFY(push(*queue, int(EventQueue::capacity)));
+    QVERIFY(!push(*queue, -2));
+
+    for (int i = 1; i <= int(EventQueue::capacity); ++i) {
+        QCOMPARE(pop(*queue), i);
+    }
+    QVERIFY(!queue->peek());
+}
+
+void TestLibinputEventQueue::testWrapAround()
+{
+    // The entries are reused once the indices run past the end of the ring.
+    std::unique_ptr<EventQueue> queue = std::make_unique<EventQueue>();
+    const int batch = EventQueue::capacity / 3 + 1;
+    int pushed = 0;
+    int popped = 0;
+    while (pushed < int(EventQueue::capacity) * 3) {
+        for (int i = 0; i < batch; ++i) {
+            QVERIFY(push(*queue, pushed++));
+        }
+        for (int i = 0; i < batch; ++i) {
+            QCOMPARE(pop(*queue), popped++);
+        }
+        QVERIFY(!queue->peek());
+    }
+
+    // fill the queue across the end of the ring
+    for (int i = 0; i < int(EventQueue::capacity); ++i) {
+        QVERIFY(push(*queue, pushed++));
+    }
+    QVERIFY(!push(*queue, -2));
+    while (const EventQueue::Entry *entry = queue->peek()) {
+        QCOMPARE(entry->timestamp, std::chrono::nanoseconds(popped++));
+        queue->pop();
+    }
+    QCOMPARE(popped, pushed);
+}
+
+void TestLibinputEventQueue::testThreads()
+{
+    // one thread pushes while the other one pops, nothing gets lost or reordered
+    std::unique_ptr<EventQueue> queue = std::make_unique<EventQueue>();
+    const int count = EventQueue::capacity * 64;
+    std::unique_ptr<QThread> producer(QThread::create([&queue, count] {
+        for (int i = 0; i < count; ++i) {
+            while (!push(*queue, i)) {
+                QThread::yieldCurrentThread();
+            }
+        }
+    }));
+    producer->start();
+
+    int expected = 0;
+    bool inOrder = true;
+    while (expected < count) {
+        const int value = pop(*queue);
+        if (value == -1) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        inOrder = inOrder && value == expected;
+        ++expected;
+    }
+    QVERIFY(producer->wait());
+    QVERIFY(inOrder);
+    QVERIFY(!queue->peek());
+}
+
+QTEST_GUILESS_MAIN(TestLibinputEventQueue)
+#include "event_queue_test.moc"
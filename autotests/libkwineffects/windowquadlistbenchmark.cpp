@@ -0,0 +1,136 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include <kwineffects.h>
+#include <QMatrix4x4>
+#include <QTest>
+
+#ifndef GL_TRIANGLES
+#  define GL_TRIANGLES      0x0004
+#endif
+
+/**
+ * Measures the operations on window quads that grid based effects, such as wobbly windows or
+ * magic lamp, cause on every frame. Generating the vertices is compared between WindowQuadList
+ * and the WindowQuadArray the OpenGL scene paints from.
+ */
+class WindowQuadListBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkMakeRegularGrid_data();
+    void benchmarkMakeRegularGrid();
+    void benchmarkMakeGrid();
+    void benchmarkSplit();
+    void benchmarkToArray();
+    void benchmarkInterleavedArraysList();
+    void benchmarkInterleavedArraysArray();
+
+private:
+    void addSubdivisions();
+
+    // A window with a title bar, borders and contents.
+    KWin::WindowQuadList m_window;
+    KWin::WindowQuadList m_grid;
+    QMatrix4x4 m_textureMatrix;
+};
+
+static KWin::WindowQuad makeQuad(const QRectF &r, KWin::WindowQuadType type)
+{
+    KWin::WindowQuad quad(type);
+    quad[ 0 ] = KWin::WindowVertex(r.x(), r.y(), r.x(), r.y());
+    quad[ 1 ] = KWin::WindowVertex(r.x() + r.width(), r.y(), r.x() + r.width(), r.y());
+    quad[ 2 ] = KWin::WindowVertex(r.x() + r.width(), r.y() + r.height(), r.x() + r.width(), r.y() + r.height());
+    quad[ 3 ] = KWin::WindowVertex(r.x(), r.y() + r.height(), r.x(), r.y() + r.height());
+    return quad;
+}
+
+void WindowQuadListBenchmark::initTestCase()
+{
+    m_window.append(makeQuad(QRectF(0, 0, 1280, 30), KWin::WindowQuadDecoration));
+    m_window.append(makeQuad(QRectF(0, 30, 4, 800), KWin::WindowQuadDecoration));
+    m_window.append(makeQuad(QRectF(1276, 30, 4, 800), KWin::WindowQuadDecoration));
+    m_window.append(makeQuad(QRectF(0, 830, 1280, 4), KWin::WindowQuadDecoration));
+    m_window.append(makeQuad(QRectF(4, 30, 1272, 800), KWin::WindowQuadContents));
+
+    // the grid of wobbly windows with its default settings
+    m_grid = m_window.makeGrid(16);
+
+    m_textureMatrix.scale(1.0 / 1280, 1.0 / 834);
+}
+
+void WindowQuadListBenchmark::addSubdivisions()
+{
+    QTest::addColumn<int>("subdivisions");
+
+    QTest::newRow("10x10") << 10;
+    QTest::newRow("50x50") << 50;
+    QTest::newRow("100x100") << 100;
+}
+
+void WindowQuadListBenchmark::benchmarkMakeRegularGrid_data()
+{
+    addSubdivisions();
+}
+
+void WindowQuadListBenchmark::benchmarkMakeRegularGrid()
+{
+    QFETCH(int, subdivisions);
+    QBENCHMARK {
+        const KWin::WindowQuadList grid = m_window.makeRegularGrid(subdivisions, subdivisions);
+        Q_UNUSED(grid)
+    }
+}
+
+void WindowQuadListBenchmark::benchmarkMakeGrid()
+{
+    QBENCHMARK {
+        const KWin::WindowQuadList grid = m_window.makeGrid(16);
+        Q_UNUSED(grid)
+    }
+}
+
+void WindowQuadListBenchmark::benchmarkSplit()
+{
+    const KWin::WindowQuadList grid = m_window.makeGrid(64);
+    QBENCHMARK {
+        const KWin::WindowQuadList split = grid.splitAtX(333.3).splitAtY(222.2);
+        Q_UNUSED(split)
+    }
+}
+
+void WindowQuadListBenchmark::benchmarkToArray()
+{
+    // the OpenGL scene converts the quads of every window it paints
+    QBENCHMARK {
+        const KWin::WindowQuadArray array(m_grid);
+        Q_UNUSED(array)
+    }
+}
+
+void WindowQuadListBenchmark::benchmarkInterleavedArraysList()
+{
+    QVector<KWin::GLVertex2D> vertices(m_grid.count() * 6);
+    QBENCHMARK {
+        m_grid.makeInterleavedArrays(GL_TRIANGLES, vertices.data(), m_textureMatrix);
+    }
+}
+
+void WindowQuadListBenchmark::benchmarkInterleavedArraysArray()
+{
+    const KWin::WindowQuadArray grid(m_grid);
+    QVector<KWin::GLVertex2D> vertices(grid.count() * 6);
+    QBENCHMARK {
+        grid.makeInterleavedArrays(GL_TRIANGLES, vertices.data(), m_textureMatrix);
+    }
+}
+
+QTEST_MAIN(WindowQuadListBenchmark)
+
+#include "windowquadlistbenchmark.moc"
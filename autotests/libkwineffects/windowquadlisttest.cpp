@@ -7,6 +7,7 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include <kwineffects.h>
+#include <QMatrix4x4>
 #include <QTest>
 
 Q_DECLARE_METATYPE(KWin::WindowQuadList)
@@ -19,6 +20,9 @@ private Q_SLOTS:
     void testMakeGrid();
     void testMakeRegularGrid_data();
     void testMakeRegularGrid();
+    void testArray_data();
+    void testArray();
+    void testArrayInterleavedArrays();
 
 private:
     KWin::WindowQuad makeQuad(const QRectF &rect);
@@ -205,6 +209,95 @@ void WindowQuadListTest::testMakeRegularGrid()
     }
 }
 
+void WindowQuadListTest::testArray_data()
+{
+    QTest::addColumn<KWin::WindowQuadList>("orig");
+
+    KWin::WindowQuadList orig;
+    QTest::newRow("empty") << orig;
+
+    orig.append(makeQuad(QRectF(0, 0, 10, 10)));
+    QTest::newRow("single") << orig;
+
+    orig.append(makeQuad(QRectF(0, 10, 4, 3)));
+    QTest::newRow("multiple") << orig;
+
+    KWin::WindowQuad swapped = makeQuad(QRectF(10, 0, 7, 13));
+    swapped.setUVAxisSwapped(true);
+    orig.append(swapped);
+    QTest::newRow("uvAxisSwapped") << orig;
+
+    orig.append(makeQuad(QRectF(20, 20, 0, 5)));
+    QTest::newRow("noSize") << orig;
+}
+
+void WindowQuadListTest::testArray()
+{
+    // WindowQuadArray has to produce the same quads as WindowQuadList
+    QFETCH(KWin::WindowQuadList, orig);
+    const KWin::WindowQuadArray array(orig);
+    QCOMPARE(array.count(), orig.count());
+    QCOMPARE(array.isTransformed(), orig.isTransformed());
+
+    auto compare = [](const KWin::WindowQuadList &expected, const KWin::WindowQuadArray &actual) {
+        if (expected.count() != actual.count()) {
+            return false;
+        }
+        for (int i = 0; i < expected.count(); ++i) {
+            const KWin::WindowQuad actualQuad = actual.at(i);
+            const KWin::WindowQuad &expectedQuad = expected.at(i);
+            if (actualQuad.type() != expectedQuad.type() || actualQuad.id() != expectedQuad.id() ||
+                    actualQuad.uvAxisSwapped() != expectedQuad.uvAxisSwapped()) {
+                return false;
+            }
+            for (int j = 0; j < 4; ++j) {
+                const KWin::WindowVertex &actualVertex = actualQuad[j];
+                const KWin::WindowVertex &expectedVertex = expectedQuad[j];
+                // the array stores the vertices in single precision
+                if (qAbs(actualVertex.x() - expectedVertex.x()) > 1e-4) return false;
+                if (qAbs(actualVertex.y() - expectedVertex.y()) > 1e-4) return false;
+                if (qAbs(actualVertex.originalX() - expectedVertex.originalX()) > 1e-4) return false;
+                if (qAbs(actualVertex.originalY() - expectedVertex.originalY()) > 1e-4) return false;
+                if (qAbs(actualVertex.u() - expectedVertex.u()) > 1e-4) return false;
+                if (qAbs(actualVertex.v() - expectedVertex.v()) > 1e-4) return false;
+            }
+        }
+        return true;
+    };
+
+    QVERIFY(compare(orig, array));
+    QVERIFY(compare(orig.makeGrid(3), KWin::WindowQuadArray(orig.makeGrid(3))));
+
+    const KWin::WindowQuadList roundTrip = array.toList();
+    QVERIFY(compare(roundTrip, array));
+}
+
+void WindowQuadListTest::testArrayInterleavedArrays()
+{
+    KWin::WindowQuadList quads;
+    quads.append(makeQuad(QRectF(0, 0, 10, 10)));
+    quads.append(makeQuad(QRectF(10, 0, 5, 7)));
+    quads = quads.makeRegularGrid(4, 4);
+    const KWin::WindowQuadArray array(quads);
+
+    QMatrix4x4 textureMatrix;
+    textureMatrix.scale(0.5, 0.25);
+    textureMatrix.translate(1, 2);
+
+    const uint types[] = { 0x0007 /* GL_QUADS */, 0x0004 /* GL_TRIANGLES */ };
+    for (const uint type : types) {
+        const int vertexCount = quads.count() * (type == 0x0007 ? 4 : 6);
+        QVector<KWin::GLVertex2D> expected(vertexCount);
+        QVector<KWin::GLVertex2D> actual(vertexCount);
+        quads.makeInterleavedArrays(type, expected.data(), textureMatrix);
+        array.makeInterleavedArrays(type, actual.data(), textureMatrix);
+        for (int i = 0; i < vertexCount; ++i) {
+            QCOMPARE(actual.at(i).position, expected.at(i).position);
+            QCOMPARE(actual.at(i).texcoord, expected.at(i).texcoord);
+        }
+    }
+}
+
 QTEST_MAIN(WindowQuadListTest)
 
 #include "windowquadlisttest.moc"
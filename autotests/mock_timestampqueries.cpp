@@ -0,0 +1,77 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "mock_timestampqueries.h"
+
+namespace KWin
+{
+
+bool MockTimestampQueries::isContextCurrent() const
+{
+    return m_contextCurrent;
+}
+
+uint MockTimestampQueries::issue()
+{
+    if (!m_contextCurrent) {
+        return 0;
+    }
+    const uint query = ++m_lastQuery;
+    m_queries.insert(query, m_time + m_latency);
+    return query;
+}
+
+bool MockTimestampQueries::isAvailable(uint query)
+{
+    Q_ASSERT(m_queries.contains(query));
+    return m_contextCurrent && m_resultsAvailable;
+}
+
+std::chrono::nanoseconds MockTimestampQueries::result(uint query)
+{
+    Q_ASSERT(m_queries.contains(query));
+    return m_queries.value(query);
+}
+
+void MockTimestampQueries::release(uint query)
+{
+    Q_ASSERT(m_queries.contains(query));
+    m_queries.remove(query);
+}
+
+std::chrono::nanoseconds MockTimestampQueries::currentTime()
+{
+    return m_time;
+}
+
+void MockTimestampQueries::advance(std::chrono::nanoseconds duration)
+{
+    m_time += duration;
+}
+
+void MockTimestampQueries::setLatency(std::chrono::nanoseconds latency)
+{
+    m_latency = latency;
+}
+
+void MockTimestampQueries::setContextCurrent(bool current)
+{
+    m_contextCurrent = current;
+}
+
+void MockTimestampQueries::setResultsAvailable(bool available)
+{
+    m_resultsAvailable = available;
+}
+
+int MockTimestampQueries::issuedCount() const
+{
+    return m_queries.count();
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_MOCK_TIMESTAMPQUERIES_H
+#define KWIN_MOCK_TIMESTAMPQUERIES_H
+
+#include "../timestampqueries.h"
+
+#include <QHash>
+
+namespace KWin
+{
+
+/**
+ * Fake timestamp queries driven by a GPU clock the test advances by hand.
+ */
+class MockTimestampQueries : public TimestampQueries
+{
+public:
+    bool isContextCurrent() const override;
+    uint issue() override;
+    bool isAvailable(uint query) override;
+    std::chrono::nanoseconds result(uint query) override;
+    void release(uint query) override;
+    std::chrono::nanoseconds currentTime() override;
+
+    /**
+     * Advances the GPU clock by @p duration.
+     */
+    void advance(std::chrono::nanoseconds duration);
+    /**
+     * The GPU completes the commands issued before a query @p latency after the query.
+     */
+    void setLatency(std::chrono::nanoseconds latency);
+    void setContextCurrent(bool current);
+    void setResultsAvailable(bool available);
+
+    /**
+     * Returns the number of queries that have been issued and not released yet.
+     */
+    int issuedCount() const;
+
+private:
+    QHash<uint, std::chrono::nanoseconds> m_queries;
+    uint m_lastQuery = 0;
+    std::chrono::nanoseconds m_time = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds m_latency = std::chrono::nanoseconds::zero();
+    bool m_contextCurrent = true;
+    bool m_resultsAvailable = true;
+};
+
+}
+
+#endif
@@ -7,6 +7,7 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "../effectloader.h"
+#include "../effects/deferredeffect.h"
 #include "../effects/effect_builtins.h"
 #include "mock_effectshandler.h"
 #include "../scripting/scriptedeffect.h" // for mocking ScriptedEffect::create
@@ -16,6 +17,7 @@
 #include <KConfigGroup>
 // Qt
 #include <QtTest>
+#include <QAction>
 #include <QStringList>
 #include <QScopedPointer>
 Q_DECLARE_METATYPE(KWin::CompositingType)
@@ -56,6 +58,10 @@ private Q_SLOTS:
     void testLoadBuiltInEffect_data();
     void testLoadBuiltInEffect();
     void testLoadAllEffects();
+    void testDeferredLoad();
+    void testDeferredLoadConfig_data();
+    void testDeferredLoadConfig();
+    void testDeferredTrigger();
 };
 
 void TestBuiltInEffectLoader::initTestCase()
@@ -551,6 +557,158 @@ void TestBuiltInEffectLoader::testLoadAllEffects()
     QCOMPARE(loadedEffects.at(1), QStringLiteral("mouseclick"));
 }
 
+void TestBuiltInEffectLoader::testDeferredLoad()
+{
+    QScopedPointer<MockEffectsHandler, QScopedPointerDeleteLater> mockHandler(new MockEffectsHandler(KWin::XRenderCompositing));
+    KWin::BuiltInEffectLoader loader;
+    KSharedConfig::Ptr config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    loader.setConfig(config);
+
+    qRegisterMetaType<KWin::Effect*>();
+    QSignalSpy spy(&loader, &KWin::BuiltInEffectLoader::effectLoaded);
+    // connect to signal to ensure that we delete the Effect again as the Effect doesn't have a parent
+    connect(&loader, &KWin::BuiltInEffectLoader::effectLoaded,
+        [](KWin::Effect *effect) {
+            effect->deleteLater();
+        }
+    );
+
+    const KWin::LoadEffectFlags flags = KWin::LoadEffectFlag::Load | KWin::LoadEffectFlag::Defer;
+
+    // desktopgrid declares its triggers, so only a stand-in is created
+    QVERIFY(loader.loadEffect(KWin::BuiltInEffect::DesktopGrid, flags));
+    QVERIFY(spy.isEmpty());
+    QVERIFY(loader.findDeferredEffect(QStringLiteral("desktopgrid")));
+
+    // mouseclick doesn't, so it's loaded right away
+    QVERIFY(loader.loadEffect(KWin::BuiltInEffect::MouseClick, flags));
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(!loader.findDeferredEffect(QStringLiteral("mouseclick")));
+
+    // loading the effect explicitly replaces the stand-in
+    QVERIFY(loader.loadEffect(QStringLiteral("desktopgrid")));
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.last().at(1).toString(), QStringLiteral("desktopgrid"));
+    QVERIFY(!loader.findDeferredEffect(QStringLiteral("desktopgrid")));
+}
+
+void TestBuiltInEffectLoader::testDeferredLoadConfig_data()
+{
+    QTest::addColumn<QVariant>("deferEffectLoading");
+    QTest::addColumn<bool>("deferred");
+
+    QTest::newRow("enabled") << QVariant(true) << true;
+    QTest::newRow("disabled") << QVariant(false) << false;
+    QTest::newRow("unset") << QVariant() << false;
+}
+
+void TestBuiltInEffectLoader::testDeferredLoadConfig()
+{
+    // This test verifies that effects loaded from the configuration are deferred only if
+    // the DeferEffectLoading option is set.
+    QScopedPointer<MockEffectsHandler, QScopedPointerDeleteLater> mockHandler(new MockEffectsHandler(KWin::XRenderCompositing));
+    KWin::BuiltInEffectLoader loader;
+    KSharedConfig::Ptr config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+
+    // only presentwindows, which declares its triggers, and mouseclick, which doesn't, are enabled
+    KConfigGroup plugins = config->group("Plugins");
+    plugins.writeEntry(QStringLiteral("desktopgridEnabled"), false);
+    plugins.writeEntry(QStringLiteral("highlightwindowEnabled"), false);
+    plugins.writeEntry(QStringLiteral("kscreenEnabled"), false);
+    plugins.writeEntry(QStringLiteral("presentwindowsEnabled"), true);
+    plugins.writeEntry(QStringLiteral("screenedgeEnabled"), false);
+    plugins.writeEntry(QStringLiteral("screenshotEnabled"), false);
+    plugins.writeEntry(QStringLiteral("slideEnabled"), false);
+    plugins.writeEntry(QStringLiteral("slidingpopupsEnabled"), false);
+    plugins.writeEntry(QStringLiteral("startupfeedbackEnabled"), false);
+    plugins.writeEntry(QStringLiteral("zoomEnabled"), false);
+    plugins.writeEntry(QStringLiteral("mouseclickEnabled"), true);
+
+    QFETCH(QVariant, deferEffectLoading);
+    if (deferEffectLoading.isValid()) {
+        KConfigGroup compositing = config->group("Compositing");
+        compositing.writeEntry(QStringLiteral("DeferEffectLoading"), deferEffectLoading.toBool());
+    }
+    config->sync();
+    loader.setConfig(config);
+
+    qRegisterMetaType<KWin::Effect*>();
+    QSignalSpy spy(&loader, &KWin::BuiltInEffectLoader::effectLoaded);
+    connect(&loader, &KWin::BuiltInEffectLoader::effectLoaded,
+        [](KWin::Effect *effect) {
+            effect->deleteLater();
+        }
+    );
+
+    loader.queryAndLoadAll();
+    // let's use qWait as the effects are loaded from a queue, one at a time
+    QTest::qWait(100);
+
+    QFETCH(bool, deferred);
+    QStringList loadedEffects;
+    for (const QList<QVariant> &arguments : qAsConst(spy)) {
+        loadedEffects << arguments.at(1).toString();
+    }
+    std::sort(loadedEffects.begin(), loadedEffects.end());
+    if (deferred) {
+        QCOMPARE(loadedEffects, QStringList{QStringLiteral("mouseclick")});
+        QVERIFY(loader.findDeferredEffect(QStringLiteral("presentwindows")));
+
+        // clearing the loader cancels the deferred loading
+        loader.clear();
+        QVERIFY(!loader.findDeferredEffect(QStringLiteral("presentwindows")));
+    } else {
+        QCOMPARE(loadedEffects, (QStringList{QStringLiteral("mouseclick"), QStringLiteral("presentwindows")}));
+        QVERIFY(!loader.findDeferredEffect(QStringLiteral("presentwindows")));
+    }
+    QVERIFY(!loader.findDeferredEffect(QStringLiteral("mouseclick")));
+}
+
+void TestBuiltInEffectLoader::testDeferredTrigger()
+{
+    // This test verifies that the effect which replaces a stand-in gets the trigger that
+    // activated the stand-in.
+    QScopedPointer<MockEffectsHandler, QScopedPointerDeleteLater> mockHandler(new MockEffectsHandler(KWin::XRenderCompositing));
+    KWin::BuiltInEffectLoader loader;
+    KSharedConfig::Ptr config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    loader.setConfig(config);
+
+    QVERIFY(loader.loadEffect(KWin::BuiltInEffect::DesktopGrid, KWin::LoadEffectFlag::Load | KWin::LoadEffectFlag::Defer));
+    KWin::DeferredEffect *deferred = loader.findDeferredEffect(QStringLiteral("desktopgrid"));
+    QVERIFY(deferred);
+    QAction *deferredAction = deferred->findChild<QAction *>(QStringLiteral("ShowDesktopGrid"));
+    QVERIFY(deferredAction);
+
+    // the loader leaves loading the effect to the receiver of the signal
+    QSignalSpy activatedSpy(&loader, &KWin::BuiltInEffectLoader::deferredEffectActivated);
+    QVERIFY(activatedSpy.isValid());
+    connect(&loader, &KWin::BuiltInEffectLoader::deferredEffectActivated, &loader,
+        [&loader](const QString &name) {
+            loader.loadEffect(name);
+        }
+    );
+
+    int triggerCount = 0;
+    connect(&loader, &KWin::BuiltInEffectLoader::effectLoaded,
+        [&triggerCount](KWin::Effect *effect) {
+            QAction *action = effect->findChild<QAction *>(QStringLiteral("ShowDesktopGrid"));
+            QVERIFY(action);
+            // don't show the desktop grid, the mock effects handler can't paint it
+            disconnect(action, &QAction::triggered, effect, nullptr);
+            connect(action, &QAction::triggered, effect, [&triggerCount]() {
+                ++triggerCount;
+            });
+            effect->deleteLater();
+        }
+    );
+
+    deferredAction->trigger();
+    QVERIFY(activatedSpy.wait());
+    QCOMPARE(activatedSpy.first().at(0).toString(), QStringLiteral("desktopgrid"));
+    QVERIFY(!loader.findDeferredEffect(QStringLiteral("desktopgrid")));
+    QCOMPARE(triggerCount, 1);
+}
+
 Q_CONSTRUCTOR_FUNCTION(forceXcb)
 QTEST_MAIN(TestBuiltInEffectLoader)
 #include "test_builtin_effectloader.moc"
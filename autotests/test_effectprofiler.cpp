@@ -0,0 +1,256 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../effectprofiler.h"
+#include "mock_timestampqueries.h"
+
+#include <kwineffects.h>
+
+#include <QElapsedTimer>
+#include <QTest>
+#include <QThread>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class EffectProfilerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testNoFrame();
+    void testExclusiveTime();
+    void testRemoveEffect();
+    void testIdleEffectsExpire();
+    void testGpuTime();
+    void testGpuContextNotCurrent();
+    void testGpuContextLostDuringFrame();
+    void testGpuResultsPending();
+};
+
+static EffectProfiler::Cost findCost(const EffectProfiler &profiler, Effect *effect)
+{
+    const QVector<EffectProfiler::Cost> costs = profiler.costs();
+    for (const EffectProfiler::Cost &cost : costs) {
+        if (cost.effect == effect) {
+            return cost;
+        }
+    }
+    return EffectProfiler::Cost{nullptr, 0ns, 0ns};
+}
+
+// Paints a frame in which effect2 paints on behalf of effect1, the GPU takes 3ms for effect1
+// before and 2ms after effect2, which takes 5ms.
+static void paintNestedFrame(EffectProfiler &profiler, MockTimestampQueries *queries,
+                             Effect *effect1, Effect *effect2)
+{
+    profiler.beginFrame();
+    queries->advance(1ms);
+    {
+        EffectProfiler::Scope outer(&profiler, effect1, true);
+        queries->advance(3ms);
+        {
+            EffectProfiler::Scope inner(&profiler, effect2, true);
+            queries->advance(5ms);
+        }
+        queries->advance(2ms);
+    }
+    queries->advance(1ms);
+    profiler.endFrame();
+}
+
+void EffectProfilerTest::testNoFrame()
+{
+    Effect effect;
+    EffectProfiler profiler;
+    QVERIFY(!profiler.hasGpuTiming());
+
+    // hooks outside of a paint pass are not accounted
+    {
+        EffectProfiler::Scope scope(&profiler, &effect, false);
+    }
+    QVERIFY(profiler.costs().isEmpty());
+
+    // a null profiler is fine
+    EffectProfiler::Scope scope(nullptr, &effect, true);
+}
+
+void EffectProfilerTest::testExclusiveTime()
+{
+    Effect effect1;
+    Effect effect2;
+    EffectProfiler profiler;
+
+    QElapsedTimer timer;
+    timer.start();
+    profiler.beginFrame();
+    {
+        EffectProfiler::Scope outer(&profiler, &effect1, false);
+        QThread::msleep(2);
+        {
+            EffectProfiler::Scope inner(&profiler, &effect2, true);
+            QThread::msleep(5);
+        }
+    }
+    profiler.endFrame();
+    const std::chrono::nanoseconds elapsed(timer.nsecsElapsed());
+
+    const EffectProfiler::Cost cost1 = findCost(profiler, &effect1);
+    const EffectProfiler::Cost cost2 = findCost(profiler, &effect2);
+    QCOMPARE(cost1.effect, &effect1);
+    QCOMPARE(cost2.effect, &effect2);
+    QVERIFY(cost1.cpuTime >= 2ms);
+    QVERIFY(cost2.cpuTime >= 5ms);
+    // the time spent in the inner hook is not accounted to the outer one
+    QVERIFY(cost1.cpuTime + cost2.cpuTime <= elapsed);
+    QCOMPARE(cost1.gpuTime, 0ns);
+}
+
+void EffectProfilerTest::testRemoveEffect()
+{
+    Effect effect1;
+    Effect effect2;
+    EffectProfiler profiler;
+    profiler.beginFrame();
+    {
+        EffectProfiler::Scope scope1(&profiler, &effect1, false);
+    }
+    {
+        EffectProfiler::Scope scope2(&profiler, &effect2, false);
+    }
+    profiler.endFrame();
+    QCOMPARE(profiler.costs().count(), 2);
+
+    profiler.removeEffect(&effect1);
+    QCOMPARE(profiler.costs().count(), 1);
+    QCOMPARE(profiler.costs().first().effect, &effect2);
+}
+
+void EffectProfilerTest::testIdleEffectsExpire()
+{
+    Effect effect;
+    EffectProfiler profiler;
+    profiler.beginFrame();
+    {
+        EffectProfiler::Scope scope(&profiler, &effect, false);
+    }
+    profiler.endFrame();
+    QCOMPARE(profiler.costs().count(), 1);
+
+    // the effect stops painting
+    for (int i = 0; i < 100; ++i) {
+        profiler.beginFrame();
+        profiler.endFrame();
+    }
+    QVERIFY(profiler.costs().isEmpty());
+}
+
+void EffectProfilerTest::testGpuTime()
+{
+    Effect effect1;
+    Effect effect2;
+    auto queries = new MockTimestampQueries();
+    EffectProfiler profiler(queries);
+    QVERIFY(profiler.hasGpuTiming());
+
+    paintNestedFrame(profiler, queries, &effect1, &effect2);
+    // the results are only read back when the next frame starts
+    QCOMPARE(findCost(profiler, &effect1).gpuTime, 0ns);
+    QCOMPARE(queries->issuedCount(), 5);
+
+    profiler.beginFrame();
+    profiler.endFrame();
+    QCOMPARE(queries->issuedCount(), 0);
+    // the GPU time spent for the inner effect is not accounted to the outer one
+    QCOMPARE(findCost(profiler, &effect1).gpuTime, 5ms);
+    QCOMPARE(findCost(profiler, &effect2).gpuTime, 5ms);
+
+    // the costs are averaged over the paint passes
+    queries->setLatency(1ms);
+    paintNestedFrame(profiler, queries, &effect1, &effect2);
+    profiler.beginFrame();
+    {
+        EffectProfiler::Scope scope(&profiler, &effect2, true);
+        queries->advance(2ms);
+    }
+    profiler.endFrame();
+    QCOMPARE(findCost(profiler, &effect1).gpuTime, 5ms);
+    QCOMPARE(findCost(profiler, &effect2).gpuTime, 5ms);
+    profiler.beginFrame();
+    profiler.endFrame();
+    QCOMPARE(findCost(profiler, &effect2).gpuTime, 4ms);
+}
+
+void EffectProfilerTest::testGpuContextNotCurrent()
+{
+    Effect effect1;
+    Effect effect2;
+    auto queries = new MockTimestampQueries();
+    EffectProfiler profiler(queries);
+
+    // no queries are issued while another context is current
+    queries->setContextCurrent(false);
+    paintNestedFrame(profiler, queries, &effect1, &effect2);
+    QCOMPARE(queries->issuedCount(), 0);
+
+    queries->setContextCurrent(true);
+    profiler.beginFrame();
+    profiler.endFrame();
+    QCOMPARE(findCost(profiler, &effect1).effect, &effect1);
+    QCOMPARE(findCost(profiler, &effect1).gpuTime, 0ns);
+    QCOMPARE(findCost(profiler, &effect2).gpuTime, 0ns);
+}
+
+void EffectProfilerTest::testGpuContextLostDuringFrame()
+{
+    Effect effect;
+    auto queries = new MockTimestampQueries();
+    EffectProfiler profiler(queries);
+
+    profiler.beginFrame();
+    {
+        EffectProfiler::Scope scope(&profiler, &effect, true);
+        queries->advance(3ms);
+        // e.g. the effect renders a QtQuick scene
+        queries->setContextCurrent(false);
+    }
+    profiler.endFrame();
+    // the incomplete intervals are dropped
+    QCOMPARE(queries->issuedCount(), 0);
+
+    queries->setContextCurrent(true);
+    profiler.beginFrame();
+    profiler.endFrame();
+    QCOMPARE(findCost(profiler, &effect).gpuTime, 0ns);
+}
+
+void EffectProfilerTest::testGpuResultsPending()
+{
+    Effect effect1;
+    Effect effect2;
+    auto queries = new MockTimestampQueries();
+    EffectProfiler profiler(queries);
+
+    // the driver never reports the results, the queries must not pile up
+    queries->setResultsAvailable(false);
+    for (int i = 0; i < 100; ++i) {
+        paintNestedFrame(profiler, queries, &effect1, &effect2);
+    }
+    QVERIFY(queries->issuedCount() <= 10 * 5);
+    QCOMPARE(findCost(profiler, &effect1).gpuTime, 0ns);
+
+    // the painting never waits for the results
+    queries->setResultsAvailable(true);
+    profiler.beginFrame();
+    profiler.endFrame();
+    QCOMPARE(queries->issuedCount(), 0);
+    QCOMPARE(findCost(profiler, &effect1).gpuTime, 5ms);
+    QCOMPARE(findCost(profiler, &effect2).gpuTime, 5ms);
+}
+
+QTEST_GUILESS_MAIN(EffectProfilerTest)
+#include "test_effectprofiler.moc"
@@ -0,0 +1,295 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../frametracer.h"
+#include "../renderloop.h"
+#include "mock_timestampqueries.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class FrameTracerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testSelf();
+    void testFrame();
+    void testUnpaintedFrame();
+    void testPresentationFailed();
+    void testRingBuffer();
+    void testWrite();
+    void testRemoveRenderLoop();
+    void testGpuCompletion();
+    void testGpuContextNotCurrent();
+    void testGpuResultsPending();
+};
+
+static void paintFrame(FrameTracer &tracer, RenderLoop *renderLoop, bool pending, bool openGL = false)
+{
+    tracer.beginFrame(renderLoop, 1ms, 2ms);
+    tracer.damageCollected(renderLoop, 2);
+    tracer.beginPaint(renderLoop);
+    if (pending) {
+        tracer.framePending(renderLoop);
+    }
+    tracer.endPaint(renderLoop, openGL);
+}
+
+void FrameTracerTest::testSelf()
+{
+    QVERIFY(!FrameTracer::self());
+    {
+        FrameTracer tracer;
+        QCOMPARE(FrameTracer::self(), &tracer);
+    }
+    QVERIFY(!FrameTracer::self());
+}
+
+void FrameTracerTest::testFrame()
+{
+    RenderLoop renderLoop;
+    FrameTracer tracer;
+    QVERIFY(tracer.frames().isEmpty());
+
+    paintFrame(tracer, &renderLoop, true);
+    tracer.framePresented(&renderLoop, 3ms);
+
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QCOMPARE(frames.count(), 1);
+    const FrameTracer::Frame &frame = frames.first();
+    QCOMPARE(frame.sequence, quint64(1));
+    QVERIFY(frame.scheduled == 1ms);
+    QVERIFY(frame.expectedPresentation == 2ms);
+    QVERIFY(frame.begin <= frame.damageCollected);
+    QVERIFY(frame.damageCollected <= frame.paintBegin);
+    QVERIFY(frame.paintBegin <= frame.submitted);
+    QVERIFY(frame.submitted <= frame.paintEnd);
+    QVERIFY(frame.presented == 3ms);
+    QCOMPARE(frame.gpuCompleted, 0ns);
+    QCOMPARE(frame.damageRoundTrips, 2);
+    QVERIFY(!frame.failed);
+
+    // the presentation feedback is only used once
+    tracer.framePresented(&renderLoop, 4ms);
+    QVERIFY(tracer.frames().first().presented == 3ms);
+}
+
+void FrameTracerTest::testUnpaintedFrame()
+{
+    RenderLoop renderLoop;
+    FrameTracer tracer;
+
+    // nothing was damaged, the frame isn't painted
+    tracer.beginFrame(&renderLoop, 1ms, 2ms);
+    tracer.damageCollected(&renderLoop);
+    tracer.endPaint(&renderLoop, false);
+    QVERIFY(tracer.frames().isEmpty());
+
+    paintFrame(tracer, &renderLoop, false);
+    QCOMPARE(tracer.frames().count(), 1);
+    QCOMPARE(tracer.frames().first().submitted, 0ns);
+
+    // no frame is pending, the feedback is ignored
+    tracer.framePresented(&renderLoop, 3ms);
+    QCOMPARE(tracer.frames().first().presented, 0ns);
+}
+
+void FrameTracerTest::testPresentationFailed()
+{
+    RenderLoop renderLoop1;
+    RenderLoop renderLoop2;
+    FrameTracer tracer;
+    paintFrame(tracer, &renderLoop1, true);
+    paintFrame(tracer, &renderLoop2, true);
+
+    tracer.frameFailed(&renderLoop2);
+    tracer.framePresented(&renderLoop1, 3ms);
+
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QCOMPARE(frames.count(), 2);
+    QVERIFY(frames[0].presented == 3ms);
+    QVERIFY(!frames[0].failed);
+    QCOMPARE(frames[1].presented, 0ns);
+    QVERIFY(frames[1].failed);
+    QVERIFY(frames[0].track != frames[1].track);
+}
+
+void FrameTracerTest::testRingBuffer()
+{
+    RenderLoop renderLoop1;
+    RenderLoop renderLoop2;
+    FrameTracer tracer(2);
+    paintFrame(tracer, &renderLoop1, true);
+    paintFrame(tracer, &renderLoop2, false);
+    paintFrame(tracer, &renderLoop2, false);
+
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QCOMPARE(frames.count(), 2);
+    QCOMPARE(frames[0].sequence, quint64(2));
+    QCOMPARE(frames[1].sequence, quint64(3));
+
+    // the frame has been overwritten before it got presented
+    tracer.framePresented(&renderLoop1, 3ms);
+    for (const FrameTracer::Frame &frame : tracer.frames()) {
+        QCOMPARE(frame.presented, 0ns);
+    }
+}
+
+void FrameTracerTest::testWrite()
+{
+    RenderLoop renderLoop;
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    const QString fileName = directory.filePath(QStringLiteral("frames.json"));
+
+    FrameTracer tracer;
+    paintFrame(tracer, &renderLoop, true);
+    tracer.framePresented(&renderLoop, std::chrono::steady_clock::now().time_since_epoch());
+    QVERIFY(tracer.write(fileName, {{&renderLoop, QStringLiteral("DP-1")}}));
+
+    // the frames are kept
+    QCOMPARE(tracer.frames().count(), 1);
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QJsonArray events = QJsonDocument::fromJson(file.readAll()).object().value(QStringLiteral("traceEvents")).toArray();
+
+    QStringList names;
+    QStringList threadNames;
+    int roundTrips = -1;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("ph")).toString() == QLatin1String("M")) {
+            threadNames << event.value(QStringLiteral("args")).toObject().value(QStringLiteral("name")).toString();
+        } else {
+            names << event.value(QStringLiteral("name")).toString();
+        }
+        if (event.value(QStringLiteral("name")).toString() == QLatin1String("Damage collection")) {
+            roundTrips = event.value(QStringLiteral("args")).toObject().value(QStringLiteral("roundTrips")).toInt();
+        }
+    }
+    QCOMPARE(roundTrips, 2);
+    QCOMPARE(names, (QStringList{QStringLiteral("Scheduled"),
+                                 QStringLiteral("Frame 1"),
+                                 QStringLiteral("Damage collection"),
+                                 QStringLiteral("Paint"),
+                                 QStringLiteral("Waiting for presentation"),
+                                 QStringLiteral("Presented")}));
+    QCOMPARE(threadNames, (QStringList{QStringLiteral("DP-1 compositing"),
+                                       QStringLiteral("DP-1 GPU"),
+                                       QStringLiteral("DP-1 display")}));
+
+    QVERIFY(!tracer.write(directory.filePath(QStringLiteral("missing/frames.json")), {}));
+}
+
+void FrameTracerTest::testRemoveRenderLoop()
+{
+    FrameTracer tracer;
+    {
+        RenderLoop renderLoop;
+        paintFrame(tracer, &renderLoop, true);
+        tracer.beginFrame(&renderLoop, 1ms, 2ms);
+    }
+
+    // a new render loop at the same address, if any, gets a new track
+    RenderLoop renderLoop;
+    tracer.beginPaint(&renderLoop);
+    tracer.endPaint(&renderLoop, false);
+    QCOMPARE(tracer.frames().count(), 1);
+    paintFrame(tracer, &renderLoop, false);
+
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QCOMPARE(frames.count(), 2);
+    QVERIFY(frames[0].track != frames[1].track);
+    // the destroyed render loop won't present its frame anymore
+    tracer.framePresented(&renderLoop, 3ms);
+    QCOMPARE(tracer.frames().first().presented, 0ns);
+}
+
+void FrameTracerTest::testGpuCompletion()
+{
+    auto queries = new MockTimestampQueries();
+    queries->setLatency(4ms);
+    FrameTracer tracer(16, queries);
+    RenderLoop renderLoop;
+
+    // frames painted without OpenGL don't issue queries
+    paintFrame(tracer, &renderLoop, false);
+    QCOMPARE(queries->issuedCount(), 0);
+
+    paintFrame(tracer, &renderLoop, false, true);
+    QCOMPARE(queries->issuedCount(), 1);
+    QCOMPARE(tracer.frames().last().gpuCompleted, 0ns);
+
+    // the query is read back when the next frame is painted
+    queries->advance(16ms);
+    paintFrame(tracer, &renderLoop, false, true);
+    QCOMPARE(queries->issuedCount(), 1);
+
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QCOMPARE(frames.count(), 3);
+    // the GPU timestamp is mapped to the monotonic clock
+    QVERIFY(frames[1].gpuCompleted >= frames[1].paintEnd + 4ms);
+    QVERIFY(frames[1].gpuCompleted <= frames[2].paintEnd + 4ms);
+    QCOMPARE(frames[2].gpuCompleted, 0ns);
+}
+
+void FrameTracerTest::testGpuContextNotCurrent()
+{
+    auto queries = new MockTimestampQueries();
+    FrameTracer tracer(16, queries);
+    RenderLoop renderLoop;
+
+    paintFrame(tracer, &renderLoop, false, true);
+    QCOMPARE(queries->issuedCount(), 1);
+
+    // no queries are issued or read back while another context is current
+    queries->setContextCurrent(false);
+    paintFrame(tracer, &renderLoop, false, true);
+    QCOMPARE(queries->issuedCount(), 1);
+    QCOMPARE(tracer.frames().first().gpuCompleted, 0ns);
+
+    queries->setContextCurrent(true);
+    paintFrame(tracer, &renderLoop, false, true);
+    QCOMPARE(queries->issuedCount(), 1);
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QVERIFY(frames[0].gpuCompleted != 0ns);
+    QCOMPARE(frames[1].gpuCompleted, 0ns);
+}
+
+void FrameTracerTest::testGpuResultsPending()
+{
+    auto queries = new MockTimestampQueries();
+    FrameTracer tracer(4096, queries);
+    RenderLoop renderLoop;
+
+    // the driver never reports the results, the queries must not pile up
+    queries->setResultsAvailable(false);
+    for (int i = 0; i < 100; ++i) {
+        paintFrame(tracer, &renderLoop, false, true);
+    }
+    QVERIFY(queries->issuedCount() <= 16);
+
+    queries->setResultsAvailable(true);
+    paintFrame(tracer, &renderLoop, false, true);
+    QCOMPARE(queries->issuedCount(), 1);
+    // the frames whose queries have been dropped have no GPU completion
+    const QVector<FrameTracer::Frame> frames = tracer.frames();
+    QCOMPARE(frames.first().gpuCompleted, 0ns);
+    QVERIFY(frames[frames.count() - 2].gpuCompleted != 0ns);
+}
+
+QTEST_GUILESS_MAIN(FrameTracerTest)
+#include "test_frametracer.moc"
@@ -0,0 +1,76 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../renderjournal.h"
+
+#include <QTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class RenderJournalTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testStatistics();
+    void testRollingWindow();
+    void testEstimateIsConservative();
+};
+
+void RenderJournalTest::testEmpty()
+{
+    RenderJournal journal;
+    QCOMPARE(journal.count(), 0);
+    QCOMPARE(journal.minimum(), 0ns);
+    QCOMPARE(journal.maximum(), 0ns);
+    QCOMPARE(journal.average(), 0ns);
+    QCOMPARE(journal.estimate(), 0ns);
+}
+
+void RenderJournalTest::testStatistics()
+{
+    RenderJournal journal;
+    journal.add(2ms);
+    journal.add(4ms);
+    journal.add(6ms);
+    QCOMPARE(journal.count(), 3);
+    QCOMPARE(journal.minimum(), std::chrono::nanoseconds(2ms));
+    QCOMPARE(journal.maximum(), std::chrono::nanoseconds(6ms));
+    QCOMPARE(journal.average(), std::chrono::nanoseconds(4ms));
+
+    journal.clear();
+    QCOMPARE(journal.count(), 0);
+    QCOMPARE(journal.maximum(), 0ns);
+}
+
+void RenderJournalTest::testRollingWindow()
+{
+    RenderJournal journal(4);
+    journal.add(10ms);
+    for (int i = 0; i < 4; ++i) {
+        journal.add(1ms);
+    }
+    // the slow frame has left the history window
+    QCOMPARE(journal.count(), 4);
+    QCOMPARE(journal.maximum(), std::chrono::nanoseconds(1ms));
+}
+
+void RenderJournalTest::testEstimateIsConservative()
+{
+    RenderJournal journal;
+    journal.add(1ms);
+    journal.add(1ms);
+    journal.add(1ms);
+    journal.add(9ms);
+    QVERIFY(journal.estimate() > journal.average());
+    QVERIFY(journal.estimate() <= journal.maximum());
+}
+
+QTEST_GUILESS_MAIN(RenderJournalTest)
+#include "test_renderjournal.moc"
@@ -0,0 +1,104 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../startuptimeline.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QTest>
+
+Q_LOGGING_CATEGORY(KWIN_CORE, "kwin_core")
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class StartupTimelineTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void testTimeline();
+
+private:
+    QTemporaryDir m_directory;
+    QString m_fileName;
+};
+
+void StartupTimelineTest::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+    m_fileName = m_directory.filePath(QStringLiteral("startup.json"));
+    // the environment is read when the timeline is used for the first time
+    qputenv("KWIN_STARTUP_TRACE", m_fileName.toLocal8Bit());
+}
+
+void StartupTimelineTest::testTimeline()
+{
+    QVERIFY(StartupTimeline::isEnabled());
+
+    StartupTimeline::begin(QStringLiteral("Startup"));
+    {
+        StartupTimeline::Phase phase(QStringLiteral("Phase"));
+    }
+    StartupTimeline::begin(QStringLiteral("Async"));
+    StartupTimeline::end(QStringLiteral("Async"));
+    StartupTimeline::begin(QStringLiteral("Unfinished"));
+    StartupTimeline::end(QStringLiteral("Never begun"));
+    StartupTimeline::mark(QStringLiteral("Mark"));
+
+    // frames presented during the startup don't end the timeline
+    StartupTimeline::framePresented(1ms);
+    QVERIFY(StartupTimeline::isEnabled());
+    QVERIFY(!QFile::exists(m_fileName));
+
+    StartupTimeline::finishStartup();
+    StartupTimeline::framePresented(std::chrono::steady_clock::now().time_since_epoch());
+    QVERIFY(!StartupTimeline::isEnabled());
+
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QJsonArray events = QJsonDocument::fromJson(file.readAll()).object().value(QStringLiteral("traceEvents")).toArray();
+
+    QStringList names;
+    QStringList phases;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        names << event.value(QStringLiteral("name")).toString();
+        phases << event.value(QStringLiteral("ph")).toString();
+    }
+    QCOMPARE(names, (QStringList{QStringLiteral("Phase"),
+                                 QStringLiteral("Async"), QStringLiteral("Async"),
+                                 QStringLiteral("Mark"),
+                                 QStringLiteral("Startup"), QStringLiteral("Startup"),
+                                 QStringLiteral("First frame presented")}));
+    QCOMPARE(phases, (QStringList{QStringLiteral("X"),
+                                  QStringLiteral("b"), QStringLiteral("e"),
+                                  QStringLiteral("i"),
+                                  QStringLiteral("b"), QStringLiteral("e"),
+                                  QStringLiteral("i")}));
+
+    const QJsonObject startupBegin = events.at(4).toObject();
+    const QJsonObject startupEnd = events.at(5).toObject();
+    QVERIFY(startupBegin.value(QStringLiteral("ts")).toDouble() <= events.at(0).toObject().value(QStringLiteral("ts")).toDouble());
+    QVERIFY(startupBegin.value(QStringLiteral("ts")).toDouble() <= startupEnd.value(QStringLiteral("ts")).toDouble());
+    QVERIFY(events.at(0).toObject().contains(QStringLiteral("dur")));
+
+    // the timeline is written only once
+    file.close();
+    QVERIFY(file.remove());
+    StartupTimeline::mark(QStringLiteral("Too late"));
+    StartupTimeline::write();
+    QVERIFY(!QFile::exists(m_fileName));
+}
+
+QTEST_GUILESS_MAIN(StartupTimelineTest)
+#include "test_startuptimeline.moc"
@@ -8,17 +8,24 @@
 */
 #include "composite.h"
 
+#include "abstract_output.h"
 #include "dbusinterface.h"
 #include "x11client.h"
 #include "decorations/decoratedclient.h"
 #include "deleted.h"
 #include "effects.h"
+#include "frametracer.h"
+#include "input.h"
 #include "internal_client.h"
 #include "overlaywindow.h"
 #include "platform.h"
+#include "pointer_input.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
 #include "scene.h"
 #include "screens.h"
 #include "shadow.h"
+#include "startuptimeline.h"
 #include "unmanaged.h"
 #include "useractions.h"
 #include "utils.h"
@@ -44,7 +51,6 @@
 #include <QQuickWindow>
 #include <QtConcurrentRun>
 #include <QTextStream>
-#include <QTimerEvent>
 
 #include <xcb/composite.h>
 #include <xcb/damage.h>
@@ -104,19 +110,12 @@ private:
     bool m_owning;
 };
 
-static inline qint64 milliToNano(int milli) { return qint64(milli) * 1000 * 1000; }
-static inline qint64 nanoToMilli(int nano) { return nano / (1000*1000); }
-
 Compositor::Compositor(QObject* workspace)
     : QObject(workspace)
     , m_state(State::Off)
     , m_selectionOwner(nullptr)
-    , vBlankInterval(0)
-    , fpsInterval(0)
-    , m_timeSinceLastVBlank(0)
     , m_scene(nullptr)
     , m_bufferSwapPending(false)
-    , m_composeAtSwapCompletion(false)
 {
     connect(options, &Options::configChanged, this, &Compositor::configChanged);
     connect(options, &Options::animationSpeedChanged, this, &Compositor::configChanged);
@@ -181,6 +180,7 @@ bool Compositor::setupStart()
     }
     m_state = State::Starting;
 
+    StartupTimeline::Phase phase(QStringLiteral("Compositor::setupStart"));
     options->reloadCompositingSettings(true);
 
     initializeX11();
@@ -317,16 +317,26 @@ void Compositor::initializeX11()
 
     xcb_composite_redirect_subwindows(connection, kwinApp()->x11RootWindow(),
                                       XCB_COMPOSITE_REDIRECT_MANUAL);
+
+    if (m_damageRegion == XCB_NONE) {
+        m_damageRegion = xcb_generate_id(connection);
+        xcb_xfixes_create_region(connection, m_damageRegion, 0, nullptr);
+    }
 }
 
 void Compositor::cleanupX11()
 {
+    if (m_damageRegion != XCB_NONE) {
+        xcb_xfixes_destroy_region(kwinApp()->x11Connection(), m_damageRegion);
+        m_damageRegion = XCB_NONE;
+    }
     delete m_selectionOwner;
     m_selectionOwner = nullptr;
 }
 
 void Compositor::startupWithWorkspace()
 {
+    StartupTimeline::Phase phase(QStringLiteral("Compositor::startupWithWorkspace"));
     connect(kwinApp(), &Application::x11ConnectionChanged,
             this, &Compositor::initializeX11, Qt::UniqueConnection);
     connect(kwinApp(), &Application::x11ConnectionAboutToBeDestroyed,
@@ -336,20 +346,22 @@ void Compositor::startupWithWorkspace()
     Workspace::self()->markXStackingOrderAsDirty();
     Q_ASSERT(m_scene);
 
-    connect(workspace(), &Workspace::destroyed, this, [this] { compositeTimer.stop(); });
-    fpsInterval = options->maxFpsInterval();
-
-    if (m_scene->syncsToVBlank()) {
-        // If we do vsync, set the fps to the next multiple of the vblank rate.
-        vBlankInterval = milliToNano(1000) / currentRefreshRate();
-        fpsInterval = qMax((fpsInterval / vBlankInterval) * vBlankInterval, vBlankInterval);
-    } else {
-        // No vsync - DO NOT set "0", would cause div-by-zero segfaults.
-        vBlankInterval = milliToNano(1);
+    connect(kwinApp()->platform()->renderLoop(), &RenderLoop::frameRequested,
+            this, &Compositor::handleFrameRequested, Qt::UniqueConnection);
+    connect(kwinApp()->platform(), &Platform::outputAdded,
+            this, &Compositor::handleOutputAdded, Qt::UniqueConnection);
+    connect(kwinApp()->platform(), &Platform::outputRemoved,
+            this, &Compositor::handleOutputRemoved, Qt::UniqueConnection);
+    const auto outputs = kwinApp()->platform()->outputs();
+    for (AbstractOutput *output : outputs) {
+        handleOutputAdded(output);
     }
 
     // Sets also the 'effects' pointer.
-    kwinApp()->platform()->createEffectsHandler(this, m_scene);
+    {
+        StartupTimeline::Phase effectsPhase(QStringLiteral("Effects handler creation"));
+        kwinApp()->platform()->createEffectsHandler(this, m_scene);
+    }
     connect(Workspace::self(), &Workspace::deletedRemoved, m_scene, &Scene::removeToplevel);
     connect(effects, &EffectsHandler::screenGeometryChanged, this, &Compositor::addRepaintFull);
 
@@ -381,15 +393,96 @@ void Compositor::startupWithWorkspace()
         m_releaseSelectionTimer.stop();
     }
 
+    if (StartupTimeline::isEnabled()) {
+        const auto loops = renderLoops();
+        for (RenderLoop *renderLoop : loops) {
+            connect(renderLoop, &RenderLoop::framePresented, this,
+                    [](RenderLoop *, std::chrono::nanoseconds timestamp) {
+                        StartupTimeline::framePresented(timestamp);
+                    });
+        }
+    }
+
     // Render at least once.
     addRepaintFull();
-    performCompositing();
+}
+
+void Compositor::handleOutputAdded(AbstractOutput *output)
+{
+    // Outputs may share the render loop of the platform, in which case we are already connected.
+    connect(output->renderLoop(), &RenderLoop::frameRequested,
+            this, &Compositor::handleFrameRequested, Qt::UniqueConnection);
+}
+
+void Compositor::handleOutputRemoved(AbstractOutput *output)
+{
+    if (output->renderLoop() != kwinApp()->platform()->renderLoop()) {
+        m_repaints.remove(output->renderLoop());
+    }
+}
+
+QVector<RenderLoop *> Compositor::renderLoops() const
+{
+    Platform *platform = kwinApp()->platform();
+    if (!platform->isPerScreenRenderingEnabled()) {
+        return { platform->renderLoop() };
+    }
+
+    QVector<RenderLoop *> loops;
+    const auto outputs = platform->enabledOutputs();
+    for (AbstractOutput *output : outputs) {
+        if (!loops.contains(output->renderLoop())) {
+            loops.append(output->renderLoop());
+        }
+    }
+    return loops;
+}
+
+QVector<int> Compositor::screensForRenderLoop(RenderLoop *renderLoop) const
+{
+    Platform *platform = kwinApp()->platform();
+    if (!platform->isPerScreenRenderingEnabled()) {
+        if (renderLoop == platform->renderLoop()) {
+            return { -1 };
+        }
+        return {};
+    }
+
+    QVector<int> screenIds;
+    for (int screenId = 0; screenId < screens()->count(); ++screenId) {
+        const AbstractOutput *output = platform->findOutput(screenId);
+        if (output && output->renderLoop() == renderLoop) {
+            screenIds.append(screenId);
+        }
+    }
+    return screenIds;
 }
 
 void Compositor::scheduleRepaint()
 {
-    if (!compositeTimer.isActive())
-        setCompositeTimer();
+    if (m_state != State::On) {
+        return;
+    }
+    // Don't schedule a repaint if all outputs are disabled
+    if (!kwinApp()->platform()->areOutputsEnabled()) {
+        return;
+    }
+    const QVector<RenderLoop *> loops = renderLoops();
+    for (RenderLoop *renderLoop : loops) {
+        renderLoop->scheduleRepaint();
+    }
+}
+
+void Compositor::scheduleRepaint(AbstractOutput *output)
+{
+    if (m_state != State::On) {
+        return;
+    }
+    // Don't schedule a repaint if all outputs are disabled
+    if (!kwinApp()->platform()->areOutputsEnabled()) {
+        return;
+    }
+    output->renderLoop()->scheduleRepaint();
 }
 
 void Compositor::stop()
@@ -445,10 +538,15 @@ void Compositor::stop()
         }
     }
 
+    if (m_frameTracer) {
+        // The GPU queries belong to the OpenGL context of the scene.
+        m_scene->makeOpenGLContextCurrent();
+        m_frameTracer->releaseGpuResources();
+    }
+
     delete m_scene;
     m_scene = nullptr;
-    compositeTimer.stop();
-    repaints_region = QRegion();
+    m_repaints.clear();
 
     m_state = State::Off;
     emit compositingToggled(false);
@@ -531,20 +629,12 @@ void Compositor::reinitialize()
 
 void Compositor::addRepaint(int x, int y, int w, int h)
 {
-    if (m_state != State::On) {
-        return;
-    }
-    repaints_region += QRegion(x, y, w, h);
-    scheduleRepaint();
+    addRepaint(QRegion(x, y, w, h));
 }
 
 void Compositor::addRepaint(const QRect& r)
 {
-    if (m_state != State::On) {
-        return;
-    }
-    repaints_region += r;
-    scheduleRepaint();
+    addRepaint(QRegion(r));
 }
 
 void Compositor::addRepaint(const QRegion& r)
@@ -552,72 +642,152 @@ void Compositor::addRepaint(const QRegion& r)
     if (m_state != State::On) {
         return;
     }
-    repaints_region += r;
-    scheduleRepaint();
-}
-
-void Compositor::addRepaintFull()
-{
-    if (m_state != State::On) {
+    Platform *platform = kwinApp()->platform();
+    if (!platform->isPerScreenRenderingEnabled()) {
+        m_repaints[platform->renderLoop()] += r;
+        scheduleRepaint();
         return;
     }
-    const QSize &s = screens()->size();
-    repaints_region = QRegion(0, 0, s.width(), s.height());
-    scheduleRepaint();
+    // Only wake up the outputs that are actually affected by the repaint.
+    const auto outputs = platform->enabledOutputs();
+    for (AbstractOutput *output : outputs) {
+        const QRegion dirtyRegion = r & output->geometry();
+        if (!dirtyRegion.isEmpty()) {
+            m_repaints[output->renderLoop()] += dirtyRegion;
+            scheduleRepaint(output);
+        }
+    }
 }
 
-void Compositor::timerEvent(QTimerEvent *te)
+void Compositor::addRepaintFull()
 {
-    if (te->timerId() == compositeTimer.timerId()) {
-        performCompositing();
-    } else
-        QObject::timerEvent(te);
+    addRepaint(QRegion(QRect(QPoint(0, 0), screens()->size())));
 }
 
 void Compositor::aboutToSwapBuffers()
 {
+    // Backends that present several outputs with the same render loop, e.g. the nested
+    // Wayland backend, swap the buffers of each output but report the completion of the
+    // frame only once.
+    if (m_bufferSwapPending) {
+        return;
+    }
     m_bufferSwapPending = true;
+
+    RenderLoopPrivate::get(kwinApp()->platform()->renderLoop())->notifyFramePending();
 }
 
 void Compositor::bufferSwapComplete()
+{
+    bufferSwapComplete(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+void Compositor::bufferSwapComplete(std::chrono::nanoseconds timestamp)
 {
     Q_ASSERT(m_bufferSwapPending);
     m_bufferSwapPending = false;
 
+    // The render loop will dispatch a repaint request if one has been scheduled
+    // while the swap was pending.
+    RenderLoopPrivate::get(kwinApp()->platform()->renderLoop())->notifyFrameCompleted(timestamp);
+
     emit bufferSwapCompleted();
+}
+
+bool Compositor::isFrameTracingEnabled() const
+{
+    return !m_frameTracer.isNull();
+}
 
-    if (m_composeAtSwapCompletion) {
-        m_composeAtSwapCompletion = false;
-        performCompositing();
+void Compositor::setFrameTracingEnabled(bool enabled)
+{
+    if (isFrameTracingEnabled() == enabled) {
+        return;
+    }
+    if (enabled) {
+        m_frameTracer.reset(new FrameTracer());
+    } else {
+        // The GPU queries can only be deleted while the OpenGL context is current.
+        if (m_scene) {
+            m_scene->makeOpenGLContextCurrent();
+        }
+        m_frameTracer.reset();
+    }
+}
+
+bool Compositor::writeFrameTrace(const QString &fileName) const
+{
+    if (!m_frameTracer) {
+        return false;
+    }
+
+    QHash<RenderLoop *, QString> names;
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    if (kwinApp()->platform()->isPerScreenRenderingEnabled()) {
+        for (AbstractOutput *output : outputs) {
+            names.insert(output->renderLoop(), output->name());
+        }
+    } else {
+        names.insert(kwinApp()->platform()->renderLoop(), QStringLiteral("All outputs"));
+    }
+    return m_frameTracer->write(fileName, names);
+}
+
+void Compositor::handleFrameRequested(RenderLoop *renderLoop)
+{
+    if (m_state != State::On || !Workspace::self()) {
+        return;
     }
+    performCompositing(renderLoop);
 }
 
-void Compositor::performCompositing()
+void Compositor::performCompositing(RenderLoop *renderLoop)
 {
+    // Coalesced pointer motion waits for the next frame, the effects and the clients
+    // have to see it before the frame is painted.
+    if (input() && input()->pointer()) {
+        input()->pointer()->flushMotion();
+    }
+
     // If a buffer swap is still pending, we return to the event loop and
-    // continue processing events until the swap has completed.
+    // continue processing events until the swap has completed. The render
+    // loop will ask for a new frame once the pending one has been presented.
     if (m_bufferSwapPending) {
-        m_composeAtSwapCompletion = true;
-        compositeTimer.stop();
+        renderLoop->scheduleRepaint();
         return;
     }
 
     // If outputs are disabled, we return to the event loop and
     // continue processing events until the outputs are enabled again
     if (!kwinApp()->platform()->areOutputsEnabled()) {
-        compositeTimer.stop();
         return;
     }
 
+    // Each render loop repaints only the screens it is driving, the other ones
+    // are repainted independently when their own render loop fires.
+    const QVector<int> screenIds = screensForRenderLoop(renderLoop);
+    if (screenIds.isEmpty()) {
+        return;
+    }
+
+    FrameTracer *tracer = FrameTracer::self();
+    if (tracer) {
+        tracer->beginFrame(renderLoop, RenderLoopPrivate::get(renderLoop)->nextRenderTimestamp,
+                           renderLoop->nextPresentationTimestamp());
+    }
+
     // Create a list of all windows in the stacking order
     QList<Toplevel *> windows = Workspace::self()->xStackingOrder();
     QList<Toplevel *> damaged;
 
     // Reset the damage state of each window and fetch the damage region
     // without waiting for a reply
-    for (Toplevel *win : qAsConst(windows)) {
-        if (win->resetAndFetchDamage()) {
-            damaged << win;
+    {
+        Scene::StageTimer damageTimer(m_scene, Scene::Stage::DamageCollection);
+        for (Toplevel *win : qAsConst(windows)) {
+            if (win->resetAndFetchDamage(m_damageRegion)) {
+                damaged << win;
+            }
         }
     }
 
@@ -635,9 +805,8 @@ void Compositor::performCompositing()
         windows.append(t);
     }
 
-    // Get the replies
+    // Discard the cached lanczos textures while the replies are on their way
     for (Toplevel *win : qAsConst(damaged)) {
-        // Discard the cached lanczos texture
         if (win->effectWindow()) {
             const QVariant texture = win->effectWindow()->data(LanczosCacheRole);
             if (texture.isValid()) {
@@ -645,18 +814,30 @@ void Compositor::performCompositing()
                 win->effectWindow()->setData(LanczosCacheRole, QVariant());
             }
         }
+    }
 
-        win->getDamageRegionReply();
+    // Get the replies
+    int roundTrips = 0;
+    {
+        Scene::StageTimer damageTimer(m_scene, Scene::Stage::DamageCollection);
+        for (Toplevel *win : qAsConst(damaged)) {
+            if (win->getDamageRegionReply()) {
+                ++roundTrips;
+            }
+        }
+    }
+    m_scene->addToCounter(Scene::Counter::DamageRoundTrips, roundTrips);
+    if (tracer) {
+        tracer->damageCollected(renderLoop, roundTrips);
     }
 
-    if (repaints_region.isEmpty() && !windowRepaintsPending()) {
+    if (m_repaints.value(renderLoop).isEmpty() && !windowRepaintsPending(screenIds)) {
         m_scene->idle();
-        m_timeSinceLastVBlank = fpsInterval - (options->vBlankTime() + 1); // means "start now"
+        m_scene->finishFrameCounters();
         // Note: It would seem here we should undo suspended unredirect, but when scenes need
         // it for some reason, e.g. transformations or translucency, the next pass that does not
         // need this anymore and paints normally will also reset the suspended unredirect.
         // Otherwise the window would not be painted normally anyway.
-        compositeTimer.stop();
         return;
     }
 
@@ -677,22 +858,24 @@ void Compositor::performCompositing()
         }
     }
 
-    QRegion repaints = repaints_region;
     // clear all repaints, so that post-pass can add repaints for the next repaint
-    repaints_region = QRegion();
+    const QRegion repaints = m_repaints.take(renderLoop);
 
     if (m_framesToTestForSafety > 0 && (m_scene->compositingType() & OpenGLCompositing)) {
         kwinApp()->platform()->createOpenGLSafePoint(Platform::OpenGLSafePoint::PreFrame);
     }
-    m_renderTimer.start();
-    if (kwinApp()->platform()->isPerScreenRenderingEnabled()) {
-        for (int screenId = 0; screenId < screens()->count(); ++screenId) {
-            m_scene->paint(screenId, repaints, windows);
-        }
-    } else {
-        m_scene->paint(-1, repaints, windows);
+    if (tracer) {
+        tracer->beginPaint(renderLoop);
+    }
+    renderLoop->beginFrame();
+    for (int screenId : screenIds) {
+        m_scene->paint(screenId, repaints, windows);
+    }
+    renderLoop->endFrame();
+    m_scene->finishFrameCounters();
+    if (tracer) {
+        tracer->endPaint(renderLoop, m_scene->compositingType() & OpenGLCompositing);
     }
-    m_timeSinceLastVBlank = m_renderTimer.elapsed();
     if (m_framesToTestForSafety > 0) {
         if (m_scene->compositingType() & OpenGLCompositing) {
             kwinApp()->platform()->createOpenGLSafePoint(Platform::OpenGLSafePoint::PostFrame);
@@ -705,9 +888,26 @@ void Compositor::performCompositing()
     }
 
     if (waylandServer()) {
+        // Only throttle clients by the outputs they are shown on. Windows that are not
+        // visible on any output are sent frame callbacks by every render loop.
+        QRegion paintedArea;
+        QRegion screenArea;
+        if (kwinApp()->platform()->isPerScreenRenderingEnabled()) {
+            for (int screenId = 0; screenId < screens()->count(); ++screenId) {
+                screenArea += screens()->geometry(screenId);
+                if (screenIds.contains(screenId)) {
+                    paintedArea += screens()->geometry(screenId);
+                }
+            }
+        }
         const auto currentTime = static_cast<quint32>(m_monotonicClock.elapsed());
         for (Toplevel *win : qAsConst(windows)) {
-            if (auto surface = win->surface()) {
+            auto surface = win->surface();
+            if (!surface) {
+                continue;
+            }
+            const QRect rect = win->visibleRect();
+            if (screenArea.isEmpty() || paintedArea.intersects(rect) || !screenArea.intersects(rect)) {
                 surface->frameRendered(currentTime);
             }
         }
@@ -716,51 +916,50 @@ void Compositor::performCompositing()
         }
     }
 
-    // Stop here to ensure *we* cause the next repaint schedule - not some effect
-    // through m_scene->paint().
-    compositeTimer.stop();
-
     // Trigger at least one more pass even if there would be nothing to paint, so that scene->idle()
-    // is called the next time. If there would be nothing pending, it will not restart the timer and
-    // scheduleRepaint() would restart it again somewhen later, called from functions that
-    // would again add something pending.
-    if (m_bufferSwapPending && m_scene->syncsToVBlank()) {
-        m_composeAtSwapCompletion = true;
-    } else {
-        scheduleRepaint();
-    }
+    // is called the next time. If there would be nothing pending, it will not request another
+    // frame and scheduleRepaint() would restart it again somewhen later, called from functions
+    // that would again add something pending. If a buffer swap is pending, the render loop
+    // postpones the request until the frame has been presented.
+    renderLoop->scheduleRepaint();
+}
+
+static bool wantsRepaint(const Toplevel *toplevel, const QVector<int> &screenIds)
+{
+    return std::any_of(screenIds.begin(), screenIds.end(),
+                       [toplevel](int screenId) { return toplevel->wantsRepaint(screenId); });
 }
 
 template <class T>
-static bool repaintsPending(const QList<T*> &windows)
+static bool repaintsPending(const QList<T*> &windows, const QVector<int> &screenIds)
 {
     return std::any_of(windows.begin(), windows.end(),
-                       [](const T *t) { return t->wantsRepaint(); });
+                       [&screenIds](const T *t) { return wantsRepaint(t, screenIds); });
 }
 
-bool Compositor::windowRepaintsPending() const
+bool Compositor::windowRepaintsPending(const QVector<int> &screenIds) const
 {
-    if (repaintsPending(Workspace::self()->clientList())) {
+    if (repaintsPending(Workspace::self()->clientList(), screenIds)) {
         return true;
     }
-    if (repaintsPending(Workspace::self()->unmanagedList())) {
+    if (repaintsPending(Workspace::self()->unmanagedList(), screenIds)) {
         return true;
     }
-    if (repaintsPending(Workspace::self()->deletedList())) {
+    if (repaintsPending(Workspace::self()->deletedList(), screenIds)) {
         return true;
     }
     if (auto *server = waylandServer()) {
         const auto &clients = server->clients();
-        auto test = [](const AbstractClient *c) {
-            return c->readyForPainting() && c->wantsRepaint();
+        auto test = [&screenIds](const AbstractClient *c) {
+            return c->readyForPainting() && wantsRepaint(c, screenIds);
         };
         if (std::any_of(clients.begin(), clients.end(), test)) {
             return true;
         }
     }
     const auto &internalClients = workspace()->internalClients();
-    auto internalTest = [] (const InternalClient *client) {
-        return client->isShown(true) && client->wantsRepaint();
+    auto internalTest = [&screenIds] (const InternalClient *client) {
+        return client->isShown(true) && wantsRepaint(client, screenIds);
     };
     if (std::any_of(internalClients.begin(), internalClients.end(), internalTest)) {
         return true;
@@ -768,81 +967,6 @@ bool Compositor::windowRepaintsPending() const
     return false;
 }
 
-void Compositor::setCompositeTimer()
-{
-    if (m_state != State::On) {
-        return;
-    }
-
-    // Don't start the timer if we're waiting for a swap event
-    if (m_bufferSwapPending && m_composeAtSwapCompletion)
-        return;
-
-    // Don't start the timer if all outputs are disabled
-    if (!kwinApp()->platform()->areOutputsEnabled()) {
-        return;
-    }
-
-    uint waitTime = 1;
-
-    if (m_scene->blocksForRetrace()) {
-
-        // TODO: make vBlankTime dynamic?!
-        // It's required because glXWaitVideoSync will *likely* block a full frame if one enters
-        // a retrace pass which can last a variable amount of time, depending on the actual screen
-        // Now, my ooold 19" CRT can do such retrace so that 2ms are entirely sufficient,
-        // while another ooold 15" TFT requires about 6ms
-
-        qint64 padding = m_timeSinceLastVBlank;
-        if (padding > fpsInterval) {
-            // We're at low repaints or spent more time in painting than the user wanted to wait
-            // for that frame. Align to next vblank:
-            padding = vBlankInterval - (padding % vBlankInterval);
-        } else {
-            // Align to the next maxFps tick:
-            // "remaining time of the first vsync" + "time for the other vsyncs of the frame"
-            padding = ((vBlankInterval - padding % vBlankInterval) +
-                       (fpsInterval / vBlankInterval - 1) * vBlankInterval);
-        }
-
-        if (padding < options->vBlankTime()) {
-            // We'll likely miss this frame so we add one:
-            waitTime = nanoToMilli(padding + vBlankInterval - options->vBlankTime());
-        } else {
-            waitTime = nanoToMilli(padding - options->vBlankTime());
-        }
-    }
-    else { // w/o blocking vsync we just jump to the next demanded tick
-        if (fpsInterval > m_timeSinceLastVBlank) {
-            waitTime = nanoToMilli(fpsInterval - m_timeSinceLastVBlank);
-            if (!waitTime) {
-                // Will ensure we don't block out the eventloop - the system's just not faster ...
-                waitTime = 1;
-            }
-        }
-        /* else if (m_scene->syncsToVBlank() && m_timeSinceLastVBlank - fpsInterval < (vBlankInterval<<1)) {
-            // NOTICE - "for later" ------------------------------------------------------------------
-            // It can happen that we push two frames within one refresh cycle.
-            // Swapping will then block even with triple buffering when the GPU does not discard but
-            // queues frames
-            // now here's the mean part: if we take that as "OMG, we're late - next frame ASAP",
-            // there'll immediately be 2 frames in the pipe, swapping will block, we think we're
-            // late ... ewww
-            // so instead we pad to the clock again and add 2ms safety to ensure the pipe is really
-            // free
-            // NOTICE: obviously m_timeSinceLastVBlank can be too big because we're too slow as well
-            // So if this code was enabled, we'd needlessly half the framerate once more (15 instead of 30)
-            waitTime = nanoToMilli(vBlankInterval - (m_timeSinceLastVBlank - fpsInterval)%vBlankInterval) + 2;
-        }*/
-        else {
-            // "0" would be sufficient here, but the compositor isn't the WMs only task.
-            waitTime = 1;
-        }
-    }
-    // Force 4fps minimum:
-    compositeTimer.start(qMin(waitTime, 250u), this);
-}
-
 bool Compositor::isActive()
 {
     return m_state == State::On;
@@ -969,15 +1093,16 @@ void X11Compositor::start()
         return;
     }
     m_xrrRefreshRate = KWin::currentRefreshRate();
+    kwinApp()->platform()->renderLoop()->setRefreshRate(m_xrrRefreshRate * 1000);
     startupWithWorkspace();
 }
-void X11Compositor::performCompositing()
+void X11Compositor::performCompositing(RenderLoop *renderLoop)
 {
     if (scene()->usesOverlayWindow() && !isOverlayWindowVisible()) {
         // Return since nothing is visible.
         return;
     }
-    Compositor::performCompositing();
+    Compositor::performCompositing(renderLoop);
 }
 
 bool X11Compositor::checkForOverlayWindow(WId w) const
@@ -11,15 +11,24 @@
 
 #include <kwinglobals.h>
 
+#include <QHash>
 #include <QObject>
 #include <QElapsedTimer>
 #include <QTimer>
-#include <QBasicTimer>
 #include <QRegion>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <chrono>
+
+#include <xcb/xfixes.h>
 
 namespace KWin
 {
+class AbstractOutput;
 class CompositorSelectionOwner;
+class FrameTracer;
+class RenderLoop;
 class Scene;
 class X11Client;
 
@@ -45,22 +54,36 @@ public:
     void addRepaintFull();
 
     /**
-     * Schedules a new repaint if no repaint is currently scheduled.
+     * Schedules a new repaint on all outputs if no repaint is currently scheduled.
      */
     void scheduleRepaint();
+    /**
+     * Schedules a new repaint of the given @p output if no repaint is currently scheduled.
+     */
+    void scheduleRepaint(AbstractOutput *output);
 
     /**
      * Notifies the compositor that SwapBuffers() is about to be called.
      * Rendering of the next frame will be deferred until bufferSwapComplete()
-     * is called.
+     * is called. If several outputs are swapped for the same frame, a single
+     * bufferSwapComplete() completes all of them.
      */
     void aboutToSwapBuffers();
 
     /**
      * Notifies the compositor that a pending buffer swap has completed.
+     *
+     * The current time is used as the presentation timestamp. Prefer the overload
+     * taking the timestamp if the platform reports when the frame hit the screen.
      */
     void bufferSwapComplete();
 
+    /**
+     * Notifies the compositor that a pending buffer swap has completed and the frame
+     * has been presented at @p timestamp, sourced from the monotonic clock.
+     */
+    void bufferSwapComplete(std::chrono::nanoseconds timestamp);
+
     /**
      * Toggles compositing, that is if the Compositor is suspended it will be resumed
      * and if the Compositor is active it will be suspended.
@@ -94,6 +117,23 @@ public:
         return s_compositor != nullptr && s_compositor->isActive();
     }
 
+    /**
+     * Whether the timings of the frames are being recorded.
+     */
+    bool isFrameTracingEnabled() const;
+    /**
+     * Enables or disables recording the timings of the frames. The recorded frames are
+     * discarded when tracing is disabled.
+     */
+    void setFrameTracingEnabled(bool enabled);
+    /**
+     * Writes the timings of the recently recorded frames to @p fileName in the Chrome trace
+     * event format. Tracing continues afterwards.
+     *
+     * @returns @c false if tracing is disabled or the file could not be written
+     */
+    bool writeFrameTrace(const QString &fileName) const;
+
     // for delayed supportproperty management of effects
     void keepSupportProperty(xcb_atom_t atom);
     void removeSupportProperty(xcb_atom_t atom);
@@ -107,7 +147,6 @@ Q_SIGNALS:
 
 protected:
     explicit Compositor(QObject *parent = nullptr);
-    void timerEvent(QTimerEvent *te) override;
 
     virtual void start() = 0;
     void stop();
@@ -121,7 +160,7 @@ protected:
      * Continues the startup after Scene And Workspace are created
      */
     void startupWithWorkspace();
-    virtual void performCompositing();
+    virtual void performCompositing(RenderLoop *renderLoop);
 
     virtual void configChanged();
 
@@ -133,32 +172,33 @@ private:
     void initializeX11();
     void cleanupX11();
 
-    void setCompositeTimer();
-    bool windowRepaintsPending() const;
+    void handleFrameRequested(RenderLoop *renderLoop);
+    void handleOutputAdded(AbstractOutput *output);
+    void handleOutputRemoved(AbstractOutput *output);
+    bool windowRepaintsPending(const QVector<int> &screenIds) const;
+    QVector<int> screensForRenderLoop(RenderLoop *renderLoop) const;
+    QVector<RenderLoop *> renderLoops() const;
 
     void releaseCompositorSelection();
     void deleteUnusedSupportProperties();
 
     State m_state;
 
-    QBasicTimer compositeTimer;
     CompositorSelectionOwner *m_selectionOwner;
+    // The windows move their damage to this region in order to fetch it.
+    xcb_xfixes_region_t m_damageRegion = XCB_NONE;
     QTimer m_releaseSelectionTimer;
     QList<xcb_atom_t> m_unusedSupportProperties;
     QTimer m_unusedSupportPropertyTimer;
-    qint64 vBlankInterval, fpsInterval;
-    QRegion repaints_region;
-
-    qint64 m_timeSinceLastVBlank;
+    QHash<RenderLoop *, QRegion> m_repaints;
 
     Scene *m_scene;
 
     bool m_bufferSwapPending;
-    bool m_composeAtSwapCompletion;
 
     int m_framesToTestForSafety = 3;
-    QElapsedTimer m_renderTimer;
     QElapsedTimer m_monotonicClock;
+    QScopedPointer<FrameTracer> m_frameTracer;
 };
 
 class KWIN_EXPORT WaylandCompositor : public Compositor
@@ -249,7 +289,7 @@ public:
 
 protected:
     void start() override;
-    void performCompositing() override;
+    void performCompositing(RenderLoop *renderLoop) override;
 
 private:
     explicit X11Compositor(QObject *parent);
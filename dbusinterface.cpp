@@ -305,6 +305,21 @@ bool CompositorDBusInterface::platformRequiresCompositing() const
     return kwinApp()->platform()->requiresCompositing();
 }
 
+bool CompositorDBusInterface::isFrameTracingEnabled() const
+{
+    return m_compositor->isFrameTracingEnabled();
+}
+
+void CompositorDBusInterface::setFrameTracingEnabled(bool enabled)
+{
+    m_compositor->setFrameTracingEnabled(enabled);
+}
+
+bool CompositorDBusInterface::dumpFrameTrace(const QString &fileName)
+{
+    return m_compositor->writeFrameTrace(fileName);
+}
+
 void CompositorDBusInterface::resume()
 {
     if (kwinApp()->operationMode() == Application::OperationModeX11) {
@@ -113,6 +113,13 @@ class CompositorDBusInterface : public QObject
      */
     Q_PROPERTY(QStringList supportedOpenGLPlatformInterfaces READ supportedOpenGLPlatformInterfaces)
     Q_PROPERTY(bool platformRequiresCompositing READ platformRequiresCompositing)
+    /**
+     * @brief Whether the timings of the frames are being recorded.
+     *
+     * The most recent frames are kept, use dumpFrameTrace to save them. Disabling frame
+     * tracing discards the recorded frames.
+     */
+    Q_PROPERTY(bool frameTracingEnabled READ isFrameTracingEnabled WRITE setFrameTracingEnabled)
 public:
     explicit CompositorDBusInterface(Compositor *parent);
     ~CompositorDBusInterface() override = default;
@@ -124,6 +131,8 @@ public:
     QString compositingType() const;
     QStringList supportedOpenGLPlatformInterfaces() const;
     bool platformRequiresCompositing() const;
+    bool isFrameTracingEnabled() const;
+    void setFrameTracingEnabled(bool enabled);
 
 public Q_SLOTS:
     /**
@@ -161,6 +170,17 @@ public Q_SLOTS:
      * On signal Compositor reloads settings and restarts.
      */
     void reinitialize();
+    /**
+     * @brief Writes the timings of the recently recorded frames to @p fileName.
+     *
+     * The file uses the Chrome trace event format, it can be opened with chrome://tracing
+     * or Perfetto. Frame tracing continues after the trace has been written.
+     *
+     * @return bool @c true if the trace has been written, @c false if frame tracing is
+     * disabled or the file could not be written
+     * @see frameTracingEnabled
+     */
+    bool dumpFrameTrace(const QString &fileName);
 
 Q_SIGNALS:
     void compositingToggled(bool active);
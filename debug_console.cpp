@@ -8,6 +8,7 @@
 */
 #include "debug_console.h"
 #include "composite.h"
+#include "effects.h"
 #include "x11client.h"
 #include "input_event.h"
 #include "internal_client.h"
@@ -38,6 +39,8 @@
 #include <QMouseEvent>
 #include <QMetaProperty>
 #include <QMetaType>
+#include <QSortFilterProxyModel>
+#include <QTimer>
 
 // xkb
 #include <xkbcommon/xkbcommon.h>
@@ -578,6 +581,9 @@ DebugConsole::DebugConsole()
     if (!kwinApp()->usesLibinput()) {
         m_ui->tabWidget->setTabEnabled(3, false);
     }
+    if (!effects) {
+        m_ui->tabWidget->setTabEnabled(6, false);
+    }
 
     connect(m_ui->quitButton, &QAbstractButton::clicked, this, &DebugConsole::deleteLater);
     connect(m_ui->tabWidget, &QTabWidget::currentChanged, this,
@@ -591,6 +597,14 @@ DebugConsole::DebugConsole()
                 updateKeyboardTab();
                 connect(input(), &InputRedirection::keyStateChanged, this, &DebugConsole::updateKeyboardTab);
             }
+            // profiling the effects has a cost, only start once the tab is selected
+            if (index == 6 && !m_ui->effectCostsView->model()) {
+                QSortFilterProxyModel *proxy = new QSortFilterProxyModel(this);
+                proxy->setSourceModel(new EffectCostModel(this));
+                proxy->setSortRole(EffectCostModel::SortRole);
+                m_ui->effectCostsView->setModel(proxy);
+                m_ui->effectCostsView->sortByColumn(1, Qt::DescendingOrder);
+            }
         }
     );
 
@@ -1544,4 +1558,117 @@ void InputDeviceModel::setupDeviceConnections(LibInput::Device *device)
     );
 }
 
+EffectCostModel::EffectCostModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+    EffectsHandlerImpl *effectsHandler = static_cast<EffectsHandlerImpl *>(effects);
+    if (effectsHandler) {
+        m_profilingWasEnabled = effectsHandler->isProfilingEnabled();
+    }
+
+    QTimer *timer = new QTimer(this);
+    timer->setInterval(1000);
+    connect(timer, &QTimer::timeout, this, &EffectCostModel::update);
+    timer->start();
+    update();
+}
+
+EffectCostModel::~EffectCostModel()
+{
+    EffectsHandlerImpl *effectsHandler = static_cast<EffectsHandlerImpl *>(effects);
+    if (effectsHandler && !m_profilingWasEnabled) {
+        effectsHandler->setProfilingEnabled(false);
+    }
+}
+
+void EffectCostModel::update()
+{
+    beginResetModel();
+    m_costs.clear();
+    // The effects handler is recreated when compositing restarts, so enable profiling again.
+    if (EffectsHandlerImpl *effectsHandler = static_cast<EffectsHandlerImpl *>(effects)) {
+        effectsHandler->setProfilingEnabled(true);
+        const QVariantMap costs = effectsHandler->effectCosts();
+        for (auto it = costs.constBegin(); it != costs.constEnd(); ++it) {
+            const QVariantMap values = it.value().toMap();
+            m_costs.append(Cost{it.key(), values.value(QStringLiteral("cpuTime")), values.value(QStringLiteral("gpuTime"))});
+        }
+    }
+    endResetModel();
+}
+
+int EffectCostModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 3;
+}
+
+QVariant EffectCostModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18nc("The name of an effect", "Effect");
+    case 1:
+        return i18nc("Average CPU time spent by an effect per frame", "CPU (µsec)");
+    case 2:
+        return i18nc("Average GPU time spent by an effect per frame", "GPU (µsec)");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant EffectCostModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_costs.count()) {
+        return QVariant();
+    }
+    const Cost &cost = m_costs.at(index.row());
+    if (index.column() == 0) {
+        if (role == Qt::DisplayRole || role == SortRole) {
+            return cost.name;
+        }
+        return QVariant();
+    }
+
+    const QVariant &time = index.column() == 1 ? cost.cpuTime : cost.gpuTime;
+    if (role == SortRole) {
+        return time.isValid() ? time.toDouble() : -1.0;
+    }
+    if (role == Qt::DisplayRole) {
+        if (!time.isValid()) {
+            return i18nc("The GPU time of an effect can't be measured", "n/a");
+        }
+        return QString::number(time.toDouble(), 'f', 1);
+    }
+    if (role == Qt::TextAlignmentRole) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    return QVariant();
+}
+
+QModelIndex EffectCostModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column >= 3 || row >= m_costs.count()) {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+int EffectCostModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_costs.count();
+}
+
+QModelIndex EffectCostModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
 }
@@ -180,6 +180,40 @@ private:
     QVector<LibInput::Device*> m_devices;
 };
 
+/**
+ * Lists the average CPU and GPU time each effect spends per paint pass. Profiling of the
+ * effects is enabled for as long as the model exists.
+ */
+class EffectCostModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum {
+        SortRole = Qt::UserRole
+    };
+
+    explicit EffectCostModel(QObject *parent = nullptr);
+    ~EffectCostModel() override;
+
+    int columnCount(const QModelIndex &parent) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    QModelIndex index(int row, int column, const QModelIndex & parent) const override;
+    int rowCount(const QModelIndex &parent) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+
+private:
+    void update();
+
+    struct Cost {
+        QString name;
+        QVariant cpuTime;
+        QVariant gpuTime;
+    };
+    QVector<Cost> m_costs;
+    bool m_profilingWasEnabled = false;
+};
+
 }
 
 #endif
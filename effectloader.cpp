@@ -11,8 +11,10 @@
 // KWin
 #include <config-kwin.h>
 #include <kwineffects.h>
+#include "effects/deferredeffect.h"
 #include "effects/effect_builtins.h"
 #include "scripting/scriptedeffect.h"
+#include "startuptimeline.h"
 #include "utils.h"
 // KDE
 #include <KConfigGroup>
@@ -22,7 +24,9 @@
 // Qt
 #include <QtConcurrentRun>
 #include <QDebug>
+#include <QAction>
 #include <QFutureWatcher>
+#include <QPointer>
 #include <QStringList>
 
 namespace KWin
@@ -49,17 +53,31 @@ LoadEffectFlags AbstractEffectLoader::readConfig(const QString &effectName, bool
 
     const QString key = effectName + QStringLiteral("Enabled");
 
+    LoadEffectFlags flags;
     // do we have a key for the effect?
     if (plugins.hasKey(key)) {
         // we have a key in the config, so read the enabled state
-        const bool load = plugins.readEntry(key, defaultValue);
-        return load ? LoadEffectFlags(LoadEffectFlag::Load) : LoadEffectFlags();
+        if (plugins.readEntry(key, defaultValue)) {
+            flags = LoadEffectFlag::Load;
+        }
+    } else if (defaultValue) {
+        // we don't have a key, so we just use the enabled by default value
+        flags = LoadEffectFlag::Load | LoadEffectFlag::CheckDefaultFunction;
     }
-    // we don't have a key, so we just use the enabled by default value
-    if (defaultValue) {
-        return LoadEffectFlag::Load | LoadEffectFlag::CheckDefaultFunction;
+
+    if (flags.testFlag(LoadEffectFlag::Load)) {
+        const KConfigGroup compositing(m_config, QStringLiteral("Compositing"));
+        if (compositing.readEntry("DeferEffectLoading", false)) {
+            flags |= LoadEffectFlag::Defer;
+        }
     }
-    return LoadEffectFlags();
+    return flags;
+}
+
+DeferredEffect *AbstractEffectLoader::findDeferredEffect(const QString &name) const
+{
+    Q_UNUSED(name)
+    return nullptr;
 }
 
 BuiltInEffectLoader::BuiltInEffectLoader(QObject *parent)
@@ -70,6 +88,7 @@ BuiltInEffectLoader::BuiltInEffectLoader(QObject *parent)
 
 BuiltInEffectLoader::~BuiltInEffectLoader()
 {
+    clear();
 }
 
 bool BuiltInEffectLoader::hasEffect(const QString &name) const
@@ -143,6 +162,15 @@ bool BuiltInEffectLoader::loadEffect(const QString &name, BuiltInEffect effect,
         }
     }
 
+    if (flags.testFlag(LoadEffectFlag::Defer) && BuiltInEffects::hasTriggers(effect)) {
+        deferEffect(name, effect);
+        return true;
+    }
+    // the stand-in must release the triggers before the Effect registers them
+    delete m_deferredEffects.take(effect);
+
+    StartupTimeline::Phase phase(QStringLiteral("Load effect ") + name);
+
     // ok, now we can try to create the Effect
     Effect *e = BuiltInEffects::create(effect);
     if (!e) {
@@ -158,9 +186,78 @@ bool BuiltInEffectLoader::loadEffect(const QString &name, BuiltInEffect effect,
     );
     qCDebug(KWIN_CORE) << "Successfully loaded built-in effect: " << name;
     emit effectLoaded(e, name);
+    if (const auto forward = m_deferredTriggers.take(effect)) {
+        forward(e);
+    }
     return true;
 }
 
+void BuiltInEffectLoader::deferEffect(const QString &name, BuiltInEffect effect)
+{
+    if (m_deferredEffects.contains(effect)) {
+        return;
+    }
+
+    DeferredEffect *deferred = new DeferredEffect(effect);
+    m_deferredEffects.insert(effect, deferred);
+    connect(deferred, &DeferredEffect::destroyed, this,
+        [this, effect]() {
+            m_deferredEffects.remove(effect);
+        }
+    );
+    connect(deferred, &DeferredEffect::actionTriggered, this,
+        [this, name, effect](const QString &actionName) {
+            activateDeferredEffect(name, effect, [actionName](Effect *e) {
+                if (QAction *action = e->findChild<QAction *>(actionName)) {
+                    action->trigger();
+                }
+            });
+        }
+    );
+    connect(deferred, &DeferredEffect::borderTriggered, this,
+        [this, name, effect](ElectricBorder border) {
+            activateDeferredEffect(name, effect, [border](Effect *e) {
+                e->borderActivated(border);
+            });
+        }
+    );
+    connect(deferred, &DeferredEffect::propertyTriggered, this,
+        [this, name, effect](EffectWindow *window, long atom) {
+            QPointer<EffectWindow> guard(window);
+            const auto propertyNotify = BuiltInEffects::triggers(effect).propertyNotify;
+            activateDeferredEffect(name, effect, [guard, atom, propertyNotify](Effect *e) {
+                // The Effect wasn't listening yet when the property changed.
+                if (guard && propertyNotify) {
+                    propertyNotify(e, guard, atom);
+                }
+            });
+        }
+    );
+    qCDebug(KWIN_CORE) << "Deferred loading of built-in effect until first use: " << name;
+}
+
+void BuiltInEffectLoader::activateDeferredEffect(const QString &name, BuiltInEffect effect, std::function<void(Effect *)> forward)
+{
+    // The Effect replaces the stand-in, which can't be deleted while it's emitting.
+    QMetaObject::invokeMethod(this,
+        [this, name, effect, forward]() {
+            if (!m_deferredEffects.contains(effect)) {
+                return;
+            }
+            // Whoever loads the Effect, e.g. the EffectsHandler, has to prepare the compositor
+            // for it. The trigger is passed on once the Effect has been created.
+            m_deferredTriggers.insert(effect, forward);
+            emit deferredEffectActivated(name);
+            m_deferredTriggers.remove(effect);
+        }, Qt::QueuedConnection
+    );
+}
+
+DeferredEffect *BuiltInEffectLoader::findDeferredEffect(const QString &name) const
+{
+    return m_deferredEffects.value(BuiltInEffects::builtInForName(internalName(name)));
+}
+
 QString BuiltInEffectLoader::internalName(const QString& name) const
 {
     return name.toLower();
@@ -169,6 +266,10 @@ QString BuiltInEffectLoader::internalName(const QString& name) const
 void BuiltInEffectLoader::clear()
 {
     m_queue->clear();
+    // the stand-ins remove themselves from the map when they get destroyed
+    const auto deferredEffects = m_deferredEffects;
+    m_deferredEffects.clear();
+    qDeleteAll(deferredEffects);
 }
 
 static const QString s_nameProperty = QStringLiteral("X-KDE-PluginInfo-Name");
@@ -235,6 +336,7 @@ bool ScriptedEffectLoader::loadEffect(const KPluginMetaData &effect, LoadEffectF
         return false;
     }
 
+    StartupTimeline::Phase phase(QStringLiteral("Load effect ") + name);
     ScriptedEffect *e = ScriptedEffect::create(effect);
     if (!e) {
         qCDebug(KWIN_CORE) << "Could not initialize scripted effect: " << name;
@@ -413,6 +515,8 @@ bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags
         }
     }
 
+    StartupTimeline::Phase phase(QStringLiteral("Load effect ") + name);
+
     // ok, now we can try to create the Effect
     Effect *e = effectFactory->createEffect();
     if (!e) {
@@ -479,6 +583,7 @@ EffectLoader::EffectLoader(QObject *parent)
               << new PluginEffectLoader(this);
     for (auto it = m_loaders.constBegin(); it != m_loaders.constEnd(); ++it) {
         connect(*it, &AbstractEffectLoader::effectLoaded, this, &AbstractEffectLoader::effectLoaded);
+        connect(*it, &AbstractEffectLoader::deferredEffectActivated, this, &AbstractEffectLoader::deferredEffectActivated);
     }
 }
 
@@ -543,4 +648,14 @@ void EffectLoader::clear()
     }
 }
 
+DeferredEffect *EffectLoader::findDeferredEffect(const QString &name) const
+{
+    for (auto it = m_loaders.constBegin(); it != m_loaders.constEnd(); ++it) {
+        if (DeferredEffect *deferred = (*it)->findDeferredEffect(name)) {
+            return deferred;
+        }
+    }
+    return nullptr;
+}
+
 } // namespace KWin
@@ -19,8 +19,11 @@
 #include <QPair>
 #include <QQueue>
 
+#include <functional>
+
 namespace KWin
 {
+class DeferredEffect;
 class Effect;
 class EffectPluginFactory;
 enum class BuiltInEffect;
@@ -35,7 +38,8 @@ enum class BuiltInEffect;
  */
 enum class LoadEffectFlag {
     Load = 1 << 0, ///< Effect should be loaded
-    CheckDefaultFunction = 1 << 2 ///< The Check Default Function needs to be invoked if the Effect provides it
+    CheckDefaultFunction = 1 << 2, ///< The Check Default Function needs to be invoked if the Effect provides it
+    Defer = 1 << 3 ///< The Effect may be loaded on first use, if it declares what activates it
 };
 Q_DECLARE_FLAGS(LoadEffectFlags, LoadEffectFlag)
 
@@ -157,6 +161,15 @@ public:
      */
     virtual void clear() = 0;
 
+    /**
+     * @brief Returns the stand-in for the Effect with the given @p name if its loading has been
+     * deferred until first use, otherwise @c null.
+     *
+     * The Effect is loaded when the stand-in gets activated or loadEffect() is called. Deleting
+     * the stand-in cancels the loading.
+     */
+    virtual DeferredEffect *findDeferredEffect(const QString &name) const;
+
 Q_SIGNALS:
     /**
      * @brief The loader emits this signal when it successfully loaded an effect.
@@ -166,6 +179,16 @@ Q_SIGNALS:
      * @return void
      */
     void effectLoaded(KWin::Effect *effect, const QString &name);
+    /**
+     * @brief The loader emits this signal when the stand-in of the Effect with the given @p name
+     * got activated.
+     *
+     * The receiver is expected to load the Effect through loadEffect() right away. The loader
+     * then passes the trigger that activated the stand-in on to the loaded Effect.
+     *
+     * @param name The internal name of the Effect to load
+     */
+    void deferredEffectActivated(const QString &name);
 
 protected:
     explicit AbstractEffectLoader(QObject *parent = nullptr);
@@ -177,6 +200,9 @@ protected:
      * @p defaultValue determines whether the Effect should be loaded. A value of @c true means
      * that Load | CheckDefaultFunction is returned, in case of @c false no Load flags are returned.
      *
+     * If the Effect is going to be loaded and the key "DeferEffectLoading" in the group
+     * "Compositing" is @c true, the Defer flag is added as well.
+     *
      * @param effectName The name of the Effect to look for in the configuration
      * @param defaultValue Whether the Effect is enabled by default or not.
      * @returns Flags indicating whether the Effect should be loaded and how it should be loaded
@@ -279,12 +305,17 @@ public:
     void queryAndLoadAll() override;
     bool loadEffect(const QString& name) override;
     bool loadEffect(BuiltInEffect effect, LoadEffectFlags flags);
+    DeferredEffect *findDeferredEffect(const QString &name) const override;
 
 private:
     bool loadEffect(const QString &name, BuiltInEffect effect, LoadEffectFlags flags);
+    void deferEffect(const QString &name, BuiltInEffect effect);
+    void activateDeferredEffect(const QString &name, BuiltInEffect effect, std::function<void(Effect *)> forward);
     QString internalName(const QString &name) const;
     EffectLoadQueue<BuiltInEffectLoader, BuiltInEffect> *m_queue;
     QMap<BuiltInEffect, Effect*> m_loadedEffects;
+    QMap<BuiltInEffect, DeferredEffect*> m_deferredEffects;
+    QMap<BuiltInEffect, std::function<void(Effect *)>> m_deferredTriggers;
 };
 
 /**
@@ -355,6 +386,7 @@ public:
     void queryAndLoadAll() override;
     void setConfig(KSharedConfig::Ptr config) override;
     void clear() override;
+    DeferredEffect *findDeferredEffect(const QString &name) const override;
 
 private:
     QList<AbstractEffectLoader*> m_loaders;
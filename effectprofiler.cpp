@@ -0,0 +1,211 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "effectprofiler.h"
+#include "timestampqueries.h"
+
+namespace KWin
+{
+
+// The number of paint passes the costs are averaged over, about a second of animation.
+static const int s_historySize = 60;
+// The number of paint passes whose queries may be in flight before the oldest are dropped.
+static const int s_maxPendingFrames = 8;
+
+EffectProfiler::Statistics::Statistics()
+    : cpu(s_historySize)
+    , gpu(s_historySize)
+{
+}
+
+EffectProfiler::EffectProfiler(TimestampQueries *queries)
+    : m_queries(queries)
+{
+}
+
+EffectProfiler::~EffectProfiler() = default;
+
+bool EffectProfiler::hasGpuTiming() const
+{
+    return bool(m_queries);
+}
+
+void EffectProfiler::beginFrame()
+{
+    if (m_inFrame) {
+        endFrame();
+    }
+
+    m_inFrame = true;
+    m_frameCount++;
+    m_stack.clear();
+    m_gpuStack.clear();
+    m_frameCpuTimes.clear();
+    m_lastSwitch = std::chrono::steady_clock::now();
+
+    // Queries can only be issued while their OpenGL context is current.
+    m_gpuFrame = m_queries && m_queries->isContextCurrent();
+    if (m_gpuFrame) {
+        resolveQueries();
+        // Marks the start of the first interval, which belongs to the compositor.
+        addQuery(nullptr);
+    }
+}
+
+void EffectProfiler::endFrame()
+{
+    if (!m_inFrame) {
+        return;
+    }
+    m_inFrame = false;
+
+    for (auto it = m_frameCpuTimes.constBegin(); it != m_frameCpuTimes.constEnd(); ++it) {
+        Statistics &statistics = m_statistics[it.key()];
+        statistics.cpu.add(it.value());
+        statistics.lastFrame = m_frameCount;
+    }
+
+    if (m_gpuFrame && m_frameSamples.count() > 1) {
+        m_pendingFrames.enqueue(m_frameSamples);
+        m_frameSamples.clear();
+    } else {
+        dropFrameQueries();
+    }
+    m_gpuFrame = false;
+
+    // Don't let the queries pile up if the driver never reports them as available.
+    while (m_pendingFrames.count() > s_maxPendingFrames) {
+        const QVector<Sample> samples = m_pendingFrames.dequeue();
+        for (const Sample &sample : samples) {
+            m_queries->release(sample.query);
+        }
+    }
+}
+
+void EffectProfiler::enter(Effect *effect, bool gpu)
+{
+    if (!m_inFrame) {
+        return;
+    }
+    switchCpuOwner();
+    m_stack.append(Entry{effect, gpu});
+
+    if (gpu && m_gpuFrame) {
+        addQuery(m_gpuStack.isEmpty() ? nullptr : m_gpuStack.last());
+        m_gpuStack.append(effect);
+    }
+}
+
+void EffectProfiler::leave()
+{
+    if (!m_inFrame || m_stack.isEmpty()) {
+        return;
+    }
+    switchCpuOwner();
+    const Entry entry = m_stack.takeLast();
+
+    if (entry.gpu && m_gpuFrame) {
+        addQuery(m_gpuStack.takeLast());
+    }
+}
+
+void EffectProfiler::removeEffect(Effect *effect)
+{
+    m_statistics.remove(effect);
+    m_frameCpuTimes.remove(effect);
+
+    auto forget = [effect](QVector<Sample> &samples) {
+        for (Sample &sample : samples) {
+            if (sample.effect == effect) {
+                sample.effect = nullptr;
+            }
+        }
+    };
+    forget(m_frameSamples);
+    for (QVector<Sample> &samples : m_pendingFrames) {
+        forget(samples);
+    }
+}
+
+QVector<EffectProfiler::Cost> EffectProfiler::costs() const
+{
+    QVector<Cost> costs;
+    costs.reserve(m_statistics.count());
+    for (auto it = m_statistics.constBegin(); it != m_statistics.constEnd(); ++it) {
+        if (m_frameCount - it->lastFrame > s_historySize) {
+            // The effect hasn't been painting for a while.
+            continue;
+        }
+        costs.append(Cost{it.key(), it->cpu.average(), it->gpu.average()});
+    }
+    return costs;
+}
+
+void EffectProfiler::switchCpuOwner()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!m_stack.isEmpty() && m_stack.last().effect) {
+        m_frameCpuTimes[m_stack.last().effect] += now - m_lastSwitch;
+    }
+    m_lastSwitch = now;
+}
+
+void EffectProfiler::addQuery(Effect *owner)
+{
+    const uint query = m_queries->issue();
+    if (!query) {
+        // Another context has been made current, the intervals of this frame are lost.
+        dropFrameQueries();
+        m_gpuFrame = false;
+        return;
+    }
+    m_frameSamples.append(Sample{owner, query});
+}
+
+void EffectProfiler::dropFrameQueries()
+{
+    for (const Sample &sample : qAsConst(m_frameSamples)) {
+        m_queries->release(sample.query);
+    }
+    m_frameSamples.clear();
+}
+
+void EffectProfiler::resolveQueries()
+{
+    while (!m_pendingFrames.isEmpty()) {
+        const QVector<Sample> samples = m_pendingFrames.head();
+
+        // The timestamps are written in order, so all of them are available once the last is.
+        if (!m_queries->isAvailable(samples.last().query)) {
+            return;
+        }
+        m_pendingFrames.dequeue();
+
+        QHash<Effect *, std::chrono::nanoseconds> gpuTimes;
+        std::chrono::nanoseconds previous = m_queries->result(samples.first().query);
+        for (int i = 1; i < samples.count(); ++i) {
+            const std::chrono::nanoseconds timestamp = m_queries->result(samples[i].query);
+            if (samples[i].effect) {
+                gpuTimes[samples[i].effect] += qMax(timestamp, previous) - previous;
+            }
+            previous = timestamp;
+        }
+        for (const Sample &sample : samples) {
+            m_queries->release(sample.query);
+        }
+
+        for (auto it = gpuTimes.constBegin(); it != gpuTimes.constEnd(); ++it) {
+            auto statistics = m_statistics.find(it.key());
+            if (statistics != m_statistics.end()) {
+                statistics->gpu.add(it.value());
+            }
+        }
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,136 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include "renderjournal.h"
+
+#include <QHash>
+#include <QQueue>
+#include <QVector>
+
+#include <chrono>
+#include <memory>
+
+namespace KWin
+{
+
+class Effect;
+class TimestampQueries;
+
+/**
+ * The EffectProfiler class measures how much CPU and GPU time the effects spend in the
+ * paint chain.
+ *
+ * The time spent in a hook is only accounted to the effect that implements it, not to the
+ * effects it calls further down the chain. The GPU time is measured with timestamp queries
+ * placed at the boundaries of the hooks that paint. The queries are read back a few frames
+ * later so painting never waits for the GPU. No GPU time is measured in paint passes that
+ * run while the OpenGL context of the queries is not current.
+ *
+ * The reported costs are averaged over the last few paint passes an effect took part in.
+ */
+class KWIN_EXPORT EffectProfiler
+{
+public:
+    struct Cost
+    {
+        Effect *effect;
+        std::chrono::nanoseconds cpuTime;
+        std::chrono::nanoseconds gpuTime;
+    };
+
+    /**
+     * Accounts the time spent while the Scope is alive to @p effect. If @p effect is @c null,
+     * the time is accounted to the compositor. Set @p gpu for the hooks that paint. The
+     * Scope does nothing if @p profiler is @c null.
+     */
+    class Scope
+    {
+    public:
+        Scope(EffectProfiler *profiler, Effect *effect, bool gpu)
+            : m_profiler(profiler)
+        {
+            if (m_profiler) {
+                m_profiler->enter(effect, gpu);
+            }
+        }
+        ~Scope()
+        {
+            if (m_profiler) {
+                m_profiler->leave();
+            }
+        }
+
+    private:
+        EffectProfiler *m_profiler;
+    };
+
+    /**
+     * Creates a profiler that measures the GPU time with @p queries, if any. The profiler
+     * takes the ownership of the queries.
+     */
+    explicit EffectProfiler(TimestampQueries *queries = nullptr);
+    ~EffectProfiler();
+
+    bool hasGpuTiming() const;
+
+    void beginFrame();
+    void endFrame();
+
+    void enter(Effect *effect, bool gpu);
+    void leave();
+
+    /**
+     * Forgets about @p effect, which is about to be destroyed.
+     */
+    void removeEffect(Effect *effect);
+
+    /**
+     * Returns the average cost of each effect that has been painting recently.
+     */
+    QVector<Cost> costs() const;
+
+private:
+    struct Entry
+    {
+        Effect *effect;
+        bool gpu;
+    };
+    struct Sample
+    {
+        Effect *effect; ///< The effect that owned the GPU up to the query
+        uint query;
+    };
+    struct Statistics
+    {
+        Statistics();
+        RenderJournal cpu;
+        RenderJournal gpu;
+        qint64 lastFrame = 0;
+    };
+
+    void switchCpuOwner();
+    void addQuery(Effect *owner);
+    void dropFrameQueries();
+    void resolveQueries();
+
+    std::unique_ptr<TimestampQueries> m_queries;
+    bool m_inFrame = false;
+    bool m_gpuFrame = false;
+    qint64 m_frameCount = 0;
+    QVector<Entry> m_stack;
+    QVector<Effect *> m_gpuStack;
+    std::chrono::steady_clock::time_point m_lastSwitch;
+    QHash<Effect *, std::chrono::nanoseconds> m_frameCpuTimes;
+    QVector<Sample> m_frameSamples;
+    QQueue<QVector<Sample>> m_pendingFrames;
+    QHash<Effect *, Statistics> m_statistics;
+};
+
+} // namespace KWin
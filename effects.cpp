@@ -12,6 +12,8 @@
 
 #include "effectsadaptor.h"
 #include "effectloader.h"
+#include "effectprofiler.h"
+#include "effects/deferredeffect.h"
 #ifdef KWIN_BUILD_ACTIVITIES
 #include "activities.h"
 #endif
@@ -31,6 +33,7 @@
 #include "screens.h"
 #include "screenlockerwatcher.h"
 #include "thumbnailitem.h"
+#include "timestampqueries.h"
 #include "virtualdesktops.h"
 #include "window_property_notify_x11_filter.h"
 #include "workspace.h"
@@ -125,6 +128,7 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
             effectsChanged();
         }
     );
+    connect(m_effectLoader, &AbstractEffectLoader::deferredEffectActivated, this, &EffectsHandlerImpl::loadEffect);
     m_effectLoader->setConfig(kwinApp()->config());
     new EffectsAdaptor(this);
     QDBusConnection dbus = QDBusConnection::sessionBus();
@@ -257,6 +261,7 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
 EffectsHandlerImpl::~EffectsHandlerImpl()
 {
     unloadAllEffects();
+    setProfilingEnabled(false);
 }
 
 void EffectsHandlerImpl::unloadAllEffects()
@@ -366,6 +371,7 @@ void EffectsHandlerImpl::reconfigure()
 void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData& data, int time)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintScreenIterator, false);
         (*m_currentPaintScreenIterator++)->prePaintScreen(data, time);
         --m_currentPaintScreenIterator;
     }
@@ -375,10 +381,13 @@ void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData& data, int time)
 void EffectsHandlerImpl::paintScreen(int mask, const QRegion &region, ScreenPaintData& data)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintScreenIterator, true);
         (*m_currentPaintScreenIterator++)->paintScreen(mask, region, data);
         --m_currentPaintScreenIterator;
-    } else
+    } else {
+        EffectProfiler::Scope scope(m_profiler.get(), nullptr, true);
         m_scene->finalPaintScreen(mask, region, data);
+    }
 }
 
 void EffectsHandlerImpl::paintDesktop(int desktop, int mask, QRegion region, ScreenPaintData &data)
@@ -388,6 +397,8 @@ void EffectsHandlerImpl::paintDesktop(int desktop, int mask, QRegion region, Scr
     }
     m_currentRenderedDesktop = desktop;
     m_desktopRendering = true;
+    // the effects painting the desktop account for themselves, the rest is the compositor's
+    EffectProfiler::Scope scope(m_profiler.get(), nullptr, true);
     // save the paint screen iterator
     EffectsIterator savedIterator = m_currentPaintScreenIterator;
     m_currentPaintScreenIterator = m_activeEffects.constBegin();
@@ -400,6 +411,7 @@ void EffectsHandlerImpl::paintDesktop(int desktop, int mask, QRegion region, Scr
 void EffectsHandlerImpl::postPaintScreen()
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintScreenIterator, false);
         (*m_currentPaintScreenIterator++)->postPaintScreen();
         --m_currentPaintScreenIterator;
     }
@@ -409,6 +421,7 @@ void EffectsHandlerImpl::postPaintScreen()
 void EffectsHandlerImpl::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int time)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintWindowIterator, false);
         (*m_currentPaintWindowIterator++)->prePaintWindow(w, data, time);
         --m_currentPaintWindowIterator;
     }
@@ -418,18 +431,23 @@ void EffectsHandlerImpl::prePaintWindow(EffectWindow* w, WindowPrePaintData& dat
 void EffectsHandlerImpl::paintWindow(EffectWindow* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintWindowIterator, true);
         (*m_currentPaintWindowIterator++)->paintWindow(w, mask, region, data);
         --m_currentPaintWindowIterator;
-    } else
+    } else {
+        EffectProfiler::Scope scope(m_profiler.get(), nullptr, true);
         m_scene->finalPaintWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+    }
 }
 
 void EffectsHandlerImpl::paintEffectFrame(EffectFrame* frame, const QRegion &region, double opacity, double frameOpacity)
 {
     if (m_currentPaintEffectFrameIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintEffectFrameIterator, true);
         (*m_currentPaintEffectFrameIterator++)->paintEffectFrame(frame, region, opacity, frameOpacity);
         --m_currentPaintEffectFrameIterator;
     } else {
+        EffectProfiler::Scope scope(m_profiler.get(), nullptr, true);
         const EffectFrameImpl* frameImpl = static_cast<const EffectFrameImpl*>(frame);
         frameImpl->finalRender(region, opacity, frameOpacity);
     }
@@ -438,6 +456,7 @@ void EffectsHandlerImpl::paintEffectFrame(EffectFrame* frame, const QRegion &reg
 void EffectsHandlerImpl::postPaintWindow(EffectWindow* w)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentPaintWindowIterator, false);
         (*m_currentPaintWindowIterator++)->postPaintWindow(w);
         --m_currentPaintWindowIterator;
     }
@@ -455,10 +474,13 @@ Effect *EffectsHandlerImpl::provides(Effect::Feature ef)
 void EffectsHandlerImpl::drawWindow(EffectWindow* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (m_currentDrawWindowIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentDrawWindowIterator, true);
         (*m_currentDrawWindowIterator++)->drawWindow(w, mask, region, data);
         --m_currentDrawWindowIterator;
-    } else
+    } else {
+        EffectProfiler::Scope scope(m_profiler.get(), nullptr, true);
         m_scene->finalDrawWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+    }
 }
 
 void EffectsHandlerImpl::buildQuads(EffectWindow* w, WindowQuadList& quadList)
@@ -469,6 +491,7 @@ void EffectsHandlerImpl::buildQuads(EffectWindow* w, WindowQuadList& quadList)
         initIterator = false;
     }
     if (m_currentBuildQuadsIterator != m_activeEffects.constEnd()) {
+        EffectProfiler::Scope scope(m_profiler.get(), *m_currentBuildQuadsIterator, false);
         (*m_currentBuildQuadsIterator++)->buildQuads(w, quadList);
         --m_currentBuildQuadsIterator;
     }
@@ -491,6 +514,13 @@ bool EffectsHandlerImpl::decorationSupportsBlurBehind() const
     return Decoration::DecorationBridge::self()->needsBlur();
 }
 
+bool EffectsHandlerImpl::blocksDirectScanout() const
+{
+    return std::any_of(loaded_effects.constBegin(), loaded_effects.constEnd(), [](const EffectPair &pair) {
+        return pair.second->isActive() && pair.second->blocksDirectScanout();
+    });
+}
+
 // start another painting pass
 void EffectsHandlerImpl::startPaint()
 {
@@ -505,6 +535,62 @@ void EffectsHandlerImpl::startPaint()
     m_currentPaintWindowIterator = m_activeEffects.constBegin();
     m_currentPaintScreenIterator = m_activeEffects.constBegin();
     m_currentPaintEffectFrameIterator = m_activeEffects.constBegin();
+
+    if (m_profiler) {
+        m_profiler->beginFrame();
+    }
+}
+
+void EffectsHandlerImpl::finishPaint()
+{
+    if (m_profiler) {
+        m_profiler->endFrame();
+    }
+}
+
+bool EffectsHandlerImpl::isProfilingEnabled() const
+{
+    return bool(m_profiler);
+}
+
+void EffectsHandlerImpl::setProfilingEnabled(bool enabled)
+{
+    if (isProfilingEnabled() == enabled) {
+        return;
+    }
+    // The profiler creates and destroys GL queries.
+    makeOpenGLContextCurrent();
+    if (enabled) {
+        m_profiler.reset(new EffectProfiler(isOpenGLCompositing() ? TimestampQueries::create() : nullptr));
+    } else {
+        m_profiler.reset();
+    }
+}
+
+QVariantMap EffectsHandlerImpl::effectCosts() const
+{
+    QVariantMap costs;
+    if (!m_profiler) {
+        return costs;
+    }
+    const QVector<EffectProfiler::Cost> profile = m_profiler->costs();
+    for (const EffectProfiler::Cost &cost : profile) {
+        auto it = std::find_if(loaded_effects.constBegin(), loaded_effects.constEnd(),
+            [&cost](const EffectPair &pair) {
+                return pair.second == cost.effect;
+            }
+        );
+        if (it == loaded_effects.constEnd()) {
+            continue;
+        }
+        QVariantMap values;
+        values.insert(QStringLiteral("cpuTime"), std::chrono::duration<double, std::micro>(cost.cpuTime).count());
+        if (m_profiler->hasGpuTiming()) {
+            values.insert(QStringLiteral("gpuTime"), std::chrono::duration<double, std::micro>(cost.gpuTime).count());
+        }
+        costs.insert(it->first, values);
+    }
+    return costs;
 }
 
 void EffectsHandlerImpl::slotClientMaximized(KWin::AbstractClient *c, MaximizeMode maxMode)
@@ -770,6 +856,11 @@ void EffectsHandlerImpl::registerTouchpadSwipeShortcut(SwipeDirection direction,
 
 void* EffectsHandlerImpl::getProxy(QString name)
 {
+    // Asking for the proxy is a use of the effect.
+    if (m_effectLoader->findDeferredEffect(name)) {
+        loadEffect(name);
+    }
+
     for (QVector< EffectPair >::const_iterator it = loaded_effects.constBegin(); it != loaded_effects.constEnd(); ++it)
         if ((*it).first == name)
             return (*it).second->proxy();
@@ -1389,6 +1480,11 @@ void EffectsHandlerImpl::unloadEffect(const QString& name)
         }
     );
     if (it == effect_order.end()) {
+        if (DeferredEffect *deferred = m_effectLoader->findDeferredEffect(name)) {
+            qCDebug(KWIN_CORE) << "EffectsHandler::unloadEffect : Cancelling deferred Effect :" << name;
+            delete deferred;
+            return;
+        }
         qCDebug(KWIN_CORE) << "EffectsHandler::unloadEffect : Effect not loaded :" << name;
         return;
     }
@@ -1415,6 +1511,10 @@ void EffectsHandlerImpl::destroyEffect(Effect *effect)
 
     stopMouseInterception(effect);
 
+    if (m_profiler) {
+        m_profiler->removeEffect(effect);
+    }
+
     const QList<QByteArray> properties = m_propertiesForEffects.keys();
     for (const QByteArray &property : properties) {
         removeSupportProperty(property, effect);
@@ -1432,13 +1532,21 @@ void EffectsHandlerImpl::reconfigureEffect(const QString& name)
             (*it).second->reconfigure(Effect::ReconfigureAll);
             return;
         }
+    if (DeferredEffect *deferred = m_effectLoader->findDeferredEffect(name)) {
+        kwinApp()->config()->reparseConfiguration();
+        deferred->reconfigure(Effect::ReconfigureAll);
+    }
 }
 
 bool EffectsHandlerImpl::isEffectLoaded(const QString& name) const
 {
     auto it = std::find_if(loaded_effects.constBegin(), loaded_effects.constEnd(),
         [&name](const EffectPair &pair) { return pair.first == name; });
-    return it != loaded_effects.constEnd();
+    if (it != loaded_effects.constEnd()) {
+        return true;
+    }
+    // An effect that is loaded on first use behaves as if it were loaded.
+    return m_effectLoader->findDeferredEffect(name) != nullptr;
 }
 
 bool EffectsHandlerImpl::isEffectSupported(const QString &name)
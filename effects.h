@@ -44,6 +44,7 @@ class AbstractClient;
 class Compositor;
 class Deleted;
 class EffectLoader;
+class EffectProfiler;
 class Group;
 class Toplevel;
 class Unmanaged;
@@ -56,6 +57,10 @@ class KWIN_EXPORT EffectsHandlerImpl : public EffectsHandler
     Q_PROPERTY(QStringList activeEffects READ activeEffects)
     Q_PROPERTY(QStringList loadedEffects READ loadedEffects)
     Q_PROPERTY(QStringList listOfEffects READ listOfEffects)
+    /**
+     * Whether the CPU and GPU time spent by each effect in the paint chain is measured.
+     */
+    Q_PROPERTY(bool profilingEnabled READ isProfilingEnabled WRITE setProfilingEnabled)
 public:
     EffectsHandlerImpl(Compositor *compositor, Scene *scene);
     ~EffectsHandlerImpl() override;
@@ -139,6 +144,18 @@ public:
     Effect* activeFullScreenEffect() const override;
     bool hasActiveFullScreenEffect() const override;
 
+    /**
+     * Returns @c true if an active effect prevents windows from being scanned out directly.
+     */
+    bool blocksDirectScanout() const;
+    /**
+     * Returns @c true if an effect takes part in painting the current frame, i.e. it may
+     * paint something in between the windows.
+     */
+    bool isPaintingWithEffects() const {
+        return !m_activeEffects.isEmpty();
+    }
+
     void addRepaintFull() override;
     void addRepaint(const QRect& r) override;
     void addRepaint(const QRegion& r) override;
@@ -191,6 +208,7 @@ public:
 
     // internal (used by kwin core or compositing code)
     void startPaint();
+    void finishPaint();
     void grabbedKeyboardEvent(QKeyEvent* e);
     bool hasKeyboardGrab() const;
     void desktopResized(const QSize &size);
@@ -263,6 +281,9 @@ public:
 
     SessionState sessionState() const override;
 
+    bool isProfilingEnabled() const;
+    void setProfilingEnabled(bool enabled);
+
 public Q_SLOTS:
     void slotCurrentTabAboutToChange(EffectWindow* from, EffectWindow* to);
     void slotTabAdded(EffectWindow* from, EffectWindow* to);
@@ -278,6 +299,12 @@ public Q_SLOTS:
     Q_SCRIPTABLE QList<bool> areEffectsSupported(const QStringList &names);
     Q_SCRIPTABLE QString supportInformation(const QString& name) const;
     Q_SCRIPTABLE QString debug(const QString& name, const QString& parameter = QString()) const;
+    /**
+     * Returns the average cost per paint pass of each effect that has been painting recently,
+     * keyed by the name of the effect. Each value is a map with the @c cpuTime and, if it can
+     * be measured, the @c gpuTime in microseconds. The map is empty unless profiling is enabled.
+     */
+    Q_SCRIPTABLE QVariantMap effectCosts() const;
 
 protected Q_SLOTS:
     void slotClientShown(KWin::Toplevel*);
@@ -352,6 +379,7 @@ private:
     EffectLoader *m_effectLoader;
     int m_trackingCursorChanges;
     std::unique_ptr<WindowPropertyNotifyX11Filter> m_x11WindowPropertyNotify;
+    std::unique_ptr<EffectProfiler> m_profiler;
 };
 
 class EffectWindowImpl : public EffectWindow
@@ -516,5 +516,11 @@ bool ContrastEffect::isActive() const
     return !effects->isScreenLocked();
 }
 
+bool ContrastEffect::blocksDirectScanout() const
+{
+    // Only windows underneath translucent windows are affected.
+    return false;
+}
+
 } // namespace KWin
 
@@ -54,6 +54,14 @@ BlurEffect::BlurEffect()
     connect(effects, &EffectsHandler::windowDeleted, this, &BlurEffect::slotWindowDeleted);
     connect(effects, &EffectsHandler::propertyNotify, this, &BlurEffect::slotPropertyNotify);
     connect(effects, &EffectsHandler::screenGeometryChanged, this, &BlurEffect::slotScreenGeometryChanged);
+    connect(effects, &EffectsHandler::stackingOrderChanged, this,
+        [this] {
+            // Windows that moved above a blurred window haven't necessarily been repainted.
+            for (BlurCache &cache : m_blurCache) {
+                cache.valid = false;
+            }
+        }
+    );
     connect(effects, &EffectsHandler::xcbConnectionChanged, this,
         [this] {
             if (m_shader && m_shader->isValid() && m_renderTargetsValid) {
@@ -93,6 +101,9 @@ bool BlurEffect::renderTargetsValid() const
 
 void BlurEffect::deleteFBOs()
 {
+    m_blurCache.clear();
+    delete m_blurCacheRenderTarget;
+    m_blurCacheRenderTarget = nullptr;
     qDeleteAll(m_renderTargets);
 
     m_renderTargets.clear();
@@ -321,6 +332,8 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
 
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    m_blurCache.remove(w);
+
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -484,6 +497,8 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
     effects->prePaintWindow(w, data, time);
 
     if (!w->isPaintingEnabled()) {
+        // we can't tell what happens underneath the window while it is not painted
+        m_blurCache.remove(w);
         return;
     }
     if (!m_shader || !m_shader->isValid()) {
@@ -511,6 +526,14 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
     const QRegion blurArea = blurRegion(w).translated(w->pos()) & screen;
     const QRegion expandedBlur = (w->isDock() ? blurArea : expand(blurArea)) & screen;
 
+    // the cached blurred background is outdated if anything underneath has been repainted
+    if (m_paintedArea.intersects(expandedBlur)) {
+        auto cache = m_blurCache.find(w);
+        if (cache != m_blurCache.end()) {
+            cache->valid = false;
+        }
+    }
+
     // if this window or a window underneath the blurred area is painted again we have to
     // blur everything
     if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
@@ -585,7 +608,13 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
         const bool transientForIsDock = (modal ? modal->isDock() : false);
 
         if (!shape.isEmpty()) {
-            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->geometry());
+            // prePaintWindow() doesn't track what is underneath transformed windows
+            const bool transformed = translated || scaled || (mask & PAINT_WINDOW_TRANSFORMED);
+            BlurCache *cache = transformed ? nullptr : &m_blurCache[w];
+            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->geometry(), cache);
+            if (cache) {
+                trimBlurCache(w);
+            }
         }
     }
 
@@ -633,7 +662,7 @@ void BlurEffect::generateNoiseTexture()
     m_noiseTexture.setWrapMode(GL_REPEAT);
 }
 
-void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
+void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, BlurCache *cache)
 {
     // Blur would not render correctly on a secondary monitor because of wrong coordinates
     // BUG: 393723
@@ -653,38 +682,63 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
 
     const QRect sourceRect = expandedBlurRegion.boundingRect() & screen;
     const QRect destRect = sourceRect.translated(xTranslate, yTranslate);
-
-    GLRenderTarget::pushRenderTargets(m_renderTargetStack);
     int blurRectCount = expandedBlurRegion.rectCount() * 6;
 
-    /*
-     * If the window is a dock or panel we avoid the "extended blur" effect.
-     * Extended blur is when windows that are not under the blurred area affect
-     * the final blur result.
-     * We want to avoid this on panels, because it looks really weird and ugly
-     * when maximized windows or windows near the panel affect the dock blur.
-     */
-    if (isDock) {
-        m_renderTargets.last()->blitFromFramebuffer(sourceRect, destRect);
+    const bool cacheHit = cache && cache->valid && cache->screen == screen && cache->isDock == isDock &&
+            (shape - cache->shape).isEmpty();
+    if (cacheHit) {
+        ++m_blurCacheHits;
+        restoreBlurCache(cache);
 
         if (useSRGB) {
             glEnable(GL_FRAMEBUFFER_SRGB);
         }
-
-        copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), screenProjection);
     } else {
-        m_renderTargets.first()->blitFromFramebuffer(sourceRect, destRect);
+        GLRenderTarget::pushRenderTargets(m_renderTargetStack);
+
+        /*
+         * If the window is a dock or panel we avoid the "extended blur" effect.
+         * Extended blur is when windows that are not under the blurred area affect
+         * the final blur result.
+         * We want to avoid this on panels, because it looks really weird and ugly
+         * when maximized windows or windows near the panel affect the dock blur.
+         */
+        if (isDock) {
+            m_renderTargets.last()->blitFromFramebuffer(sourceRect, destRect);
+
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
 
-        if (useSRGB) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
+            copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), screenProjection);
+        } else {
+            m_renderTargets.first()->blitFromFramebuffer(sourceRect, destRect);
+
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+
+            // Remove the m_renderTargets[0] from the top of the stack that we will not use
+            GLRenderTarget::popRenderTarget();
         }
 
-        // Remove the m_renderTargets[0] from the top of the stack that we will not use
-        GLRenderTarget::popRenderTarget();
+        downSampleTexture(vbo, blurRectCount);
+        upSampleTexture(vbo, blurRectCount);
+
+        if (cache) {
+            ++m_blurCacheMisses;
+            storeBlurCache(cache, blurTextureRect(destRect));
+
+            cache->shape = shape;
+            cache->screen = screen;
+            cache->isDock = isDock;
+            cache->valid = true;
+        }
     }
 
-    downSampleTexture(vbo, blurRectCount);
-    upSampleTexture(vbo, blurRectCount);
+    if (cache) {
+        cache->lastUsed = ++m_blurCacheClock;
+    }
 
     // Modulate the blurred texture with the window opacity if the window isn't opaque
     if (opacity < 1.0) {
@@ -713,6 +767,77 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
     vbo->unbindArrays();
 }
 
+QRect BlurEffect::blurTextureRect(const QRect &rect) const
+{
+    // The upsample passes draw with a flipped y axis, so the first row of the texture holds
+    // the bottom of the screen. One texel of padding covers the rounding of the halved rect.
+    const int textureHeight = m_renderTextures[1].height();
+    const QPoint topLeft(rect.x() / 2 - 1, textureHeight - (rect.y() + rect.height()) / 2 - 1);
+    const QPoint bottomRight((rect.x() + rect.width()) / 2, textureHeight - rect.y() / 2);
+    return QRect(topLeft, bottomRight) & QRect(QPoint(0, 0), m_renderTextures[1].size());
+}
+
+void BlurEffect::storeBlurCache(BlurCache *cache, const QRect &textureRect)
+{
+    // Only the part of the first downsampled texture that the final pass reads is kept.
+    if (cache->texture.isNull() || cache->texture.width() < textureRect.width() ||
+            cache->texture.height() < textureRect.height()) {
+        cache->texture = GLTexture(m_renderTextures[1].internalFormat(), textureRect.size());
+        cache->texture.setFilter(GL_LINEAR);
+        cache->texture.setWrapMode(GL_CLAMP_TO_EDGE);
+    }
+    cache->textureRect = textureRect;
+
+    GLRenderTarget::pushRenderTarget(m_renderTargets[1]);
+    cache->texture.bind();
+    glCopyTexSubImage2D(cache->texture.target(), 0, 0, 0,
+                        textureRect.x(), textureRect.y(), textureRect.width(), textureRect.height());
+    cache->texture.unbind();
+    GLRenderTarget::popRenderTarget();
+}
+
+void BlurEffect::restoreBlurCache(const BlurCache *cache)
+{
+    if (!m_blurCacheRenderTarget) {
+        m_blurCacheRenderTarget = new GLRenderTarget(cache->texture);
+    } else {
+        m_blurCacheRenderTarget->attachTexture(cache->texture);
+    }
+
+    const QRect &textureRect = cache->textureRect;
+    GLRenderTarget::pushRenderTarget(m_blurCacheRenderTarget);
+    m_renderTextures[1].bind();
+    glCopyTexSubImage2D(m_renderTextures[1].target(), 0, textureRect.x(), textureRect.y(),
+                        0, 0, textureRect.width(), textureRect.height());
+    m_renderTextures[1].unbind();
+    GLRenderTarget::popRenderTarget();
+}
+
+void BlurEffect::trimBlurCache(const EffectWindow *w)
+{
+    // Keep the textures of the most recently painted windows within the budget.
+    static const qint64 budget = 32 * 1024 * 1024;
+
+    qint64 size = 0;
+    for (const BlurCache &cache : qAsConst(m_blurCache)) {
+        size += qint64(cache.texture.width()) * cache.texture.height() * 4;
+    }
+
+    while (size > budget) {
+        auto oldest = m_blurCache.end();
+        for (auto it = m_blurCache.begin(); it != m_blurCache.end(); ++it) {
+            if (it.key() != w && (oldest == m_blurCache.end() || it->lastUsed < oldest->lastUsed)) {
+                oldest = it;
+            }
+        }
+        if (oldest == m_blurCache.end()) {
+            break;
+        }
+        size -= qint64(oldest->texture.width()) * oldest->texture.height() * 4;
+        m_blurCache.erase(oldest);
+    }
+}
+
 void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, QMatrix4x4 screenProjection, QPoint windowPosition)
 {
     glActiveTexture(GL_TEXTURE0);
@@ -809,10 +934,33 @@ void BlurEffect::copyScreenSampleTexture(GLVertexBuffer *vbo, int blurRectCount,
     m_shader->unbind();
 }
 
+QString BlurEffect::debug(const QString &parameter) const
+{
+    if (parameter == QLatin1String("reset")) {
+        m_blurCacheHits = 0;
+        m_blurCacheMisses = 0;
+        return QStringLiteral("Blur cache statistics have been reset");
+    }
+
+    const quint64 total = m_blurCacheHits + m_blurCacheMisses;
+    const qreal hitRate = total ? 100.0 * m_blurCacheHits / total : 0.0;
+    return QStringLiteral("Blur cache: %1 hits, %2 misses (%3% hit rate), %4 cached windows")
+        .arg(m_blurCacheHits)
+        .arg(m_blurCacheMisses)
+        .arg(hitRate, 0, 'f', 1)
+        .arg(m_blurCache.count());
+}
+
 bool BlurEffect::isActive() const
 {
     return !effects->isScreenLocked();
 }
 
+bool BlurEffect::blocksDirectScanout() const
+{
+    // Only windows underneath translucent windows are affected.
+    return false;
+}
+
 } // namespace KWin
 
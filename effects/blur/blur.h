@@ -12,6 +12,7 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 
+#include <QHash>
 #include <QVector>
 #include <QVector2D>
 #include <QStack>
@@ -47,6 +48,7 @@ public:
 
     bool provides(Feature feature) override;
     bool isActive() const override;
+    bool blocksDirectScanout() const override;
 
     int requestedEffectChainPosition() const override {
         return 75;
@@ -54,6 +56,12 @@ public:
 
     bool eventFilter(QObject *watched, QEvent *event) override;
 
+    /**
+     * Reports how often the blurred background of a window could be reused from the cache.
+     * The parameter "reset" clears the statistics.
+     */
+    QString debug(const QString &parameter) const override;
+
 public Q_SLOTS:
     void slotWindowAdded(KWin::EffectWindow *w);
     void slotWindowDeleted(KWin::EffectWindow *w);
@@ -61,6 +69,20 @@ public Q_SLOTS:
     void slotScreenGeometryChanged();
 
 private:
+    /**
+     * The blurred background of a window from a previous frame. It stays valid as long as
+     * nothing underneath the expanded blur region of the window is repainted.
+     */
+    struct BlurCache {
+        GLTexture texture; // Holds textureRect of the first downsampled render texture
+        QRect textureRect;
+        QRegion shape; // The area whose blurred background is in the texture
+        QRect screen;
+        bool isDock = false;
+        bool valid = false;
+        quint64 lastUsed = 0;
+    };
+
     QRect expand(const QRect &rect) const;
     QRegion expand(const QRegion &region) const;
     bool renderTargetsValid() const;
@@ -70,7 +92,11 @@ private:
     QRegion blurRegion(const EffectWindow *w) const;
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
-    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, BlurCache *cache = nullptr);
+    QRect blurTextureRect(const QRect &rect) const;
+    void storeBlurCache(BlurCache *cache, const QRect &textureRect);
+    void restoreBlurCache(const BlurCache *cache);
+    void trimBlurCache(const EffectWindow *w);
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
@@ -115,6 +141,13 @@ private:
     QVector <BlurValuesStruct> blurStrengthValues;
 
     QMap <EffectWindow*, QMetaObject::Connection> windowBlurChangedConnections;
+
+    QHash<const EffectWindow *, BlurCache> m_blurCache;
+    GLRenderTarget *m_blurCacheRenderTarget = nullptr;
+    quint64 m_blurCacheClock = 0;
+    // Statistics for debug(), which may reset them
+    mutable quint64 m_blurCacheHits = 0;
+    mutable quint64 m_blurCacheMisses = 0;
     KWaylandServer::BlurManagerInterface *m_blurManager = nullptr;
 };
 
@@ -9,6 +9,7 @@
 #include "cube.h"
 // KConfigSkeleton
 #include "cubeconfig.h"
+#include "../effect_builtins.h"
 
 
 #include <QAction>
@@ -180,25 +181,14 @@ void CubeEffect::reconfigure(ReconfigureFlags)
     // do not connect the shortcut if we use cylinder or sphere
     if (!shortcutsRegistered) {
         QAction* cubeAction = m_cubeAction;
-        cubeAction->setObjectName(QStringLiteral("Cube"));
-        cubeAction->setText(i18n("Desktop Cube"));
-        KGlobalAccel::self()->setDefaultShortcut(cubeAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F11);
-        KGlobalAccel::self()->setShortcut(cubeAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F11);
-        effects->registerGlobalShortcut(Qt::CTRL + Qt::Key_F11, cubeAction);
-        effects->registerPointerShortcut(Qt::ControlModifier | Qt::AltModifier, Qt::LeftButton, cubeAction);
+        BuiltInEffects::setupAction(cubeAction, BuiltInEffect::Cube, QStringLiteral("Cube"));
         cubeShortcut = KGlobalAccel::self()->shortcut(cubeAction);
         QAction* cylinderAction = m_cylinderAction;
-        cylinderAction->setObjectName(QStringLiteral("Cylinder"));
-        cylinderAction->setText(i18n("Desktop Cylinder"));
-        KGlobalAccel::self()->setShortcut(cylinderAction, QList<QKeySequence>());
-        effects->registerGlobalShortcut(QKeySequence(), cylinderAction);
+        BuiltInEffects::setupAction(cylinderAction, BuiltInEffect::Cube, QStringLiteral("Cylinder"));
         cylinderShortcut = KGlobalAccel::self()->shortcut(cylinderAction);
         QAction* sphereAction = m_sphereAction;
-        sphereAction->setObjectName(QStringLiteral("Sphere"));
-        sphereAction->setText(i18n("Desktop Sphere"));
-        KGlobalAccel::self()->setShortcut(sphereAction, QList<QKeySequence>());
+        BuiltInEffects::setupAction(sphereAction, BuiltInEffect::Cube, QStringLiteral("Sphere"));
         sphereShortcut = KGlobalAccel::self()->shortcut(sphereAction);
-        effects->registerGlobalShortcut(QKeySequence(), sphereAction);
         connect(cubeAction, &QAction::triggered, this, &CubeEffect::toggleCube);
         connect(cylinderAction, &QAction::triggered, this, &CubeEffect::toggleCylinder);
         connect(sphereAction, &QAction::triggered, this, &CubeEffect::toggleSphere);
@@ -0,0 +1,111 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "deferredeffect.h"
+#include "effect_builtins.h"
+
+#include <QAction>
+
+namespace KWin
+{
+
+DeferredEffect::DeferredEffect(BuiltInEffect effect)
+    : m_effect(effect)
+{
+    connect(effects, &EffectsHandler::propertyNotify, this, &DeferredEffect::handlePropertyNotify);
+    connect(effects, &EffectsHandler::xcbConnectionChanged, this, [this]() {
+        reconfigure(ReconfigureAll);
+    });
+    reconfigure(ReconfigureAll);
+}
+
+DeferredEffect::~DeferredEffect()
+{
+    release();
+}
+
+BuiltInEffect DeferredEffect::effect() const
+{
+    return m_effect;
+}
+
+void DeferredEffect::reconfigure(ReconfigureFlags)
+{
+    release();
+
+    const BuiltInEffects::Triggers triggers = BuiltInEffects::triggers(m_effect);
+
+    // Same as the effects, touch screen edges are only supported on the sides of the screen.
+    const QVector<ElectricBorder> touchBorders{ElectricLeft, ElectricTop, ElectricRight, ElectricBottom};
+
+    for (const BuiltInEffects::ActionTrigger &trigger : triggers.actions) {
+        QAction *action = new QAction(this);
+        BuiltInEffects::setupAction(action, trigger);
+        for (int border : trigger.touchBorders) {
+            if (touchBorders.contains(ElectricBorder(border))) {
+                effects->registerTouchBorder(ElectricBorder(border), action);
+            }
+        }
+
+        const QString name = trigger.name;
+        connect(action, &QAction::triggered, this, [this, name]() {
+            emit actionTriggered(name);
+        });
+        m_actions.append(action);
+    }
+
+    for (int border : triggers.borders) {
+        m_borders.append(ElectricBorder(border));
+        effects->reserveElectricBorder(ElectricBorder(border), this);
+    }
+
+    for (const QByteArray &property : triggers.properties) {
+        const long atom = effects->announceSupportProperty(property, this);
+        m_properties.append(property);
+        if (atom != XCB_ATOM_NONE) {
+            m_atoms.append(atom);
+        }
+    }
+}
+
+void DeferredEffect::release()
+{
+    for (ElectricBorder border : qAsConst(m_borders)) {
+        effects->unreserveElectricBorder(border, this);
+    }
+    m_borders.clear();
+
+    for (const QByteArray &property : qAsConst(m_properties)) {
+        effects->removeSupportProperty(property, this);
+    }
+    m_properties.clear();
+    m_atoms.clear();
+
+    // Deleting the actions releases their shortcuts and touch screen edges, so that the
+    // effect can register them once it's loaded.
+    qDeleteAll(m_actions);
+    m_actions.clear();
+}
+
+bool DeferredEffect::borderActivated(ElectricBorder border)
+{
+    if (!m_borders.contains(border)) {
+        return false;
+    }
+    emit borderTriggered(border);
+    return true;
+}
+
+void DeferredEffect::handlePropertyNotify(EffectWindow *window, long atom)
+{
+    if (window && m_atoms.contains(atom)) {
+        emit propertyTriggered(window, atom);
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,65 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_DEFERRED_EFFECT_H
+#define KWIN_DEFERRED_EFFECT_H
+
+#include <kwineffects.h>
+
+namespace KWin
+{
+enum class BuiltInEffect;
+
+/**
+ * The DeferredEffect stands in for a built-in effect that is loaded on first use.
+ *
+ * It registers the shortcuts, screen edges and window properties that activate the effect,
+ * as declared by BuiltInEffects::triggers(), and tells when one of them fires. It never
+ * takes part in painting.
+ */
+class KWINEFFECTS_EXPORT DeferredEffect : public Effect
+{
+    Q_OBJECT
+
+public:
+    explicit DeferredEffect(BuiltInEffect effect);
+    ~DeferredEffect() override;
+
+    BuiltInEffect effect() const;
+
+    void reconfigure(ReconfigureFlags flags) override;
+    bool borderActivated(ElectricBorder border) override;
+
+Q_SIGNALS:
+    /**
+     * This signal is emitted when the QAction with the given object @p name is triggered.
+     */
+    void actionTriggered(const QString &name);
+    /**
+     * This signal is emitted when one of the screen edges of the effect is activated.
+     */
+    void borderTriggered(KWin::ElectricBorder border);
+    /**
+     * This signal is emitted when a window changes one of the properties of the effect.
+     */
+    void propertyTriggered(KWin::EffectWindow *window, long atom);
+
+private:
+    void handlePropertyNotify(EffectWindow *window, long atom);
+    void release();
+
+    BuiltInEffect m_effect;
+    QList<QAction *> m_actions;
+    QList<ElectricBorder> m_borders;
+    QList<QByteArray> m_properties;
+    QList<long> m_atoms;
+};
+
+} // namespace KWin
+
+#endif
@@ -62,13 +62,8 @@ DesktopGridEffect::DesktopGridEffect()
     initConfig<DesktopGridConfig>();
     // Load shortcuts
     QAction* a = m_activateAction;
-    a->setObjectName(QStringLiteral("ShowDesktopGrid"));
-    a->setText(i18n("Show Desktop Grid"));
-    KGlobalAccel::self()->setDefaultShortcut(a, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F8);
-    KGlobalAccel::self()->setShortcut(a, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F8);
+    BuiltInEffects::setupAction(a, BuiltInEffect::DesktopGrid, QStringLiteral("ShowDesktopGrid"));
     shortcut = KGlobalAccel::self()->shortcut(a);
-    effects->registerGlobalShortcut(Qt::CTRL + Qt::Key_F8, a);
-    effects->registerTouchpadSwipeShortcut(SwipeDirection::Up, a);
     connect(a, &QAction::triggered, this, &DesktopGridEffect::toggle);
     connect(KGlobalAccel::self(), &KGlobalAccel::globalShortcutChanged, this, &DesktopGridEffect::globalShortcutChanged);
     connect(effects, &EffectsHandler::windowAdded, this, &DesktopGridEffect::slotWindowAdded);
@@ -48,6 +48,14 @@
 #include "startupfeedback/startupfeedback.h"
 #include "trackmouse/trackmouse.h"
 #include "wobblywindows/wobblywindows.h"
+// configuration of the effects that can be loaded on first use
+#include "cubeconfig.h"
+#include "desktopgridconfig.h"
+#include "presentwindowsconfig.h"
+
+#include <KGlobalAccel>
+
+#include <QAction>
 #endif
 
 #include <KLocalizedString>
@@ -71,6 +79,92 @@ inline Effect *createHelper()
     return new T();
 }
 
+#ifdef EFFECT_BUILTINS
+template <class T>
+inline void readConfigHelper()
+{
+    T::instance(effects->config());
+    T::self()->read();
+}
+
+// The effects set up their actions from these as well, so the stand-ins of effects that are
+// loaded on first use can't get out of sync with them.
+static QVector<ActionTrigger> actionTriggers(BuiltInEffect effect)
+{
+    switch (effect) {
+    case BuiltInEffect::Cube:
+        return {
+            { QStringLiteral("Cube"), i18n("Desktop Cube"), { Qt::CTRL + Qt::Key_F11 }, SwipeDirection::Invalid,
+              Qt::ControlModifier | Qt::AltModifier, Qt::LeftButton, {} },
+            { QStringLiteral("Cylinder"), i18n("Desktop Cylinder"), {}, SwipeDirection::Invalid,
+              Qt::NoModifier, Qt::NoButton, {} },
+            { QStringLiteral("Sphere"), i18n("Desktop Sphere"), {}, SwipeDirection::Invalid,
+              Qt::NoModifier, Qt::NoButton, {} },
+        };
+    case BuiltInEffect::DesktopGrid:
+        return {
+            { QStringLiteral("ShowDesktopGrid"), i18n("Show Desktop Grid"), { Qt::CTRL + Qt::Key_F8 }, SwipeDirection::Up,
+              Qt::NoModifier, Qt::NoButton, {} },
+        };
+    case BuiltInEffect::PresentWindows:
+        return {
+            { QStringLiteral("Expose"), i18n("Toggle Present Windows (Current desktop)"), { Qt::CTRL + Qt::Key_F9 },
+              SwipeDirection::Invalid, Qt::NoModifier, Qt::NoButton, {} },
+            { QStringLiteral("ExposeAll"), i18n("Toggle Present Windows (All desktops)"), { Qt::CTRL + Qt::Key_F10, Qt::Key_LaunchC },
+              SwipeDirection::Down, Qt::NoModifier, Qt::NoButton, {} },
+            { QStringLiteral("ExposeClass"), i18n("Toggle Present Windows (Window class)"), { Qt::CTRL + Qt::Key_F7 },
+              SwipeDirection::Invalid, Qt::NoModifier, Qt::NoButton, {} },
+        };
+    default:
+        return {};
+    }
+}
+
+static Triggers cubeTriggers()
+{
+    readConfigHelper<CubeConfig>();
+    Triggers triggers;
+    triggers.actions = actionTriggers(BuiltInEffect::Cube);
+    triggers.actions[0].touchBorders = CubeConfig::touchBorderActivate();
+    triggers.actions[1].touchBorders = CubeConfig::touchBorderActivateCylinder();
+    triggers.actions[2].touchBorders = CubeConfig::touchBorderActivateSphere();
+    triggers.borders = CubeConfig::borderActivate() + CubeConfig::borderActivateCylinder()
+        + CubeConfig::borderActivateSphere();
+    return triggers;
+}
+
+static Triggers desktopGridTriggers()
+{
+    readConfigHelper<DesktopGridConfig>();
+    Triggers triggers;
+    triggers.actions = actionTriggers(BuiltInEffect::DesktopGrid);
+    triggers.actions[0].touchBorders = DesktopGridConfig::touchBorderActivate();
+    triggers.borders = DesktopGridConfig::borderActivate();
+    return triggers;
+}
+
+static Triggers presentWindowsTriggers()
+{
+    readConfigHelper<PresentWindowsConfig>();
+    Triggers triggers;
+    triggers.actions = actionTriggers(BuiltInEffect::PresentWindows);
+    triggers.actions[0].touchBorders = PresentWindowsConfig::touchBorderActivate();
+    triggers.actions[1].touchBorders = PresentWindowsConfig::touchBorderActivateAll();
+    triggers.actions[2].touchBorders = PresentWindowsConfig::touchBorderActivateClass();
+    triggers.borders = PresentWindowsConfig::borderActivate() + PresentWindowsConfig::borderActivateAll()
+        + PresentWindowsConfig::borderActivateClass();
+    // Plasma asks for present windows through these properties on its windows.
+    triggers.properties = {
+        QByteArrayLiteral("_KDE_PRESENT_WINDOWS_DESKTOP"),
+        QByteArrayLiteral("_KDE_PRESENT_WINDOWS_GROUP"),
+    };
+    triggers.propertyNotify = [](Effect *effect, EffectWindow *window, long atom) {
+        static_cast<PresentWindowsEffect *>(effect)->slotPropertyNotify(window, atom);
+    };
+    return triggers;
+}
+#endif
+
 static const QVector<EffectData> &effectData()
 {
     static const QVector<EffectData> s_effectData = {
@@ -167,6 +261,9 @@ EFFECT_FALLBACK
 #endif
 EFFECT_FALLBACK
         QStringLiteral("kwin_cube_config")
+#ifdef EFFECT_BUILTINS
+        , &cubeTriggers
+#endif
     }, {
         QStringLiteral("cubeslide"),
         i18ndc("kwin_effects", "Name of a KWin Effect", "Desktop Cube Animation"),
@@ -199,6 +296,9 @@ EFFECT_FALLBACK
 #endif
 EFFECT_FALLBACK
         QStringLiteral("kwin_desktopgrid_config")
+#ifdef EFFECT_BUILTINS
+        , &desktopGridTriggers
+#endif
     }, {
         QStringLiteral("diminactive"),
         i18ndc("kwin_effects", "Name of a KWin Effect", "Dim Inactive"),
@@ -407,6 +507,9 @@ EFFECT_FALLBACK
 #endif
 EFFECT_FALLBACK
         QStringLiteral("kwin_presentwindows_config")
+#ifdef EFFECT_BUILTINS
+        , &presentWindowsTriggers
+#endif
     }, {
         QStringLiteral("resize"),
         i18ndc("kwin_effects", "Name of a KWin Effect", "Resize Window"),
@@ -781,6 +884,55 @@ const EffectData &effectData(BuiltInEffect effect)
     return effectData().at(index(effect));
 }
 
+bool hasTriggers(BuiltInEffect effect)
+{
+    if (effect == BuiltInEffect::Invalid) {
+        return false;
+    }
+    return effectData(effect).triggersFunction != nullptr;
+}
+
+Triggers triggers(BuiltInEffect effect)
+{
+    if (!hasTriggers(effect)) {
+        return Triggers();
+    }
+    return effectData(effect).triggersFunction();
+}
+
+#ifdef EFFECT_BUILTINS
+void setupAction(QAction *action, const ActionTrigger &trigger)
+{
+    action->setObjectName(trigger.name);
+    action->setText(trigger.text);
+    if (!trigger.shortcuts.isEmpty()) {
+        KGlobalAccel::self()->setDefaultShortcut(action, trigger.shortcuts);
+    }
+    KGlobalAccel::self()->setShortcut(action, trigger.shortcuts);
+    effects->registerGlobalShortcut(trigger.shortcuts.value(0), action);
+    if (trigger.swipe != SwipeDirection::Invalid) {
+        effects->registerTouchpadSwipeShortcut(trigger.swipe, action);
+    }
+    if (trigger.pointerButton != Qt::NoButton) {
+        effects->registerPointerShortcut(trigger.pointerModifiers, trigger.pointerButton, action);
+    }
+}
+
+void setupAction(QAction *action, BuiltInEffect effect, const QString &name)
+{
+    const QVector<ActionTrigger> triggers = actionTriggers(effect);
+    auto it = std::find_if(triggers.constBegin(), triggers.constEnd(),
+        [&name](const ActionTrigger &trigger) {
+            return trigger.name == name;
+        }
+    );
+    Q_ASSERT(it != triggers.constEnd());
+    if (it != triggers.constEnd()) {
+        setupAction(action, *it);
+    }
+}
+#endif
+
 } // BuiltInEffects
 
 } // namespace
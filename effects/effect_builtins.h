@@ -9,13 +9,19 @@
 #ifndef KWIN_EFFECT_BUILTINS_H
 #define KWIN_EFFECT_BUILTINS_H
 #include <kwineffects_export.h>
+#include <kwinglobals.h>
+#include <QKeySequence>
 #include <QStringList>
 #include <QUrl>
+#include <QVector>
 #include <functional>
 
+class QAction;
+
 namespace KWin
 {
 class Effect;
+class EffectWindow;
 
 /**
  * Defines all the built in effects.
@@ -65,6 +71,33 @@ enum class BuiltInEffect
 namespace BuiltInEffects
 {
 
+/**
+ * Describes a QAction through which a built-in effect is activated.
+ */
+struct ActionTrigger {
+    QString name; ///< The object name of the QAction created by the effect
+    QString text;
+    QList<QKeySequence> shortcuts; ///< The default global shortcuts
+    SwipeDirection swipe = SwipeDirection::Invalid;
+    Qt::KeyboardModifiers pointerModifiers = Qt::NoModifier;
+    Qt::MouseButton pointerButton = Qt::NoButton;
+    QList<int> touchBorders;
+};
+
+/**
+ * Describes everything that activates a built-in effect, so that the effect can be loaded
+ * when it is used for the first time.
+ */
+struct Triggers {
+    QVector<ActionTrigger> actions;
+    QList<int> borders; ///< Screen edges passed to Effect::borderActivated()
+    QList<QByteArray> properties; ///< Window properties announced by the effect
+    /**
+     * Passes a change of one of the properties to the effect.
+     */
+    std::function<void(Effect *effect, EffectWindow *window, long atom)> propertyNotify;
+};
+
 struct EffectData {
     QString name;
     QString displayName;
@@ -78,6 +111,10 @@ struct EffectData {
     std::function<bool()> supportedFunction;
     std::function<bool()> enabledFunction;
     QString configModule;
+    /**
+     * Set for effects that can be loaded on first use.
+     */
+    std::function<Triggers()> triggersFunction;
 };
 
 KWINEFFECTS_EXPORT Effect *create(BuiltInEffect effect);
@@ -90,6 +127,19 @@ KWINEFFECTS_EXPORT BuiltInEffect builtInForName(const QString &name);
 KWINEFFECTS_EXPORT QStringList availableEffectNames();
 KWINEFFECTS_EXPORT QList<BuiltInEffect> availableEffects();
 KWINEFFECTS_EXPORT const EffectData &effectData(BuiltInEffect effect);
+KWINEFFECTS_EXPORT bool hasTriggers(BuiltInEffect effect);
+KWINEFFECTS_EXPORT Triggers triggers(BuiltInEffect effect);
+/**
+ * Sets up the @p action as described by @p trigger: its object name, text, global shortcuts,
+ * touchpad swipe and pointer shortcut. The touch screen edges are configurable, they have to be
+ * registered separately.
+ */
+KWINEFFECTS_EXPORT void setupAction(QAction *action, const ActionTrigger &trigger);
+/**
+ * Sets up the @p action with the object name @p name of the built-in @p effect, as declared by
+ * its triggers.
+ */
+KWINEFFECTS_EXPORT void setupAction(QAction *action, BuiltInEffect effect, const QString &name);
 }
 
 }
@@ -11,6 +11,7 @@
 #include "presentwindows.h"
 //KConfigSkeleton
 #include "presentwindowsconfig.h"
+#include "../effect_builtins.h"
 #include <QAction>
 #include <KGlobalAccel>
 #include <KLocalizedString>
@@ -62,30 +63,17 @@ PresentWindowsEffect::PresentWindowsEffect()
     connect(effects, &EffectsHandler::xcbConnectionChanged, this, announceSupportProperties);
 
     QAction* exposeAction = m_exposeAction;
-    exposeAction->setObjectName(QStringLiteral("Expose"));
-    exposeAction->setText(i18n("Toggle Present Windows (Current desktop)"));
-    KGlobalAccel::self()->setDefaultShortcut(exposeAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F9);
-    KGlobalAccel::self()->setShortcut(exposeAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F9);
+    BuiltInEffects::setupAction(exposeAction, BuiltInEffect::PresentWindows, QStringLiteral("Expose"));
     shortcut = KGlobalAccel::self()->shortcut(exposeAction);
-    effects->registerGlobalShortcut(Qt::CTRL + Qt::Key_F9, exposeAction);
     connect(exposeAction, &QAction::triggered, this, &PresentWindowsEffect::toggleActive);
 
     QAction* exposeAllAction = m_exposeAllAction;
-    exposeAllAction->setObjectName(QStringLiteral("ExposeAll"));
-    exposeAllAction->setText(i18n("Toggle Present Windows (All desktops)"));
-    KGlobalAccel::self()->setDefaultShortcut(exposeAllAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F10 << Qt::Key_LaunchC);
-    KGlobalAccel::self()->setShortcut(exposeAllAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F10 << Qt::Key_LaunchC);
+    BuiltInEffects::setupAction(exposeAllAction, BuiltInEffect::PresentWindows, QStringLiteral("ExposeAll"));
     shortcutAll = KGlobalAccel::self()->shortcut(exposeAllAction);
-    effects->registerGlobalShortcut(Qt::CTRL + Qt::Key_F10, exposeAllAction);
-    effects->registerTouchpadSwipeShortcut(SwipeDirection::Down, exposeAllAction);
     connect(exposeAllAction, &QAction::triggered, this, &PresentWindowsEffect::toggleActiveAllDesktops);
 
     QAction* exposeClassAction = m_exposeClassAction;
-    exposeClassAction->setObjectName(QStringLiteral("ExposeClass"));
-    exposeClassAction->setText(i18n("Toggle Present Windows (Window class)"));
-    KGlobalAccel::self()->setDefaultShortcut(exposeClassAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F7);
-    KGlobalAccel::self()->setShortcut(exposeClassAction, QList<QKeySequence>() << Qt::CTRL + Qt::Key_F7);
-    effects->registerGlobalShortcut(Qt::CTRL + Qt::Key_F7, exposeClassAction);
+    BuiltInEffects::setupAction(exposeClassAction, BuiltInEffect::PresentWindows, QStringLiteral("ExposeClass"));
     connect(exposeClassAction, &QAction::triggered, this, &PresentWindowsEffect::toggleActiveClass);
     shortcutClass = KGlobalAccel::self()->shortcut(exposeClassAction);
     connect(KGlobalAccel::self(), &KGlobalAccel::globalShortcutChanged, this, &PresentWindowsEffect::globalShortcutChanged);
@@ -0,0 +1,354 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "frametracer.h"
+#include "timestampqueries.h"
+#include "utils.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+
+#include <unistd.h>
+
+namespace KWin
+{
+
+// The number of frames whose GPU queries may be in flight before the oldest are dropped.
+static const int s_maxPendingQueries = 16;
+
+FrameTracer *FrameTracer::s_self = nullptr;
+
+static std::chrono::nanoseconds now()
+{
+    return std::chrono::steady_clock::now().time_since_epoch();
+}
+
+FrameTracer::FrameTracer(int capacity, TimestampQueries *queries)
+    : m_frames(qMax(capacity, 1))
+    , m_queries(queries)
+    , m_gpuTimingChecked(queries != nullptr)
+{
+    Q_ASSERT(!s_self);
+    s_self = this;
+}
+
+FrameTracer::~FrameTracer()
+{
+    releaseGpuResources();
+    s_self = nullptr;
+}
+
+FrameTracer *FrameTracer::self()
+{
+    return s_self;
+}
+
+void FrameTracer::beginFrame(RenderLoop *renderLoop, std::chrono::nanoseconds scheduled,
+                             std::chrono::nanoseconds expectedPresentation)
+{
+    // A frame that hasn't been painted, e.g. because nothing was damaged, is simply replaced.
+    Frame &frame = m_currentFrames[renderLoop];
+    frame = Frame();
+    frame.track = trackForRenderLoop(renderLoop);
+    frame.scheduled = scheduled;
+    frame.expectedPresentation = expectedPresentation;
+    frame.begin = now();
+}
+
+void FrameTracer::damageCollected(RenderLoop *renderLoop, int roundTrips)
+{
+    auto it = m_currentFrames.find(renderLoop);
+    if (it != m_currentFrames.end()) {
+        it->damageCollected = now();
+        it->damageRoundTrips = roundTrips;
+    }
+}
+
+void FrameTracer::beginPaint(RenderLoop *renderLoop)
+{
+    auto it = m_currentFrames.find(renderLoop);
+    if (it != m_currentFrames.end()) {
+        it->paintBegin = now();
+    }
+}
+
+void FrameTracer::endPaint(RenderLoop *renderLoop, bool openGL)
+{
+    auto it = m_currentFrames.find(renderLoop);
+    if (it == m_currentFrames.end() || it->paintBegin == std::chrono::nanoseconds::zero()) {
+        return;
+    }
+    Frame frame = *it;
+    m_currentFrames.erase(it);
+
+    frame.paintEnd = now();
+    frame.sequence = ++m_lastSequence;
+    m_frames[frame.sequence % m_frames.count()] = frame;
+
+    if (frame.submitted != std::chrono::nanoseconds::zero()) {
+        m_presentingFrames.insert(renderLoop, frame.sequence);
+    }
+
+    if (openGL && !m_gpuTimingChecked) {
+        // The context of the scene is current while the frame is painted.
+        m_queries.reset(TimestampQueries::create());
+        m_gpuTimingChecked = true;
+    }
+    if (openGL && m_queries && m_queries->isContextCurrent()) {
+        resolveGpuQueries();
+        addGpuQuery(frame.sequence);
+    }
+}
+
+void FrameTracer::framePending(RenderLoop *renderLoop)
+{
+    // The backends hand the frame over while it's being painted.
+    auto it = m_currentFrames.find(renderLoop);
+    if (it != m_currentFrames.end()) {
+        it->submitted = now();
+    }
+}
+
+void FrameTracer::framePresented(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp)
+{
+    if (Frame *frame = find(m_presentingFrames.take(renderLoop))) {
+        frame->presented = timestamp;
+    }
+}
+
+void FrameTracer::frameFailed(RenderLoop *renderLoop)
+{
+    if (Frame *frame = find(m_presentingFrames.take(renderLoop))) {
+        frame->failed = true;
+    }
+}
+
+void FrameTracer::removeRenderLoop(RenderLoop *renderLoop)
+{
+    // The recorded frames keep the track, a new render loop at the same address gets a new one.
+    m_tracks.remove(renderLoop);
+    m_currentFrames.remove(renderLoop);
+    m_presentingFrames.remove(renderLoop);
+}
+
+void FrameTracer::releaseGpuResources()
+{
+    m_pendingQueries.clear();
+    m_queries.reset();
+    // The next context might be different.
+    m_gpuTimingChecked = false;
+}
+
+QVector<FrameTracer::Frame> FrameTracer::frames() const
+{
+    const quint64 capacity = m_frames.count();
+    const quint64 first = m_lastSequence > capacity ? m_lastSequence - capacity + 1 : 1;
+
+    QVector<Frame> frames;
+    frames.reserve(m_lastSequence - first + 1);
+    for (quint64 sequence = first; sequence <= m_lastSequence; ++sequence) {
+        frames.append(m_frames[sequence % capacity]);
+    }
+    return frames;
+}
+
+FrameTracer::Frame *FrameTracer::find(quint64 sequence)
+{
+    if (!sequence) {
+        return nullptr;
+    }
+    Frame &frame = m_frames[sequence % m_frames.count()];
+    if (frame.sequence != sequence) {
+        // The frame has been overwritten in the meantime.
+        return nullptr;
+    }
+    return &frame;
+}
+
+int FrameTracer::trackForRenderLoop(RenderLoop *renderLoop)
+{
+    auto it = m_tracks.find(renderLoop);
+    if (it == m_tracks.end()) {
+        it = m_tracks.insert(renderLoop, ++m_lastTrack);
+    }
+    return *it;
+}
+
+void FrameTracer::addGpuQuery(quint64 sequence)
+{
+    const uint query = m_queries->issue();
+    if (!query) {
+        return;
+    }
+
+    // The GPU clock has an unspecified epoch, sample it now to map it to the monotonic clock.
+    const std::chrono::nanoseconds clockOffset = now() - m_queries->currentTime();
+
+    m_pendingQueries.enqueue(GpuQuery{sequence, query, clockOffset});
+
+    // Don't let the queries pile up if the driver never reports them as available.
+    while (m_pendingQueries.count() > s_maxPendingQueries) {
+        m_queries->release(m_pendingQueries.dequeue().query);
+    }
+}
+
+void FrameTracer::resolveGpuQueries()
+{
+    while (!m_pendingQueries.isEmpty()) {
+        const GpuQuery &pending = m_pendingQueries.head();
+        if (!m_queries->isAvailable(pending.query)) {
+            return;
+        }
+        const std::chrono::nanoseconds timestamp = m_queries->result(pending.query);
+
+        if (Frame *frame = find(pending.sequence)) {
+            frame->gpuCompleted = timestamp + pending.clockOffset;
+        }
+        m_queries->release(m_pendingQueries.dequeue().query);
+    }
+}
+
+static double toMicroseconds(std::chrono::nanoseconds timestamp)
+{
+    return timestamp.count() / 1000.0;
+}
+
+static QJsonObject createEvent(const QString &name, const QString &phase,
+                               std::chrono::nanoseconds timestamp, int threadId)
+{
+    return QJsonObject{
+        {QStringLiteral("name"), name},
+        {QStringLiteral("cat"), QStringLiteral("frame")},
+        {QStringLiteral("ph"), phase},
+        {QStringLiteral("ts"), toMicroseconds(timestamp)},
+        {QStringLiteral("pid"), qint64(getpid())},
+        {QStringLiteral("tid"), threadId},
+    };
+}
+
+static QJsonObject createSpan(const QString &name, std::chrono::nanoseconds begin,
+                              std::chrono::nanoseconds end, int threadId)
+{
+    QJsonObject event = createEvent(name, QStringLiteral("X"), begin, threadId);
+    event.insert(QStringLiteral("dur"), toMicroseconds(qMax(end - begin, std::chrono::nanoseconds::zero())));
+    return event;
+}
+
+static QJsonObject createMark(const QString &name, std::chrono::nanoseconds timestamp, int threadId)
+{
+    QJsonObject event = createEvent(name, QStringLiteral("i"), timestamp, threadId);
+    event.insert(QStringLiteral("s"), QStringLiteral("t"));
+    return event;
+}
+
+static QJsonObject createThreadName(const QString &name, int threadId)
+{
+    QJsonObject event = createEvent(QStringLiteral("thread_name"), QStringLiteral("M"),
+                                    std::chrono::nanoseconds::zero(), threadId);
+    event.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), name}});
+    return event;
+}
+
+bool FrameTracer::write(const QString &fileName, const QHash<RenderLoop *, QString> &names) const
+{
+    // Each render loop gets three tracks in the trace, so the stages that overlap, e.g. the GPU
+    // catching up with the paint commands while the next frame is composited, don't have to nest.
+    enum Track {
+        CompositingTrack,
+        GpuTrack,
+        DisplayTrack,
+        TrackCount,
+    };
+    auto threadId = [](int track, Track type) {
+        return track * TrackCount + type;
+    };
+
+    QJsonArray events;
+    QSet<int> tracks;
+
+    const QVector<Frame> recordedFrames = frames();
+    for (const Frame &frame : recordedFrames) {
+        if (!frame.sequence) {
+            continue;
+        }
+        tracks.insert(frame.track);
+
+        const int compositing = threadId(frame.track, CompositingTrack);
+        if (frame.scheduled != std::chrono::nanoseconds::zero()) {
+            events.append(createMark(QStringLiteral("Scheduled"), frame.scheduled, compositing));
+        }
+        QJsonObject frameEvent = createSpan(QStringLiteral("Frame %1").arg(frame.sequence),
+                                            frame.begin, frame.paintEnd, compositing);
+        frameEvent.insert(QStringLiteral("args"), QJsonObject{
+            {QStringLiteral("sequence"), qint64(frame.sequence)},
+            {QStringLiteral("expectedPresentation"), toMicroseconds(frame.expectedPresentation)},
+        });
+        events.append(frameEvent);
+        if (frame.damageCollected != std::chrono::nanoseconds::zero()) {
+            QJsonObject damageEvent = createSpan(QStringLiteral("Damage collection"),
+                                                 frame.begin, frame.damageCollected, compositing);
+            damageEvent.insert(QStringLiteral("args"), QJsonObject{
+                {QStringLiteral("roundTrips"), frame.damageRoundTrips},
+            });
+            events.append(damageEvent);
+        }
+        events.append(createSpan(QStringLiteral("Paint"), frame.paintBegin, frame.paintEnd, compositing));
+
+        if (frame.gpuCompleted != std::chrono::nanoseconds::zero()) {
+            events.append(createSpan(QStringLiteral("GPU"), frame.paintEnd, frame.gpuCompleted,
+                                     threadId(frame.track, GpuTrack)));
+        }
+
+        const int display = threadId(frame.track, DisplayTrack);
+        if (frame.submitted == std::chrono::nanoseconds::zero()) {
+            continue;
+        }
+        if (frame.presented != std::chrono::nanoseconds::zero()) {
+            events.append(createSpan(QStringLiteral("Waiting for presentation"),
+                                     frame.submitted, frame.presented, display));
+            events.append(createMark(QStringLiteral("Presented"), frame.presented, display));
+        } else if (frame.failed) {
+            events.append(createMark(QStringLiteral("Presentation failed"), frame.submitted, display));
+        } else {
+            events.append(createMark(QStringLiteral("Submitted"), frame.submitted, display));
+        }
+    }
+
+    for (int track : qAsConst(tracks)) {
+        QString name = names.value(m_tracks.key(track));
+        if (name.isEmpty()) {
+            name = QStringLiteral("Render loop %1").arg(track);
+        }
+        events.append(createThreadName(name + QStringLiteral(" compositing"), threadId(track, CompositingTrack)));
+        events.append(createThreadName(name + QStringLiteral(" GPU"), threadId(track, GpuTrack)));
+        events.append(createThreadName(name + QStringLiteral(" display"), threadId(track, DisplayTrack)));
+    }
+
+    const QJsonObject document{
+        {QStringLiteral("traceEvents"), events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+    };
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(KWIN_CORE) << "Failed to open" << fileName << "to write the frame trace:"
+                             << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(document).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qCWarning(KWIN_CORE) << "Failed to write the frame trace to" << fileName;
+        return false;
+    }
+    return true;
+}
+
+} // namespace KWin
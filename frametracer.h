@@ -0,0 +1,152 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QQueue>
+#include <QVector>
+
+#include <chrono>
+#include <memory>
+
+namespace KWin
+{
+
+class RenderLoop;
+class TimestampQueries;
+
+/**
+ * The FrameTracer class records how long the compositor takes to produce and present
+ * each frame.
+ *
+ * The most recent frames are kept in a ring buffer, so tracing can stay enabled for a whole
+ * session. The buffer can be written to a file in the Chrome trace event format at any time,
+ * which can be inspected with chrome://tracing or Perfetto.
+ *
+ * The tracer only exists while tracing is enabled, the compositor and the render loops check
+ * self() before recording anything.
+ *
+ * The GPU completion is measured with a timestamp query placed after the last paint command
+ * of the frame. The query is read back a few frames later so painting never waits for the GPU.
+ */
+class KWIN_EXPORT FrameTracer
+{
+public:
+    /**
+     * All timestamps are sourced from the monotonic clock. A zero timestamp means that the
+     * respective stage didn't happen or hasn't been reported yet.
+     */
+    struct Frame
+    {
+        quint64 sequence = 0;
+        int track = 0; ///< Identifies the render loop that produced the frame
+        std::chrono::nanoseconds scheduled = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds expectedPresentation = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds begin = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds damageCollected = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds paintBegin = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds paintEnd = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds gpuCompleted = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds submitted = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds presented = std::chrono::nanoseconds::zero();
+        int damageRoundTrips = 0; ///< Replies of the X server the damage collection waited for
+        bool failed = false;
+    };
+
+    /**
+     * Creates a tracer that keeps the last @p capacity frames of all render loops. The GPU
+     * completion is measured with @p queries if given, otherwise the queries are created
+     * for the OpenGL context of the first frame painted with OpenGL. The tracer takes the
+     * ownership of the queries.
+     */
+    explicit FrameTracer(int capacity = 4096, TimestampQueries *queries = nullptr);
+    ~FrameTracer();
+
+    /**
+     * Returns the tracer if frame tracing is enabled, otherwise @c null.
+     */
+    static FrameTracer *self();
+
+    /**
+     * Starts a new frame of @p renderLoop. The render loop planned to start compositing
+     * at @p scheduled in order to hit the vblank at @p expectedPresentation.
+     */
+    void beginFrame(RenderLoop *renderLoop, std::chrono::nanoseconds scheduled,
+                    std::chrono::nanoseconds expectedPresentation);
+    /**
+     * The damage of the windows has been collected for the frame of @p renderLoop. Collecting
+     * it required waiting for @p roundTrips replies of the X server.
+     */
+    void damageCollected(RenderLoop *renderLoop, int roundTrips = 0);
+    void beginPaint(RenderLoop *renderLoop);
+    /**
+     * Finishes the frame of @p renderLoop and adds it to the ring buffer. Set @p openGL
+     * if the frame has been painted with OpenGL.
+     */
+    void endPaint(RenderLoop *renderLoop, bool openGL);
+    /**
+     * The frame of @p renderLoop has been handed over to the windowing system, i.e. buffers
+     * have been swapped or a page flip has been scheduled.
+     */
+    void framePending(RenderLoop *renderLoop);
+    void framePresented(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp);
+    void frameFailed(RenderLoop *renderLoop);
+    /**
+     * Forgets about @p renderLoop, which is about to be destroyed.
+     */
+    void removeRenderLoop(RenderLoop *renderLoop);
+
+    /**
+     * Drops the GPU queries. This should be called with the OpenGL context current before the
+     * context is destroyed, e.g. when compositing is restarted.
+     */
+    void releaseGpuResources();
+
+    /**
+     * Returns the recorded frames, oldest first.
+     */
+    QVector<Frame> frames() const;
+
+    /**
+     * Writes the recorded frames to @p fileName in the Chrome trace event format. The tracks
+     * of the render loops are labeled with @p names, e.g. the names of the outputs. The
+     * frames stay in the ring buffer.
+     */
+    bool write(const QString &fileName, const QHash<RenderLoop *, QString> &names) const;
+
+private:
+    struct GpuQuery
+    {
+        quint64 sequence;
+        uint query;
+        std::chrono::nanoseconds clockOffset; ///< Converts the GPU timestamp to the monotonic clock
+    };
+
+    Frame *find(quint64 sequence);
+    int trackForRenderLoop(RenderLoop *renderLoop);
+    void addGpuQuery(quint64 sequence);
+    void resolveGpuQueries();
+
+    QVector<Frame> m_frames;
+    quint64 m_lastSequence = 0;
+    QHash<RenderLoop *, int> m_tracks;
+    int m_lastTrack = 0;
+    QHash<RenderLoop *, Frame> m_currentFrames;
+    QHash<RenderLoop *, quint64> m_presentingFrames;
+
+    std::unique_ptr<TimestampQueries> m_queries;
+    bool m_gpuTimingChecked = false;
+    QQueue<GpuQuery> m_pendingQueries;
+
+    static FrameTracer *s_self;
+};
+
+} // namespace KWin
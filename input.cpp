@@ -14,6 +14,7 @@
 #include "globalshortcuts.h"
 #include "input_event.h"
 #include "input_event_spy.h"
+#include "inputhitindex.h"
 #include "keyboard_input.h"
 #include "logind.h"
 #include "main.h"
@@ -1376,7 +1377,13 @@ public:
         case QEvent::MouseMove: {
             seat->setPointerPos(event->globalPos());
             MouseEvent *e = static_cast<MouseEvent*>(event);
-            if (e->delta() != QSizeF()) {
+            const auto relativeMotions = e->relativeMotions();
+            if (!relativeMotions.isEmpty()) {
+                // relative pointer clients get every motion of a coalesced event
+                for (const MouseEvent::RelativeMotion &motion : relativeMotions) {
+                    seat->relativePointerMotion(motion.delta, motion.deltaUnaccelerated, motion.timestampMicroseconds);
+                }
+            } else if (e->delta() != QSizeF()) {
                 seat->relativePointerMotion(e->delta(), e->deltaUnaccelerated(), e->timestampMicroseconds());
             }
             break;
@@ -2100,6 +2107,7 @@ void InputRedirection::setupWorkspace()
         m_touch->init();
         m_tablet->init();
     }
+    m_hitIndex = new InputHitIndex(this);
     setupInputFilters();
 }
 
@@ -2222,6 +2230,7 @@ void InputRedirection::setupLibInput()
         connect(conn, &LibInput::Connection::touchCanceled, m_touch, &TouchInputRedirection::cancel);
         connect(conn, &LibInput::Connection::touchFrame, m_touch, &TouchInputRedirection::frame);
         auto handleSwitchEvent = [this] (SwitchEvent::State state, quint32 time, quint64 timeMicroseconds, LibInput::Device *device) {
+            m_pointer->flushMotion();
             SwitchEvent event(state, time, timeMicroseconds, device);
             processSpies(std::bind(&InputEventSpy::switchEvent, std::placeholders::_1, &event));
             processFilters(std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
@@ -2423,7 +2432,7 @@ Qt::MouseButtons InputRedirection::qtButtonStates() const
 
 Toplevel *InputRedirection::findToplevel(const QPoint &pos)
 {
-    if (!Workspace::self()) {
+    if (!Workspace::self() || !m_hitIndex) {
         return nullptr;
     }
     const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
@@ -2433,8 +2442,8 @@ Toplevel *InputRedirection::findToplevel(const QPoint &pos)
         if (effects && static_cast<EffectsHandlerImpl*>(effects)->isMouseInterception()) {
             return nullptr;
         }
-        const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
-        foreach (Unmanaged *u, unmanaged) {
+        const QVector<Toplevel *> unmanaged = m_hitIndex->unmanagedCandidates(pos);
+        for (Toplevel *u : unmanaged) {
             if (u->hitTest(pos)) {
                 return u;
             }
@@ -2445,18 +2454,13 @@ Toplevel *InputRedirection::findToplevel(const QPoint &pos)
 
 Toplevel *InputRedirection::findManagedToplevel(const QPoint &pos)
 {
-    if (!Workspace::self()) {
+    if (!Workspace::self() || !m_hitIndex) {
         return nullptr;
     }
     const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
-    const QList<Toplevel *> &stacking = Workspace::self()->stackingOrder();
-    if (stacking.isEmpty()) {
-        return nullptr;
-    }
-    auto it = stacking.end();
-    do {
-        --it;
-        Toplevel *t = (*it);
+    // The candidates are ordered topmost first.
+    const QVector<Toplevel *> candidates = m_hitIndex->managedCandidates(pos);
+    for (Toplevel *t : candidates) {
         if (t->isDeleted()) {
             // a deleted window doesn't get mouse events
             continue;
@@ -2477,7 +2481,7 @@ Toplevel *InputRedirection::findManagedToplevel(const QPoint &pos)
         if (t->hitTest(pos)) {
             return t;
         }
-    } while (it != stacking.begin());
+    }
     return nullptr;
 }
 
@@ -34,6 +34,7 @@ class GlobalShortcutsManager;
 class Toplevel;
 class InputEventFilter;
 class InputEventSpy;
+class InputHitIndex;
 class KeyboardInputRedirection;
 class PointerInputRedirection;
 class TabletInputRedirection;
@@ -315,6 +316,7 @@ private:
     LibInput::Connection *m_libInput = nullptr;
 
     WindowSelectorFilter *m_windowSelector = nullptr;
+    InputHitIndex *m_hitIndex = nullptr;
 
     QVector<InputEventFilter*> m_filters;
     QVector<InputEventSpy*> m_spies;
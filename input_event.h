@@ -12,6 +12,7 @@
 #include "input.h"
 
 #include <QInputEvent>
+#include <QVector>
 
 namespace KWin
 {
@@ -24,6 +25,15 @@ class Device;
 class MouseEvent : public QMouseEvent
 {
 public:
+    /**
+     * A single relative motion reported by the input device.
+     */
+    struct RelativeMotion {
+        QSizeF delta;
+        QSizeF deltaUnaccelerated;
+        quint64 timestampMicroseconds;
+    };
+
     explicit MouseEvent(QEvent::Type type, const QPointF &pos, Qt::MouseButton button, Qt::MouseButtons buttons,
                         Qt::KeyboardModifiers modifiers, quint32 timestamp,
                         const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint64 timestampMicroseconds,
@@ -61,6 +71,18 @@ public:
         m_nativeButton = button;
     }
 
+    /**
+     * The individual relative motions of a coalesced motion event, oldest first. Empty if
+     * the event has not been coalesced.
+     */
+    QVector<RelativeMotion> relativeMotions() const {
+        return m_relativeMotions;
+    }
+
+    void setRelativeMotions(const QVector<RelativeMotion> &motions) {
+        m_relativeMotions = motions;
+    }
+
 private:
     QSizeF m_delta;
     QSizeF m_deltaUnccelerated;
@@ -68,6 +90,7 @@ private:
     LibInput::Device *m_device;
     Qt::KeyboardModifiers m_modifiersRelevantForShortcuts = Qt::KeyboardModifiers();
     quint32 m_nativeButton = 0;
+    QVector<RelativeMotion> m_relativeMotions;
 };
 
 // TODO: Don't derive from QWheelEvent, this event is quite domain specific.
@@ -0,0 +1,169 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "inputhitindex.h"
+#include "abstract_client.h"
+#include "screens.h"
+#include "unmanaged.h"
+#include "virtualdesktops.h"
+#include "workspace.h"
+#ifdef KWIN_BUILD_ACTIVITIES
+#include "activities.h"
+#endif
+
+#include <KWaylandServer/surface_interface.h>
+
+namespace KWin
+{
+
+static const int s_cellSize = 256;
+
+/**
+ * Returns a rectangle that contains every point for which Toplevel::hitTest() can
+ * succeed, including sub-surfaces that stick out of the main surface.
+ */
+static QRect inputBounds(const Toplevel *toplevel)
+{
+    QRect bounds = toplevel->inputGeometry() | toplevel->frameGeometry();
+    if (const KWaylandServer::SurfaceInterface *surface = toplevel->surface()) {
+        bounds |= surface->boundingRect().translated(toplevel->bufferGeometry().topLeft());
+    }
+    return bounds;
+}
+
+void InputHitIndex::Grid::build(const QRect &area, const QVector<Toplevel *> &toplevels)
+{
+    this->area = area;
+    columns = (area.width() + s_cellSize - 1) / s_cellSize;
+    rows = (area.height() + s_cellSize - 1) / s_cellSize;
+    all = toplevels;
+
+    cells.clear();
+    cells.resize(columns * rows);
+
+    for (Toplevel *toplevel : toplevels) {
+        const QRect bounds = inputBounds(toplevel).intersected(area).translated(-area.topLeft());
+        if (bounds.isEmpty()) {
+            continue;
+        }
+        const int left = bounds.left() / s_cellSize;
+        const int right = bounds.right() / s_cellSize;
+        const int top = bounds.top() / s_cellSize;
+        const int bottom = bounds.bottom() / s_cellSize;
+        for (int row = top; row <= bottom; ++row) {
+            for (int column = left; column <= right; ++column) {
+                cells[row * columns + column].append(toplevel);
+            }
+        }
+    }
+}
+
+QVector<Toplevel *> InputHitIndex::Grid::candidates(const QPoint &pos) const
+{
+    if (!area.contains(pos)) {
+        return all;
+    }
+    const QPoint local = pos - area.topLeft();
+    return cells.at(local.y() / s_cellSize * columns + local.x() / s_cellSize);
+}
+
+InputHitIndex::InputHitIndex(QObject *parent)
+    : QObject(parent)
+{
+    Workspace *ws = workspace();
+    connect(ws, &Workspace::stackingOrderChanged, this, &InputHitIndex::invalidate);
+    connect(ws, &Workspace::unmanagedAdded, this, &InputHitIndex::invalidate);
+    connect(ws, &Workspace::unmanagedRemoved, this, &InputHitIndex::invalidate);
+    connect(screens(), &Screens::changed, this, &InputHitIndex::invalidate);
+    connect(VirtualDesktopManager::self(), &VirtualDesktopManager::currentChanged,
+            this, &InputHitIndex::invalidate);
+#ifdef KWIN_BUILD_ACTIVITIES
+    if (Activities *activities = Activities::self()) {
+        connect(activities, &Activities::currentChanged, this, &InputHitIndex::invalidate);
+    }
+#endif
+}
+
+InputHitIndex::~InputHitIndex()
+{
+}
+
+void InputHitIndex::invalidate()
+{
+    m_dirty = true;
+}
+
+QVector<Toplevel *> InputHitIndex::managedCandidates(const QPoint &pos)
+{
+    if (m_dirty) {
+        rebuild();
+    }
+    return m_managed.candidates(pos);
+}
+
+QVector<Toplevel *> InputHitIndex::unmanagedCandidates(const QPoint &pos)
+{
+    if (m_dirty) {
+        rebuild();
+    }
+    return m_unmanaged.candidates(pos);
+}
+
+void InputHitIndex::watch(Toplevel *toplevel)
+{
+    // The index is rebuilt lazily, so it's enough to know that something has changed.
+    connect(toplevel, &QObject::destroyed, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    connect(toplevel, &Toplevel::frameGeometryChanged, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    connect(toplevel, &Toplevel::bufferGeometryChanged, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    connect(toplevel, &Toplevel::geometryShapeChanged, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    connect(toplevel, &Toplevel::surfaceChanged, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    if (AbstractClient *client = qobject_cast<AbstractClient *>(toplevel)) {
+        connect(client, &AbstractClient::desktopChanged, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+        connect(client, &AbstractClient::activitiesChanged, this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    }
+    if (KWaylandServer::SurfaceInterface *surface = toplevel->surface()) {
+        connect(surface, &KWaylandServer::SurfaceInterface::subSurfaceTreeChanged,
+                this, &InputHitIndex::invalidate, Qt::UniqueConnection);
+    }
+}
+
+void InputHitIndex::rebuild()
+{
+    m_dirty = false;
+
+    const QRect area = screens()->geometry();
+
+    const QList<Toplevel *> &stacking = workspace()->stackingOrder();
+    QVector<Toplevel *> managed;
+    managed.reserve(stacking.count());
+    for (auto it = stacking.crbegin(); it != stacking.crend(); ++it) {
+        Toplevel *toplevel = *it;
+        if (toplevel->isDeleted()) {
+            continue;
+        }
+        watch(toplevel);
+        if (AbstractClient *client = qobject_cast<AbstractClient *>(toplevel)) {
+            if (!client->isOnCurrentActivity() || !client->isOnCurrentDesktop()) {
+                continue;
+            }
+        }
+        managed.append(toplevel);
+    }
+    m_managed.build(area, managed);
+
+    const QList<Unmanaged *> &unmanagedList = workspace()->unmanagedList();
+    QVector<Toplevel *> unmanaged;
+    unmanaged.reserve(unmanagedList.count());
+    for (Unmanaged *toplevel : unmanagedList) {
+        watch(toplevel);
+        unmanaged.append(toplevel);
+    }
+    m_unmanaged.build(area, unmanaged);
+}
+
+} // namespace KWin
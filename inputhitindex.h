@@ -0,0 +1,79 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QObject>
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+class Toplevel;
+
+/**
+ * The InputHitIndex class is a spatial index that speeds up finding the window under
+ * a given position, e.g. for every pointer motion.
+ *
+ * The area covered by the screens is split into a grid of fixed size cells. Every cell
+ * holds the windows whose input area may intersect the cell, topmost first. The index
+ * only answers which windows are candidates, the caller still has to hit test them.
+ *
+ * Windows of other virtual desktops and activities are not indexed. The index is rebuilt
+ * lazily after the stacking order, the geometry of a window, the current desktop or the
+ * current activity have changed.
+ */
+class KWIN_EXPORT InputHitIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputHitIndex(QObject *parent = nullptr);
+    ~InputHitIndex() override;
+
+    /**
+     * Returns the managed windows whose input area may contain @p pos, topmost first.
+     */
+    QVector<Toplevel *> managedCandidates(const QPoint &pos);
+    /**
+     * Returns the unmanaged windows whose input area may contain @p pos, in the same
+     * order as Workspace::unmanagedList().
+     */
+    QVector<Toplevel *> unmanagedCandidates(const QPoint &pos);
+
+    /**
+     * Marks the index as outdated. It will be rebuilt on the next lookup.
+     */
+    void invalidate();
+
+private:
+    struct Grid
+    {
+        void build(const QRect &area, const QVector<Toplevel *> &toplevels);
+        QVector<Toplevel *> candidates(const QPoint &pos) const;
+
+        QRect area;
+        int columns = 0;
+        int rows = 0;
+        QVector<QVector<Toplevel *>> cells;
+        // Used for positions outside of the area covered by the cells.
+        QVector<Toplevel *> all;
+    };
+
+    void rebuild();
+    void watch(Toplevel *toplevel);
+
+    Grid m_managed;
+    Grid m_unmanaged;
+    bool m_dirty = true;
+};
+
+} // namespace KWin
@@ -13,6 +13,7 @@
 #include "keyboard_repeat.h"
 #include "abstract_client.h"
 #include "modifier_only_shortcuts.h"
+#include "pointer_input.h"
 #include "utils.h"
 #include "screenlockerwatcher.h"
 #include "toplevel.h"
@@ -181,6 +182,9 @@ void KeyboardInputRedirection::update()
 
 void KeyboardInputRedirection::processKey(uint32_t key, InputRedirection::KeyboardKeyState state, uint32_t time, LibInput::Device *device)
 {
+    // Pointer motion that has been coalesced so far happened before the key event.
+    input()->pointer()->flushMotion();
+
     QEvent::Type type;
     bool autoRepeat = false;
     switch (state) {
@@ -232,6 +236,7 @@ void KeyboardInputRedirection::processModifiers(uint32_t modsDepressed, uint32_t
     if (!m_inited) {
         return;
     }
+    input()->pointer()->flushMotion();
     const quint32 previousLayout = m_xkb->currentLayout();
     // TODO: send to proper Client and also send when active Client changes
     m_xkb->updateModifiers(modsDepressed, modsLatched, modsLocked, group);
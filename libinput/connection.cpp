@@ -31,6 +31,7 @@
 #include <QThread>
 
 #include <libinput.h>
+#include <chrono>
 #include <cmath>
 
 namespace KWin
@@ -43,6 +44,7 @@ class ConnectionAdaptor : public QObject
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.KWin.InputDeviceManager")
     Q_PROPERTY(QStringList devicesSysNames READ devicesSysNames CONSTANT)
+    Q_PROPERTY(QStringList dispatchLatencyHistogram READ dispatchLatencyHistogram)
 
 private:
     Connection *m_con;
@@ -71,6 +73,17 @@ public:
         return m_con->devicesSysNames();
     }
 
+    QStringList dispatchLatencyHistogram() {
+        QStringList buckets;
+        const QVector<quint64> histogram = m_con->dispatchLatencyHistogram();
+        for (int i = 0; i < histogram.count(); ++i) {
+            const QString bound = i == histogram.count() - 1 ? QStringLiteral(">=%1us").arg(quint64(1) << i)
+                                                              : QStringLiteral("<%1us").arg(quint64(1) << (i + 1));
+            buckets << bound + QLatin1Char(' ') + QString::number(histogram.at(i));
+        }
+        return buckets;
+    }
+
 Q_SIGNALS:
     void deviceAdded(QString sysName);
     void deviceRemoved(QString sysName);
@@ -225,20 +238,83 @@ void Connection::deactivate()
 void Connection::handleEvent()
 {
     QMutexLocker locker(&m_mutex);
-    const bool wasEmpty = m_eventQueue.isEmpty();
+    destroyReleasedEvents();
+    bool queued = false;
+    if (m_notifier && !m_notifier->isEnabled()) {
+        m_notifier->setEnabled(true);
+    }
     do {
+        if (m_outstandingEvents == int(EventQueue::capacity)) {
+            // Stop reading until the main thread has caught up, it resumes reading
+            // once it has drained the queue. The socket notifier is disabled in the
+            // meantime, the file descriptor stays readable and would fire continuously.
+            m_readStalled = true;
+            destroyReleasedEvents();
+            if (m_outstandingEvents == int(EventQueue::capacity) || !m_readStalled.exchange(false)) {
+                if (m_notifier) {
+                    m_notifier->setEnabled(false);
+                }
+                break;
+            }
+        }
         m_input->dispatch();
         Event *event = m_input->event();
         if (!event) {
             break;
         }
-        m_eventQueue << event;
+        const auto timestamp = std::chrono::steady_clock::now().time_since_epoch();
+        m_eventQueue.push(event, timestamp);
+        m_outstandingEvents++;
+        queued = true;
     } while (true);
-    if (wasEmpty && !m_eventQueue.isEmpty()) {
+    if (queued && !m_eventsPending.exchange(true)) {
         emit eventsRead();
     }
 }
 
+void Connection::destroyReleasedEvents()
+{
+    while (const EventQueue::Entry *entry = m_releasedEvents.peek()) {
+        Event *event = entry->event;
+        m_releasedEvents.pop();
+        delete event;
+        m_outstandingEvents--;
+    }
+}
+
+void Connection::releaseEvent(Event *event)
+{
+    // libinput is not thread safe, so the event is destroyed on the libinput thread the
+    // next time it reads events. The libinput thread never has more events in flight than
+    // the queue can hold, so there is always room to hand the event back.
+    const bool released = m_releasedEvents.push(event, std::chrono::nanoseconds::zero());
+    Q_ASSERT(released);
+    Q_UNUSED(released)
+}
+
+void Connection::EventReleaser::cleanup(Event *event)
+{
+    if (event) {
+        s_self->releaseEvent(event);
+    }
+}
+
+void Connection::recordDispatchLatency(std::chrono::nanoseconds timestamp)
+{
+    const auto latency = std::chrono::steady_clock::now().time_since_epoch() - timestamp;
+    const quint64 microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    int bucket = 0;
+    while (bucket < int(m_dispatchLatency.size()) - 1 && (microseconds >> (bucket + 1))) {
+        bucket++;
+    }
+    m_dispatchLatency[bucket]++;
+}
+
+QVector<quint64> Connection::dispatchLatencyHistogram() const
+{
+    return QVector<quint64>(m_dispatchLatency.cbegin(), m_dispatchLatency.cend());
+}
+
 #ifndef KWIN_BUILD_TESTING
 QPointF devicePointToGlobalPosition(const QPointF &devicePos, const AbstractWaylandOutput *output)
 {
@@ -272,14 +348,29 @@ QPointF devicePointToGlobalPosition(const QPointF &devicePos, const AbstractWayl
 
 void Connection::processEvents()
 {
-    QMutexLocker locker(&m_mutex);
-    while (!m_eventQueue.isEmpty()) {
-        QScopedPointer<Event> event(m_eventQueue.takeFirst());
+    // Cleared before draining, so that events read from now on trigger another dispatch.
+    m_eventsPending = false;
+    while (const EventQueue::Entry *entry = m_eventQueue.peek()) {
+        QScopedPointer<Event, EventReleaser> event(entry->event);
+        recordDispatchLatency(entry->timestamp);
+        m_eventQueue.pop();
         switch (event->type()) {
             case LIBINPUT_EVENT_DEVICE_ADDED: {
-                auto device = new Device(event->nativeDevice());
-                device->moveToThread(s_thread);
-                m_devices << device;
+                Device *device;
+                {
+                    // libinput is not thread safe, the devices are only accessed with the lock
+                    // held. It is released before emitting, so that reading can go on while the
+                    // event is handled.
+                    QMutexLocker locker(&m_mutex);
+                    device = new Device(event->nativeDevice());
+                    device->moveToThread(s_thread);
+                    m_devices << device;
+                    applyDeviceConfig(device);
+                    applyScreenToDevice(device);
+
+                    // enable possible leds
+                    libinput_device_led_update(device->device(), static_cast<libinput_led>(toLibinputLEDS(m_leds)));
+                }
                 if (device->isKeyboard()) {
                     m_keyboard++;
                     if (device->isAlphaNumericKeyboard()) {
@@ -310,23 +401,22 @@ void Connection::processEvents()
                         emit hasTabletModeSwitchChanged(true);
                     }
                 }
-                applyDeviceConfig(device);
-                applyScreenToDevice(device);
-
-                // enable possible leds
-                libinput_device_led_update(device->device(), static_cast<libinput_led>(toLibinputLEDS(m_leds)));
 
                 emit deviceAdded(device);
                 break;
             }
             case LIBINPUT_EVENT_DEVICE_REMOVED: {
-                auto it = std::find_if(m_devices.begin(), m_devices.end(), [&event] (Device *d) { return event->device() == d; } );
-                if (it == m_devices.end()) {
-                    // we don't know this device
-                    break;
+                Device *device;
+                {
+                    QMutexLocker locker(&m_mutex);
+                    auto it = std::find_if(m_devices.begin(), m_devices.end(), [&event] (Device *d) { return event->device() == d; } );
+                    if (it == m_devices.end()) {
+                        // we don't know this device
+                        break;
+                    }
+                    device = *it;
+                    m_devices.erase(it);
                 }
-                auto device = *it;
-                m_devices.erase(it);
                 emit deviceRemoved(device);
 
                 if (device->isKeyboard()) {
@@ -387,18 +477,18 @@ void Connection::processEvents()
                 auto deltaNonAccel = pe->deltaUnaccelerated();
                 quint32 latestTime = pe->time();
                 quint64 latestTimeUsec = pe->timeMicroseconds();
-                auto it = m_eventQueue.begin();
-                while (it != m_eventQueue.end()) {
-                    if ((*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
-                        QScopedPointer<PointerEvent> p(static_cast<PointerEvent*>(*it));
-                        delta += p->delta();
-                        deltaNonAccel += p->deltaUnaccelerated();
-                        latestTime = p->time();
-                        latestTimeUsec = p->timeMicroseconds();
-                        it = m_eventQueue.erase(it);
-                    } else {
+                while (const EventQueue::Entry *next = m_eventQueue.peek()) {
+                    if (next->event->type() != LIBINPUT_EVENT_POINTER_MOTION) {
                         break;
                     }
+                    QScopedPointer<Event, EventReleaser> p(next->event);
+                    recordDispatchLatency(next->timestamp);
+                    m_eventQueue.pop();
+                    PointerEvent *motion = static_cast<PointerEvent*>(p.data());
+                    delta += motion->delta();
+                    deltaNonAccel += motion->deltaUnaccelerated();
+                    latestTime = motion->time();
+                    latestTimeUsec = motion->timeMicroseconds();
                 }
                 emit pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, pe->device());
                 break;
@@ -635,6 +725,10 @@ void Connection::processEvents()
         }
         wasSuspended = false;
     }
+    if (m_readStalled.exchange(false)) {
+        // The libinput thread stopped reading because the queue was full.
+        QMetaObject::invokeMethod(this, [this] { handleEvent(); }, Qt::QueuedConnection);
+    }
 }
 
 void Connection::setScreenSize(const QSize &size)
@@ -11,6 +11,7 @@
 
 #include "../input.h"
 #include "../keyboard_input.h"
+#include "eventqueue.h"
 #include <kwinglobals.h>
 
 #include <QObject>
@@ -20,6 +21,9 @@
 #include <QVector>
 #include <QStringList>
 
+#include <array>
+#include <atomic>
+
 class QSocketNotifier;
 class QThread;
 
@@ -86,6 +90,13 @@ public:
 
     void updateLEDs(KWin::Xkb::LEDs leds);
 
+    /**
+     * Returns how many events waited how long between being read on the libinput thread
+     * and being dispatched on the main thread. Bucket @c i counts the events that waited
+     * less than 2^(i+1) microseconds, the last bucket also counts all longer waits.
+     */
+    QVector<quint64> dispatchLatencyHistogram() const;
+
     static void createThread();
 
 Q_SIGNALS:
@@ -142,6 +153,13 @@ private Q_SLOTS:
 private:
     Connection(Context *input, QObject *parent = nullptr);
     void handleEvent();
+    void destroyReleasedEvents();
+    void releaseEvent(Event *event);
+    void recordDispatchLatency(std::chrono::nanoseconds timestamp);
+    // Hands the processed events back to the libinput thread
+    struct EventReleaser {
+        static void cleanup(Event *event);
+    };
     void applyDeviceConfig(Device *device);
     void applyScreenToDevice(Device *device);
     Context *m_input;
@@ -158,7 +176,15 @@ private:
     bool m_touchBeforeSuspend = false;
     bool m_tabletModeSwitchBeforeSuspend = false;
     QMutex m_mutex;
-    QVector<Event*> m_eventQueue;
+    // Events read on the libinput thread and waiting to be processed on the main thread
+    EventQueue m_eventQueue;
+    // Processed events waiting to be destroyed on the libinput thread
+    EventQueue m_releasedEvents;
+    // Events that have been read but not destroyed yet, only used on the libinput thread
+    int m_outstandingEvents = 0;
+    std::atomic<bool> m_eventsPending{false};
+    std::atomic<bool> m_readStalled{false};
+    std::array<quint64, 20> m_dispatchLatency = {};
     bool wasSuspended = false;
     QVector<Device*> m_devices;
     KSharedConfigPtr m_config;
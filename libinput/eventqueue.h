@@ -0,0 +1,88 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_LIBINPUT_EVENTQUEUE_H
+#define KWIN_LIBINPUT_EVENTQUEUE_H
+
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace KWin
+{
+namespace LibInput
+{
+
+class Event;
+
+/**
+ * The EventQueue class is a bounded, lock-free queue that passes events from exactly one
+ * producer thread to exactly one consumer thread.
+ *
+ * push() may only be called by the producer, peek() and pop() only by the
+ * consumer.
+ */
+class EventQueue
+{
+public:
+    struct Entry {
+        Event *event = nullptr;
+        // when the event was pushed, on the steady clock
+        std::chrono::nanoseconds timestamp = std::chrono::nanoseconds::zero();
+    };
+
+    static constexpr quint32 capacity = 1024;
+
+    /**
+     * Appends the @p event to the queue. Returns @c false if the queue is full.
+     */
+    bool push(Event *event, std::chrono::nanoseconds timestamp) {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == capacity) {
+            return false;
+        }
+        m_entries[tail % capacity] = Entry{event, timestamp};
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns the oldest entry in the queue without removing it, or @c nullptr if the queue
+     * is empty.
+     */
+    const Entry *peek() const {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_entries[head % capacity];
+    }
+
+    /**
+     * Removes the oldest entry from the queue. The queue must not be empty.
+     */
+    void pop() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    static_assert((capacity & (capacity - 1)) == 0, "the capacity must be a power of two");
+
+    std::array<Entry, capacity> m_entries;
+    // The indices grow monotonically and wrap around, keep them on separate cache lines
+    // so that the producer and the consumer don't contend.
+    alignas(64) std::atomic<quint32> m_head{0};
+    alignas(64) std::atomic<quint32> m_tail{0};
+};
+
+}
+}
+
+#endif
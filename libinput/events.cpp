@@ -10,12 +10,86 @@
 #include "device.h"
 
 #include <QSize>
+#include <QVector>
 
 namespace KWin
 {
 namespace LibInput
 {
 
+// Large enough for every Event subclass
+static const std::size_t s_eventBlockSize = 64;
+// How many unused blocks a pool keeps around at most
+static const int s_eventPoolCapacity = 1024;
+
+static_assert(sizeof(KeyEvent) <= s_eventBlockSize, "KeyEvent does not fit in a pool block");
+static_assert(sizeof(PointerEvent) <= s_eventBlockSize, "PointerEvent does not fit in a pool block");
+static_assert(sizeof(TouchEvent) <= s_eventBlockSize, "TouchEvent does not fit in a pool block");
+static_assert(sizeof(PinchGestureEvent) <= s_eventBlockSize, "PinchGestureEvent does not fit in a pool block");
+static_assert(sizeof(SwipeGestureEvent) <= s_eventBlockSize, "SwipeGestureEvent does not fit in a pool block");
+static_assert(sizeof(SwitchEvent) <= s_eventBlockSize, "SwitchEvent does not fit in a pool block");
+static_assert(sizeof(TabletToolEvent) <= s_eventBlockSize, "TabletToolEvent does not fit in a pool block");
+static_assert(sizeof(TabletToolButtonEvent) <= s_eventBlockSize, "TabletToolButtonEvent does not fit in a pool block");
+static_assert(sizeof(TabletPadRingEvent) <= s_eventBlockSize, "TabletPadRingEvent does not fit in a pool block");
+static_assert(sizeof(TabletPadStripEvent) <= s_eventBlockSize, "TabletPadStripEvent does not fit in a pool block");
+static_assert(sizeof(TabletPadButtonEvent) <= s_eventBlockSize, "TabletPadButtonEvent does not fit in a pool block");
+
+namespace
+{
+
+class EventPool
+{
+public:
+    ~EventPool()
+    {
+        for (void *block : qAsConst(m_blocks)) {
+            ::operator delete(block);
+        }
+    }
+
+    void *allocate()
+    {
+        if (m_blocks.isEmpty()) {
+            return ::operator new(s_eventBlockSize);
+        }
+        return m_blocks.takeLast();
+    }
+
+    void release(void *block)
+    {
+        if (m_blocks.count() >= s_eventPoolCapacity) {
+            ::operator delete(block);
+        } else {
+            m_blocks.append(block);
+        }
+    }
+
+private:
+    QVector<void *> m_blocks;
+};
+
+// Events are created and destroyed on the libinput thread, a pool per thread needs no locking.
+thread_local EventPool s_eventPool;
+
+}
+
+void *Event::operator new(std::size_t size)
+{
+    if (size > s_eventBlockSize) {
+        return ::operator new(size);
+    }
+    return s_eventPool.allocate();
+}
+
+void Event::operator delete(void *pointer, std::size_t size)
+{
+    if (size > s_eventBlockSize) {
+        ::operator delete(pointer);
+    } else {
+        s_eventPool.release(pointer);
+    }
+}
+
 Event *Event::create(libinput_event *event)
 {
     if (!event) {
@@ -38,6 +38,13 @@ public:
 
     static Event *create(libinput_event *event);
 
+    /**
+     * Events are allocated from a per-thread pool of recycled memory blocks, so reading
+     * events does not hit the heap for every single event.
+     */
+    static void *operator new(std::size_t size);
+    static void operator delete(void *pointer, std::size_t size);
+
 protected:
     Event(libinput_event *event, libinput_event_type type);
 
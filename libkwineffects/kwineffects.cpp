@@ -34,8 +34,12 @@
 
 #if defined(__SSE2__)
 #  include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
 #endif
 
+#include <algorithm>
+
 
 namespace KWin
 {
@@ -612,6 +616,11 @@ bool Effect::isActive() const
     return true;
 }
 
+bool Effect::blocksDirectScanout() const
+{
+    return true;
+}
+
 QString Effect::debug(const QString &) const
 {
     return QString();
@@ -1303,6 +1312,220 @@ bool WindowQuadList::isTransformed() const
     return std::any_of(constBegin(), constEnd(), [] (const WindowQuad & q) { return q.isTransformed(); });
 }
 
+/***************************************************************
+ WindowQuadArray
+***************************************************************/
+
+static_assert(sizeof(GLVertex2D) == 4 * sizeof(float), "GLVertex2D must consist of four floats");
+
+namespace
+{
+
+// Holds one component of the four vertices of a quad.
+#if defined(__SSE2__)
+using Float4 = __m128;
+
+inline Float4 load4(const float *p) { return _mm_loadu_ps(p); }
+inline Float4 splat4(float a) { return _mm_set1_ps(a); }
+inline Float4 add4(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 mul4(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+
+inline bool equal4(Float4 a, Float4 b)
+{
+    return _mm_movemask_ps(_mm_cmpeq_ps(a, b)) == 0xf;
+}
+
+inline void interleave4(Float4 x, Float4 y, Float4 u, Float4 v, GLVertex2D *vertices)
+{
+    _MM_TRANSPOSE4_PS(x, y, u, v);
+    float *out = reinterpret_cast<float *>(vertices);
+    _mm_storeu_ps(out, x);
+    _mm_storeu_ps(out + 4, y);
+    _mm_storeu_ps(out + 8, u);
+    _mm_storeu_ps(out + 12, v);
+}
+#elif defined(__ARM_NEON)
+using Float4 = float32x4_t;
+
+inline Float4 load4(const float *p) { return vld1q_f32(p); }
+inline Float4 splat4(float a) { return vdupq_n_f32(a); }
+inline Float4 add4(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 mul4(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+
+inline bool equal4(Float4 a, Float4 b)
+{
+    const uint32x4_t equal = vceqq_f32(a, b);
+    const uint32x2_t m = vand_u32(vget_low_u32(equal), vget_high_u32(equal));
+    return (vget_lane_u32(m, 0) & vget_lane_u32(m, 1)) == 0xffffffff;
+}
+
+inline void interleave4(Float4 x, Float4 y, Float4 u, Float4 v, GLVertex2D *vertices)
+{
+    const float32x4x4_t components = {{ x, y, u, v }};
+    vst4q_f32(reinterpret_cast<float *>(vertices), components);
+}
+#else
+struct Float4
+{
+    float values[4];
+};
+
+inline Float4 load4(const float *p) { return Float4{{ p[0], p[1], p[2], p[3] }}; }
+inline Float4 splat4(float a) { return Float4{{ a, a, a, a }}; }
+
+template <typename Operation>
+inline Float4 apply4(Float4 a, Float4 b, Operation operation)
+{
+    Float4 result;
+    for (int i = 0; i < 4; ++i) {
+        result.values[i] = operation(a.values[i], b.values[i]);
+    }
+    return result;
+}
+
+inline Float4 add4(Float4 a, Float4 b) { return apply4(a, b, std::plus<float>()); }
+inline Float4 mul4(Float4 a, Float4 b) { return apply4(a, b, std::multiplies<float>()); }
+inline bool equal4(Float4 a, Float4 b) { return std::equal(a.values, a.values + 4, b.values); }
+
+inline void interleave4(Float4 x, Float4 y, Float4 u, Float4 v, GLVertex2D *vertices)
+{
+    for (int i = 0; i < 4; ++i) {
+        vertices[i].position = QVector2D(x.values[i], y.values[i]);
+        vertices[i].texcoord = QVector2D(u.values[i], v.values[i]);
+    }
+}
+#endif
+
+}
+
+WindowQuadArray::WindowQuadArray()
+{
+}
+
+WindowQuadArray::WindowQuadArray(const WindowQuadList &quads)
+{
+    reserve(quads.count());
+    for (const WindowQuad &quad : quads) {
+        append(quad);
+    }
+}
+
+void WindowQuadArray::reserve(int quadCount)
+{
+    m_x.reserve(quadCount * 4);
+    m_y.reserve(quadCount * 4);
+    m_originalX.reserve(quadCount * 4);
+    m_originalY.reserve(quadCount * 4);
+    m_textureX.reserve(quadCount * 4);
+    m_textureY.reserve(quadCount * 4);
+    m_types.reserve(quadCount);
+    m_ids.reserve(quadCount);
+    m_uvAxisSwapped.reserve(quadCount);
+}
+
+void WindowQuadArray::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_originalX.clear();
+    m_originalY.clear();
+    m_textureX.clear();
+    m_textureY.clear();
+    m_types.clear();
+    m_ids.clear();
+    m_uvAxisSwapped.clear();
+}
+
+void WindowQuadArray::append(const WindowQuad &quad)
+{
+    for (const WindowVertex &vertex : quad.verts) {
+        m_x.append(vertex.px);
+        m_y.append(vertex.py);
+        m_originalX.append(vertex.ox);
+        m_originalY.append(vertex.oy);
+        m_textureX.append(vertex.tx);
+        m_textureY.append(vertex.ty);
+    }
+    m_types.append(quad.quadType);
+    m_ids.append(quad.quadID);
+    m_uvAxisSwapped.append(quad.uvSwapped);
+}
+
+WindowQuad WindowQuadArray::at(int index) const
+{
+    WindowQuad quad(m_types.at(index), m_ids.at(index));
+    quad.setUVAxisSwapped(m_uvAxisSwapped.at(index));
+    for (int i = 0; i < 4; ++i) {
+        const int vertex = index * 4 + i;
+        quad.verts[i].px = m_x.at(vertex);
+        quad.verts[i].py = m_y.at(vertex);
+        quad.verts[i].ox = m_originalX.at(vertex);
+        quad.verts[i].oy = m_originalY.at(vertex);
+        quad.verts[i].tx = m_textureX.at(vertex);
+        quad.verts[i].ty = m_textureY.at(vertex);
+    }
+    return quad;
+}
+
+WindowQuadList WindowQuadArray::toList() const
+{
+    WindowQuadList ret;
+    ret.reserve(count());
+    for (int i = 0; i < count(); ++i) {
+        ret.append(at(i));
+    }
+    return ret;
+}
+
+bool WindowQuadArray::isTransformed() const
+{
+    for (int i = 0; i < m_x.count(); i += 4) {
+        if (!equal4(load4(m_x.constData() + i), load4(m_originalX.constData() + i)) ||
+                !equal4(load4(m_y.constData() + i), load4(m_originalY.constData() + i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WindowQuadArray::makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &textureMatrix) const
+{
+    // Since we know that the texture matrix just scales and translates
+    // we can use this information to optimize the transformation
+    const Float4 uCoeff = splat4(textureMatrix(0, 0));
+    const Float4 vCoeff = splat4(textureMatrix(1, 1));
+    const Float4 uOffset = splat4(textureMatrix(0, 3));
+    const Float4 vOffset = splat4(textureMatrix(1, 3));
+
+    Q_ASSERT(type == GL_QUADS || type == GL_TRIANGLES);
+
+    GLVertex2D *vertex = vertices;
+    for (int i = 0; i < m_x.count(); i += 4) {
+        const Float4 x = load4(m_x.constData() + i);
+        const Float4 y = load4(m_y.constData() + i);
+        const Float4 u = add4(mul4(load4(m_textureX.constData() + i), uCoeff), uOffset);
+        const Float4 v = add4(mul4(load4(m_textureY.constData() + i), vCoeff), vOffset);
+
+        if (type == GL_QUADS) {
+            interleave4(x, y, u, v, vertex);
+            vertex += 4;
+        } else {
+            GLVertex2D quad[4];
+            interleave4(x, y, u, v, quad);
+
+            // First triangle
+            *(vertex++) = quad[1]; // Top-right
+            *(vertex++) = quad[0]; // Top-left
+            *(vertex++) = quad[3]; // Bottom-left
+
+            // Second triangle
+            *(vertex++) = quad[3]; // Bottom-left
+            *(vertex++) = quad[2]; // Bottom-right
+            *(vertex++) = quad[1]; // Top-right
+        }
+    }
+}
+
 /***************************************************************
  PaintClipper
 ***************************************************************/
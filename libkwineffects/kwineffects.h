@@ -174,7 +174,7 @@ X-KDE-Library=kwin4_effect_cooleffect
 
 #define KWIN_EFFECT_API_MAKE_VERSION( major, minor ) (( major ) << 8 | ( minor ))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 232
+#define KWIN_EFFECT_API_VERSION_MINOR 233
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
         KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR )
 
@@ -557,6 +557,19 @@ public:
      */
     virtual int requestedEffectChainPosition() const;
 
+    /**
+     * Reimplement this method to indicate whether the effect can coexist with direct
+     * scanout, i.e. the topmost fullscreen window being shown on an output without
+     * being composited. Effects that alter the painting of such a window or paint on
+     * top of it must keep the default.
+     *
+     * The method is only consulted while the effect is active.
+     *
+     * The default implementation returns @c true.
+     * @since 5.21
+     */
+    virtual bool blocksDirectScanout() const;
+
 
     /**
      * A touch point was pressed.
@@ -2535,6 +2548,7 @@ public:
 private:
     friend class WindowQuad;
     friend class WindowQuadList;
+    friend class WindowQuadArray;
     double px, py; // position
     double ox, oy; // origional position
     double tx, ty; // texture coords
@@ -2571,6 +2585,7 @@ public:
     bool isTransformed() const;
 private:
     friend class WindowQuadList;
+    friend class WindowQuadArray;
     WindowVertex verts[ 4 ];
     WindowQuadType quadType; // 0 - contents, 1 - decoration
     bool uvSwapped;
@@ -2593,6 +2608,91 @@ public:
     bool isTransformed() const;
 };
 
+/**
+ * @short Compact structure-of-arrays storage for WindowQuads.
+ *
+ * WindowQuadArray holds the same data as a WindowQuadList, but keeps every vertex component
+ * in its own tightly packed float array. The four vertices of a quad are stored next to each
+ * other, clockwise starting from the top left corner, so the vertex of quad @c i at corner
+ * @c j is found at index <tt>i * 4 + j</tt>.
+ *
+ * Generating vertices for the GPU processes a whole quad at a time with SSE or NEON
+ * instructions where available. Unlike WindowQuadList, the array stores the vertices in
+ * single precision, which is what the GPU gets in either case.
+ *
+ * @since 5.21
+ */
+class KWINEFFECTS_EXPORT WindowQuadArray
+{
+public:
+    WindowQuadArray();
+    explicit WindowQuadArray(const WindowQuadList &quads);
+
+    int count() const {
+        return m_types.count();
+    }
+    bool isEmpty() const {
+        return m_types.isEmpty();
+    }
+    void reserve(int quadCount);
+    void clear();
+    void append(const WindowQuad &quad);
+    /**
+     * Returns the quad at @p index as a WindowQuad.
+     */
+    WindowQuad at(int index) const;
+    WindowQuadList toList() const;
+
+    WindowQuadType type(int index) const {
+        return m_types.at(index);
+    }
+    int id(int index) const {
+        return m_ids.at(index);
+    }
+
+    /**
+     * Vertex positions, these may be modified to transform the quads.
+     */
+    float *x() {
+        return m_x.data();
+    }
+    float *y() {
+        return m_y.data();
+    }
+    const float *x() const {
+        return m_x.constData();
+    }
+    const float *y() const {
+        return m_y.constData();
+    }
+    const float *originalX() const {
+        return m_originalX.constData();
+    }
+    const float *originalY() const {
+        return m_originalY.constData();
+    }
+    const float *textureX() const {
+        return m_textureX.constData();
+    }
+    const float *textureY() const {
+        return m_textureY.constData();
+    }
+
+    void makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &matrix) const;
+    bool isTransformed() const;
+
+private:
+    QVector<float> m_x;
+    QVector<float> m_y;
+    QVector<float> m_originalX;
+    QVector<float> m_originalY;
+    QVector<float> m_textureX;
+    QVector<float> m_textureY;
+    QVector<WindowQuadType> m_types;
+    QVector<int> m_ids;
+    QVector<bool> m_uvAxisSwapped;
+};
+
 class KWINEFFECTS_EXPORT WindowPrePaintData
 {
 public:
@@ -20,15 +20,21 @@
 #include <QPixmap>
 #include <QImage>
 #include <QHash>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
 #include <QMatrix4x4>
 #include <QVarLengthArray>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstring>
 #include <deque>
 
 #define DEBUG_GLRENDERTARGET 0
@@ -132,6 +138,147 @@ bool checkGLError(const char* txt)
     return hasError;
 }
 
+//****************************************
+// Program cache
+//****************************************
+
+// Linked programs are kept on disk with glGetProgramBinary(), so that the shaders don't have
+// to be compiled again on the next start. Drivers may reject a binary at any time, e.g.
+// after an update, in which case the shader is compiled from source.
+static bool s_programCacheEnabled = !qEnvironmentVariableIsSet("KWIN_GL_NO_PROGRAM_CACHE");
+static int s_programCacheHits = 0;
+
+static bool isProgramCacheSupported()
+{
+    if (!s_programCacheEnabled) {
+        return false;
+    }
+    // GL_OES_get_program_binary lacks glProgramParameteri() and GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+    // so OpenGL ES 2 is not supported.
+    if (GLPlatform::instance()->isGLES()) {
+        if (!hasGLVersion(3, 0)) {
+            return false;
+        }
+    } else if (!hasGLVersion(4, 1) && !hasGLExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+        return false;
+    }
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+int GLShader::programCacheHits()
+{
+    return s_programCacheHits;
+}
+
+QString GLShader::programCacheDirectory()
+{
+    const GLPlatform *platform = GLPlatform::instance();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(platform->glVendorString());
+    hash.addData(platform->glRendererString());
+    hash.addData(platform->glVersionString());
+    hash.addData(platform->glShadingLanguageVersionString());
+    hash.addData(QByteArray::number(platform->driverVersion()));
+    const QString driverKey = QString::fromLatin1(hash.result().toHex());
+
+    const QString basePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/kwin/glprograms/");
+
+    static QString s_prunedDriverKey;
+    if (s_prunedDriverKey != driverKey) {
+        s_prunedDriverKey = driverKey;
+        QDir baseDirectory(basePath);
+        const QStringList entries = baseDirectory.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString &entry : entries) {
+            if (entry != driverKey) {
+                QDir(baseDirectory.filePath(entry)).removeRecursively();
+            }
+        }
+    }
+
+    return basePath + driverKey;
+}
+
+static void clearProgramCache()
+{
+    const QString basePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + QStringLiteral("/kwin/glprograms/");
+    QDir(basePath).removeRecursively();
+}
+
+static QByteArray programCacheKey(const QByteArray &vertexSource, const QByteArray &fragmentSource, bool explicitLinking)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(vertexSource.size()));
+    hash.addData(vertexSource);
+    hash.addData(fragmentSource);
+    // Programs linked by the ShaderManager have their attribute locations bound explicitly.
+    hash.addData(explicitLinking ? QByteArrayLiteral("explicit") : QByteArrayLiteral("implicit"));
+    return hash.result().toHex();
+}
+
+static bool loadProgramBinary(GLuint program, const QByteArray &key)
+{
+    QFile file(GLShader::programCacheDirectory() + QLatin1Char('/') + QString::fromLatin1(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    if (data.size() <= int(sizeof(GLenum))) {
+        file.remove();
+        return false;
+    }
+
+    GLenum format;
+    memcpy(&format, data.constData(), sizeof(format));
+    glProgramBinary(program, format, data.constData() + sizeof(format), data.size() - sizeof(format));
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == 0) {
+        qCDebug(LIBKWINGLUTILS) << "The driver rejected the cached program" << key;
+        // An unknown binary format raises GL_INVALID_ENUM, which must not be mistaken
+        // for an error of the code that compiles the shader instead.
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        file.remove();
+        return false;
+    }
+
+    ++s_programCacheHits;
+    return true;
+}
+
+static void storeProgramBinary(GLuint program, const QByteArray &key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    QByteArray data(sizeof(GLenum) + length, Qt::Uninitialized);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, data.data() + sizeof(GLenum));
+    if (written <= 0) {
+        return;
+    }
+    memcpy(data.data(), &format, sizeof(format));
+    data.truncate(sizeof(GLenum) + written);
+
+    const QString directory = GLShader::programCacheDirectory();
+    if (!QDir().mkpath(directory)) {
+        return;
+    }
+    QSaveFile file(directory + QLatin1Char('/') + QString::fromLatin1(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qCDebug(LIBKWINGLUTILS) << "Failed to store the program binary" << key << file.errorString();
+    }
+}
+
 //****************************************
 // GLShader
 //****************************************
@@ -140,6 +287,7 @@ GLShader::GLShader(unsigned int flags)
     : mValid(false)
     , mLocationsResolved(false)
     , mExplicitLinking(flags & ExplicitLinking)
+    , mLoadedFromCache(false)
 {
     mProgram = glCreateProgram();
 }
@@ -148,6 +296,7 @@ GLShader::GLShader(const QString& vertexfile, const QString& fragmentfile, unsig
     : mValid(false)
     , mLocationsResolved(false)
     , mExplicitLinking(flags & ExplicitLinking)
+    , mLoadedFromCache(false)
 {
     mProgram = glCreateProgram();
     loadFromFiles(vertexfile, fragmentfile);
@@ -181,9 +330,17 @@ bool GLShader::loadFromFiles(const QString &vertexFile, const QString &fragmentF
 
 bool GLShader::link()
 {
+    // The program binary has been linked already.
+    if (mLoadedFromCache) {
+        return mValid;
+    }
+
     // Be optimistic
     mValid = true;
 
+    if (!mCacheKey.isEmpty()) {
+        glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(mProgram);
 
     // Get the program info log
@@ -204,6 +361,11 @@ bool GLShader::link()
         qCDebug(LIBKWINGLUTILS) << "Shader link log:" << log;
     }
 
+    if (mValid && !mCacheKey.isEmpty()) {
+        storeProgramBinary(mProgram, mCacheKey);
+    }
+    mCacheKey.clear();
+
     return mValid;
 }
 
@@ -270,6 +432,16 @@ bool GLShader::load(const QByteArray &vertexSource, const QByteArray &fragmentSo
 
     mValid = false;
 
+    if (isProgramCacheSupported()) {
+        mCacheKey = programCacheKey(vertexSource, fragmentSource, mExplicitLinking);
+        if (loadProgramBinary(mProgram, mCacheKey)) {
+            mCacheKey.clear();
+            mLoadedFromCache = true;
+            mValid = true;
+            return true;
+        }
+    }
+
     // Compile the vertex shader
     if (!vertexSource.isEmpty()) {
         bool success = compile(mProgram, GL_VERTEX_SHADER, vertexSource);
@@ -589,6 +761,45 @@ static QVector4D adjustSaturation(const QVector4D &color, float saturation)
 }
 
 bool ShaderManager::selfTest()
+{
+    if (runSelfTest()) {
+        return true;
+    }
+    if (s_programCacheHits == 0) {
+        return false;
+    }
+
+    // Drivers are supposed to reject binaries they can't use, but don't trust them blindly.
+    qCWarning(LIBKWINGLUTILS) << "Shader self test failed with cached programs, compiling the shaders from source";
+    clearProgramCache();
+    s_programCacheEnabled = false;
+    recompileShaders();
+
+    return runSelfTest();
+}
+
+void ShaderManager::recompileShaders()
+{
+    for (auto it = m_shaderHash.begin(); it != m_shaderHash.end(); ++it) {
+        GLShader *shader = it.value();
+        if (!shader->mLoadedFromCache) {
+            continue;
+        }
+        // Swap the programs rather than the shaders, the old ones may be on the stack.
+        GLShader *compiled = generateShader(it.key());
+        std::swap(shader->mProgram, compiled->mProgram);
+        shader->mValid = compiled->mValid;
+        shader->mLoadedFromCache = false;
+        shader->mLocationsResolved = false;
+        delete compiled;
+    }
+
+    if (!m_boundShaders.isEmpty()) {
+        m_boundShaders.top()->bind();
+    }
+}
+
+bool ShaderManager::runSelfTest()
 {
     bool pass = true;
 
@@ -1767,6 +1978,7 @@ public:
     static bool haveSyncFences;
     static bool hasMapBufferRange;
     static bool supportsIndexedQuads;
+    static bool haveMultiDraw;
     QByteArray dataStore;
     bool persistent;
     bool useColor;
@@ -1787,6 +1999,7 @@ public:
 
 bool GLVertexBufferPrivate::hasMapBufferRange = false;
 bool GLVertexBufferPrivate::supportsIndexedQuads = false;
+bool GLVertexBufferPrivate::haveMultiDraw = false;
 GLVertexBuffer *GLVertexBufferPrivate::streamingBuffer = nullptr;
 bool GLVertexBufferPrivate::haveBufferStorage = false;
 bool GLVertexBufferPrivate::haveSyncFences = false;
@@ -2180,6 +2393,59 @@ void GLVertexBuffer::draw(const QRegion &region, GLenum primitiveMode, int first
     }
 }
 
+void GLVertexBuffer::multiDraw(const QRegion &region, GLenum primitiveMode, const int *first, const int *count,
+                               int drawCount, bool hardwareClipping)
+{
+    if (drawCount == 1 || !GLVertexBufferPrivate::haveMultiDraw) {
+        for (int i = 0; i < drawCount; ++i) {
+            draw(region, primitiveMode, first[i], count[i], hardwareClipping);
+        }
+        return;
+    }
+
+    QVarLengthArray<GLsizei, 16> counts(drawCount);
+    QVarLengthArray<const GLvoid *, 16> indices;
+    if (primitiveMode == GL_QUADS) {
+        IndexBuffer *&indexBuffer = GLVertexBufferPrivate::s_indexBuffer;
+
+        if (!indexBuffer)
+            indexBuffer = new IndexBuffer;
+
+        indexBuffer->bind();
+        indexBuffer->accommodate(*std::max_element(count, count + drawCount) / 4);
+
+        indices.resize(drawCount);
+        for (int i = 0; i < drawCount; ++i) {
+            counts[i] = count[i] * 6 / 4;
+            indices[i] = nullptr;
+        }
+    } else {
+        std::copy(count, count + drawCount, counts.begin());
+    }
+
+    auto drawRanges = [&]() {
+        if (primitiveMode == GL_QUADS) {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.constData(), GL_UNSIGNED_SHORT,
+                                          indices.constData(), drawCount, first);
+        } else {
+            glMultiDrawArrays(primitiveMode, first, counts.constData(), drawCount);
+        }
+    };
+
+    if (!hardwareClipping) {
+        drawRanges();
+    } else {
+        // Clip using scissoring
+        for (const QRect &r : region) {
+            glScissor((r.x() - s_virtualScreenGeometry.x()) * s_virtualScreenScale,
+                      (s_virtualScreenGeometry.height() + s_virtualScreenGeometry.y() - r.y() - r.height()) * s_virtualScreenScale,
+                      r.width() * s_virtualScreenScale,
+                      r.height() * s_virtualScreenScale);
+            drawRanges();
+        }
+    }
+}
+
 bool GLVertexBuffer::supportsIndexedQuads()
 {
     return GLVertexBufferPrivate::supportsIndexedQuads;
@@ -2262,6 +2528,7 @@ void GLVertexBuffer::initStatic()
 
         GLVertexBufferPrivate::hasMapBufferRange = haveMapBufferRange;
         GLVertexBufferPrivate::supportsIndexedQuads = haveBaseVertex && haveCopyBuffer && haveMapBufferRange;
+        GLVertexBufferPrivate::haveMultiDraw = hasGLExtension(QByteArrayLiteral("GL_EXT_multi_draw_arrays"));
         GLVertexBufferPrivate::haveBufferStorage = hasGLExtension("GL_EXT_buffer_storage");
         GLVertexBufferPrivate::haveSyncFences = hasGLVersion(3, 0);
     } else {
@@ -2271,6 +2538,7 @@ void GLVertexBuffer::initStatic()
 
         GLVertexBufferPrivate::hasMapBufferRange = haveMapBufferRange;
         GLVertexBufferPrivate::supportsIndexedQuads = haveBaseVertex && haveCopyBuffer && haveMapBufferRange;
+        GLVertexBufferPrivate::haveMultiDraw = true;
         GLVertexBufferPrivate::haveBufferStorage = hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage");
         GLVertexBufferPrivate::haveSyncFences = hasGLVersion(3, 2) || hasGLExtension("GL_ARB_sync");
     }
@@ -2290,6 +2558,7 @@ void GLVertexBuffer::cleanup()
     GLVertexBufferPrivate::s_indexBuffer = nullptr;
     GLVertexBufferPrivate::hasMapBufferRange = false;
     GLVertexBufferPrivate::supportsIndexedQuads = false;
+    GLVertexBufferPrivate::haveMultiDraw = false;
     delete GLVertexBufferPrivate::streamingBuffer;
     GLVertexBufferPrivate::streamingBuffer = nullptr;
 }
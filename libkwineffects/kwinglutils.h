@@ -145,6 +145,19 @@ public:
     bool setUniform(ColorUniform uniform,  const QVector4D &value);
     bool setUniform(ColorUniform uniform,  const QColor &value);
 
+    /**
+     * Returns how many programs have been loaded from the program binary cache instead
+     * of being compiled from source.
+     * @since 5.21
+     */
+    static int programCacheHits();
+    /**
+     * Returns the directory with the cached program binaries of the current driver. The
+     * binaries of other drivers, or of other versions of the same driver, are removed.
+     * @since 5.21
+     */
+    static QString programCacheDirectory();
+
 protected:
     GLShader(unsigned int flags = NoFlags);
     bool loadFromFiles(const QString& vertexfile, const QString& fragmentfile);
@@ -160,6 +173,9 @@ private:
     bool mValid:1;
     bool mLocationsResolved:1;
     bool mExplicitLinking:1;
+    bool mLoadedFromCache:1;
+    // Identifies the program binary in the program cache, empty if it's not going to be cached
+    QByteArray mCacheKey;
     int mMatrixLocation[MatrixCount];
     int mVec2Location[Vec2UniformCount];
     int mVec4Location[Vec4UniformCount];
@@ -288,6 +304,9 @@ public:
     /**
      * Compiles and tests the dynamically generated shaders.
      * Returns true if successful and false otherwise.
+     *
+     * If the test fails with shaders that have been loaded from the program cache, the cache
+     * is discarded and the test is repeated with shaders compiled from source.
      */
     bool selfTest();
 
@@ -311,6 +330,8 @@ private:
     QByteArray generateVertexSource(ShaderTraits traits) const;
     QByteArray generateFragmentSource(ShaderTraits traits) const;
     GLShader *generateShader(ShaderTraits traits);
+    bool runSelfTest();
+    void recompileShaders();
 
     QStack<GLShader*> m_boundShaders;
     QHash<ShaderTraits, GLShader *> m_shaderHash;
@@ -700,6 +721,15 @@ public:
      */
     void draw(const QRegion &region, GLenum primitiveMode, int first, int count, bool hardwareClipping = false);
 
+    /**
+     * Draws @p drawCount ranges of vertices with a single draw call where supported. The
+     * range @c i begins with @p first[i] and has @p count[i] vertices. The draws are
+     * restricted to @p region if @p hardwareClipping is true.
+     * @since 5.21
+     */
+    void multiDraw(const QRegion &region, GLenum primitiveMode, const int *first, const int *count,
+                   int drawCount, bool hardwareClipping = false);
+
     /**
      * Renders the vertex data in given @a primitiveMode.
      * Please refer to OpenGL documentation of glDrawArrays or glDrawElements for allowed
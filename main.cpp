@@ -21,6 +21,7 @@
 #include "screens.h"
 #include "screenlockerwatcher.h"
 #include "sm.h"
+#include "startuptimeline.h"
 #include "workspace.h"
 #include "xcbutils.h"
 
@@ -143,6 +144,8 @@ void Application::start()
 
 Application::~Application()
 {
+    // Write whatever has been recorded if KWin quits during the startup.
+    StartupTimeline::write();
     delete options;
     destroyAtoms();
     destroyPlatform();
@@ -150,6 +153,7 @@ Application::~Application()
 
 void Application::notifyStarted()
 {
+    StartupTimeline::finishStartup();
     emit started();
 }
 
@@ -257,6 +261,8 @@ void Application::setupLocalizedString()
 
 void Application::createWorkspace()
 {
+    StartupTimeline::Phase phase(QStringLiteral("Workspace construction"));
+
     // we want all QQuickWindows with an alpha buffer, do here as Workspace might create QQuickWindows
     QQuickWindow::setDefaultAlphaBuffer(true);
 
@@ -271,6 +277,7 @@ void Application::createWorkspace()
 
 void Application::createInput()
 {
+    StartupTimeline::Phase phase(QStringLiteral("Application::createInput"));
     ScreenLockerWatcher::create(this);
     LogindIntegration::create(this);
     auto input = InputRedirection::create(this);
@@ -294,11 +301,13 @@ void Application::createAtoms()
 
 void Application::createOptions()
 {
+    StartupTimeline::Phase phase(QStringLiteral("Application::createOptions"));
     options = new Options;
 }
 
 void Application::createPlugins()
 {
+    StartupTimeline::Phase phase(QStringLiteral("Application::createPlugins"));
     PluginManager::create(this);
 }
 
@@ -435,6 +444,7 @@ QProcessEnvironment Application::processStartupEnvironment() const
 
 void Application::initPlatform(const KPluginMetaData &plugin)
 {
+    StartupTimeline::Phase phase(QStringLiteral("Application::initPlatform"));
     Q_ASSERT(!m_platform);
     m_platform = qobject_cast<Platform *>(plugin.instantiate());
     if (m_platform) {
@@ -14,6 +14,7 @@
 // kwin
 #include "platform.h"
 #include "effects.h"
+#include "startuptimeline.h"
 #include "tabletmodemanager.h"
 
 #include "wayland_server.h"
@@ -143,6 +144,7 @@ ApplicationWayland::~ApplicationWayland()
 
 void ApplicationWayland::performStartup()
 {
+    StartupTimeline::Phase phase(QStringLiteral("ApplicationWayland::performStartup"));
     if (m_startXWayland) {
         setOperationMode(OperationModeXwayland);
     }
@@ -163,6 +165,8 @@ void ApplicationWayland::performStartup()
 
 void ApplicationWayland::createBackend()
 {
+    StartupTimeline::Phase phase(QStringLiteral("ApplicationWayland::createBackend"));
+    StartupTimeline::begin(QStringLiteral("Backend initialization"));
     connect(platform(), &Platform::screensQueried, this, &ApplicationWayland::continueStartupWithScreens);
     connect(platform(), &Platform::initFailed, this,
         [] () {
@@ -175,10 +179,13 @@ void ApplicationWayland::createBackend()
 
 void ApplicationWayland::continueStartupWithScreens()
 {
+    StartupTimeline::end(QStringLiteral("Backend initialization"));
+    StartupTimeline::Phase phase(QStringLiteral("ApplicationWayland::continueStartupWithScreens"));
     disconnect(kwinApp()->platform(), &Platform::screensQueried, this, &ApplicationWayland::continueStartupWithScreens);
     createScreens();
     WaylandCompositor::create();
     connect(Compositor::self(), &Compositor::sceneCreated, this, &ApplicationWayland::continueStartupWithScene);
+    StartupTimeline::begin(QStringLiteral("Scene creation"));
 }
 
 void ApplicationWayland::finalizeStartup()
@@ -186,6 +193,8 @@ void ApplicationWayland::finalizeStartup()
     if (m_xwayland) {
         disconnect(m_xwayland, &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
         disconnect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+        disconnect(m_xwayland, &Xwl::Xwayland::listening, this, &ApplicationWayland::finalizeStartup);
+        StartupTimeline::end(QStringLiteral("Xwayland startup"));
     }
     startSession();
     notifyStarted();
@@ -193,6 +202,8 @@ void ApplicationWayland::finalizeStartup()
 
 void ApplicationWayland::continueStartupWithScene()
 {
+    StartupTimeline::end(QStringLiteral("Scene creation"));
+    StartupTimeline::Phase phase(QStringLiteral("ApplicationWayland::continueStartupWithScene"));
     disconnect(Compositor::self(), &Compositor::sceneCreated, this, &ApplicationWayland::continueStartupWithScene);
 
     // Note that we start accepting client connections after creating the Workspace.
@@ -210,6 +221,8 @@ void ApplicationWayland::continueStartupWithScene()
     m_xwayland = new Xwl::Xwayland(this);
     connect(m_xwayland, &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
     connect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+    connect(m_xwayland, &Xwl::Xwayland::listening, this, &ApplicationWayland::finalizeStartup);
+    StartupTimeline::begin(QStringLiteral("Xwayland startup"));
     m_xwayland->start();
 }
 
@@ -399,6 +412,7 @@ int main(int argc, char * argv[])
         std::cerr << "kwin_wayland does not support running as root." << std::endl;
         return 1;
     }
+    KWin::StartupTimeline::begin(QStringLiteral("Startup"));
     KWin::disablePtrace();
     KWin::Application::setupMalloc();
     KWin::Application::setupLocalizedString();
@@ -430,7 +444,9 @@ int main(int argc, char * argv[])
     qputenv("QT_IM_MODULE", "qtvirtualkeyboard");
     qputenv("QSG_RENDER_LOOP", "basic");
     QCoreApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
+    KWin::StartupTimeline::begin(QStringLiteral("Application construction"));
     KWin::ApplicationWayland a(argc, argv);
+    KWin::StartupTimeline::end(QStringLiteral("Application construction"));
     a.setupTranslator();
     // reset QT_QPA_PLATFORM to a sane value for any processes started from KWin
     setenv("QT_QPA_PLATFORM", "wayland", true);
@@ -676,10 +692,12 @@ int main(int argc, char * argv[])
     if (parser.isSet(noGlobalShortcutsOption)) {
         flags |= KWin::WaylandServer::InitializationFlag::NoGlobalShortcuts;
     }
+    KWin::StartupTimeline::begin(QStringLiteral("WaylandServer::init"));
     if (!server->init(parser.value(waylandSocketOption).toUtf8(), flags)) {
         std::cerr << "FATAL ERROR: could not create Wayland server" << std::endl;
         return 1;
     }
+    KWin::StartupTimeline::end(QStringLiteral("WaylandServer::init"));
 
     a.initPlatform(*pluginIt);
     if (!a.platform()) {
@@ -14,6 +14,7 @@
 
 #include "platform.h"
 #include "sm.h"
+#include "startuptimeline.h"
 #include "workspace.h"
 #include "xcbutils.h"
 
@@ -213,6 +214,7 @@ static xcb_screen_t *findXcbScreen(xcb_connection_t *connection, int screen)
 
 void ApplicationX11::performStartup()
 {
+    StartupTimeline::Phase phase(QStringLiteral("ApplicationX11::performStartup"));
     crashChecking();
 
     if (Application::x11ScreenNumber() == -1) {
@@ -227,6 +229,8 @@ void ApplicationX11::performStartup()
     });
     connect(owner.data(), &KSelectionOwner::lostOwnership, this, &ApplicationX11::lostSelection);
     connect(owner.data(), &KSelectionOwner::claimedOwnership, [this]{
+        StartupTimeline::end(QStringLiteral("Selection claim"));
+        StartupTimeline::Phase phase(QStringLiteral("ApplicationX11::performStartup (claimed ownership)"));
         installNativeX11EventFilter();
         // first load options - done internally by a different thread
         createOptions();
@@ -248,6 +252,8 @@ void ApplicationX11::performStartup()
 
         connect(platform(), &Platform::screensQueried, this,
             [this] {
+                StartupTimeline::end(QStringLiteral("Backend initialization"));
+                StartupTimeline::Phase phase(QStringLiteral("ApplicationX11::performStartup (screens queried)"));
                 createWorkspace();
                 createPlugins();
 
@@ -264,10 +270,12 @@ void ApplicationX11::performStartup()
                 ::exit(1);
             }
         );
+        StartupTimeline::begin(QStringLiteral("Backend initialization"));
         platform()->init();
     });
     // we need to do an XSync here, otherwise the QPA might crash us later on
     Xcb::sync();
+    StartupTimeline::begin(QStringLiteral("Selection claim"));
     owner->claim(m_replace || wasCrash(), true);
 
     createAtoms();
@@ -344,6 +352,7 @@ void ApplicationX11::crashHandler(int signal)
 
 int main(int argc, char * argv[])
 {
+    KWin::StartupTimeline::begin(QStringLiteral("Startup"));
     KWin::Application::setupMalloc();
     KWin::Application::setupLocalizedString();
 
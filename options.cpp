@@ -97,6 +97,8 @@ Options::Options(QObject *parent)
     , m_hideUtilityWindowsForInactive(false)
     , m_xwaylandCrashPolicy(Options::defaultXwaylandCrashPolicy())
     , m_xwaylandMaxCrashCount(Options::defaultXwaylandMaxCrashCount())
+    , m_xwaylandStartOnDemand(Options::defaultXwaylandStartOnDemand())
+    , m_xwaylandIdleTimeout(Options::defaultXwaylandIdleTimeout())
     , m_compositingMode(Options::defaultCompositingMode())
     , m_useCompositing(Options::defaultUseCompositing())
     , m_hiddenPreviews(Options::defaultHiddenPreviews())
@@ -192,6 +194,24 @@ void Options::setXwaylandMaxCrashCount(int maxCrashCount)
     emit xwaylandMaxCrashCountChanged();
 }
 
+void Options::setXwaylandStartOnDemand(bool startOnDemand)
+{
+    if (m_xwaylandStartOnDemand == startOnDemand) {
+        return;
+    }
+    m_xwaylandStartOnDemand = startOnDemand;
+    emit xwaylandStartOnDemandChanged();
+}
+
+void Options::setXwaylandIdleTimeout(int idleTimeout)
+{
+    if (m_xwaylandIdleTimeout == idleTimeout) {
+        return;
+    }
+    m_xwaylandIdleTimeout = idleTimeout;
+    emit xwaylandIdleTimeoutChanged();
+}
+
 void Options::setClickRaise(bool clickRaise)
 {
     if (m_autoRaise) {
@@ -835,6 +855,8 @@ void Options::syncFromKcfgc()
     setFocusStealingPreventionLevel(m_settings->focusStealingPreventionLevel());
     setXwaylandCrashPolicy(m_settings->xwaylandCrashPolicy());
     setXwaylandMaxCrashCount(m_settings->xwaylandMaxCrashCount());
+    setXwaylandStartOnDemand(m_settings->xwaylandStartOnDemand());
+    setXwaylandIdleTimeout(m_settings->xwaylandIdleTimeout());
 
 #ifdef KWIN_BUILD_DECORATIONS
     setPlacement(m_settings->placement());
@@ -51,6 +51,8 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(FocusPolicy focusPolicy READ focusPolicy WRITE setFocusPolicy NOTIFY focusPolicyChanged)
     Q_PROPERTY(XwaylandCrashPolicy xwaylandCrashPolicy READ xwaylandCrashPolicy WRITE setXwaylandCrashPolicy NOTIFY xwaylandCrashPolicyChanged)
     Q_PROPERTY(int xwaylandMaxCrashCount READ xwaylandMaxCrashCount WRITE setXwaylandMaxCrashCount NOTIFY xwaylandMaxCrashCountChanged)
+    Q_PROPERTY(bool xwaylandStartOnDemand READ xwaylandStartOnDemand WRITE setXwaylandStartOnDemand NOTIFY xwaylandStartOnDemandChanged)
+    Q_PROPERTY(int xwaylandIdleTimeout READ xwaylandIdleTimeout WRITE setXwaylandIdleTimeout NOTIFY xwaylandIdleTimeoutChanged)
     Q_PROPERTY(bool nextFocusPrefersMouse READ isNextFocusPrefersMouse WRITE setNextFocusPrefersMouse NOTIFY nextFocusPrefersMouseChanged)
     /**
      * Whether clicking on a window raises it in FocusFollowsMouse
@@ -235,6 +237,19 @@ public:
     int xwaylandMaxCrashCount() const {
         return m_xwaylandMaxCrashCount;
     }
+    /**
+     * Whether Xwayland is only spawned when the first X11 client connects.
+     */
+    bool xwaylandStartOnDemand() const {
+        return m_xwaylandStartOnDemand;
+    }
+    /**
+     * Seconds after the last X11 window is closed until an on demand Xwayland is stopped,
+     * or 0 to keep it running.
+     */
+    int xwaylandIdleTimeout() const {
+        return m_xwaylandIdleTimeout;
+    }
 
     /**
      * Whether clicking on a window raises it in FocusFollowsMouse
@@ -599,6 +614,8 @@ public:
     void setFocusPolicy(FocusPolicy focusPolicy);
     void setXwaylandCrashPolicy(XwaylandCrashPolicy crashPolicy);
     void setXwaylandMaxCrashCount(int maxCrashCount);
+    void setXwaylandStartOnDemand(bool startOnDemand);
+    void setXwaylandIdleTimeout(int idleTimeout);
     void setNextFocusPrefersMouse(bool nextFocusPrefersMouse);
     void setClickRaise(bool clickRaise);
     void setAutoRaise(bool autoRaise);
@@ -765,6 +782,12 @@ public:
     static int defaultXwaylandMaxCrashCount() {
         return 3;
     }
+    static bool defaultXwaylandStartOnDemand() {
+        return false;
+    }
+    static int defaultXwaylandIdleTimeout() {
+        return 0;
+    }
     /**
      * Performs loading all settings except compositing related.
      */
@@ -784,6 +807,8 @@ Q_SIGNALS:
     void focusPolicyIsResonableChanged();
     void xwaylandCrashPolicyChanged();
     void xwaylandMaxCrashCountChanged();
+    void xwaylandStartOnDemandChanged();
+    void xwaylandIdleTimeoutChanged();
     void nextFocusPrefersMouseChanged();
     void clickRaiseChanged();
     void autoRaiseChanged();
@@ -869,6 +894,8 @@ private:
     bool m_hideUtilityWindowsForInactive;
     XwaylandCrashPolicy m_xwaylandCrashPolicy;
     int m_xwaylandMaxCrashCount;
+    bool m_xwaylandStartOnDemand;
+    int m_xwaylandIdleTimeout;
 
     CompositingType m_compositingMode;
     bool m_useCompositing;
@@ -17,6 +17,7 @@
 #include "overlaywindow.h"
 #include "outline.h"
 #include "pointer_input.h"
+#include "renderloop.h"
 #include "scene.h"
 #include "screens.h"
 #include "screenedge.h"
@@ -35,6 +36,7 @@ namespace KWin
 Platform::Platform(QObject *parent)
     : QObject(parent)
     , m_eglDisplay(EGL_NO_DISPLAY)
+    , m_renderLoop(new RenderLoop(this))
 {
     setSoftwareCursorForced(false);
     connect(Cursors::self(), &Cursors::currentCursorRendered, this, &Platform::cursorRendered);
@@ -444,6 +446,11 @@ void Platform::setPerScreenRenderingEnabled(bool enabled)
     m_isPerScreenRenderingEnabled = enabled;
 }
 
+RenderLoop *Platform::renderLoop() const
+{
+    return m_renderLoop;
+}
+
 void Platform::warpPointer(const QPointF &globalPos)
 {
     Q_UNUSED(globalPos)
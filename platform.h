@@ -38,6 +38,7 @@ class OpenGLBackend;
 class Outline;
 class OutlineVisual;
 class QPainterBackend;
+class RenderLoop;
 class Scene;
 class Screens;
 class ScreenEdges;
@@ -459,6 +460,14 @@ public:
      */
     bool isPerScreenRenderingEnabled() const;
 
+    /**
+     * Returns the render loop that drives the compositing of this platform.
+     *
+     * The render loop is fed with the presentation timestamps of the frames
+     * rendered by the compositor.
+     */
+    RenderLoop *renderLoop() const;
+
 public Q_SLOTS:
     void pointerMotion(const QPointF &position, quint32 time);
     void pointerButtonPressed(quint32 button, quint32 time);
@@ -573,6 +582,7 @@ private:
     bool m_supportsGammaControl = false;
     bool m_supportsOutputChanges = false;
     bool m_isPerScreenRenderingEnabled = false;
+    RenderLoop *m_renderLoop;
     CompositingType m_selectedCompositor = NoCompositing;
 };
 
@@ -27,6 +27,7 @@
 #include <QOpenGLContext>
 #include <QOpenGLFramebufferObject>
 
+#include <cstring>
 #include <memory>
 
 namespace KWin
@@ -402,6 +403,9 @@ AbstractEglTexture::~AbstractEglTexture()
     if (m_image != EGL_NO_IMAGE_KHR) {
         eglDestroyImageKHR(m_backend->eglDisplay(), m_image);
     }
+    if (m_pixelBuffer) {
+        glDeleteBuffers(1, &m_pixelBuffer);
+    }
 }
 
 OpenGLBackend *AbstractEglTexture::backend()
@@ -541,31 +545,91 @@ bool AbstractEglTexture::createTextureImage(const QImage &image)
 
 void AbstractEglTexture::createTextureSubImage(const QImage &image, const QRegion &damage)
 {
-    q->bind();
+    // Find the layout the texture is uploaded with. If the image already has it, which is
+    // the common case for shm buffers, the damaged areas are read straight from the image.
+    QImage::Format uploadFormat;
+    GLenum format;
     if (GLPlatform::instance()->isGLES()) {
         if (s_supportsARGB32 && (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied)) {
-            const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-            for (const QRect &rect : damage) {
-                glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
-                                GL_BGRA_EXT, GL_UNSIGNED_BYTE, im.copy(rect).bits());
-            }
+            uploadFormat = QImage::Format_ARGB32_Premultiplied;
+            format = GL_BGRA_EXT;
         } else {
-            const QImage im = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
-            for (const QRect &rect : damage) {
-                glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
-                                GL_RGBA, GL_UNSIGNED_BYTE, im.copy(rect).bits());
-            }
+            uploadFormat = QImage::Format_RGBA8888_Premultiplied;
+            format = GL_RGBA;
         }
     } else {
-        const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-        for (const QRect &rect : damage) {
-            glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
-                            GL_BGRA, GL_UNSIGNED_BYTE, im.copy(rect).bits());
+        // RGB32 images back GL_RGB8 textures, so the undefined alpha channel is irrelevant.
+        uploadFormat = image.format() == QImage::Format_RGB32 ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied;
+        format = GL_BGRA;
+    }
+
+    q->bind();
+    for (const QRect &rect : damage) {
+        const QRect source = rect & image.rect();
+        if (source.isEmpty()) {
+            continue;
+        }
+        if (image.format() == uploadFormat) {
+            uploadSubImage(image, source, source.topLeft(), format);
+        } else {
+            // Only convert the damaged part of the image.
+            const QImage converted = image.copy(source).convertToFormat(uploadFormat);
+            uploadSubImage(converted, converted.rect(), source.topLeft(), format);
         }
     }
     q->unbind();
 }
 
+void AbstractEglTexture::uploadSubImage(const QImage &image, const QRect &source, const QPoint &offset, GLenum format)
+{
+    Q_ASSERT(image.depth() == 32);
+    const int bytesPerRow = source.width() * 4;
+
+    // Stream large uploads through a pixel buffer object so that glTexSubImage2D()
+    // returns without waiting for the transfer. Only the damaged rows are copied.
+    if (hasGLVersion(3, 0) && bytesPerRow * source.height() >= s_pixelBufferThreshold) {
+        if (!m_pixelBuffer) {
+            glGenBuffers(1, &m_pixelBuffer);
+        }
+        const GLsizeiptr size = bytesPerRow * source.height();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+        // Orphan the previous storage, it might still be in use by the last transfer.
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        uchar *data = static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (data) {
+            for (int y = 0; y < source.height(); ++y) {
+                memcpy(data + y * bytesPerRow, image.constScanLine(source.y() + y) + source.x() * 4, bytesPerRow);
+            }
+            if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+                glTexSubImage2D(m_target, 0, offset.x(), offset.y(), source.width(), source.height(),
+                                format, GL_UNSIGNED_BYTE, nullptr);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                return;
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    const uchar *data = image.constScanLine(source.y()) + source.x() * 4;
+    const bool contiguous = image.bytesPerLine() == bytesPerRow;
+    const bool supportsUnpack = s_supportsUnpack || hasGLVersion(3, 0);
+    if (contiguous || (supportsUnpack && image.bytesPerLine() % 4 == 0)) {
+        if (!contiguous) {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, image.bytesPerLine() / 4);
+        }
+        glTexSubImage2D(m_target, 0, offset.x(), offset.y(), source.width(), source.height(),
+                        format, GL_UNSIGNED_BYTE, data);
+        if (!contiguous) {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+    } else {
+        const QImage copy = image.copy(source);
+        glTexSubImage2D(m_target, 0, offset.x(), offset.y(), source.width(), source.height(),
+                        format, GL_UNSIGNED_BYTE, copy.constBits());
+    }
+}
+
 bool AbstractEglTexture::loadShmTexture(const QPointer< KWaylandServer::BufferInterface > &buffer)
 {
     return createTextureImage(buffer->data());
@@ -114,6 +114,7 @@ protected:
 
 private:
     void createTextureSubImage(const QImage &image, const QRegion &damage);
+    void uploadSubImage(const QImage &image, const QRect &source, const QPoint &offset, GLenum format);
     bool createTextureImage(const QImage &image);
     bool loadShmTexture(const QPointer<KWaylandServer::BufferInterface> &buffer);
     bool loadEglTexture(const QPointer<KWaylandServer::BufferInterface> &buffer);
@@ -125,6 +126,9 @@ private:
     SceneOpenGLTexture *q;
     AbstractEglBackend *m_backend;
     EGLImageKHR m_image;
+    GLuint m_pixelBuffer = 0;
+    // Uploads smaller than this many bytes are not worth a pixel buffer object
+    static const int s_pixelBufferThreshold = 64 * 1024;
 };
 
 }
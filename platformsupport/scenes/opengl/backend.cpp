@@ -93,6 +93,20 @@ QSharedPointer<KWin::GLTexture> OpenGLBackend::textureForOutput(AbstractOutput*
     return {};
 }
 
+bool OpenGLBackend::scanout(int screenId, KWaylandServer::SurfaceInterface *surface)
+{
+    Q_UNUSED(screenId)
+    Q_UNUSED(surface)
+    return false;
+}
+
+QRegion OpenGLBackend::assignOverlays(int screenId, const QVector<Overlay> &candidates)
+{
+    Q_UNUSED(screenId)
+    Q_UNUSED(candidates)
+    return QRegion();
+}
+
 void OpenGLBackend::aboutToStartPainting(int screenId, const QRegion &damage)
 {
     Q_UNUSED(screenId)
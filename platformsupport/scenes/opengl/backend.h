@@ -11,9 +11,15 @@
 #define KWIN_SCENE_OPENGL_BACKEND_H
 
 #include <QRegion>
+#include <QVector>
 
 #include <kwin_export.h>
 
+namespace KWaylandServer
+{
+class SurfaceInterface;
+}
+
 namespace KWin
 {
 class AbstractOutput;
@@ -61,6 +67,34 @@ public:
     virtual bool usesOverlayWindow() const = 0;
     virtual QRegion beginFrame(int screenId) = 0;
     virtual void endFrame(int screenId, const QRegion &damage, const QRegion &damagedRegion) = 0;
+    /**
+     * Tries to present the current buffer of the given @p surface on the screen with the
+     * given @p screenId without compositing it. The scene has already verified that the
+     * surface is the only thing visible on the screen.
+     *
+     * Returns @c true if the buffer has been scheduled for presentation, in which case no
+     * frame is rendered. The default implementation returns @c false.
+     */
+    virtual bool scanout(int screenId, KWaylandServer::SurfaceInterface *surface);
+
+    /**
+     * A surface that could be shown on a hardware overlay plane.
+     */
+    struct Overlay {
+        KWaylandServer::SurfaceInterface *surface = nullptr;
+        // The geometry of the surface in global compositor coordinates
+        QRect geometry;
+    };
+    /**
+     * Tries to show the current buffers of the given @p candidates on hardware overlay planes
+     * of the screen with the given @p screenId in the next frame. The scene has already
+     * verified that the candidates are opaque and not covered by anything else.
+     *
+     * This is called once per frame before rendering, overlay planes that are not needed
+     * anymore are released. Returns the area of the screen that is covered by overlay planes
+     * and doesn't have to be composited. The default implementation returns an empty region.
+     */
+    virtual QRegion assignOverlays(int screenId, const QVector<Overlay> &candidates);
     /**
      * @brief Compositor is going into idle mode, flushes any pending paints.
      */
@@ -16,6 +16,8 @@
 #include "logging.h"
 #include "logind.h"
 #include "main.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
 #include "scene_qpainter_drm_backend.h"
 #include "screens_drm.h"
 #include "udev.h"
@@ -188,9 +190,16 @@ void DrmBackend::reactivate()
         }
     }
     // restart compositor
+    for (DrmOutput *output : qAsConst(m_outputs)) {
+        if (output->m_pageFlipPending) {
+            // page flips that got queued before the session was deactivated won't complete anymore
+            output->m_pageFlipPending = false;
+            RenderLoopPrivate::get(output->renderLoop())->notifyFrameFailed();
+        }
+        output->renderLoop()->uninhibit();
+    }
     m_pageFlipsPending = 0;
     if (Compositor *compositor = Compositor::self()) {
-        compositor->bufferSwapComplete();
         compositor->addRepaintFull();
     }
 }
@@ -200,36 +209,50 @@ void DrmBackend::deactivate()
     if (!m_active) {
         return;
     }
-    // block compositor
-    if (m_pageFlipsPending == 0 && Compositor::self()) {
-        Compositor::self()->aboutToSwapBuffers();
-    }
-    // hide cursor and disable
+    // block compositor and hide cursor
     for (auto it = m_outputs.constBegin(); it != m_outputs.constEnd(); ++it) {
         DrmOutput *o = *it;
+        o->renderLoop()->inhibit();
         o->hideCursor();
     }
     m_active = false;
 }
 
+static std::chrono::nanoseconds convertTimestamp(const timespec &timestamp)
+{
+    return std::chrono::seconds(timestamp.tv_sec) + std::chrono::nanoseconds(timestamp.tv_nsec);
+}
+
+static std::chrono::nanoseconds convertTimestamp(clockid_t sourceClock, clockid_t targetClock,
+                                                 const timespec &timestamp)
+{
+    if (sourceClock == targetClock) {
+        return convertTimestamp(timestamp);
+    }
+
+    timespec sourceCurrentTime = {};
+    timespec targetCurrentTime = {};
+
+    clock_gettime(sourceClock, &sourceCurrentTime);
+    clock_gettime(targetClock, &targetCurrentTime);
+
+    const auto delta = convertTimestamp(sourceCurrentTime) - convertTimestamp(timestamp);
+    return convertTimestamp(targetCurrentTime) - delta;
+}
+
 void DrmBackend::pageFlipHandler(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
 {
     Q_UNUSED(fd)
     Q_UNUSED(frame)
-    Q_UNUSED(sec)
-    Q_UNUSED(usec)
     auto output = reinterpret_cast<DrmOutput*>(data);
 
-    output->pageFlipped();
-    output->m_backend->m_pageFlipsPending--;
-    if (output->m_backend->m_pageFlipsPending == 0) {
-        // TODO: improve, this currently means we wait for all page flips or all outputs.
-        // It would be better to driver the repaint per output
+    // The render loop expects presentation timestamps from the monotonic clock.
+    const timespec flipTime = { time_t(sec), long(usec * 1000) };
+    const std::chrono::nanoseconds timestamp =
+            convertTimestamp(output->gpu()->presentationClock(), CLOCK_MONOTONIC, flipTime);
 
-        if (Compositor::self()) {
-            Compositor::self()->bufferSwapComplete();
-        }
-    }
+    output->m_backend->m_pageFlipsPending--;
+    output->pageFlipped(timestamp);
 }
 
 void DrmBackend::openDrm()
@@ -340,6 +363,10 @@ void DrmBackend::addOutput(DrmOutput *o)
 {
     m_outputs.append(o);
     m_enabledOutputs.append(o);
+    if (!m_active) {
+        // The output has been hotplugged while the session is inactive.
+        o->renderLoop()->inhibit();
+    }
     emit o->gpu()->outputEnabled(o);
     emit outputAdded(o);
 }
@@ -503,9 +530,7 @@ bool DrmBackend::present(DrmBuffer *buffer, DrmOutput *output)
 
     if (output->present(buffer)) {
         m_pageFlipsPending++;
-        if (m_pageFlipsPending == 1 && Compositor::self()) {
-            Compositor::self()->aboutToSwapBuffers();
-        }
+        RenderLoopPrivate::get(output->renderLoop())->notifyFramePending();
         return true;
     } else if (output->gpu()->deleteBufferAfterPageFlip()) {
         delete buffer;
@@ -513,6 +538,16 @@ bool DrmBackend::present(DrmBuffer *buffer, DrmOutput *output)
     return false;
 }
 
+bool DrmBackend::presentOverlays(DrmOutput *output)
+{
+    if (!output->presentOverlays()) {
+        return false;
+    }
+    m_pageFlipsPending++;
+    RenderLoopPrivate::get(output->renderLoop())->notifyFramePending();
+    return true;
+}
+
 void DrmBackend::initCursor()
 {
 
@@ -63,6 +63,7 @@ public:
     void prepareShutdown() override;
 
     bool present(DrmBuffer *buffer, DrmOutput *output);
+    bool presentOverlays(DrmOutput *output);
 
     Outputs outputs() const override;
     Outputs enabledOutputs() const override;
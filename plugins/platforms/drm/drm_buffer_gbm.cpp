@@ -8,14 +8,19 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "drm_buffer_gbm.h"
+#include "drm_gpu.h"
 #include "gbm_surface.h"
 
 #include "logging.h"
+#include "platformsupport/scenes/opengl/drm_fourcc.h"
+
+#include <KWaylandServer/buffer_interface.h>
 
 // system
 #include <sys/mman.h>
 // c++
 #include <cerrno>
+#include <cstring>
 // drm
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -52,12 +57,53 @@ DrmSurfaceBuffer::DrmSurfaceBuffer(int fd, gbm_bo *buffer)
     gbm_bo_set_user_data(m_bo, this, nullptr);
 }
 
+DrmSurfaceBuffer::DrmSurfaceBuffer(DrmGpu *gpu, gbm_bo *buffer, KWaylandServer::BufferInterface *clientBuffer)
+    : DrmBuffer(gpu->fd())
+    , m_bo(buffer)
+    , m_clientBuffer(clientBuffer)
+{
+    m_clientBuffer->ref();
+    m_size = QSize(gbm_bo_get_width(m_bo), gbm_bo_get_height(m_bo));
+
+    uint32_t handles[4] = { };
+    uint32_t strides[4] = { };
+    uint32_t offsets[4] = { };
+    uint64_t modifiers[4] = { };
+    const uint64_t modifier = gbm_bo_get_modifier(m_bo);
+    const int planeCount = gbm_bo_get_plane_count(m_bo);
+    for (int i = 0; i < planeCount; ++i) {
+        handles[i] = gbm_bo_get_handle_for_plane(m_bo, i).u32;
+        strides[i] = gbm_bo_get_stride_for_plane(m_bo, i);
+        offsets[i] = gbm_bo_get_offset(m_bo, i);
+        modifiers[i] = modifier;
+    }
+
+    int ret;
+    if (modifier == DRM_FORMAT_MOD_INVALID || modifier == DRM_FORMAT_MOD_LINEAR) {
+        ret = drmModeAddFB2(fd(), m_size.width(), m_size.height(), gbm_bo_get_format(m_bo),
+                            handles, strides, offsets, &m_bufferId, 0);
+    } else if (gpu->addFB2ModifiersSupported()) {
+        ret = drmModeAddFB2WithModifiers(fd(), m_size.width(), m_size.height(), gbm_bo_get_format(m_bo),
+                                         handles, strides, offsets, modifiers, &m_bufferId, DRM_MODE_FB_MODIFIERS);
+    } else {
+        // The kernel would assume an implicit layout which doesn't match the buffer.
+        ret = -EINVAL;
+    }
+    if (ret != 0) {
+        qCDebug(KWIN_DRM) << "Failed to create a framebuffer for the client buffer:" << strerror(-ret);
+        m_bufferId = 0;
+    }
+}
+
 DrmSurfaceBuffer::~DrmSurfaceBuffer()
 {
     if (m_bufferId) {
         drmModeRmFB(fd(), m_bufferId);
     }
     releaseGbm();
+    if (m_clientBuffer) {
+        m_clientBuffer->unref();
+    }
 }
 
 void DrmSurfaceBuffer::releaseGbm()
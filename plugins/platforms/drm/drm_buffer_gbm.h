@@ -12,13 +12,21 @@
 
 #include "drm_buffer.h"
 
+#include <QPointer>
+
 #include <memory>
 
 struct gbm_bo;
 
+namespace KWaylandServer
+{
+class BufferInterface;
+}
+
 namespace KWin
 {
 
+class DrmGpu;
 class GbmSurface;
 
 class DrmSurfaceBuffer : public DrmBuffer
@@ -26,6 +34,12 @@ class DrmSurfaceBuffer : public DrmBuffer
 public:
     DrmSurfaceBuffer(int fd, const std::shared_ptr<GbmSurface> &surface);
     DrmSurfaceBuffer(int fd, gbm_bo *buffer);
+    /**
+     * Creates a framebuffer for the imported client @p buffer. The client buffer is kept
+     * referenced until the framebuffer is destroyed, so the client doesn't reuse it while
+     * it is being scanned out.
+     */
+    DrmSurfaceBuffer(DrmGpu *gpu, gbm_bo *buffer, KWaylandServer::BufferInterface *clientBuffer);
     ~DrmSurfaceBuffer() override;
 
     bool needsModeChange(DrmBuffer *b) const override {
@@ -49,6 +63,7 @@ public:
 private:
     std::shared_ptr<GbmSurface> m_surface;
     gbm_bo *m_bo = nullptr;
+    QPointer<KWaylandServer::BufferInterface> m_clientBuffer;
 };
 
 }
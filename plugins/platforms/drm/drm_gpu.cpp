@@ -23,6 +23,7 @@
 #endif
 // system
 #include <algorithm>
+#include <time.h>
 #include <unistd.h>
 // drm
 #include <xf86drm.h>
@@ -48,6 +49,14 @@ DrmGpu::DrmGpu(DrmBackend *backend, QByteArray devNode, int fd, int drmId) : m_b
         m_cursorSize.setHeight(64);
     }
 
+    if (drmGetCap(fd, DRM_CAP_TIMESTAMP_MONOTONIC, &capability) == 0 && capability == 1) {
+        m_presentationClock = CLOCK_MONOTONIC;
+    } else {
+        m_presentationClock = CLOCK_REALTIME;
+    }
+
+    m_addFB2ModifiersSupported = drmGetCap(fd, DRM_CAP_ADDFB2_MODIFIERS, &capability) == 0 && capability == 1;
+
     // find out if this GPU is using the NVidia proprietary driver
     DrmScopedPointer<drmVersion> version(drmGetVersion(fd));
     m_useEglStreams = strstr(version->name, "nvidia-drm");
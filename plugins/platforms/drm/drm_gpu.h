@@ -18,6 +18,8 @@
 
 #include "drm_buffer.h"
 
+#include <sys/types.h>
+
 struct gbm_device;
 
 namespace KWin
@@ -58,10 +60,24 @@ public:
         return m_useEglStreams;
     }
 
+    /**
+     * Returns the clock from which the page flip timestamps are sourced.
+     */
+    clockid_t presentationClock() const {
+        return m_presentationClock;
+    }
+
     bool deleteBufferAfterPageFlip() const {
         return m_deleteBufferAfterPageFlip;
     }
 
+    /**
+     * Returns @c true if framebuffers with explicit format modifiers can be created.
+     */
+    bool addFB2ModifiersSupported() const {
+        return m_addFB2ModifiersSupported;
+    }
+
     QByteArray devNode() const {
         return m_devNode;
     }
@@ -78,6 +94,10 @@ public:
         return m_planes;
     }
 
+    QVector<DrmPlane*> overlayPlanes() const {
+        return m_overlayPlanes;
+    }
+
     AbstractEglBackend *eglBackend() {
         return m_eglBackend;
     }
@@ -127,6 +147,8 @@ private:
     bool m_atomicModeSetting;
     bool m_useEglStreams;
     bool m_deleteBufferAfterPageFlip;
+    bool m_addFB2ModifiersSupported = false;
+    clockid_t m_presentationClock;
     gbm_device* m_gbmDevice;
     EGLDisplay m_eglDisplay = EGL_NO_DISPLAY;
 
@@ -16,6 +16,8 @@
 #include "logind.h"
 #include "logging.h"
 #include "main.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
 #include "screens_drm.h"
 #include "wayland_server.h"
 // KWayland
@@ -29,6 +31,7 @@
 #include <QCryptographicHash>
 #include <QPainter>
 // c++
+#include <algorithm>
 #include <cerrno>
 // drm
 #include <xf86drm.h>
@@ -43,6 +46,7 @@ DrmOutput::DrmOutput(DrmBackend *backend, DrmGpu *gpu)
     : AbstractWaylandOutput(backend)
     , m_backend(backend)
     , m_gpu(gpu)
+    , m_renderLoop(new RenderLoop(this))
 {
 }
 
@@ -61,8 +65,17 @@ void DrmOutput::teardown()
     hideCursor();
     m_crtc->blank();
 
+    if (!m_overlayPlanes.isEmpty()) {
+        // Overlay planes are not affected by blanking the crtc, turn them off explicitly.
+        disableOverlayPlanes();
+        if (!commitPlanes(m_overlayPlanes, 0)) {
+            qCWarning(KWIN_DRM) << "Failed to disable overlay planes:" << strerror(errno);
+        }
+        m_nextPlanesFlipList.clear();
+        releaseOverlayPlanes();
+    }
+
     if (m_primaryPlane) {
-        // TODO: when having multiple planes, also clean up these
         m_primaryPlane->setOutput(nullptr);
 
         if (m_gpu->deleteBufferAfterPageFlip()) {
@@ -236,6 +249,7 @@ bool DrmOutput::init(drmModeConnector *connector)
                 || connector->connector_type == DRM_MODE_CONNECTOR_DSI);
     setDpmsSupported(true);
     initOutputDevice(connector);
+    m_renderLoop->setRefreshRate(refreshRateForMode(&m_mode));
 
     if (!m_gpu->atomicModeSetting() && !m_crtc->blank()) {
         // We use legacy mode and the initial output blank failed.
@@ -694,12 +708,193 @@ void DrmOutput::setWaylandMode()
 {
     AbstractWaylandOutput::setWaylandMode(QSize(m_mode.hdisplay, m_mode.vdisplay),
                                           refreshRateForMode(&m_mode));
+    m_renderLoop->setRefreshRate(refreshRateForMode(&m_mode));
+}
+
+RenderLoop *DrmOutput::renderLoop() const
+{
+    return m_renderLoop;
+}
+
+bool DrmOutput::isDirectScanoutAllowed() const
+{
+    return m_gpu->atomicModeSetting() && m_primaryPlane && !m_modesetRequested
+            && !m_pageFlipPending && transform() == Transform::Normal;
+}
+
+bool DrmOutput::beginOverlayAssignment()
+{
+    m_assignedOverlayPlanes.clear();
+
+    // Drop overlay changes of a previous frame that have never been committed.
+    for (DrmPlane *p : qAsConst(m_overlayPlanes)) {
+        if (m_nextPlanesFlipList.removeOne(p)) {
+            if (m_gpu->deleteBufferAfterPageFlip()) {
+                delete p->next();
+            }
+            p->setNext(nullptr);
+        }
+    }
+
+    if (!isDirectScanoutAllowed() || m_dpmsModePending != DpmsMode::On) {
+        // Don't let stale client buffers cover the composited frame.
+        if (!m_pageFlipPending) {
+            disableOverlayPlanes();
+        }
+        return false;
+    }
+    return !m_gpu->overlayPlanes().isEmpty();
+}
+
+bool DrmOutput::assignOverlayPlane(DrmBuffer *buffer, uint32_t format, const QSize &bufferSize, const QRect &geometry)
+{
+    // Prefer planes that this output already uses, they are known to work with our crtc.
+    QVector<DrmPlane*> candidates;
+    for (DrmPlane *p : qAsConst(m_overlayPlanes)) {
+        if (!m_assignedOverlayPlanes.contains(p)) {
+            candidates << p;
+        }
+    }
+    const auto overlayPlanes = m_gpu->overlayPlanes();
+    for (DrmPlane *p : overlayPlanes) {
+        if (!p->output() && p->isCrtcSupported(m_crtc->resIndex())) {
+            candidates << p;
+        }
+    }
+
+    for (DrmPlane *p : qAsConst(candidates)) {
+        if (!p->formats().contains(format)) {
+            continue;
+        }
+        p->setValue(int(DrmPlane::PropertyIndex::SrcX), 0);
+        p->setValue(int(DrmPlane::PropertyIndex::SrcY), 0);
+        p->setValue(int(DrmPlane::PropertyIndex::SrcW), bufferSize.width() << 16);
+        p->setValue(int(DrmPlane::PropertyIndex::SrcH), bufferSize.height() << 16);
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcX), geometry.x());
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcY), geometry.y());
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcW), geometry.width());
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcH), geometry.height());
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcId), m_crtc->id());
+        p->setTransformation(DrmPlane::Transformation::Rotate0);
+        p->setNext(buffer);
+        m_nextPlanesFlipList << p;
+
+        if (!commitPlanes(m_nextPlanesFlipList, DRM_MODE_ATOMIC_TEST_ONLY)) {
+            qCDebug(KWIN_DRM) << "Overlay plane" << p->id() << "rejected a buffer of" << bufferSize << "at" << geometry;
+            m_nextPlanesFlipList.removeOne(p);
+            p->setNext(nullptr);
+            continue;
+        }
+
+        if (!p->output()) {
+            p->setOutput(this);
+            m_overlayPlanes << p;
+        }
+        m_assignedOverlayPlanes << p;
+        return true;
+    }
+    return false;
+}
+
+void DrmOutput::endOverlayAssignment()
+{
+    for (DrmPlane *p : qAsConst(m_overlayPlanes)) {
+        if (m_assignedOverlayPlanes.contains(p)) {
+            continue;
+        }
+        p->setNext(nullptr);
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcId), 0);
+        if (p->current()) {
+            m_nextPlanesFlipList << p;
+        }
+    }
+    // Planes that didn't show anything yet can be handed back right away.
+    for (auto it = m_overlayPlanes.begin(); it != m_overlayPlanes.end();) {
+        DrmPlane *p = *it;
+        if (!p->current() && !p->next()) {
+            p->setOutput(nullptr);
+            it = m_overlayPlanes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_assignedOverlayPlanes.clear();
 }
 
-void DrmOutput::pageFlipped()
+bool DrmOutput::hasPendingOverlayChanges() const
+{
+    return std::any_of(m_overlayPlanes.constBegin(), m_overlayPlanes.constEnd(), [this](DrmPlane *p) {
+        return m_nextPlanesFlipList.contains(p);
+    });
+}
+
+bool DrmOutput::presentOverlays()
+{
+    if (!hasPendingOverlayChanges()) {
+        return false;
+    }
+    if (!LogindIntegration::self()->isActiveSession() || m_pageFlipPending || m_modesetRequested
+            || m_dpmsModePending != DpmsMode::On) {
+        return false;
+    }
+    if (!doAtomicCommit(AtomicCommitMode::Test)) {
+        qCDebug(KWIN_DRM) << "Atomic test commit of overlay planes failed.";
+        return false;
+    }
+    if (!doAtomicCommit(AtomicCommitMode::Real)) {
+        qCDebug(KWIN_DRM) << "Atomic commit of overlay planes failed.";
+        return false;
+    }
+    m_pageFlipPending = true;
+    return true;
+}
+
+bool DrmOutput::commitPlanes(const QVector<DrmPlane*> &planes, uint32_t flags)
+{
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    bool ret = true;
+    for (DrmPlane *p : planes) {
+        ret &= p->atomicPopulate(req);
+    }
+    ret = ret && drmModeAtomicCommit(m_gpu->fd(), req, flags, this) == 0;
+    drmModeAtomicFree(req);
+    return ret;
+}
+
+void DrmOutput::disableOverlayPlanes()
+{
+    for (DrmPlane *p : qAsConst(m_overlayPlanes)) {
+        if (m_gpu->deleteBufferAfterPageFlip() && p->next() != p->current()) {
+            delete p->next();
+        }
+        p->setNext(nullptr);
+        p->setValue(int(DrmPlane::PropertyIndex::CrtcId), 0);
+        if (!m_nextPlanesFlipList.contains(p)) {
+            m_nextPlanesFlipList << p;
+        }
+    }
+}
+
+void DrmOutput::releaseOverlayPlanes()
+{
+    for (DrmPlane *p : qAsConst(m_overlayPlanes)) {
+        if (m_gpu->deleteBufferAfterPageFlip()) {
+            delete p->current();
+        }
+        p->setCurrent(nullptr);
+        p->setOutput(nullptr);
+    }
+    m_overlayPlanes.clear();
+}
+
+void DrmOutput::pageFlipped(std::chrono::nanoseconds timestamp)
 {
     // In legacy mode we might get a page flip through a blank.
     Q_ASSERT(m_pageFlipPending || !m_gpu->atomicModeSetting());
+    const bool wasPageFlipPending = m_pageFlipPending;
     m_pageFlipPending = false;
 
     if (m_deleted) {
@@ -707,6 +902,11 @@ void DrmOutput::pageFlipped()
         return;
     }
 
+    // Only flips that have been queued by present() complete a frame of the render loop.
+    if (wasPageFlipPending) {
+        RenderLoopPrivate::get(m_renderLoop)->notifyFrameCompleted(timestamp);
+    }
+
     if (!m_crtc) {
         return;
     }
@@ -714,11 +914,8 @@ void DrmOutput::pageFlipped()
     // TODO: split up DrmOutput in two for dumb and egl/gbm surface buffer compatible subclasses completely?
     if (m_gpu->deleteBufferAfterPageFlip()) {
         if (m_gpu->atomicModeSetting()) {
-            if (!m_primaryPlane->next()) {
+            if (!m_primaryPlane->next() && !hasPendingOverlayChanges()) {
                 // on manual vt switch
-                // TODO: when we later use overlay planes it might happen, that we have a page flip with only
-                //       damage on one of these, and therefore the primary plane has no next buffer
-                //       -> Then we don't want to return here!
                 if (m_primaryPlane->current()) {
                     m_primaryPlane->current()->releaseGbm();
                 }
@@ -728,6 +925,16 @@ void DrmOutput::pageFlipped()
                 p->flipBufferWithDelete();
             }
             m_nextPlanesFlipList.clear();
+
+            // Hand back overlay planes that have been turned off.
+            for (auto it = m_overlayPlanes.begin(); it != m_overlayPlanes.end();) {
+                if (!(*it)->current()) {
+                    (*it)->setOutput(nullptr);
+                    it = m_overlayPlanes.erase(it);
+                } else {
+                    ++it;
+                }
+            }
         } else {
             if (!m_crtc->next()) {
                 // on manual vt switch
@@ -770,10 +977,10 @@ bool DrmOutput::dpmsAtomicOff()
 {
     m_atomicOffPending = false;
 
-    // TODO: With multiple planes: deactivate all of them here
     delete m_primaryPlane->next();
     m_primaryPlane->setNext(nullptr);
     m_nextPlanesFlipList << m_primaryPlane;
+    disableOverlayPlanes();
 
     if (!doAtomicCommit(AtomicCommitMode::Test)) {
         qCDebug(KWIN_DRM) << "Atomic test commit to Dpms Off failed. Aborting.";
@@ -784,6 +991,7 @@ bool DrmOutput::dpmsAtomicOff()
         return false;
     }
     m_nextPlanesFlipList.clear();
+    releaseOverlayPlanes();
     dpmsFinishOff();
 
     return true;
@@ -814,11 +1022,11 @@ bool DrmOutput::presentAtomically(DrmBuffer *buffer)
     m_nextPlanesFlipList << m_primaryPlane;
 
     if (!doAtomicCommit(AtomicCommitMode::Test)) {
-        //TODO: When we use planes for layered rendering, fallback to renderer instead. Also for direct scanout?
-        //TODO: Probably should undo setNext and reset the flip list
+        //TODO: When we use planes for layered rendering, fallback to renderer instead.
         qCDebug(KWIN_DRM) << "Atomic test commit failed. Aborting present.";
-        // go back to previous state
-        if (m_lastWorkingState.valid) {
+        // go back to previous state, unless the failure is unrelated to a mode change,
+        // e.g. a client buffer that cannot be scanned out directly
+        if (m_modesetRequested && m_lastWorkingState.valid) {
             m_mode = m_lastWorkingState.mode;
             setTransform(m_lastWorkingState.transform);
             setGlobalPos(m_lastWorkingState.globalPos);
@@ -898,9 +1106,6 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
     drmModeAtomicReq *req = drmModeAtomicAlloc();
 
     auto errorHandler = [this, mode, req] () {
-        if (mode == AtomicCommitMode::Test) {
-            // TODO: when we later test overlay planes, make sure we change only the right stuff back
-        }
         if (req) {
             drmModeAtomicFree(req);
         }
@@ -913,8 +1118,12 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
             }
         }
 
-        // TODO: see above, rework later for overlay planes!
         for (DrmPlane *p : m_nextPlanesFlipList) {
+            // The buffer of the primary plane is deleted by whoever called present(),
+            // client buffers on overlay planes are owned by the planes.
+            if (p != m_primaryPlane && m_gpu->deleteBufferAfterPageFlip() && p->next() != p->current()) {
+                delete p->next();
+            }
             p->setNext(nullptr);
         }
         m_nextPlanesFlipList.clear();
@@ -21,6 +21,8 @@
 #include <QVector>
 #include <xf86drmMode.h>
 
+#include <chrono>
+
 namespace KWin
 {
 
@@ -49,7 +51,41 @@ public:
     void moveCursor();
     bool init(drmModeConnector *connector);
     bool present(DrmBuffer *buffer);
-    void pageFlipped();
+    void pageFlipped(std::chrono::nanoseconds timestamp);
+
+    RenderLoop *renderLoop() const override;
+
+    /**
+     * Returns @c true if a client buffer can be put on the primary plane of this output,
+     * i.e. atomic mode setting is used and neither a modeset nor a page flip is pending.
+     */
+    bool isDirectScanoutAllowed() const;
+
+    /**
+     * Starts assigning client buffers to the overlay planes of this output for the next
+     * frame. Returns @c false if overlay planes cannot be used right now, e.g. because a
+     * modeset or a page flip is pending.
+     */
+    bool beginOverlayAssignment();
+    /**
+     * Tries to show @p buffer on a free overlay plane, scaled to @p geometry in output pixels.
+     * The assignment is validated with a test-only atomic commit and takes effect with the
+     * next present() or presentOverlays(). On success, the plane takes ownership of @p buffer.
+     */
+    bool assignOverlayPlane(DrmBuffer *buffer, uint32_t format, const QSize &bufferSize, const QRect &geometry);
+    /**
+     * Disables the overlay planes that haven't been assigned a buffer since the last call
+     * to beginOverlayAssignment().
+     */
+    void endOverlayAssignment();
+    /**
+     * Returns @c true if overlay planes have to be updated with the next page flip.
+     */
+    bool hasPendingOverlayChanges() const;
+    /**
+     * Commits pending overlay plane changes without a new buffer for the primary plane.
+     */
+    bool presentOverlays();
 
     // These values are defined by the kernel
     enum class DpmsMode {
@@ -122,6 +158,9 @@ private:
     void initUuid();
     bool initPrimaryPlane();
     bool initCursorPlane();
+    bool commitPlanes(const QVector<DrmPlane*> &planes, uint32_t flags);
+    void disableOverlayPlanes();
+    void releaseOverlayPlanes();
 
     void atomicEnable();
     void atomicDisable();
@@ -145,6 +184,7 @@ private:
 
     DrmBackend *m_backend;
     DrmGpu *m_gpu;
+    RenderLoop *m_renderLoop;
     DrmConnector *m_conn = nullptr;
     DrmCrtc *m_crtc = nullptr;
     bool m_lastGbm = false;
@@ -159,6 +199,9 @@ private:
     DrmPlane *m_primaryPlane = nullptr;
     DrmPlane *m_cursorPlane = nullptr;
     QVector<DrmPlane*> m_nextPlanesFlipList;
+    // overlay planes that are in use by this output, or have been in the previous frame
+    QVector<DrmPlane*> m_overlayPlanes;
+    QVector<DrmPlane*> m_assignedOverlayPlanes;
     bool m_pageFlipPending = false;
     bool m_atomicOffPending = false;
     bool m_modesetRequested = true;
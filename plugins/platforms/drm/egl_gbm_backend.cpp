@@ -12,17 +12,23 @@
 #include "drm_backend.h"
 #include "drm_output.h"
 #include "gbm_surface.h"
+#include "linux_dmabuf.h"
 #include "logging.h"
 #include "options.h"
 #include "screens.h"
 #include "drm_gpu.h"
+#include "platformsupport/scenes/opengl/drm_fourcc.h"
 // kwin libs
 #include <kwinglplatform.h>
 #include <kwineglimagetexture.h>
+
+#include <KWaylandServer/buffer_interface.h>
+#include <KWaylandServer/surface_interface.h>
 // system
 #include <gbm.h>
 #include <unistd.h>
 #include <errno.h>
+#include <string.h>
 
 namespace KWin
 {
@@ -687,6 +693,11 @@ void EglGbmBackend::endFrame(int screenId, const QRegion &renderedRegion,
             glFlush();
 
         output.bufferAge = 1;
+
+        // Only the contents of overlay planes might have changed.
+        if (output.output->hasPendingOverlayChanges()) {
+            m_backend->presentOverlays(output.output);
+        }
         return;
     }
     presentOnOutput(output, damagedRegion);
@@ -699,6 +710,122 @@ void EglGbmBackend::endFrame(int screenId, const QRegion &renderedRegion,
     }
 }
 
+bool EglGbmBackend::scanout(int screenId, KWaylandServer::SurfaceInterface *surface)
+{
+    // Outputs of secondary GPUs show what the primary GPU has rendered.
+    if (!isPrimary()) {
+        return false;
+    }
+    Output &output = m_outputs[screenId];
+    if (!output.output->isDirectScanoutAllowed()) {
+        return false;
+    }
+
+    KWaylandServer::BufferInterface *clientBuffer = surface->buffer();
+    auto dmabuf = static_cast<DmabufBuffer *>(clientBuffer->linuxDmabufBuffer());
+    if (!dmabuf || dmabuf->planes().isEmpty()) {
+        return false;
+    }
+    if (dmabuf->size() != output.output->modeSize()) {
+        return false;
+    }
+    if (!output.output->primaryPlane()->formats().contains(dmabuf->format())) {
+        return false;
+    }
+
+    DrmSurfaceBuffer *buffer = importClientBuffer(clientBuffer);
+    if (!buffer) {
+        return false;
+    }
+    // The DrmBackend takes care of deleting the buffer if it cannot be presented.
+    if (!m_backend->present(buffer, output.output)) {
+        return false;
+    }
+    output.buffer = buffer;
+
+    // The back buffers of the gbm surface are stale now, force a full repaint once
+    // compositing resumes.
+    output.damageHistory.clear();
+
+    Q_EMIT output.output->outputChange(output.output->geometry());
+    return true;
+}
+
+QRegion EglGbmBackend::assignOverlays(int screenId, const QVector<Overlay> &candidates)
+{
+    if (!isPrimary()) {
+        return QRegion();
+    }
+    DrmOutput *drmOutput = m_outputs[screenId].output;
+    if (!drmOutput->beginOverlayAssignment()) {
+        return QRegion();
+    }
+
+    const QRect outputGeometry = drmOutput->geometry();
+    const qreal scale = drmOutput->scale();
+
+    QRegion assigned;
+    for (const Overlay &candidate : candidates) {
+        KWaylandServer::BufferInterface *clientBuffer = candidate.surface->buffer();
+        auto dmabuf = static_cast<DmabufBuffer *>(clientBuffer->linuxDmabufBuffer());
+        if (!dmabuf || dmabuf->planes().isEmpty()) {
+            continue;
+        }
+        DrmSurfaceBuffer *buffer = importClientBuffer(clientBuffer);
+        if (!buffer) {
+            continue;
+        }
+        const QRect geometry = candidate.geometry.translated(-outputGeometry.topLeft());
+        const QRect deviceGeometry(geometry.topLeft() * scale, geometry.size() * scale);
+        if (drmOutput->assignOverlayPlane(buffer, dmabuf->format(), dmabuf->size(), deviceGeometry)) {
+            assigned += candidate.geometry;
+        } else {
+            delete buffer;
+        }
+    }
+    drmOutput->endOverlayAssignment();
+    return assigned;
+}
+
+DrmSurfaceBuffer *EglGbmBackend::importClientBuffer(KWaylandServer::BufferInterface *clientBuffer) const
+{
+    auto dmabuf = static_cast<DmabufBuffer *>(clientBuffer->linuxDmabufBuffer());
+    const QVector<DmabufBuffer::Plane> planes = dmabuf->planes();
+    gbm_bo *importedBuffer;
+    if (planes.count() > 1 || planes[0].offset > 0 || planes[0].modifier != DRM_FORMAT_MOD_INVALID) {
+        gbm_import_fd_modifier_data data = {};
+        data.width = dmabuf->size().width();
+        data.height = dmabuf->size().height();
+        data.format = dmabuf->format();
+        data.num_fds = planes.count();
+        data.modifier = planes[0].modifier;
+        for (int i = 0; i < planes.count(); ++i) {
+            data.fds[i] = planes[i].fd;
+            data.strides[i] = planes[i].stride;
+            data.offsets[i] = planes[i].offset;
+        }
+        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
+    } else {
+        gbm_import_fd_data data = {};
+        data.fd = planes[0].fd;
+        data.width = dmabuf->size().width();
+        data.height = dmabuf->size().height();
+        data.stride = planes[0].stride;
+        data.format = dmabuf->format();
+        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+    }
+    if (!importedBuffer) {
+        qCDebug(KWIN_DRM) << "Importing a client buffer for scanout failed:" << strerror(errno);
+        return nullptr;
+    }
+    DrmSurfaceBuffer *buffer = new DrmSurfaceBuffer(m_gpu, importedBuffer, clientBuffer);
+    if (buffer->bufferId() == 0) {
+        delete buffer;
+        return nullptr;
+    }
+    return buffer;
+}
+
 QSharedPointer<GLTexture> EglGbmBackend::textureForOutput(AbstractOutput *abstractOutput) const
 {
     const QVector<KWin::EglGbmBackend::Output>::const_iterator itOutput = std::find_if(m_outputs.begin(), m_outputs.end(),
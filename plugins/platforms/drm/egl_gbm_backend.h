@@ -15,6 +15,11 @@
 struct gbm_surface;
 struct gbm_bo;
 
+namespace KWaylandServer
+{
+class BufferInterface;
+}
+
 namespace KWin
 {
 class AbstractOutput;
@@ -35,6 +40,8 @@ public:
     SceneOpenGLTexturePrivate *createBackendTexture(SceneOpenGLTexture *texture) override;
     QRegion beginFrame(int screenId) override;
     void endFrame(int screenId, const QRegion &damage, const QRegion &damagedRegion) override;
+    bool scanout(int screenId, KWaylandServer::SurfaceInterface *surface) override;
+    QRegion assignOverlays(int screenId, const QVector<Overlay> &candidates) override;
     void init() override;
 
     QSharedPointer<GLTexture> textureForOutput(AbstractOutput *requestedOutput) const override;
@@ -97,6 +104,7 @@ private:
     QRegion prepareRenderingForOutput(const Output &output) const;
 
     void presentOnOutput(Output &output, const QRegion &damagedRegion);
+    DrmSurfaceBuffer *importClientBuffer(KWaylandServer::BufferInterface *clientBuffer) const;
 
     void cleanupOutput(Output &output);
     void cleanupFramebuffer(Output &output);
@@ -79,6 +79,22 @@ void EglMultiBackend::endFrame(int screenId, const QRegion &damage, const QRegio
     backend->endFrame(internalScreenId, damage, damagedRegion);
 }
 
+bool EglMultiBackend::scanout(int screenId, KWaylandServer::SurfaceInterface *surface)
+{
+    int internalScreenId;
+    AbstractEglBackend *backend = findBackend(screenId, internalScreenId);
+    Q_ASSERT(backend != nullptr);
+    return backend->scanout(internalScreenId, surface);
+}
+
+QRegion EglMultiBackend::assignOverlays(int screenId, const QVector<Overlay> &candidates)
+{
+    int internalScreenId;
+    AbstractEglBackend *backend = findBackend(screenId, internalScreenId);
+    Q_ASSERT(backend != nullptr);
+    return backend->assignOverlays(internalScreenId, candidates);
+}
+
 bool EglMultiBackend::makeCurrent()
 {
     return m_backends[0]->makeCurrent();
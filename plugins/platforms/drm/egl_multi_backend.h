@@ -25,6 +25,8 @@ public:
 
     QRegion beginFrame(int screenId) override;
     void endFrame(int screenId, const QRegion &damage, const QRegion &damagedRegion) override;
+    bool scanout(int screenId, KWaylandServer::SurfaceInterface *surface) override;
+    QRegion assignOverlays(int screenId, const QVector<Overlay> &candidates) override;
 
     bool makeCurrent() override;
     void doneCurrent() override;
@@ -11,6 +11,7 @@
 #include "composite.h"
 #include "logind.h"
 #include "cursor.h"
+#include "renderloop.h"
 #include "virtual_terminal.h"
 // Qt
 #include <QPainter>
@@ -34,12 +35,12 @@ FramebufferQPainterBackend::FramebufferQPainterBackend(FramebufferBackend *backe
     m_backBuffer.fill(Qt::black);
 
     connect(VirtualTerminal::self(), &VirtualTerminal::activeChanged, this,
-        [] (bool active) {
+        [this] (bool active) {
             if (active) {
-                Compositor::self()->bufferSwapComplete();
+                m_backend->renderLoop()->uninhibit();
                 Compositor::self()->addRepaintFull();
             } else {
-                Compositor::self()->aboutToSwapBuffers();
+                m_backend->renderLoop()->inhibit();
             }
         }
     );
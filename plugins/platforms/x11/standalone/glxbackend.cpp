@@ -80,7 +80,14 @@ bool SwapEventFilter::event(xcb_generic_event_t *event)
     // by a WireToEvent handler, and the GLX drawable when the event was
     // received over the wire
     if (ev->drawable == m_drawable || ev->drawable == m_glxDrawable) {
-        Compositor::self()->bufferSwapComplete();
+        // The UST is the system time in microseconds when the swap took place,
+        // Mesa sources it from the monotonic clock.
+        const std::chrono::microseconds ust((quint64(ev->ust_hi) << 32) | ev->ust_lo);
+        if (ust.count() != 0) {
+            Compositor::self()->bufferSwapComplete(ust);
+        } else {
+            Compositor::self()->bufferSwapComplete();
+        }
         return true;
     }
 
@@ -47,15 +47,19 @@
 #include <cstddef>
 #include <unistd.h>
 
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QDBusInterface>
 #include <QGraphicsScale>
 #include <QPainter>
 #include <QStringList>
+#include <QVarLengthArray>
 #include <QVector2D>
 #include <QVector4D>
 #include <QMatrix4x4>
+#include <QtConcurrentRun>
 
 #include <KLocalizedString>
 #include <KNotification>
@@ -538,6 +542,33 @@ void SceneOpenGL::handleGraphicsReset(GLenum status)
 }
 
 
+OpenGLWindowBatch *SceneOpenGL::windowBatch() const
+{
+    return m_windowBatchActive ? m_windowBatch.data() : nullptr;
+}
+
+void SceneOpenGL::beginWindowBatch()
+{
+    if (!m_windowBatch) {
+        m_windowBatch.reset(new OpenGLWindowBatch(this));
+    }
+    m_windowBatch->begin(painted_screen);
+    m_windowBatchActive = true;
+}
+
+void SceneOpenGL::endWindowBatch()
+{
+    m_windowBatch->end();
+    m_windowBatchActive = false;
+}
+
+void SceneOpenGL::flushWindowBatch()
+{
+    if (m_windowBatchActive) {
+        m_windowBatch->flush();
+    }
+}
+
 void SceneOpenGL::triggerFence()
 {
     if (m_syncManager) {
@@ -630,6 +661,12 @@ void SceneOpenGL::paint(int screenId, const QRegion &damage, const QList<Topleve
     // actually paint the frame, flushed with the NEXT frame
     createStackingOrder(toplevels);
 
+    if (tryDirectScanout(screenId)) {
+        clearStackingOrder();
+        return;
+    }
+    m_overlayPlanesAssigned = false;
+
     QRegion update;
     QRegion valid;
     QRegion repaint;
@@ -661,6 +698,12 @@ void SceneOpenGL::paint(int screenId, const QRegion &damage, const QList<Topleve
         paintScreen(&mask, damage.intersected(geo), repaint, &update, &valid, projectionMatrix(), geo, scaling);   // call generic implementation
         paintCursor(valid);
 
+        if (!m_overlayPlanesAssigned && screenId != -1) {
+            // The frame has been composited in the generic way, including the windows
+            // that have been shown on overlay planes so far.
+            m_backend->assignOverlays(screenId, {});
+        }
+
         if (!GLPlatform::instance()->isGLES() && screenId == -1) {
             const QSize &screenSize = screens()->size();
             const QRegion displayRegion(0, 0, screenSize.width(), screenSize.height());
@@ -695,6 +738,152 @@ void SceneOpenGL::paint(int screenId, const QRegion &damage, const QList<Topleve
     clearStackingOrder();
 }
 
+/**
+ * Returns @c true if the buffer of the @p surface is neither cropped, rotated nor flipped.
+ */
+static bool hasUntransformedBuffer(KWaylandServer::SurfaceInterface *surface)
+{
+    const QMatrix4x4 surfaceToBufferMatrix = surface->surfaceToBufferMatrix();
+    const QSize surfaceSize = surface->size();
+    const QSize bufferSize = surface->buffer()->size();
+    return surfaceToBufferMatrix.map(QPointF(0, 0)) == QPointF(0, 0) &&
+            surfaceToBufferMatrix.map(QPointF(surfaceSize.width(), 0)) == QPointF(bufferSize.width(), 0) &&
+            surfaceToBufferMatrix.map(QPointF(surfaceSize.width(), surfaceSize.height()))
+                == QPointF(bufferSize.width(), bufferSize.height());
+}
+
+bool SceneOpenGL::tryDirectScanout(int screenId)
+{
+    if (screenId == -1 || !waylandServer()) {
+        return false;
+    }
+    // The cursor and effects would have to be composited on top of the window.
+    if (kwinApp()->platform()->usesSoftwareCursor()) {
+        return false;
+    }
+    if (static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        return false;
+    }
+
+    const QRect screenGeometry = screens()->geometry(screenId);
+
+    // Find the topmost window on the screen, it has to be an opaque fullscreen window.
+    Window *candidate = nullptr;
+    for (int i = stacking_order.count() - 1; i >= 0; --i) {
+        Window *window = stacking_order[i];
+        if (window->isVisible() && window->window()->visibleRect().intersects(screenGeometry)) {
+            candidate = window;
+            break;
+        }
+    }
+    if (!candidate || !candidate->isOpaque()) {
+        return false;
+    }
+    const AbstractClient *client = qobject_cast<AbstractClient *>(candidate->window());
+    if (!client || !client->isFullScreen() || client->frameGeometry() != screenGeometry) {
+        return false;
+    }
+
+    KWaylandServer::SurfaceInterface *surface = client->surface();
+    if (!surface || !surface->buffer() || !surface->buffer()->linuxDmabufBuffer()) {
+        return false;
+    }
+    if (!surface->childSubSurfaces().isEmpty()) {
+        return false;
+    }
+    if (!hasUntransformedBuffer(surface)) {
+        return false;
+    }
+
+    // Overlay planes would cover the window.
+    m_backend->assignOverlays(screenId, {});
+    if (!m_backend->scanout(screenId, surface)) {
+        return false;
+    }
+
+    for (Window *window : qAsConst(stacking_order)) {
+        window->resetRepaints(screenId);
+    }
+    return true;
+}
+
+QRegion SceneOpenGL::assignOverlayPlanes(const QVector<Phase2Data> &windows)
+{
+    if (painted_screen == -1 || !waylandServer()) {
+        return QRegion();
+    }
+    m_overlayPlanesAssigned = true;
+
+    QVector<OpenGLBackend::Overlay> candidates;
+    // The cursor and effects would have to be composited on top of the overlay planes.
+    if (!kwinApp()->platform()->usesSoftwareCursor() &&
+            !static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        candidates = findOverlayCandidates(windows);
+    }
+    return m_backend->assignOverlays(painted_screen, candidates);
+}
+
+static QRegion subtreeArea(const WindowPixmap *pixmap)
+{
+    QRegion area = pixmap->mapToGlobal(pixmap->shape());
+    const auto children = pixmap->children();
+    for (const WindowPixmap *child : children) {
+        area += subtreeArea(child);
+    }
+    return area;
+}
+
+QVector<OpenGLBackend::Overlay> SceneOpenGL::findOverlayCandidates(const QVector<Phase2Data> &windows) const
+{
+    const QRect screenGeometry = screens()->geometry(painted_screen);
+
+    QVector<OpenGLBackend::Overlay> candidates;
+    for (int i = 0; i < windows.count(); ++i) {
+        const Phase2Data &data = windows[i];
+        if ((data.mask & PAINT_WINDOW_TRANSFORMED) || data.window->window()->opacity() != 1.0) {
+            continue;
+        }
+        const WindowPixmap *windowPixmap = data.window->windowPixmap<WindowPixmap>();
+        if (!windowPixmap) {
+            continue;
+        }
+
+        // Only leaf subsurfaces, such as video surfaces, are considered.
+        const QVector<WindowPixmap *> children = windowPixmap->children();
+        for (int j = 0; j < children.count(); ++j) {
+            const WindowPixmap *child = children[j];
+            KWaylandServer::SurfaceInterface *surface = child->surface();
+            if (!surface || !surface->buffer() || !surface->buffer()->linuxDmabufBuffer()) {
+                continue;
+            }
+            if (!child->children().isEmpty() || !hasUntransformedBuffer(surface)) {
+                continue;
+            }
+            if (child->hasAlphaChannel() && !(child->shape() - child->opaque()).isEmpty()) {
+                continue;
+            }
+            const QRect geometry = child->mapToGlobal(child->shape()).boundingRect();
+            if (!screenGeometry.contains(geometry)) {
+                continue;
+            }
+
+            // Nothing may be painted on top of an overlay plane.
+            bool occluded = false;
+            for (int k = j + 1; k < children.count() && !occluded; ++k) {
+                occluded = subtreeArea(children[k]).intersects(geometry);
+            }
+            for (int k = i + 1; k < windows.count() && !occluded; ++k) {
+                occluded = (windows[k].mask & PAINT_WINDOW_TRANSFORMED) ||
+                        windows[k].window->window()->visibleRect().intersects(geometry);
+            }
+            if (!occluded) {
+                candidates.append({ surface, geometry });
+            }
+        }
+    }
+    return candidates;
+}
+
 QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) const
 {
     QMatrix4x4 matrix;
@@ -805,6 +994,8 @@ void SceneOpenGL::screenGeometryChanged(const QSize &size)
 
 void SceneOpenGL::paintDesktop(int desktop, int mask, const QRegion &region, ScreenPaintData &data)
 {
+    flushWindowBatch();
+
     const QRect r = region.boundingRect();
     glEnable(GL_SCISSOR_TEST);
     glScissor(r.x(), screens()->size().height() - r.y() - r.height(), r.width(), r.height());
@@ -1005,11 +1196,23 @@ void SceneOpenGL2::paintSimpleScreen(int mask, const QRegion &region)
 {
     m_screenProjectionMatrix = m_projectionMatrix;
 
+    // Without active effects nothing but the scene paints in between the windows, so the
+    // windows can be painted in batches.
+    const bool batchWindows = !windowBatch() &&
+            !static_cast<EffectsHandlerImpl *>(effects)->isPaintingWithEffects();
+    if (batchWindows) {
+        beginWindowBatch();
+    }
     Scene::paintSimpleScreen(mask, region);
+    if (batchWindows) {
+        endWindowBatch();
+    }
 }
 
 void SceneOpenGL2::paintGenericScreen(int mask, const ScreenPaintData &data)
 {
+    flushWindowBatch();
+
     const QMatrix4x4 screenMatrix = transformation(mask, data);
 
     m_screenProjectionMatrix = m_projectionMatrix * screenMatrix;
@@ -1046,6 +1249,7 @@ void SceneOpenGL2::finalDrawWindow(EffectWindowImpl* w, int mask, const QRegion
 void SceneOpenGL2::performPaintWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data)
 {
     if (mask & PAINT_WINDOW_LANCZOS) {
+        flushWindowBatch();
         if (!m_lanczosFilter) {
             m_lanczosFilter = new LanczosFilter(this);
             // reset the lanczos filter when the screen gets resized
@@ -1065,6 +1269,11 @@ void SceneOpenGL2::performPaintWindow(EffectWindowImpl* w, int mask, const QRegi
 // OpenGLWindow
 //****************************************
 
+static const GLVertexAttrib s_windowVertexAttribs[] = {
+    { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
+    { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
+};
+
 OpenGLWindow::OpenGLWindow(Toplevel *toplevel, SceneOpenGL *scene)
     : Scene::Window(toplevel)
     , m_scene(scene)
@@ -1089,6 +1298,7 @@ bool OpenGLWindow::bindTexture()
     if (!window()->damage().isEmpty())
         m_scene->insertWait();
 
+    Scene::StageTimer uploadTimer(m_scene, Scene::Stage::TextureUpload);
     return pixmap->bind();
 }
 
@@ -1122,7 +1332,10 @@ bool OpenGLWindow::beginRenderWindow(int mask, const QRegion &region, WindowPain
     if (region.isEmpty())
         return false;
 
-    m_hardwareClipping = region != infiniteRegion() && (mask & Scene::PAINT_WINDOW_TRANSFORMED) && !(mask & Scene::PAINT_SCREEN_TRANSFORMED);
+    // The vertices of a window that keeps them on the GPU must not change with the region,
+    // so such windows are clipped with the scissor test rather than by splitting their quads.
+    m_hardwareClipping = region != infiniteRegion() && !(mask & Scene::PAINT_SCREEN_TRANSFORMED) &&
+            ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || canKeepVertices(data));
     if (region != infiniteRegion() && !m_hardwareClipping) {
         WindowQuadList quads;
         quads.reserve(data.quads.count());
@@ -1159,18 +1372,55 @@ bool OpenGLWindow::beginRenderWindow(int mask, const QRegion &region, WindowPain
         glEnable(GL_SCISSOR_TEST);
     }
 
-    const GLVertexAttrib attribs[] = {
-        { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
-        { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
-    };
-
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
     vbo->reset();
-    vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
+    vbo->setAttribLayout(s_windowVertexAttribs, 2, sizeof(GLVertex2D));
 
     return true;
 }
 
+bool OpenGLWindow::canKeepVertices(const WindowPaintData &data) const
+{
+    return data.crossFadeProgress() == 1.0 && isCachedQuadList(data.quads);
+}
+
+bool OpenGLWindow::canBatch(int mask, const WindowPaintData &data) const
+{
+    // The windows of a batch are painted with the plain texture shader.
+    if (data.shader || !(mask & Scene::PAINT_WINDOW_OPAQUE)) {
+        return false;
+    }
+    if (mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_SCREEN_TRANSFORMED)) {
+        return false;
+    }
+    if (data.opacity() != 1.0 || data.brightness() != 1.0 || data.saturation() != 1.0) {
+        return false;
+    }
+    return canKeepVertices(data);
+}
+
+void OpenGLWindow::addToBatch(OpenGLWindowBatch *batch, const QRegion &region, const WindowPaintData &data,
+                              const QMatrix4x4 &mvpMatrix, GLenum filter)
+{
+    RenderContext renderContext;
+    initializeRenderContext(renderContext, data);
+
+    OpenGLWindowBatch::Window window;
+    window.quads = data.quads;
+    window.mvpMatrix = mvpMatrix;
+    window.region = m_hardwareClipping ? region : infiniteRegion();
+    window.filter = filter;
+    for (const RenderNode &renderNode : qAsConst(renderContext.renderNodes)) {
+        if (renderNode.quads.isEmpty() || !renderNode.texture)
+            continue;
+        window.renderNodes.append(renderNode);
+        window.textureMatrices.append(renderNode.texture->matrix(renderNode.coordinateType));
+    }
+    if (!window.renderNodes.isEmpty()) {
+        batch->add(window);
+    }
+}
+
 void OpenGLWindow::endRenderWindow()
 {
     if (m_hardwareClipping) {
@@ -1261,15 +1511,15 @@ void OpenGLWindow::initializeRenderContext(RenderContext &context, const WindowP
     for (const WindowQuad &quad : data.quads) {
         switch (quad.type()) {
         case WindowQuadShadow:
-            renderNodes[context.shadowOffset].quads << quad;
+            renderNodes[context.shadowOffset].quads.append(quad);
             break;
 
         case WindowQuadDecoration:
-            renderNodes[context.decorationOffset].quads << quad;
+            renderNodes[context.decorationOffset].quads.append(quad);
             break;
 
         case WindowQuadContents:
-            renderNodes[context.contentOffset + quad.id()].quads << quad;
+            renderNodes[context.contentOffset + quad.id()].quads.append(quad);
             break;
 
         default:
@@ -1342,7 +1592,9 @@ void OpenGLWindow::initializeRenderContext(RenderContext &context, const WindowP
         if (previous) { // TODO(vlad): Should cross-fading be disabled on Wayland?
             const QRect &oldGeometry = previous->contentsRect();
             RenderNode &previousContentRenderNode = renderNodes[context.previousContentOffset];
-            for (const WindowQuad &quad : qAsConst(renderNodes[context.contentOffset].quads)) {
+            const WindowQuadArray &contentQuads = renderNodes[context.contentOffset].quads;
+            for (int index = 0; index < contentQuads.count(); ++index) {
+                const WindowQuad quad = contentQuads.at(index);
                 // We need to create new window quads with normalized texture coordinates.
                 // Normal quads divide the x/y position by width/height. This would not work
                 // as the texture is larger than the visible content in case of a decorated
@@ -1401,6 +1653,13 @@ QMatrix4x4 OpenGLWindow::modelViewProjectionMatrix(int mask, const WindowPaintDa
 
 void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPaintData &_data)
 {
+    OpenGLWindowBatch *batch = m_scene->windowBatch();
+    if (batch && !canBatch(mask, _data)) {
+        // The windows batched so far are below this one.
+        m_scene->flushWindowBatch();
+        batch = nullptr;
+    }
+
     WindowPaintData data = _data;
     if (!beginRenderWindow(mask, region, data))
         return;
@@ -1427,6 +1686,12 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
         }
     }
 
+    if (batch) {
+        addToBatch(batch, region, data, mvpMatrix, filter);
+        endRenderWindow();
+        return;
+    }
+
     if (!shader) {
         ShaderTraits traits = ShaderTrait::MapTexture;
         if (useX11TextureClamp) {
@@ -1454,8 +1719,10 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
 
     const size_t size = verticesPerQuad * renderContext.quadCount * sizeof(GLVertex2D);
 
-    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
-    GLVertex2D *map = (GLVertex2D *) vbo->map(size);
+    QVector<int> vertexNodes;
+    QVector<QMatrix4x4> textureMatrices;
+    vertexNodes.reserve(renderContext.renderNodes.count());
+    textureMatrices.reserve(renderContext.renderNodes.count());
 
     for (int i = 0, v = 0; i < renderContext.renderNodes.count(); i++) {
         RenderNode &renderNode = renderContext.renderNodes[i];
@@ -1464,14 +1731,58 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
 
         renderNode.firstVertex = v;
         renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad;
+        vertexNodes.append(i);
+        textureMatrices.append(renderNode.texture->matrix(renderNode.coordinateType));
+
+        v += renderNode.vertexCount;
+    }
+
+    // The vertices depend only on the window quads and the texture matrices. As long as
+    // neither the window nor an effect changes the quads, they are the quads cached by the
+    // window, so a static window can keep drawing the vertices it uploaded earlier. Windows
+    // whose quads are changed by an effect, e.g. while they are animated, keep using the
+    // streaming buffer.
+    const bool keepVertices = canKeepVertices(data);
+    const bool verticesUnchanged = keepVertices && m_vertexBufferValid &&
+            data.quads.isSharedWith(m_vertexQuads) &&
+            primitiveType == m_vertexPrimitiveType &&
+            vertexNodes == m_vertexNodes &&
+            textureMatrices == m_vertexTextureMatrices;
+
+    GLVertexBuffer *vbo;
+    if (verticesUnchanged) {
+        vbo = m_vertexBuffer.data();
+    } else {
+        if (keepVertices) {
+            if (!m_vertexBuffer) {
+                m_vertexBuffer.reset(new GLVertexBuffer(GLVertexBuffer::Dynamic));
+                m_vertexBuffer->setAttribLayout(s_windowVertexAttribs, 2, sizeof(GLVertex2D));
+            }
+            vbo = m_vertexBuffer.data();
+            m_vertexQuads = data.quads;
+            m_vertexPrimitiveType = primitiveType;
+            m_vertexNodes = vertexNodes;
+            m_vertexTextureMatrices = textureMatrices;
+            m_vertexBufferValid = true;
+        } else {
+            vbo = GLVertexBuffer::streamingBuffer();
+        }
+        m_scene->addToCounter(Scene::Counter::VertexUploads);
 
-        const QMatrix4x4 matrix = renderNode.texture->matrix(renderNode.coordinateType);
+        GLVertex2D *map = (GLVertex2D *) vbo->map(size);
 
-        renderNode.quads.makeInterleavedArrays(primitiveType, &map[v], matrix);
-        v += renderNode.quads.count() * verticesPerQuad;
+        for (int i = 0, j = 0; i < renderContext.renderNodes.count(); i++) {
+            const RenderNode &renderNode = renderContext.renderNodes[i];
+            if (renderNode.vertexCount == 0)
+                continue;
+
+            renderNode.quads.makeInterleavedArrays(primitiveType, &map[renderNode.firstVertex],
+                                                   textureMatrices.at(j++));
+        }
+
+        vbo->unmap();
     }
 
-    vbo->unmap();
     vbo->bindArrays();
 
     // Make sure the blend function is set up correctly in case we will be doing blending
@@ -1561,6 +1872,169 @@ QSharedPointer<GLTexture> OpenGLWindow::windowTexture()
     }
 }
 
+//****************************************
+// OpenGLWindowBatch
+//****************************************
+
+OpenGLWindowBatch::OpenGLWindowBatch(Scene *scene)
+    : m_scene(scene)
+{
+}
+
+void OpenGLWindowBatch::begin(int screenId)
+{
+    m_screenId = screenId;
+    m_flushCount = 0;
+}
+
+void OpenGLWindowBatch::end()
+{
+    flush();
+
+    // Drop the vertices of batches that the screen no longer paints.
+    auto it = m_vertices.lower_bound(std::make_pair(m_screenId, m_flushCount));
+    while (it != m_vertices.end() && it->first.first == m_screenId) {
+        it = m_vertices.erase(it);
+    }
+}
+
+void OpenGLWindowBatch::add(const Window &window)
+{
+    m_windows.append(window);
+}
+
+bool OpenGLWindowBatch::uploadVertices(Vertices &vertices, GLenum primitiveType, int verticesPerQuad)
+{
+    bool unchanged = vertices.buffer && vertices.primitiveType == primitiveType &&
+            vertices.quads.count() == m_windows.count();
+
+    // Lay out the vertices of the render nodes one after another.
+    int vertexCount = 0;
+    for (int i = 0; i < m_windows.count(); ++i) {
+        Window &window = m_windows[i];
+        QVector<int> vertexCounts;
+        vertexCounts.reserve(window.renderNodes.count());
+        for (OpenGLWindow::RenderNode &renderNode : window.renderNodes) {
+            renderNode.firstVertex = vertexCount;
+            renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad;
+            vertexCount += renderNode.vertexCount;
+            vertexCounts.append(renderNode.vertexCount);
+        }
+        unchanged = unchanged && window.quads.isSharedWith(vertices.quads.at(i)) &&
+                vertexCounts == vertices.vertexCounts.at(i) &&
+                window.textureMatrices == vertices.textureMatrices.at(i);
+        if (!unchanged) {
+            vertices.quads.resize(i + 1);
+            vertices.vertexCounts.resize(i + 1);
+            vertices.textureMatrices.resize(i + 1);
+            vertices.quads[i] = window.quads;
+            vertices.vertexCounts[i] = vertexCounts;
+            vertices.textureMatrices[i] = window.textureMatrices;
+        }
+    }
+    if (unchanged) {
+        return false;
+    }
+
+    if (!vertices.buffer) {
+        vertices.buffer.reset(new GLVertexBuffer(GLVertexBuffer::Dynamic));
+        vertices.buffer->setAttribLayout(s_windowVertexAttribs, 2, sizeof(GLVertex2D));
+    }
+    vertices.primitiveType = primitiveType;
+
+    GLVertex2D *map = (GLVertex2D *) vertices.buffer->map(vertexCount * sizeof(GLVertex2D));
+    for (const Window &window : qAsConst(m_windows)) {
+        for (int i = 0; i < window.renderNodes.count(); ++i) {
+            const OpenGLWindow::RenderNode &renderNode = window.renderNodes.at(i);
+            renderNode.quads.makeInterleavedArrays(primitiveType, &map[renderNode.firstVertex],
+                                                   window.textureMatrices.at(i));
+        }
+    }
+    vertices.buffer->unmap();
+
+    m_scene->addToCounter(Scene::Counter::VertexUploads, m_windows.count());
+    return true;
+}
+
+void OpenGLWindowBatch::flush()
+{
+    if (m_windows.isEmpty()) {
+        return;
+    }
+
+    const bool indexedQuads = GLVertexBuffer::supportsIndexedQuads();
+    const GLenum primitiveType = indexedQuads ? GL_QUADS : GL_TRIANGLES;
+    const int verticesPerQuad = indexedQuads ? 4 : 6;
+
+    Vertices &vertices = m_vertices[std::make_pair(m_screenId, m_flushCount++)];
+    uploadVertices(vertices, primitiveType, verticesPerQuad);
+
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    GLShader *shader = binder.shader();
+
+    vertices.buffer->bindArrays();
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    bool blending = false;
+    bool scissoring = false;
+    QVarLengthArray<int, 8> firsts;
+    QVarLengthArray<int, 8> counts;
+
+    for (const Window &window : qAsConst(m_windows)) {
+        shader->setUniform(GLShader::ModelViewProjectionMatrix, window.mvpMatrix);
+
+        const bool hardwareClipping = window.region != infiniteRegion();
+        if (hardwareClipping != scissoring) {
+            if (hardwareClipping) {
+                glEnable(GL_SCISSOR_TEST);
+            } else {
+                glDisable(GL_SCISSOR_TEST);
+            }
+            scissoring = hardwareClipping;
+        }
+
+        const QVector<OpenGLWindow::RenderNode> &renderNodes = window.renderNodes;
+        for (int i = 0; i < renderNodes.count();) {
+            const OpenGLWindow::RenderNode &renderNode = renderNodes.at(i);
+
+            // Consecutive render nodes that sample the same texture are drawn at once.
+            firsts.clear();
+            counts.clear();
+            for (; i < renderNodes.count() && renderNodes.at(i).texture == renderNode.texture &&
+                     renderNodes.at(i).hasAlpha == renderNode.hasAlpha; ++i) {
+                firsts.append(renderNodes.at(i).firstVertex);
+                counts.append(renderNodes.at(i).vertexCount);
+            }
+
+            if (renderNode.hasAlpha != blending) {
+                if (renderNode.hasAlpha) {
+                    glEnable(GL_BLEND);
+                } else {
+                    glDisable(GL_BLEND);
+                }
+                blending = renderNode.hasAlpha;
+            }
+
+            renderNode.texture->setFilter(window.filter);
+            renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+            renderNode.texture->bind();
+
+            vertices.buffer->multiDraw(window.region, primitiveType, firsts.constData(),
+                                       counts.constData(), firsts.count(), hardwareClipping);
+        }
+    }
+
+    if (blending) {
+        glDisable(GL_BLEND);
+    }
+    if (scissoring) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+    vertices.buffer->unbindArrays();
+
+    m_windows.clear();
+}
+
 //****************************************
 // OpenGLWindowPixmap
 //****************************************
@@ -2508,11 +2982,24 @@ bool SceneOpenGLShadow::prepareBackend()
     return true;
 }
 
+// Decorations that look the same, e.g. those of inactive windows with the same size and
+// caption, share their texture. The key is a hash of the recorded paint commands.
+static QHash<QByteArray, QWeakPointer<GLTexture>> s_sharedDecorationTextures;
+
+// We pad each part in the decoration atlas in order to avoid texture bleeding.
+static const int s_decorationPadding = 1;
+
 SceneOpenGLDecorationRenderer::SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client)
     : Renderer(client)
     , m_texture()
 {
     connect(this, &Renderer::renderScheduled, client->client(), static_cast<void (AbstractClient::*)(const QRect&)>(&AbstractClient::addRepaint));
+    connect(&m_pendingRender, &QFutureWatcher<QVector<PartImage>>::finished, this, [this]() {
+        // The images are uploaded the next time the decoration is painted.
+        if (m_renderPending) {
+            emit renderScheduled(m_pendingRegion.boundingRect());
+        }
+    });
 }
 
 SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
@@ -2522,29 +3009,37 @@ SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
     }
 }
 
-// Rotates the given source rect 90° counter-clockwise,
-// and flips it vertically
-static QImage rotate(const QImage &srcImage, const QRect &srcRect)
-{
-    auto dpr = srcImage.devicePixelRatio();
-    QImage image(srcRect.height() * dpr, srcRect.width() * dpr, srcImage.format());
-    image.setDevicePixelRatio(dpr);
-    const QPoint srcPoint(srcRect.x() * dpr, srcRect.y() * dpr);
-
-    const uint32_t *src = reinterpret_cast<const uint32_t *>(srcImage.bits());
-    uint32_t *dst = reinterpret_cast<uint32_t *>(image.bits());
-
-    for (int x = 0; x < image.width(); x++) {
-        const uint32_t *s = src + (srcPoint.y() + x) * srcImage.width() + srcPoint.x();
-        uint32_t *d = dst + x;
+namespace {
 
-        for (int y = 0; y < image.height(); y++) {
-            *d = s[y];
-            d += image.width();
+/**
+ * Reports the device pixel ratio of the screen to the decoration, so that it can pick
+ * the right icon sizes while it is recorded.
+ */
+class DecorationPicture : public QPicture
+{
+public:
+    explicit DecorationPicture(qreal devicePixelRatio)
+        : m_devicePixelRatio(devicePixelRatio)
+    {
+    }
+
+protected:
+    int metric(PaintDeviceMetric metric) const override
+    {
+        switch (metric) {
+        case PdmDevicePixelRatio:
+            return std::ceil(m_devicePixelRatio);
+        case PdmDevicePixelRatioScaled:
+            return m_devicePixelRatio * devicePixelRatioFScale();
+        default:
+            return QPicture::metric(metric);
         }
     }
 
-    return image;
+private:
+    qreal m_devicePixelRatio;
+};
+
 }
 
 static void clamp_row(int left, int width, int right, const uint32_t *src, uint32_t *dest)
@@ -2593,29 +3088,60 @@ static void clamp(QImage &image, const QRect &viewport)
     }
 }
 
-void SceneOpenGLDecorationRenderer::render()
+static QRect transposed(const QRect &rect)
 {
-    const QRegion scheduled = getScheduled();
-    if (scheduled.isEmpty()) {
-        return;
-    }
-    if (areImageSizesDirty()) {
-        resizeTexture();
-        resetImageSizesDirty();
-    }
+    return QRect(rect.y(), rect.x(), rect.height(), rect.width());
+}
 
-    if (!m_texture) {
-        // for invalid sizes we get no texture, see BUG 361551
-        return;
+// Runs on a worker thread, it must not touch the decoration or the renderer.
+static QVector<SceneOpenGLDecorationRenderer::PartImage> rasteriseParts(const QVector<SceneOpenGLDecorationRenderer::PartRecording> &parts)
+{
+    QVector<SceneOpenGLDecorationRenderer::PartImage> images;
+    images.reserve(parts.count());
+
+    for (const SceneOpenGLDecorationRenderer::PartRecording &part : parts) {
+        const qreal devicePixelRatio = part.devicePixelRatio;
+
+        QSize size = part.size * devicePixelRatio;
+        QRect viewport(part.viewport.topLeft() * devicePixelRatio, part.viewport.size() * devicePixelRatio);
+        QTransform transform = QTransform::fromTranslate(part.viewport.x() - part.geometry.x(),
+                                                         part.viewport.y() - part.geometry.y());
+        transform *= QTransform::fromScale(devicePixelRatio, devicePixelRatio);
+        if (part.rotated) {
+            // The left and right parts are stored rotated 90° counter-clockwise and flipped
+            // vertically in the texture, i.e. transposed.
+            transform *= QTransform(0, 1, 1, 0, 0, 0);
+            size.transpose();
+            viewport = transposed(viewport);
+        }
+
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setTransform(transform);
+        painter.drawPicture(0, 0, part.picture);
+        painter.end();
+
+        clamp(image, viewport);
+
+        images.append({image, part.position * devicePixelRatio});
     }
 
+    return images;
+}
+
+QVector<SceneOpenGLDecorationRenderer::PartRecording> SceneOpenGLDecorationRenderer::recordParts(const QRegion &region)
+{
     QRect left, top, right, bottom;
     client()->client()->layoutDecorationRects(left, top, right, bottom);
+    const qreal devicePixelRatio = client()->client()->screenScale();
+    const int padding = s_decorationPadding;
 
-    // We pad each part in the decoration atlas in order to avoid texture bleeding.
-    const int padding = 1;
+    QVector<PartRecording> parts;
 
-    auto renderPart = [=](const QRect &geo, const QRect &partRect, const QPoint &position, bool rotated = false) {
+    auto recordPart = [&](const QRect &geo, const QRect &partRect, const QPoint &position, bool rotated = false) {
         if (!geo.isValid()) {
             return;
         }
@@ -2638,44 +3164,180 @@ void SceneOpenGLDecorationRenderer::render()
             rect.setBottom(rect.bottom() + padding);
         }
 
-        QRect viewport = geo.translated(-rect.x(), -rect.y());
-        const qreal devicePixelRatio = client()->client()->screenScale();
+        PartRecording part;
+        part.geometry = geo;
+        part.viewport = geo.translated(-rect.x(), -rect.y());
+        part.size = rect.size();
+        part.devicePixelRatio = devicePixelRatio;
+        part.rotated = rotated;
 
-        QImage image(rect.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
-        image.setDevicePixelRatio(devicePixelRatio);
-        image.fill(Qt::transparent);
+        QPoint dirtyOffset = geo.topLeft() - partRect.topLeft();
+        QPoint viewportOffset = part.viewport.topLeft();
+        if (rotated) {
+            dirtyOffset = QPoint(dirtyOffset.y(), dirtyOffset.x());
+            viewportOffset = QPoint(viewportOffset.y(), viewportOffset.x());
+        }
+        part.position = position + dirtyOffset - viewportOffset;
 
-        QPainter painter(&image);
+        DecorationPicture picture(devicePixelRatio);
+        QPainter painter(&picture);
         painter.setRenderHint(QPainter::Antialiasing);
-        painter.setViewport(QRect(viewport.topLeft(), viewport.size() * devicePixelRatio));
-        painter.setWindow(QRect(geo.topLeft(), geo.size() * devicePixelRatio));
         painter.setClipRect(geo);
         renderToPainter(&painter, geo);
         painter.end();
+        part.picture = picture;
 
-        clamp(image, QRect(viewport.topLeft(), viewport.size() * devicePixelRatio));
-
-        if (rotated) {
-            // TODO: get this done directly when rendering to the image
-            image = rotate(image, QRect(QPoint(), rect.size()));
-            viewport = QRect(viewport.y(), viewport.x(), viewport.height(), viewport.width());
-        }
-
-        const QPoint dirtyOffset = geo.topLeft() - partRect.topLeft();
-        m_texture->update(image, (position + dirtyOffset - viewport.topLeft()) * image.devicePixelRatio());
+        parts.append(part);
     };
 
-    const QRect geometry = scheduled.boundingRect();
+    const QRect geometry = region.boundingRect();
 
     const QPoint topPosition(padding, padding);
     const QPoint bottomPosition(padding, topPosition.y() + top.height() + 2 * padding);
     const QPoint leftPosition(padding, bottomPosition.y() + bottom.height() + 2 * padding);
     const QPoint rightPosition(padding, leftPosition.y() + left.width() + 2 * padding);
 
-    renderPart(left.intersected(geometry), left, leftPosition, true);
-    renderPart(top.intersected(geometry), top, topPosition);
-    renderPart(right.intersected(geometry), right, rightPosition, true);
-    renderPart(bottom.intersected(geometry), bottom, bottomPosition);
+    recordPart(left.intersected(geometry), left, leftPosition, true);
+    recordPart(top.intersected(geometry), top, topPosition);
+    recordPart(right.intersected(geometry), right, rightPosition, true);
+    recordPart(bottom.intersected(geometry), bottom, bottomPosition);
+
+    return parts;
+}
+
+static QByteArray sharedTextureKey(const QSize &size, const QVector<SceneOpenGLDecorationRenderer::PartRecording> &parts)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << size;
+    for (const SceneOpenGLDecorationRenderer::PartRecording &part : parts) {
+        stream << part.geometry << part.position << part.devicePixelRatio << part.rotated;
+        stream.writeRawData(part.picture.data(), part.picture.size());
+    }
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+static QSharedPointer<GLTexture> createDecorationTexture(const QSize &size)
+{
+    QSharedPointer<GLTexture> texture(new GLTexture(GL_RGBA8, size.width(), size.height()));
+    texture->setYInverted(true);
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    texture->clear();
+    return texture;
+}
+
+void SceneOpenGLDecorationRenderer::upload(const QVector<PartImage> &images)
+{
+    for (const PartImage &part : images) {
+        m_texture->update(part.image, part.position);
+    }
+}
+
+void SceneOpenGLDecorationRenderer::finishPendingRender()
+{
+    if (!m_renderPending) {
+        return;
+    }
+    m_pendingRender.waitForFinished();
+    m_renderPending = false;
+
+    if (areImageSizesDirty()) {
+        // The texture is going to be replaced, the images are outdated.
+        return;
+    }
+    if (m_renderDetaches) {
+        m_texture = createDecorationTexture(m_texture->size());
+        m_sharedTextureKey.clear();
+    }
+    upload(m_pendingRender.result());
+}
+
+void SceneOpenGLDecorationRenderer::renderSynchronously()
+{
+    finishPendingRender();
+
+    if (!areImageSizesDirty()) {
+        const QRegion scheduled = getScheduled();
+        if (scheduled.isEmpty() || !m_texture) {
+            return;
+        }
+        QRegion region = scheduled;
+        if (!m_sharedTextureKey.isEmpty()) {
+            m_texture = createDecorationTexture(m_texture->size());
+            m_sharedTextureKey.clear();
+            region = client()->client()->rect();
+        }
+        upload(rasteriseParts(recordParts(region)));
+        return;
+    }
+
+    // The whole decoration is repainted whenever its size changes.
+    getScheduled();
+    resetImageSizesDirty();
+
+    const QSize size = textureSize();
+    if (size.isEmpty()) {
+        // for invalid sizes we get no texture, see BUG 361551
+        m_texture.reset();
+        m_sharedTextureKey.clear();
+        return;
+    }
+
+    const QVector<PartRecording> parts = recordParts(client()->client()->rect());
+    const QByteArray key = sharedTextureKey(size, parts);
+    if (QSharedPointer<GLTexture> texture = s_sharedDecorationTextures.value(key).toStrongRef()) {
+        m_texture = texture;
+        m_sharedTextureKey = key;
+        return;
+    }
+
+    if (!m_texture || m_texture->size() != size || !m_sharedTextureKey.isEmpty()) {
+        m_texture = createDecorationTexture(size);
+    }
+    upload(rasteriseParts(parts));
+
+    for (auto it = s_sharedDecorationTextures.begin(); it != s_sharedDecorationTextures.end();) {
+        if (it.value().isNull()) {
+            it = s_sharedDecorationTextures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    s_sharedDecorationTextures.insert(key, m_texture);
+    m_sharedTextureKey = key;
+}
+
+void SceneOpenGLDecorationRenderer::render()
+{
+    if (areImageSizesDirty()) {
+        // Don't show a blank or stretched decoration for a frame after a resize.
+        renderSynchronously();
+        return;
+    }
+
+    if (m_renderPending) {
+        if (!m_pendingRender.isFinished()) {
+            // Anything scheduled meanwhile is rendered once the worker is done.
+            return;
+        }
+        finishPendingRender();
+    }
+
+    const QRegion scheduled = getScheduled();
+    if (scheduled.isEmpty() || !m_texture) {
+        return;
+    }
+
+    // Painting the decoration, e.g. for hover animations, must not stall compositing, so only
+    // the recording happens here. The images are rasterised by a worker and uploaded later.
+    QRegion region = scheduled;
+    m_renderDetaches = !m_sharedTextureKey.isEmpty();
+    if (m_renderDetaches) {
+        region = client()->client()->rect();
+    }
+    m_pendingRender.setFuture(QtConcurrent::run(rasteriseParts, recordParts(region)));
+    m_pendingRegion = region;
+    m_renderPending = true;
 }
 
 static int align(int value, int align)
@@ -2683,7 +3345,7 @@ static int align(int value, int align)
     return (value + align - 1) & ~(align - 1);
 }
 
-void SceneOpenGLDecorationRenderer::resizeTexture()
+QSize SceneOpenGLDecorationRenderer::textureSize()
 {
     QRect left, top, right, bottom;
     client()->client()->layoutDecorationRects(left, top, right, bottom);
@@ -2695,29 +3357,20 @@ void SceneOpenGLDecorationRenderer::resizeTexture()
                      left.width() + right.width();
 
     // Reserve some space for padding. We pad decoration parts to avoid texture bleeding.
-    const int padding = 1;
+    const int padding = s_decorationPadding;
     size.rwidth() += 2 * padding;
     size.rheight() += 4 * 2 * padding;
 
     size.rwidth() = align(size.width(), 128);
 
     size *= client()->client()->screenScale();
-    if (m_texture && m_texture->size() == size)
-        return;
-
-    if (!size.isEmpty()) {
-        m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
-        m_texture->setYInverted(true);
-        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_texture->clear();
-    } else {
-        m_texture.reset();
-    }
+    return size;
 }
 
 void SceneOpenGLDecorationRenderer::reparent(Deleted *deleted)
 {
-    render();
+    // Nothing can be recorded after the client is gone.
+    renderSynchronously();
     Renderer::reparent(deleted);
 }
 
@@ -19,10 +19,16 @@
 #include "decorations/decorationrenderer.h"
 #include "platformsupport/scenes/opengl/backend.h"
 
+#include <QFutureWatcher>
+#include <QPicture>
+
+#include <map>
+
 namespace KWin
 {
 class LanczosFilter;
 class OpenGLBackend;
+class OpenGLWindowBatch;
 class SyncManager;
 class SyncObject;
 
@@ -75,17 +81,32 @@ public:
 
     static SceneOpenGL *createScene(QObject *parent);
 
+    /**
+     * Returns the batch that windows which can share their draw calls are added to instead
+     * of being painted right away, or @c null if every window is painted on its own.
+     */
+    OpenGLWindowBatch *windowBatch() const;
+    /**
+     * Paints the windows that have been added to the window batch so far. Anything that is
+     * painted in between windows has to flush the batch first.
+     */
+    void flushWindowBatch();
+
 protected:
     SceneOpenGL(OpenGLBackend *backend, QObject *parent = nullptr);
     void paintBackground(const QRegion &region) override;
     void aboutToStartPainting(int screenId, const QRegion &damage) override;
     void extendPaintRegion(QRegion &region, bool opaqueFullscreen) override;
+    QRegion assignOverlayPlanes(const QVector<Phase2Data> &windows) override;
     QMatrix4x4 transformation(int mask, const ScreenPaintData &data) const;
     void paintDesktop(int desktop, int mask, const QRegion &region, ScreenPaintData &data) override;
     void paintEffectQuickView(EffectQuickView *w) override;
 
     void handleGraphicsReset(GLenum status);
 
+    void beginWindowBatch();
+    void endWindowBatch();
+
     virtual void doPaintBackground(const QVector<float> &vertices) = 0;
     virtual void updateProjectionMatrix() = 0;
 
@@ -93,9 +114,14 @@ protected:
     bool init_ok;
 private:
     bool viewportLimitsMatched(const QSize &size) const;
+    bool tryDirectScanout(int screenId);
+    QVector<OpenGLBackend::Overlay> findOverlayCandidates(const QVector<Phase2Data> &windows) const;
 
 private:
     bool m_resetOccurred = false;
+    bool m_overlayPlanesAssigned = false;
+    QScopedPointer<OpenGLWindowBatch> m_windowBatch;
+    bool m_windowBatchActive = false;
     bool m_debug;
     OpenGLBackend *m_backend;
     SyncManager *m_syncManager;
@@ -160,7 +186,7 @@ public:
         }
 
         GLTexture *texture;
-        WindowQuadList quads;
+        WindowQuadArray quads;
         int firstVertex;
         int vertexCount;
         float opacity;
@@ -195,11 +221,78 @@ private:
     void initializeRenderContext(RenderContext &context, const WindowPaintData &data);
     bool beginRenderWindow(int mask, const QRegion &region, WindowPaintData &data);
     void endRenderWindow();
+    bool canKeepVertices(const WindowPaintData &data) const;
+    bool canBatch(int mask, const WindowPaintData &data) const;
+    void addToBatch(OpenGLWindowBatch *batch, const QRegion &region, const WindowPaintData &data,
+                    const QMatrix4x4 &mvpMatrix, GLenum filter);
     bool bindTexture();
 
     SceneOpenGL *m_scene;
     bool m_hardwareClipping = false;
     bool m_blendingEnabled = false;
+
+    // Vertices of the window kept on the GPU while its quads don't change, and what they
+    // were generated from.
+    QScopedPointer<GLVertexBuffer> m_vertexBuffer;
+    bool m_vertexBufferValid = false;
+    WindowQuadList m_vertexQuads;
+    GLenum m_vertexPrimitiveType = GL_TRIANGLES;
+    QVector<int> m_vertexNodes;
+    QVector<QMatrix4x4> m_vertexTextureMatrices;
+};
+
+/**
+ * Collects consecutive windows that are painted untransformed, opaque and with the plain
+ * texture shader, so that they can be drawn with one vertex upload and one shader bind.
+ * Render nodes of a window that sample the same texture one after another are drawn with
+ * a single multi-draw call.
+ *
+ * The vertices of a batch are kept on the GPU and reused as long as the batch at the same
+ * position in the frame is made of the same window quads.
+ */
+class OpenGLWindowBatch
+{
+public:
+    struct Window
+    {
+        WindowQuadList quads;
+        QVector<OpenGLWindow::RenderNode> renderNodes;
+        QVector<QMatrix4x4> textureMatrices;
+        QMatrix4x4 mvpMatrix;
+        QRegion region;
+        GLenum filter;
+    };
+
+    explicit OpenGLWindowBatch(Scene *scene);
+
+    /**
+     * Starts collecting the windows that are painted on the screen with the given @p screenId.
+     */
+    void begin(int screenId);
+    void end();
+    void add(const Window &window);
+    /**
+     * Draws the windows collected so far.
+     */
+    void flush();
+
+private:
+    struct Vertices
+    {
+        QScopedPointer<GLVertexBuffer> buffer;
+        GLenum primitiveType = GL_TRIANGLES;
+        QVector<WindowQuadList> quads;
+        QVector<QVector<int>> vertexCounts;
+        QVector<QVector<QMatrix4x4>> textureMatrices;
+    };
+
+    bool uploadVertices(Vertices &vertices, GLenum primitiveType, int verticesPerQuad);
+
+    Scene *m_scene;
+    QVector<Window> m_windows;
+    int m_screenId = -1;
+    int m_flushCount = 0;
+    std::map<std::pair<int, int>, Vertices> m_vertices;
 };
 
 class OpenGLWindowPixmap : public WindowPixmap
@@ -303,9 +396,42 @@ public:
         return m_texture.data();
     }
 
+    /**
+     * The paint commands for a repainted area of one decoration part. The decoration can
+     * only be used on the main thread, its recording can be rasterised on any thread.
+     */
+    struct PartRecording {
+        QPicture picture;
+        QRect geometry; ///< The repainted area, in decoration coordinates
+        QRect viewport; ///< The repainted area within the padded image, in logical pixels
+        QSize size; ///< The size of the padded image, in logical pixels
+        QPoint position; ///< The position of the padded image in the texture, in logical pixels
+        qreal devicePixelRatio = 1;
+        bool rotated = false;
+    };
+    /**
+     * A rasterised PartRecording that is ready to be uploaded to the texture.
+     */
+    struct PartImage {
+        QImage image;
+        QPoint position; ///< In device pixels
+    };
+
 private:
-    void resizeTexture();
-    QScopedPointer<GLTexture> m_texture;
+    QSize textureSize();
+    QVector<PartRecording> recordParts(const QRegion &region);
+    void renderSynchronously();
+    void finishPendingRender();
+    void upload(const QVector<PartImage> &images);
+
+    QSharedPointer<GLTexture> m_texture;
+    // Set if the texture is shared with other decorations that look the same.
+    QByteArray m_sharedTextureKey;
+    QFutureWatcher<QVector<PartImage>> m_pendingRender;
+    QRegion m_pendingRegion;
+    bool m_renderPending = false;
+    // Whether the pending render has to go to a new texture because the current one is shared.
+    bool m_renderDetaches = false;
 };
 
 inline bool SceneOpenGL::hasPendingFlush() const
@@ -31,6 +31,7 @@
 #include <KDecoration2/Decoration>
 
 #include <cmath>
+#include <cstring>
 
 namespace KWin
 {
@@ -330,7 +331,7 @@ void SceneQPainter::Window::renderWindowDecorations(QPainter *painter)
 
 WindowPixmap *SceneQPainter::Window::createWindowPixmap()
 {
-    return new QPainterWindowPixmap(this);
+    return new QPainterWindowPixmap(this, m_scene);
 }
 
 Decoration::Renderer *SceneQPainter::createDecorationRenderer(Decoration::DecoratedClientImpl *impl)
@@ -341,13 +342,15 @@ Decoration::Renderer *SceneQPainter::createDecorationRenderer(Decoration::Decora
 //****************************************
 // QPainterWindowPixmap
 //****************************************
-QPainterWindowPixmap::QPainterWindowPixmap(Scene::Window *window)
+QPainterWindowPixmap::QPainterWindowPixmap(Scene::Window *window, SceneQPainter *scene)
     : WindowPixmap(window)
+    , m_scene(scene)
 {
 }
 
-QPainterWindowPixmap::QPainterWindowPixmap(KWaylandServer::SubSurfaceInterface *subSurface, WindowPixmap *parent)
+QPainterWindowPixmap::QPainterWindowPixmap(KWaylandServer::SubSurfaceInterface *subSurface, WindowPixmap *parent, SceneQPainter *scene)
     : WindowPixmap(subSurface, parent)
+    , m_scene(scene)
 {
 }
 
@@ -369,39 +372,57 @@ void QPainterWindowPixmap::create()
         m_image = internalImage();
         return;
     }
-    // performing deep copy, this could probably be improved
-    m_image = buffer()->data().copy();
-    if (auto s = surface()) {
-        s->resetTrackedDamage();
-    }
+    updateImage();
 }
 
 WindowPixmap *QPainterWindowPixmap::createChild(KWaylandServer::SubSurfaceInterface *subSurface)
 {
-    return new QPainterWindowPixmap(subSurface, this);
+    return new QPainterWindowPixmap(subSurface, this, m_scene);
 }
 
 void QPainterWindowPixmap::update()
 {
-    const auto oldBuffer = buffer();
     WindowPixmap::update();
-    const auto &b = buffer();
     if (!surface()) {
         // That's an internal client.
         m_image = internalImage();
         return;
     }
-    if (!b) {
+    if (!buffer()) {
         m_image = QImage();
         return;
     }
-    if (b == oldBuffer) {
+    updateImage();
+}
+
+void QPainterWindowPixmap::updateImage()
+{
+    KWaylandServer::SurfaceInterface *s = surface();
+    const QImage source = buffer()->data();
+    const QRegion damage = s->mapToBuffer(s->trackedDamage()) & source.rect();
+    s->resetTrackedDamage();
+
+    // The client buffer may be reused by the client as soon as it's released, so keep a
+    // copy of it. Once we have one, only the damaged parts need to be brought up to date.
+    if (m_image.size() != source.size() || m_image.format() != source.format()) {
+        m_image = source.copy();
+        m_scene->addToCounter(Scene::Counter::CopiedBytes, m_image.sizeInBytes());
         return;
     }
-    // perform deep copy
-    m_image = b->data().copy();
-    if (auto s = surface()) {
-        s->resetTrackedDamage();
+
+    const int bytesPerPixel = source.depth() / 8;
+    for (const QRect &rect : damage) {
+        const int rowBytes = rect.width() * bytesPerPixel;
+        if (rect.width() == source.width() && source.bytesPerLine() == m_image.bytesPerLine()) {
+            // Consecutive full rows can be copied in one go.
+            memcpy(m_image.scanLine(rect.y()), source.constScanLine(rect.y()), source.bytesPerLine() * rect.height());
+        } else {
+            const int offset = rect.x() * bytesPerPixel;
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                memcpy(m_image.scanLine(y) + offset, source.constScanLine(y) + offset, rowBytes);
+            }
+        }
+        m_scene->addToCounter(Scene::Counter::CopiedBytes, qint64(rowBytes) * rect.height());
     }
 }
 
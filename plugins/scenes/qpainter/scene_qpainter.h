@@ -63,7 +63,7 @@ private:
 class QPainterWindowPixmap : public WindowPixmap
 {
 public:
-    explicit QPainterWindowPixmap(Scene::Window *window);
+    explicit QPainterWindowPixmap(Scene::Window *window, SceneQPainter *scene);
     ~QPainterWindowPixmap() override;
     void create() override;
     void update() override;
@@ -74,8 +74,10 @@ public:
 protected:
     WindowPixmap *createChild(KWaylandServer::SubSurfaceInterface *subSurface) override;
 private:
-    explicit QPainterWindowPixmap(KWaylandServer::SubSurfaceInterface *subSurface, WindowPixmap *parent);
+    explicit QPainterWindowPixmap(KWaylandServer::SubSurfaceInterface *subSurface, WindowPixmap *parent, SceneQPainter *scene);
+    void updateImage();
     QImage m_image;
+    SceneQPainter *m_scene;
 };
 
 class SceneQPainter::Window : public Scene::Window
@@ -7,6 +7,7 @@
 */
 
 #include "pipewirestream.h"
+#include "composite.h"
 #include "cursor.h"
 #include "dmabuftexture.h"
 #include "eglnativefence.h"
@@ -16,6 +17,7 @@
 #include "main.h"
 #include "pipewirecore.h"
 #include "platform.h"
+#include "scene.h"
 #include "utils.h"
 
 #include <KLocalizedString>
@@ -25,6 +27,7 @@
 
 #include <spa/buffer/meta.h>
 
+#include <cstring>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -162,6 +165,13 @@ void PipeWireStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
 
+    stream->m_bufferDamage.remove(buffer);
+    for (Readback &readback : stream->m_readbacks) {
+        if (readback.buffer == buffer) {
+            readback.buffer = nullptr;
+        }
+    }
+
     if (spa_data->type == SPA_DATA_DmaBuf) {
         stream->m_dmabufDataForPwBuffer.remove(buffer);
     } else if (spa_data->type == SPA_DATA_MemFd) {
@@ -180,11 +190,26 @@ PipeWireStream::PipeWireStream(bool hasAlpha, const QSize &resolution, QObject *
     pwStreamEvents.remove_buffer = &PipeWireStream::onStreamRemoveBuffer;
     pwStreamEvents.state_changed = &PipeWireStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &PipeWireStream::onStreamParamChanged;
+
+    m_readbackTimer.setSingleShot(true);
+    connect(&m_readbackTimer, &QTimer::timeout, this, [this]() {
+        if (Compositor::self() && Compositor::self()->scene() && Compositor::self()->scene()->makeOpenGLContextCurrent()) {
+            finishReadbacks();
+        }
+    });
+
+    // The pixel buffers and fences belong to the OpenGL context of the scene, which goes
+    // away when compositing is restarted.
+    if (Compositor *compositor = Compositor::self()) {
+        connect(compositor, &Compositor::aboutToToggleCompositing, this, &PipeWireStream::destroyReadbacks);
+        connect(compositor, &Compositor::aboutToDestroy, this, &PipeWireStream::destroyReadbacks);
+    }
 }
 
 PipeWireStream::~PipeWireStream()
 {
     m_stopped = true;
+    destroyReadbacks();
     if (pwStream) {
         pw_stream_destroy(pwStream);
     }
@@ -303,29 +328,36 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
     Q_ASSERT(!m_stopped);
     Q_ASSERT(frameTexture);
 
-    if (m_pendingBuffer) {
-        qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
-        return;
-    }
+    // Hand frames that have been read back in the meantime over to PipeWire.
+    finishReadbacks();
 
     if (frameTexture->size() != m_resolution) {
         m_resolution = frameTexture->size();
+        m_bufferDamage.clear();
         newStreamParams();
         return;
     }
 
+    if (m_pendingBuffer || m_pendingReadbacks == s_readbackCount) {
+        qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
+        addBufferDamage(damagedRegion);
+        return;
+    }
+
     const char *error = "";
     auto state = pw_stream_get_state(pwStream, &error);
     if (state != PW_STREAM_STATE_STREAMING) {
         if (error) {
             qCWarning(KWIN_SCREENCAST) << "Failed to record frame: stream is not active" << error;
         }
+        addBufferDamage(damagedRegion);
         return;
     }
 
     struct pw_buffer *buffer = pw_stream_dequeue_buffer(pwStream);
 
     if (!buffer) {
+        addBufferDamage(damagedRegion);
         return;
     }
 
@@ -355,15 +387,15 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
         spa_data->chunk->size = bufferSize;
         spa_data->chunk->stride = stride;
 
+        if (supportsAsyncReadback()) {
+            // The buffer is handed over to PipeWire once the GPU has finished copying.
+            startReadback(buffer, frameTexture, damagedRegion);
+            return;
+        }
+
         frameTexture->bind();
         glGetTextureImage(frameTexture->texture(), 0, m_hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, bufferSize, data);
-        auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            QImage dest(data, size.width(), size.height(), QImage::Format_RGBA8888_Premultiplied);
-            QPainter painter(&dest);
-            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
-        }
+        embedCursor(buffer);
     } else {
         auto &buf = m_dmabufDataForPwBuffer[buffer];
 
@@ -422,6 +454,187 @@ void PipeWireStream::recordFrame(GLTexture *frameTexture, const QRegion &damaged
     tryEnqueue(buffer);
 }
 
+void PipeWireStream::embedCursor(pw_buffer *buffer)
+{
+    auto cursor = Cursors::self()->currentCursor();
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
+        uint8_t *data = static_cast<uint8_t *>(buffer->buffer->datas->data);
+        QImage dest(data, m_resolution.width(), m_resolution.height(), QImage::Format_RGBA8888_Premultiplied);
+        QPainter painter(&dest);
+        const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
+        const QRect cursorRect(position, cursor->image().size());
+        painter.drawImage(cursorRect, cursor->image());
+
+        // The cursor has to be painted over with the screen contents the next time the
+        // buffer is used.
+        if (m_bufferDamage.contains(buffer)) {
+            m_bufferDamage[buffer] |= cursorRect;
+        }
+    }
+}
+
+bool PipeWireStream::supportsAsyncReadback() const
+{
+    return hasGLVersion(4, 5) || hasGLExtension(QByteArrayLiteral("GL_ARB_get_texture_sub_image"));
+}
+
+void PipeWireStream::addBufferDamage(const QRegion &damage, pw_buffer *except)
+{
+    for (auto it = m_bufferDamage.begin(); it != m_bufferDamage.end(); ++it) {
+        if (it.key() != except) {
+            it.value() |= damage;
+        }
+    }
+}
+
+void PipeWireStream::startReadback(pw_buffer *buffer, GLTexture *frameTexture, const QRegion &damagedRegion)
+{
+    const QRect frame({}, m_resolution);
+    const int bpp = m_hasAlpha ? 4 : 3;
+    const int stride = buffer->buffer->datas->chunk->stride;
+    const int bufferSize = buffer->buffer->datas->chunk->size;
+
+    // The damage is in top-left origin coordinates, whereas the texture rows might be
+    // stored bottom up.
+    QRegion damage;
+    for (const QRect &rect : damagedRegion) {
+        if (frameTexture->isYInverted()) {
+            damage += rect & frame;
+        } else {
+            damage += QRect(rect.x(), frame.height() - rect.y() - rect.height(), rect.width(), rect.height()) & frame;
+        }
+    }
+
+    // A PipeWire buffer still holds an older frame, so in addition to the damage of this
+    // frame the areas that changed since the buffer has been filled last must be copied.
+    auto it = m_bufferDamage.find(buffer);
+    const QRegion region = it == m_bufferDamage.end() ? QRegion(frame) : (*it | damage);
+    m_bufferDamage[buffer] = QRegion();
+    addBufferDamage(damage, buffer);
+
+    Readback &readback = m_readbacks[(m_readbackHead + m_pendingReadbacks) % s_readbackCount];
+    m_pendingReadbacks++;
+    readback.buffer = buffer;
+    readback.region = region;
+
+    if (!readback.pixelBuffer) {
+        glGenBuffers(1, &readback.pixelBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+    } else {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+        GLint pixelBufferSize = 0;
+        glGetBufferParameteriv(GL_PIXEL_PACK_BUFFER, GL_BUFFER_SIZE, &pixelBufferSize);
+        if (pixelBufferSize != bufferSize) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+        }
+    }
+
+    // Keep the layout of the PipeWire buffer, so rows can be copied one to one.
+    glPixelStorei(GL_PACK_ROW_LENGTH, m_resolution.width());
+    for (const QRect &rect : region) {
+        const intptr_t offset = rect.y() * stride + rect.x() * bpp;
+        glGetTextureSubImage(frameTexture->texture(), 0, rect.x(), rect.y(), 0, rect.width(), rect.height(), 1,
+                             m_hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, bufferSize - offset,
+                             reinterpret_cast<void *>(offset));
+    }
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    m_readbackTimer.start(1);
+}
+
+void PipeWireStream::finishReadbacks()
+{
+    while (m_pendingReadbacks) {
+        Readback &readback = m_readbacks[m_readbackHead];
+        const GLenum status = glClientWaitSync(readback.sync, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            // Check again shortly, new frames might not arrive.
+            m_readbackTimer.start(1);
+            return;
+        }
+        finishReadback(readback);
+        m_readbackHead = (m_readbackHead + 1) % s_readbackCount;
+        m_pendingReadbacks--;
+    }
+}
+
+void PipeWireStream::finishReadback(Readback &readback)
+{
+    glDeleteSync(readback.sync);
+    readback.sync = nullptr;
+
+    pw_buffer *buffer = readback.buffer;
+    readback.buffer = nullptr;
+    if (!buffer) {
+        // The buffer has been removed from the stream in the meantime.
+        return;
+    }
+
+    spa_data *spaData = buffer->buffer->datas;
+    uint8_t *data = static_cast<uint8_t *>(spaData->data);
+    const int bpp = m_hasAlpha ? 4 : 3;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    const uint8_t *pixels = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, spaData->chunk->size, GL_MAP_READ_BIT));
+    if (pixels) {
+        for (const QRect &rect : qAsConst(readback.region)) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                const int offset = y * spaData->chunk->stride + rect.x() * bpp;
+                memcpy(data + offset, pixels + offset, rect.width() * bpp);
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        qCWarning(KWIN_SCREENCAST) << "Failed to map the pixel buffer of a screencast frame";
+        m_bufferDamage.remove(buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    embedCursor(buffer);
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Metadata) {
+        sendCursorData(Cursors::self()->currentCursor(),
+                        (spa_meta_cursor *) spa_buffer_find_meta_data (buffer->buffer, SPA_META_Cursor, sizeof (spa_meta_cursor)));
+    }
+    pw_stream_queue_buffer(pwStream, buffer);
+}
+
+void PipeWireStream::destroyReadbacks()
+{
+    m_readbackTimer.stop();
+    const bool haveContext = Compositor::self() && Compositor::self()->scene()
+        && Compositor::self()->scene()->makeOpenGLContextCurrent();
+
+    if (haveContext && !m_stopped) {
+        // Hand the pending frames over to PipeWire, mapping the pixel buffers waits for
+        // the copies to finish.
+        while (m_pendingReadbacks) {
+            finishReadback(m_readbacks[m_readbackHead]);
+            m_readbackHead = (m_readbackHead + 1) % s_readbackCount;
+            m_pendingReadbacks--;
+        }
+    }
+
+    // Without a current context the names are gone along with it, just forget them.
+    for (Readback &readback : m_readbacks) {
+        if (haveContext) {
+            if (readback.sync) {
+                glDeleteSync(readback.sync);
+            }
+            if (readback.pixelBuffer) {
+                glDeleteBuffers(1, &readback.pixelBuffer);
+            }
+        }
+        readback = Readback();
+    }
+    m_readbackHead = 0;
+    m_pendingReadbacks = 0;
+}
+
 void PipeWireStream::tryEnqueue(pw_buffer *buffer)
 {
     m_pendingBuffer = buffer;
@@ -18,6 +18,9 @@
 #include <QSharedPointer>
 #include <QSize>
 #include <QSocketNotifier>
+#include <QTimer>
+
+#include <epoxy/gl.h>
 
 #include <pipewire/pipewire.h>
 #include <spa/param/format-utils.h>
@@ -60,6 +63,17 @@ Q_SIGNALS:
     void stopStreaming();
 
 private:
+    /**
+     * A frame that is being copied from the GPU into a pixel pack buffer. Once the fence
+     * is signaled, the damaged parts are copied into the memfd backed PipeWire buffer.
+     */
+    struct Readback {
+        GLuint pixelBuffer = 0;
+        GLsync sync = nullptr;
+        pw_buffer *buffer = nullptr;
+        QRegion region;
+    };
+
     static void onStreamParamChanged(void *data, uint32_t id, const struct spa_pod *format);
     static void onStreamStateChanged(void *data, pw_stream_state old, pw_stream_state state, const char *error_message);
     static void onStreamAddBuffer(void *data, pw_buffer *buffer);
@@ -72,6 +86,13 @@ private:
     void newStreamParams();
     void tryEnqueue(pw_buffer *buffer);
     void enqueue();
+    bool supportsAsyncReadback() const;
+    void startReadback(pw_buffer *buffer, GLTexture *frameTexture, const QRegion &damagedRegion);
+    void finishReadbacks();
+    void finishReadback(Readback &readback);
+    void destroyReadbacks();
+    void addBufferDamage(const QRegion &damage, pw_buffer *except = nullptr);
+    void embedCursor(pw_buffer *buffer);
 
     QSharedPointer<PipeWireCore> pwCore;
     struct pw_stream *pwStream = nullptr;
@@ -104,6 +125,14 @@ private:
     pw_buffer *m_pendingBuffer = nullptr;
     QSocketNotifier *m_pendingNotifier = nullptr;
     EGLNativeFence *m_pendingFence = nullptr;
+
+    static const int s_readbackCount = 3;
+    Readback m_readbacks[s_readbackCount];
+    int m_readbackHead = 0;
+    int m_pendingReadbacks = 0;
+    QTimer m_readbackTimer;
+    // The area of each memfd buffer that is out of date, in texture coordinates
+    QHash<struct pw_buffer *, QRegion> m_bufferDamage;
 };
 
 } // namespace KWin
@@ -9,7 +9,10 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "pointer_input.h"
+#include "abstract_output.h"
+#include "composite.h"
 #include "platform.h"
+#include "renderloop.h"
 #include "x11client.h"
 #include "effects.h"
 #include "input_event.h"
@@ -39,6 +42,9 @@
 
 #include <linux/input.h>
 
+#include <algorithm>
+#include <utility>
+
 namespace KWin
 {
 
@@ -103,6 +109,9 @@ PointerInputRedirection::PointerInputRedirection(InputRedirection* parent)
     , m_cursor(nullptr)
     , m_supportsWarping(Application::usesLibinput())
 {
+    if (qEnvironmentVariableIsSet("KWIN_COALESCE_POINTER_MOTION")) {
+        setMotionCoalescingEnabled(qEnvironmentVariableIntValue("KWIN_COALESCE_POINTER_MOTION") != 0);
+    }
 }
 
 PointerInputRedirection::~PointerInputRedirection() = default;
@@ -123,6 +132,7 @@ void PointerInputRedirection::init()
     connect(Cursors::self()->mouse(), &Cursor::rendered, m_cursor, &CursorImage::markAsRendered);
 
     connect(screens(), &Screens::changed, this, &PointerInputRedirection::updateAfterScreenChange);
+
     if (waylandServer()->hasScreenLockerIntegration()) {
         connect(ScreenLocker::KSldApp::self(), &ScreenLocker::KSldApp::lockStateChanged, this,
             [this] {
@@ -248,21 +258,97 @@ void PointerInputRedirection::processMotion(const QPointF &pos, const QSizeF &de
         PositionUpdateBlocker::schedulePosition(pos, delta, deltaNonAccelerated, time, timeUsec);
         return;
     }
+    if (m_motionCoalescingEnabled && device && scheduleMotionFlush(pos)) {
+        queueMotion(pos, delta, deltaNonAccelerated, time, timeUsec, device);
+        return;
+    }
 
+    flushMotion();
+    dispatchMotion(pos, delta, deltaNonAccelerated, time, timeUsec, device);
+}
+
+void PointerInputRedirection::dispatchMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec,
+                                             LibInput::Device *device, const QVector<MouseEvent::RelativeMotion> &relativeMotions)
+{
     PositionUpdateBlocker blocker(this);
     updatePosition(pos);
     MouseEvent event(QEvent::MouseMove, m_pos, Qt::NoButton, m_qtButtons,
                      input()->keyboardModifiers(), time,
                      delta, deltaNonAccelerated, timeUsec, device);
     event.setModifiersRelevantForGlobalShortcuts(input()->modifiersRelevantForGlobalShortcuts());
+    event.setRelativeMotions(relativeMotions);
 
     update();
     input()->processSpies(std::bind(&InputEventSpy::pointerEvent, std::placeholders::_1, &event));
     input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
 }
 
+void PointerInputRedirection::setMotionCoalescingEnabled(bool enabled)
+{
+    if (m_motionCoalescingEnabled == enabled) {
+        return;
+    }
+    m_motionCoalescingEnabled = enabled;
+    if (!enabled) {
+        flushMotion();
+    }
+}
+
+bool PointerInputRedirection::scheduleMotionFlush(const QPointF &pos)
+{
+    // The compositor delivers the pending motion before it paints the next frame. Only the
+    // output under the cursor needs to be repainted for that. If its render loop is inhibited,
+    // e.g. while the session is inactive, or nothing is composited, the motion can't wait.
+    if (!Compositor::compositing()) {
+        return false;
+    }
+    RenderLoop *renderLoop = kwinApp()->platform()->renderLoop();
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    for (AbstractOutput *output : outputs) {
+        if (output->geometry().contains(pos.toPoint())) {
+            renderLoop = output->renderLoop();
+            break;
+        }
+    }
+    if (renderLoop->isInhibited()) {
+        return false;
+    }
+    renderLoop->scheduleRepaint();
+    return true;
+}
+
+void PointerInputRedirection::queueMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, LibInput::Device *device)
+{
+    // The cursor follows the device immediately, only the expensive part is deferred.
+    updatePosition(pos);
+
+    m_motionPending = true;
+    m_pendingMotion.delta += delta;
+    m_pendingMotion.deltaNonAccelerated += deltaNonAccelerated;
+    m_pendingMotion.time = time;
+    m_pendingMotion.timeUsec = timeUsec;
+    m_pendingMotion.device = device;
+    if (delta != QSizeF()) {
+        m_pendingMotion.relativeMotions.append({delta, deltaNonAccelerated, timeUsec});
+    }
+}
+
+void PointerInputRedirection::flushMotion()
+{
+    if (!m_motionPending) {
+        return;
+    }
+    m_motionPending = false;
+
+    const PendingMotion motion = std::exchange(m_pendingMotion, PendingMotion());
+    dispatchMotion(m_pos, motion.delta, motion.deltaNonAccelerated, motion.time, motion.timeUsec,
+                   motion.device, motion.relativeMotions);
+}
+
 void PointerInputRedirection::processButton(uint32_t button, InputRedirection::PointerButtonState state, uint32_t time, LibInput::Device *device)
 {
+    flushMotion();
+
     QEvent::Type type;
     switch (state) {
     case InputRedirection::PointerButtonReleased:
@@ -300,6 +386,7 @@ void PointerInputRedirection::processButton(uint32_t button, InputRedirection::P
 void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qreal delta, qint32 discreteDelta,
     InputRedirection::PointerAxisSource source, uint32_t time, LibInput::Device *device)
 {
+    flushMotion();
     update();
 
     emit input()->pointerAxisChanged(axis, delta);
@@ -320,6 +407,7 @@ void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qr
 void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -331,6 +419,7 @@ void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32
 void PointerInputRedirection::processSwipeGestureUpdate(const QSizeF &delta, quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -343,6 +432,7 @@ void PointerInputRedirection::processSwipeGestureUpdate(const QSizeF &delta, qui
 void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -355,6 +445,7 @@ void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::LibInpu
 void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -367,6 +458,7 @@ void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::L
 void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -379,6 +471,7 @@ void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32
 void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -391,6 +484,7 @@ void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angle
 void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -403,6 +497,7 @@ void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::LibInpu
 void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::LibInput::Device *device)
 {
     Q_UNUSED(device)
+    flushMotion();
     if (!inited()) {
         return;
     }
@@ -12,6 +12,7 @@
 #define KWIN_POINTER_INPUT_H
 
 #include "input.h"
+#include "input_event.h"
 #include "cursor.h"
 #include "xcursortheme.h"
 
@@ -82,6 +83,28 @@ public:
 
     bool focusUpdatesBlocked() override;
 
+    /**
+     * Enables coalescing of pointer motion. Motion events from input devices only update the
+     * pointer position right away, the spies, the filters and the focus see a single motion
+     * event per frame that accumulates all the motion since the last one. The pending motion
+     * is delivered when the compositor paints the next frame of the output under the cursor or
+     * before any other input event. Clients using relative pointer motion still receive every
+     * individual motion.
+     *
+     * Coalescing is disabled by default, it can be enabled by setting the environment variable
+     * KWIN_COALESCE_POINTER_MOTION to 1.
+     */
+    void setMotionCoalescingEnabled(bool enabled);
+    bool isMotionCoalescingEnabled() const {
+        return m_motionCoalescingEnabled;
+    }
+
+    /**
+     * Delivers the pending coalesced motion, if there is any. Must be called before any
+     * other input event gets processed to preserve the order of events.
+     */
+    void flushMotion();
+
     /**
      * @internal
      */
@@ -149,6 +172,10 @@ private:
     void disconnectLockedPointerAboutToBeUnboundConnection();
     void disconnectPointerConstraintsConnection();
     void breakPointerConstraints(KWaylandServer::SurfaceInterface *surface);
+    void dispatchMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec,
+                        LibInput::Device *device, const QVector<MouseEvent::RelativeMotion> &relativeMotions = {});
+    void queueMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, LibInput::Device *device);
+    bool scheduleMotionFlush(const QPointF &pos);
     CursorImage *m_cursor;
     bool m_supportsWarping;
     QPointF m_pos;
@@ -164,6 +191,18 @@ private:
     bool m_confined = false;
     bool m_locked = false;
     bool m_enableConstraints = true;
+
+    struct PendingMotion {
+        QSizeF delta;
+        QSizeF deltaNonAccelerated;
+        uint32_t time = 0;
+        quint64 timeUsec = 0;
+        LibInput::Device *device = nullptr;
+        QVector<MouseEvent::RelativeMotion> relativeMotions;
+    };
+    PendingMotion m_pendingMotion;
+    bool m_motionPending = false;
+    bool m_motionCoalescingEnabled = false;
 };
 
 class WaylandCursorImage : public QObject
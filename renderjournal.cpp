@@ -0,0 +1,79 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "renderjournal.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+RenderJournal::RenderJournal(int capacity)
+    : m_capacity(qMax(capacity, 1))
+{
+    m_log.reserve(m_capacity);
+}
+
+void RenderJournal::add(std::chrono::nanoseconds renderTime)
+{
+    if (m_log.count() < m_capacity) {
+        m_log.append(renderTime);
+    } else {
+        m_log[m_head] = renderTime;
+    }
+    m_head = (m_head + 1) % m_capacity;
+}
+
+std::chrono::nanoseconds RenderJournal::minimum() const
+{
+    if (m_log.isEmpty()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return *std::min_element(m_log.constBegin(), m_log.constEnd());
+}
+
+std::chrono::nanoseconds RenderJournal::maximum() const
+{
+    if (m_log.isEmpty()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return *std::max_element(m_log.constBegin(), m_log.constEnd());
+}
+
+std::chrono::nanoseconds RenderJournal::average() const
+{
+    if (m_log.isEmpty()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    std::chrono::nanoseconds sum = std::chrono::nanoseconds::zero();
+    for (const std::chrono::nanoseconds &renderTime : m_log) {
+        sum += renderTime;
+    }
+    return sum / m_log.count();
+}
+
+std::chrono::nanoseconds RenderJournal::estimate() const
+{
+    // A single slow frame should not make us start compositing a lot earlier for
+    // the rest of the history window, but a missed deadline is a lot worse than
+    // a bit of extra latency, so bias the estimate towards the slowest frame.
+    return (maximum() * 3 + average()) / 4;
+}
+
+int RenderJournal::count() const
+{
+    return m_log.count();
+}
+
+void RenderJournal::clear()
+{
+    m_log.clear();
+    m_head = 0;
+}
+
+} // namespace KWin
@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QVector>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The RenderJournal class measures how long it takes to render frames and estimates
+ * how long it will take to render the next one.
+ *
+ * The journal keeps a rolling history of the last few render times. Since the render
+ * time of the next frame cannot be known in advance, the estimate errs on the safe
+ * side and is biased towards the slowest frame in the history window.
+ */
+class KWIN_EXPORT RenderJournal
+{
+public:
+    explicit RenderJournal(int capacity = 16);
+
+    /**
+     * Adds the render time of the last frame to the journal.
+     */
+    void add(std::chrono::nanoseconds renderTime);
+
+    /**
+     * Returns the shortest render time in the journal.
+     */
+    std::chrono::nanoseconds minimum() const;
+
+    /**
+     * Returns the longest render time in the journal.
+     */
+    std::chrono::nanoseconds maximum() const;
+
+    /**
+     * Returns the average render time in the journal.
+     */
+    std::chrono::nanoseconds average() const;
+
+    /**
+     * Returns the predicted render time of the next frame.
+     */
+    std::chrono::nanoseconds estimate() const;
+
+    int count() const;
+    void clear();
+
+private:
+    QVector<std::chrono::nanoseconds> m_log;
+    int m_capacity;
+    int m_head = 0;
+};
+
+} // namespace KWin
@@ -0,0 +1,229 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "renderloop.h"
+#include "renderloop_p.h"
+#include "frametracer.h"
+#include "main.h"
+#include "utils.h"
+
+namespace KWin
+{
+
+template <typename T>
+T alignTimestamp(const T &timestamp, const T &alignment)
+{
+    return timestamp + ((alignment - (timestamp % alignment)) % alignment);
+}
+
+RenderLoopPrivate *RenderLoopPrivate::get(RenderLoop *loop)
+{
+    return loop->d.data();
+}
+
+RenderLoopPrivate::RenderLoopPrivate(RenderLoop *q)
+    : q(q)
+{
+    compositeTimer.setSingleShot(true);
+    compositeTimer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&compositeTimer, &QTimer::timeout, q, [this]() { dispatch(); });
+}
+
+void RenderLoopPrivate::scheduleRepaint()
+{
+    if (kwinApp()->isTerminating()) {
+        return;
+    }
+
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+    const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
+
+    // Estimate when the next presentation will occur. Note that this is a prediction.
+    nextPresentationTimestamp = lastPresentationTimestamp + vblankInterval;
+
+    // Estimate when it's a good time to perform the next compositing cycle.
+    const std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(1);
+    const std::chrono::nanoseconds renderTime = renderJournal.estimate();
+
+    nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin;
+
+    // If we can't render the frame before the deadline, aim for the next vblank.
+    if (nextRenderTimestamp < currentTime) {
+        const std::chrono::nanoseconds sinceLastPresentation = currentTime - lastPresentationTimestamp;
+        nextPresentationTimestamp = lastPresentationTimestamp
+                + alignTimestamp(sinceLastPresentation + renderTime + safetyMargin, vblankInterval);
+        nextRenderTimestamp = qMax(currentTime, nextPresentationTimestamp - renderTime - safetyMargin);
+    }
+
+    const std::chrono::nanoseconds waitInterval = nextRenderTimestamp - currentTime;
+    compositeTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(waitInterval));
+}
+
+void RenderLoopPrivate::delayScheduleRepaint()
+{
+    pendingReschedule = true;
+}
+
+void RenderLoopPrivate::maybeScheduleRepaint()
+{
+    if (pendingReschedule) {
+        scheduleRepaint();
+        pendingReschedule = false;
+    }
+}
+
+void RenderLoopPrivate::notifyFramePending()
+{
+    pendingFrameCount++;
+
+    if (FrameTracer *tracer = FrameTracer::self()) {
+        tracer->framePending(q);
+    }
+}
+
+void RenderLoopPrivate::notifyFrameFailed()
+{
+    Q_ASSERT(pendingFrameCount > 0);
+    pendingFrameCount--;
+
+    if (FrameTracer *tracer = FrameTracer::self()) {
+        tracer->frameFailed(q);
+    }
+
+    if (!inhibitCount) {
+        maybeScheduleRepaint();
+    }
+}
+
+void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
+{
+    Q_ASSERT(pendingFrameCount > 0);
+    pendingFrameCount--;
+
+    if (lastPresentationTimestamp <= timestamp) {
+        lastPresentationTimestamp = timestamp;
+    } else {
+        qCWarning(KWIN_CORE,
+                  "Got invalid presentation timestamp: %lld (current %lld)",
+                  static_cast<long long>(timestamp.count()),
+                  static_cast<long long>(lastPresentationTimestamp.count()));
+        lastPresentationTimestamp = std::chrono::steady_clock::now().time_since_epoch();
+    }
+
+    if (FrameTracer *tracer = FrameTracer::self()) {
+        tracer->framePresented(q, timestamp);
+    }
+
+    if (!inhibitCount) {
+        maybeScheduleRepaint();
+    }
+
+    emit q->framePresented(q, timestamp);
+}
+
+void RenderLoopPrivate::dispatch()
+{
+    // On X11, we want to ignore repaints that are scheduled by windows right before
+    // the Compositor starts repainting.
+    pendingRepaint = true;
+
+    emit q->frameRequested(q);
+
+    // The Compositor may decide to not repaint when the frameRequested() signal is
+    // emitted, in which case the pending repaint flag has to be reset manually.
+    pendingRepaint = false;
+}
+
+RenderLoop::RenderLoop(QObject *parent)
+    : QObject(parent)
+    , d(new RenderLoopPrivate(this))
+{
+}
+
+RenderLoop::~RenderLoop()
+{
+    if (FrameTracer *tracer = FrameTracer::self()) {
+        tracer->removeRenderLoop(this);
+    }
+}
+
+void RenderLoop::inhibit()
+{
+    d->inhibitCount++;
+
+    if (d->inhibitCount == 1 && d->compositeTimer.isActive()) {
+        d->compositeTimer.stop();
+        d->delayScheduleRepaint();
+    }
+}
+
+void RenderLoop::uninhibit()
+{
+    Q_ASSERT(d->inhibitCount > 0);
+    d->inhibitCount--;
+
+    if (d->inhibitCount == 0) {
+        d->maybeScheduleRepaint();
+    }
+}
+
+bool RenderLoop::isInhibited() const
+{
+    return d->inhibitCount > 0;
+}
+
+void RenderLoop::beginFrame()
+{
+    d->pendingRepaint = false;
+    d->renderTimer.start();
+}
+
+void RenderLoop::endFrame()
+{
+    d->renderJournal.add(std::chrono::nanoseconds(d->renderTimer.nsecsElapsed()));
+}
+
+int RenderLoop::refreshRate() const
+{
+    return d->refreshRate;
+}
+
+void RenderLoop::setRefreshRate(int refreshRate)
+{
+    if (d->refreshRate == refreshRate || refreshRate <= 0) {
+        return;
+    }
+    d->refreshRate = refreshRate;
+    emit refreshRateChanged();
+}
+
+void RenderLoop::scheduleRepaint()
+{
+    if (d->pendingRepaint) {
+        return;
+    }
+    if (!d->pendingFrameCount && !d->inhibitCount) {
+        if (!d->compositeTimer.isActive()) {
+            d->scheduleRepaint();
+        }
+    } else {
+        d->delayScheduleRepaint();
+    }
+}
+
+std::chrono::nanoseconds RenderLoop::lastPresentationTimestamp() const
+{
+    return d->lastPresentationTimestamp;
+}
+
+std::chrono::nanoseconds RenderLoop::nextPresentationTimestamp() const
+{
+    return d->nextPresentationTimestamp;
+}
+
+} // namespace KWin
@@ -0,0 +1,123 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QObject>
+
+#include <chrono>
+
+namespace KWin
+{
+
+class RenderLoopPrivate;
+
+/**
+ * The RenderLoop class represents the compositing scheduler on a particular output.
+ *
+ * The RenderLoop class drives the compositing. The frameRequested() signal is emitted
+ * when the loop wants a new frame to be rendered. The framePresented() signal is
+ * emitted when a previously rendered frame has been presented on the screen. In case
+ * you want the compositor to repaint the scene, call the scheduleRepaint() function.
+ *
+ * The time when the next frame is requested is computed from the timestamp of the last
+ * presented frame, the refresh rate and a prediction of how long it takes to render
+ * a frame. The prediction is based on the render times of the last few frames.
+ */
+class KWIN_EXPORT RenderLoop : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenderLoop(QObject *parent = nullptr);
+    ~RenderLoop() override;
+
+    /**
+     * Pauses the render loop. While the render loop is inhibited, scheduleRepaint()
+     * requests are queued.
+     *
+     * Once the render loop is uninhibited, the pending schedule requests are going to
+     * be re-sent.
+     */
+    void inhibit();
+
+    /**
+     * Uninhibits the render loop.
+     */
+    void uninhibit();
+
+    /**
+     * Returns @c true if the render loop is inhibited; otherwise returns @c false.
+     */
+    bool isInhibited() const;
+
+    /**
+     * This function must be called before the Compositor starts rendering the next
+     * frame.
+     */
+    void beginFrame();
+
+    /**
+     * This function must be called after the Compositor has finished rendering the
+     * next frame.
+     */
+    void endFrame();
+
+    /**
+     * Returns the refresh rate at which the output is being updated, in millihertz.
+     */
+    int refreshRate() const;
+
+    /**
+     * Sets the refresh rate of this RenderLoop to @a refreshRate, in millihertz.
+     */
+    void setRefreshRate(int refreshRate);
+
+    /**
+     * Schedules a compositing cycle at the next available moment.
+     */
+    void scheduleRepaint();
+
+    /**
+     * Returns the timestamp of the last frame that has been presented on the screen.
+     * The returned timestamp is sourced from the monotonic clock.
+     */
+    std::chrono::nanoseconds lastPresentationTimestamp() const;
+
+    /**
+     * If a repaint has been scheduled, this function returns the expected time when
+     * the next frame will be presented on the screen. The returned timestamp is sourced
+     * from the monotonic clock.
+     */
+    std::chrono::nanoseconds nextPresentationTimestamp() const;
+
+Q_SIGNALS:
+    /**
+     * This signal is emitted when the refresh rate of this RenderLoop has changed.
+     */
+    void refreshRateChanged();
+
+    /**
+     * This signal is emitted when a frame has been actually presented on the screen.
+     * @a timestamp indicates the time when it took place.
+     */
+    void framePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp);
+
+    /**
+     * This signal is emitted when the RenderLoop wants a new frame to be rendered.
+     */
+    void frameRequested(RenderLoop *loop);
+
+private:
+    QScopedPointer<RenderLoopPrivate> d;
+    friend class RenderLoopPrivate;
+};
+
+} // namespace KWin
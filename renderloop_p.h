@@ -0,0 +1,59 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include "renderloop.h"
+#include "renderjournal.h"
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+namespace KWin
+{
+
+/**
+ * The RenderLoopPrivate class provides the interface that is used by the platform
+ * backends to feed presentation feedback into the RenderLoop.
+ */
+class KWIN_EXPORT RenderLoopPrivate
+{
+public:
+    static RenderLoopPrivate *get(RenderLoop *loop);
+    explicit RenderLoopPrivate(RenderLoop *q);
+
+    void dispatch();
+
+    void delayScheduleRepaint();
+    void scheduleRepaint();
+    void maybeScheduleRepaint();
+
+    /**
+     * Notifies the render loop that the frame that has been rendered last will be
+     * presented asynchronously, i.e. notifyFrameCompleted() or notifyFrameFailed()
+     * will be called later on.
+     */
+    void notifyFramePending();
+    void notifyFrameFailed();
+    void notifyFrameCompleted(std::chrono::nanoseconds timestamp);
+
+    RenderLoop *q;
+    std::chrono::nanoseconds lastPresentationTimestamp = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds nextPresentationTimestamp = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds nextRenderTimestamp = std::chrono::nanoseconds::zero();
+    QTimer compositeTimer;
+    QElapsedTimer renderTimer;
+    RenderJournal renderJournal;
+    int refreshRate = 60000;
+    int pendingFrameCount = 0;
+    int inhibitCount = 0;
+    bool pendingReschedule = false;
+    bool pendingRepaint = false;
+};
+
+} // namespace KWin
@@ -11,13 +11,14 @@
 
 #include <kconfig.h>
 #include <KXMessages>
-#include <QRegExp>
 #include <QTemporaryFile>
 #include <QFile>
 #include <QFileInfo>
 #include <QDebug>
 #include <QDir>
 
+#include <algorithm>
+
 #ifndef KCMRULES
 #include "x11client.h"
 #include "client_machine.h"
@@ -124,6 +125,10 @@ void Rules::readFromSettings(const RuleSettings *settings)
     READ_MATCH_STRING(windowrole, .toLower().toLatin1());
     READ_MATCH_STRING(title,);
     READ_MATCH_STRING(clientmachine, .toLower().toLatin1());
+    wmclassregexp = compileRegExp(QString::fromUtf8(wmclass), wmclassmatch);
+    windowroleregexp = compileRegExp(QString::fromUtf8(windowrole), windowrolematch);
+    titleregexp = compileRegExp(title, titlematch);
+    clientmachineregexp = compileRegExp(QString::fromUtf8(clientmachine), clientmachinematch);
     types = NET::WindowTypeMask(settings->types());
     READ_FORCE_RULE(placement,);
     READ_SET_RULE(position);
@@ -318,6 +323,16 @@ QString Rules::getDecoColor(const QString &themeName)
                                   QLatin1String("color-schemes/") + themeName + QLatin1String(".colors"));
 }
 
+QRegularExpression Rules::compileRegExp(const QString &pattern, StringMatch match)
+{
+    if (match != RegExpMatch) {
+        return QRegularExpression();
+    }
+    QRegularExpression regExp(pattern);
+    regExp.optimize();
+    return regExp;
+}
+
 bool Rules::matchType(NET::WindowType match_type) const
 {
     if (types != NET::AllTypesMask) {
@@ -332,10 +347,9 @@ bool Rules::matchType(NET::WindowType match_type) const
 bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_name) const
 {
     if (wmclassmatch != UnimportantMatch) {
-        // TODO optimize?
         QByteArray cwmclass = wmclasscomplete
                               ? match_name + ' ' + match_class : match_class;
-        if (wmclassmatch == RegExpMatch && QRegExp(QString::fromUtf8(wmclass)).indexIn(QString::fromUtf8(cwmclass)) == -1)
+        if (wmclassmatch == RegExpMatch && !wmclassregexp.match(QString::fromUtf8(cwmclass)).hasMatch())
             return false;
         if (wmclassmatch == ExactMatch && wmclass != cwmclass)
             return false;
@@ -348,7 +362,7 @@ bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_
 bool Rules::matchRole(const QByteArray& match_role) const
 {
     if (windowrolematch != UnimportantMatch) {
-        if (windowrolematch == RegExpMatch && QRegExp(QString::fromUtf8(windowrole)).indexIn(QString::fromUtf8(match_role)) == -1)
+        if (windowrolematch == RegExpMatch && !windowroleregexp.match(QString::fromUtf8(match_role)).hasMatch())
             return false;
         if (windowrolematch == ExactMatch && windowrole != match_role)
             return false;
@@ -361,7 +375,7 @@ bool Rules::matchRole(const QByteArray& match_role) const
 bool Rules::matchTitle(const QString& match_title) const
 {
     if (titlematch != UnimportantMatch) {
-        if (titlematch == RegExpMatch && QRegExp(title).indexIn(match_title) == -1)
+        if (titlematch == RegExpMatch && !titleregexp.match(match_title).hasMatch())
             return false;
         if (titlematch == ExactMatch && title != match_title)
             return false;
@@ -379,7 +393,7 @@ bool Rules::matchClientMachine(const QByteArray& match_machine, bool local) cons
                 && matchClientMachine("localhost", true))
             return true;
         if (clientmachinematch == RegExpMatch
-                && QRegExp(QString::fromUtf8(clientmachine)).indexIn(QString::fromUtf8(match_machine)) == -1)
+                && !clientmachineregexp.match(QString::fromUtf8(match_machine)).hasMatch())
             return false;
         if (clientmachinematch == ExactMatch
                 && clientmachine != match_machine)
@@ -412,6 +426,14 @@ bool Rules::match(const AbstractClient* c) const
     return true;
 }
 
+QByteArray Rules::exactWMClass() const
+{
+    if (wmclassmatch != ExactMatch) {
+        return QByteArray();
+    }
+    return wmclass;
+}
+
 #define NOW_REMEMBER(_T_, _V_) ((selection & _T_) && (_V_##rule == (SetRule)Remember))
 
 bool Rules::update(AbstractClient* c, int selection)
@@ -958,29 +980,60 @@ void RuleBook::deleteAll()
 {
     qDeleteAll(m_rules);
     m_rules.clear();
+    m_indexDirty = true;
+}
+
+void RuleBook::rebuildIndex()
+{
+    m_wmclassIndex.clear();
+    m_unindexedRules.clear();
+    for (int i = 0; i < m_rules.count(); ++i) {
+        const QByteArray wmclass = m_rules.at(i)->exactWMClass();
+        if (wmclass.isEmpty()) {
+            m_unindexedRules.append(i);
+        } else {
+            m_wmclassIndex[wmclass].append(i);
+        }
+    }
+    m_indexDirty = false;
 }
 
 WindowRules RuleBook::find(const AbstractClient* c, bool ignore_temporary)
 {
+    if (m_indexDirty) {
+        rebuildIndex();
+    }
+
+    // Only the rules that don't require a specific WM_CLASS and the ones that require the
+    // WM_CLASS of the client can match. A rule can require either the window class or the
+    // complete WM_CLASS, look up both.
+    QVector<int> candidates = m_unindexedRules;
+    candidates += m_wmclassIndex.value(c->resourceClass());
+    candidates += m_wmclassIndex.value(c->resourceName() + ' ' + c->resourceClass());
+    std::sort(candidates.begin(), candidates.end()); // keep the priority order
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
     QVector< Rules* > ret;
-    for (QList< Rules* >::Iterator it = m_rules.begin();
-            it != m_rules.end();
-       ) {
-        if (ignore_temporary && (*it)->isTemporary()) {
-            ++it;
+    QVector<int> matchedTemporary;
+    for (int i : qAsConst(candidates)) {
+        Rules *rule = m_rules.at(i);
+        if (ignore_temporary && rule->isTemporary()) {
             continue;
         }
-        if ((*it)->match(c)) {
-            Rules* rule = *it;
+        ++m_evaluationCount;
+        if (rule->match(c)) {
             qCDebug(KWIN_CORE) << "Rule found:" << rule << ":" << c;
             if (rule->isTemporary())
-                it = m_rules.erase(it);
-            else
-                ++it;
+                matchedTemporary.append(i);
             ret.append(rule);
-            continue;
         }
-        ++it;
+    }
+    // temporary rules apply only once
+    for (auto it = matchedTemporary.crbegin(); it != matchedTemporary.crend(); ++it) {
+        m_rules.removeAt(*it);
+    }
+    if (!matchedTemporary.isEmpty()) {
+        m_indexDirty = true;
     }
     return WindowRules(ret);
 }
@@ -1016,6 +1069,7 @@ void RuleBook::load()
         m_config->reparseConfiguration();
     }
     m_rules = RuleBookSettings(m_config).rules().toList();
+    m_indexDirty = true;
 }
 
 void RuleBook::save()
@@ -1046,6 +1100,7 @@ void RuleBook::temporaryRulesMessage(const QString& message)
             was_temporary = true;
     Rules* rule = new Rules(message, true);
     m_rules.prepend(rule);   // highest priority first
+    m_indexDirty = true;
     if (!was_temporary)
         QTimer::singleShot(60000, this, &RuleBook::cleanupTemporaryRules);
 }
@@ -1058,6 +1113,7 @@ void RuleBook::cleanupTemporaryRules()
        ) {
         if ((*it)->discardTemporary(false)) { // deletes (*it)
             it = m_rules.erase(it);
+            m_indexDirty = true;
         } else {
             if ((*it)->isTemporary())
                 has_temporary = true;
@@ -1082,6 +1138,7 @@ void RuleBook::discardUsed(AbstractClient* c, bool withdrawn)
                 c->removeRule(*it);
                 Rules* r = *it;
                 it = m_rules.erase(it);
+                m_indexDirty = true;
                 delete r;
                 continue;
             }
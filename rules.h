@@ -12,7 +12,9 @@
 
 
 #include <netwm_def.h>
+#include <QHash>
 #include <QRect>
+#include <QRegularExpression>
 #include <QVector>
 
 #include "placement.h"
@@ -132,6 +134,11 @@ public:
 #ifndef KCMRULES
     bool discardUsed(bool withdrawn);
     bool match(const AbstractClient* c) const;
+    /**
+     * Returns the WM_CLASS (or the complete WM_CLASS if wmclasscomplete is set) a client
+     * must have to match this rule, or an empty array if clients can match with any WM_CLASS.
+     */
+    QByteArray exactWMClass() const;
     bool update(AbstractClient*, int selection);
     bool isTemporary() const;
     bool discardTemporary(bool force);   // removes if temporary and forced or too old
@@ -183,6 +190,7 @@ private:
     void readFromSettings(const RuleSettings *settings);
     static ForceRule convertForceRule(int v);
     static QString getDecoColor(const QString &themeName);
+    static QRegularExpression compileRegExp(const QString &pattern, StringMatch match);
 #ifndef KCMRULES
     static bool checkSetRule(SetRule rule, bool init);
     static bool checkForceRule(ForceRule rule);
@@ -200,6 +208,11 @@ private:
     StringMatch titlematch;
     QByteArray clientmachine;
     StringMatch clientmachinematch;
+    // the patterns of RegExpMatch matches, compiled once when the rule is read
+    QRegularExpression wmclassregexp;
+    QRegularExpression windowroleregexp;
+    QRegularExpression titleregexp;
+    QRegularExpression clientmachineregexp;
     NET::WindowTypes types; // types for matching
     Placement::Policy placement;
     ForceRule placementrule;
@@ -294,6 +307,16 @@ public:
         m_config = config;
     }
 
+    int ruleCount() const {
+        return m_rules.count();
+    }
+    /**
+     * Returns how many times a rule has been matched against a client, for diagnosis.
+     */
+    quint64 evaluationCount() const {
+        return m_evaluationCount;
+    }
+
 private Q_SLOTS:
     void temporaryRulesMessage(const QString&);
     void cleanupTemporaryRules();
@@ -303,9 +326,16 @@ private:
     void deleteAll();
     void initializeX11();
     void cleanupX11();
+    void rebuildIndex();
     QTimer *m_updateTimer;
     bool m_updatesDisabled;
     QList<Rules*> m_rules;
+    // Positions in m_rules of the rules that require an exact WM_CLASS, keyed by it,
+    // and of all the other rules. Rebuilt on demand after m_rules has changed.
+    QHash<QByteArray, QVector<int>> m_wmclassIndex;
+    QVector<int> m_unindexedRules;
+    bool m_indexDirty = true;
+    quint64 m_evaluationCount = 0;
     QScopedPointer<KXMessages> m_temporaryRulesMessages;
     KSharedConfig::Ptr m_config;
 
@@ -56,6 +56,7 @@
 */
 
 #include "scene.h"
+#include "abstract_output.h"
 #include "platform.h"
 
 #include <QQuickWindow>
@@ -140,6 +141,7 @@ void Scene::paintScreen(int* mask, const QRegion &damage, const QRegion &repaint
     }
 
     effects->postPaintScreen();
+    static_cast<EffectsHandlerImpl*>(effects)->finishPaint();
 
     // make sure not to go outside of the screen area
     *updateRegion = damaged_region;
@@ -198,6 +200,8 @@ void Scene::paintGenericScreen(int orig_mask, const ScreenPaintData &)
     QVector<Phase2Data> phase2;
     phase2.reserve(stacking_order.size());
     foreach (Window * w, stacking_order) { // bottom to top
+        StageTimer prePaintTimer(this, Stage::PrePaint);
+
         // Let the scene window update the window pixmap tree.
         w->preprocess();
 
@@ -211,7 +215,10 @@ void Scene::paintGenericScreen(int orig_mask, const ScreenPaintData &)
         w->resetPaintingEnabled();
         data.paint = infiniteRegion(); // no clipping, so doesn't really matter
         data.clip = QRegion();
-        data.quads = w->buildQuads();
+        {
+            StageTimer quadTimer(this, Stage::QuadBuilding);
+            data.quads = w->buildQuads();
+        }
         // preparation step
         effects->prePaintWindow(effectWindow(w), data, time_diff);
 #if !defined(QT_NO_DEBUG)
@@ -237,6 +244,7 @@ void Scene::paintGenericScreen(int orig_mask, const ScreenPaintData &)
     if (!(orig_mask & PAINT_SCREEN_BACKGROUND_FIRST)) {
         paintBackground(infiniteRegion());
     }
+    StageTimer drawTimer(this, Stage::Draw);
     foreach (const Phase2Data & d, phase2) {
         paintWindow(d.window, d.mask, d.region, d.quads);
     }
@@ -257,6 +265,7 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
 
     // Traverse the scene windows from bottom to top.
     for (int i = 0; i < stacking_order.count(); ++i) {
+        StageTimer prePaintTimer(this, Stage::PrePaint);
         Window *window = stacking_order[i];
         Toplevel *toplevel = window->window();
         WindowPrePaintData data;
@@ -304,7 +313,10 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
             data.clip |= window->decorationShape().translated(window->pos());
         }
 
-        data.quads = window->buildQuads();
+        {
+            StageTimer quadTimer(this, Stage::QuadBuilding);
+            data.quads = window->buildQuads();
+        }
         // preparation step
         effects->prePaintWindow(effectWindow(window), data, time_diff);
 #if !defined(QT_NO_DEBUG)
@@ -320,6 +332,17 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         phase2data.append({ window, data.paint, data.clip, data.mask, data.quads });
     }
 
+    // Parts of the scene shown on overlay planes neither need to be painted nor repaired,
+    // whereas areas that were covered in the previous frame hold stale contents.
+    QRegion overlayArea;
+    QRegion exposedOverlayArea;
+    if (m_paintScreenCount == 1) {
+        overlayArea = assignOverlayPlanes(phase2data);
+        exposedOverlayArea = m_overlayAreas.value(painted_screen) - overlayArea;
+        m_overlayAreas[painted_screen] = overlayArea;
+        dirtyArea |= exposedOverlayArea;
+    }
+
     // Save the part of the repaint region that's exclusively rendered to
     // bring a reused back buffer up to date. Then union the dirty region
     // with the repaint region.
@@ -335,33 +358,37 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
     }
 
     QRegion allclips, upperTranslucentDamage;
-    upperTranslucentDamage = repaint_region;
+    allclips = overlayArea;
+    upperTranslucentDamage = repaint_region | exposedOverlayArea;
 
     // This is the occlusion culling pass
-    for (int i = phase2data.count() - 1; i >= 0; --i) {
-        Phase2Data *data = &phase2data[i];
+    {
+        StageTimer occlusionTimer(this, Stage::Occlusion);
+        for (int i = phase2data.count() - 1; i >= 0; --i) {
+            Phase2Data *data = &phase2data[i];
 
-        if (fullRepaint) {
-            data->region = displayRegion;
-        } else {
-            data->region |= upperTranslucentDamage;
-        }
+            if (fullRepaint) {
+                data->region = displayRegion;
+            } else {
+                data->region |= upperTranslucentDamage;
+            }
 
-        // subtract the parts which will possibly been drawn as part of
-        // a higher opaque window
-        data->region -= allclips;
-
-        // Here we rely on WindowPrePaintData::setTranslucent() to remove
-        // the clip if needed.
-        if (!data->clip.isEmpty() && !(data->mask & PAINT_WINDOW_TRANSLUCENT)) {
-            // clip away the opaque regions for all windows below this one
-            allclips |= data->clip;
-            // extend the translucent damage for windows below this by remaining (translucent) regions
-            if (!fullRepaint) {
-                upperTranslucentDamage |= data->region - data->clip;
+            // subtract the parts which will possibly been drawn as part of
+            // a higher opaque window
+            data->region -= allclips;
+
+            // Here we rely on WindowPrePaintData::setTranslucent() to remove
+            // the clip if needed.
+            if (!data->clip.isEmpty() && !(data->mask & PAINT_WINDOW_TRANSLUCENT)) {
+                // clip away the opaque regions for all windows below this one
+                allclips |= data->clip;
+                // extend the translucent damage for windows below this by remaining (translucent) regions
+                if (!fullRepaint) {
+                    upperTranslucentDamage |= data->region - data->clip;
+                }
+            } else if (!fullRepaint) {
+                upperTranslucentDamage |= data->region;
             }
-        } else if (!fullRepaint) {
-            upperTranslucentDamage |= data->region;
         }
     }
 
@@ -380,6 +407,7 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
     }
 
     // Now walk the list bottom to top and draw the windows.
+    StageTimer drawTimer(this, Stage::Draw);
     for (int i = 0; i < phase2data.count(); ++i) {
         Phase2Data *data = &phase2data[i];
 
@@ -406,6 +434,83 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
     }
 }
 
+QRegion Scene::assignOverlayPlanes(const QVector<Phase2Data> &windows)
+{
+    Q_UNUSED(windows)
+    return QRegion();
+}
+
+Scene::StageTimer::StageTimer(Scene *scene, Stage stage)
+    : m_scene(scene->isStageTimingEnabled() ? scene : nullptr)
+    , m_stage(stage)
+{
+    if (m_scene) {
+        m_parent = m_scene->m_stageTimer;
+        m_scene->m_stageTimer = this;
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+Scene::StageTimer::~StageTimer()
+{
+    if (!m_scene) {
+        return;
+    }
+    const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - m_start;
+    m_scene->m_stageTimes[int(m_stage)] += elapsed - m_nested;
+    if (m_parent) {
+        m_parent->m_nested += elapsed;
+    }
+    m_scene->m_stageTimer = m_parent;
+}
+
+void Scene::setStageTimingEnabled(bool enabled)
+{
+    m_stageTimingEnabled = enabled;
+}
+
+bool Scene::isStageTimingEnabled() const
+{
+    return m_stageTimingEnabled;
+}
+
+std::chrono::nanoseconds Scene::stageTime(Stage stage) const
+{
+    return m_stageTimes[int(stage)];
+}
+
+void Scene::resetStageTimes()
+{
+    m_stageTimes.fill(std::chrono::nanoseconds::zero());
+}
+
+void Scene::addToCounter(Counter counter, qint64 amount)
+{
+    m_counters[int(counter)] += amount;
+    m_frameCounters[int(counter)] += amount;
+}
+
+qint64 Scene::counter(Counter counter) const
+{
+    return m_counters[int(counter)];
+}
+
+qint64 Scene::lastFrameCounter(Counter counter) const
+{
+    return m_lastFrameCounters[int(counter)];
+}
+
+void Scene::resetCounters()
+{
+    m_counters.fill(0);
+}
+
+void Scene::finishFrameCounters()
+{
+    m_lastFrameCounters = m_frameCounters;
+    m_frameCounters.fill(0);
+}
+
 void Scene::addToplevel(Toplevel *c)
 {
     Q_ASSERT(!m_windows.contains(c));
@@ -1120,6 +1225,11 @@ void Scene::Window::discardQuads()
     cached_quad_list.reset();
 }
 
+bool Scene::Window::isCachedQuadList(const WindowQuadList &quads) const
+{
+    return cached_quad_list && quads.isSharedWith(*cached_quad_list);
+}
+
 void Scene::Window::updateShadow(Shadow* shadow)
 {
     if (m_shadow == shadow) {
@@ -1141,18 +1251,43 @@ void Scene::Window::preprocess()
 
 void Scene::Window::addRepaint(const QRegion &region)
 {
+    if (!kwinApp()->platform()->isPerScreenRenderingEnabled()) {
+        m_repaints[0] += region;
+        Compositor::self()->scheduleRepaint();
+        return;
+    }
+    // The repaint region is in window-local coordinates.
+    const QRegion globalRegion = region.translated(pos());
     for (int screen = 0; screen < m_repaints.count(); ++screen) {
-        m_repaints[screen] += region;
+        const QRegion dirtyRegion = globalRegion & screens()->geometry(screen);
+        if (!dirtyRegion.isEmpty()) {
+            m_repaints[screen] += dirtyRegion.translated(-pos());
+            scheduleRepaint(screen);
+        }
     }
-    Compositor::self()->scheduleRepaint();
 }
 
 void Scene::Window::addLayerRepaint(const QRegion &region)
 {
+    if (!kwinApp()->platform()->isPerScreenRenderingEnabled()) {
+        m_layerRepaints[0] += region;
+        Compositor::self()->scheduleRepaint();
+        return;
+    }
     for (int screen = 0; screen < m_layerRepaints.count(); ++screen) {
-        m_layerRepaints[screen] += region;
+        const QRegion dirtyRegion = region & screens()->geometry(screen);
+        if (!dirtyRegion.isEmpty()) {
+            m_layerRepaints[screen] += dirtyRegion;
+            scheduleRepaint(screen);
+        }
+    }
+}
+
+void Scene::Window::scheduleRepaint(int screen)
+{
+    if (AbstractOutput *output = kwinApp()->platform()->findOutput(screen)) {
+        Compositor::self()->scheduleRepaint(output);
     }
-    Compositor::self()->scheduleRepaint();
 }
 
 QRegion Scene::Window::repaints(int screen) const
@@ -1187,15 +1322,11 @@ void Scene::Window::reallocRepaints()
     m_layerRepaints.fill(infiniteRegion());
 }
 
-static bool wantsRepaint_test(const QRegion &region)
-{
-    return !region.isEmpty();
-}
-
-bool Scene::Window::wantsRepaint() const
+bool Scene::Window::wantsRepaint(int screen) const
 {
-    return std::any_of(m_repaints.begin(), m_repaints.end(), wantsRepaint_test) ||
-            std::any_of(m_layerRepaints.begin(), m_layerRepaints.end(), wantsRepaint_test);
+    Q_ASSERT(!m_repaints.isEmpty() && !m_layerRepaints.isEmpty());
+    const int index = screen != -1 ? screen : 0;
+    return !m_repaints[index].isEmpty() || !m_layerRepaints[index].isEmpty();
 }
 
 //****************************************
@@ -17,6 +17,9 @@
 #include <QElapsedTimer>
 #include <QMatrix4x4>
 
+#include <array>
+#include <chrono>
+
 class QOpenGLFramebufferObject;
 
 namespace KWaylandServer
@@ -194,6 +197,79 @@ public:
         return {};
     }
 
+    /**
+     * The stages of a compositing cycle whose cost can be measured with stage timing.
+     */
+    enum class Stage {
+        DamageCollection, ///< Fetching the damage of all windows
+        PrePaint, ///< Preprocessing the windows and the pre-paint pass of the effects
+        QuadBuilding, ///< Building the window quads
+        Occlusion, ///< The occlusion culling pass of paintSimpleScreen()
+        TextureUpload, ///< Updating the window textures from the client buffers
+        Draw, ///< Painting the windows, not including texture uploads
+        Count
+    };
+
+    /**
+     * Measures the time spent in a Stage while the StageTimer is alive. The time spent in
+     * nested timers is only accounted to the innermost stage. Does nothing unless stage
+     * timing is enabled.
+     */
+    class KWIN_EXPORT StageTimer
+    {
+    public:
+        StageTimer(Scene *scene, Stage stage);
+        ~StageTimer();
+
+    private:
+        Scene *m_scene;
+        StageTimer *m_parent = nullptr;
+        Stage m_stage;
+        std::chrono::steady_clock::time_point m_start;
+        std::chrono::nanoseconds m_nested = std::chrono::nanoseconds::zero();
+    };
+
+    /**
+     * Enables accumulating the time spent in each Stage, e.g. for benchmarks.
+     * Stage timing is disabled by default.
+     */
+    void setStageTimingEnabled(bool enabled);
+    bool isStageTimingEnabled() const;
+    /**
+     * Returns the time spent in @p stage since the stage times were last reset.
+     */
+    std::chrono::nanoseconds stageTime(Stage stage) const;
+    void resetStageTimes();
+
+    /**
+     * The work done in a compositing cycle that is counted rather than timed.
+     */
+    enum class Counter {
+        VertexUploads, ///< Windows whose vertices have been uploaded to the GPU
+        CopiedBytes, ///< Bytes of client buffers copied by the QPainter scene
+        DamageRoundTrips, ///< Damage replies of X11 windows the compositor had to wait for
+        Count
+    };
+
+    /**
+     * Adds @p amount to @p counter. Counting is cheap, so the counters are always maintained.
+     */
+    void addToCounter(Counter counter, qint64 amount = 1);
+    /**
+     * Returns the value of @p counter accumulated since the counters were last reset.
+     */
+    qint64 counter(Counter counter) const;
+    /**
+     * Returns the value of @p counter in the last finished frame.
+     */
+    qint64 lastFrameCounter(Counter counter) const;
+    void resetCounters();
+    /**
+     * Finishes counting the current frame. This is called by the compositor once a
+     * compositing cycle is over.
+     */
+    void finishFrameCounters();
+
 Q_SIGNALS:
     void frameRendered();
     void resetCompositing();
@@ -250,6 +326,14 @@ protected:
         int mask = 0;
         WindowQuadList quads;
     };
+    /**
+     * Gives the scene a chance to show parts of the windows on hardware overlay planes
+     * instead of compositing them. @p windows are the windows that are going to be painted,
+     * from bottom to top. Returns the area of the screen that is covered by overlay planes.
+     *
+     * The default implementation returns an empty region.
+     */
+    virtual QRegion assignOverlayPlanes(const QVector<Phase2Data> &windows);
     // The region which actually has been painted by paintScreen() and should be
     // copied from the buffer to the screen. I.e. the region returned from Scene::paintScreen().
     // Since prePaintWindow() can extend areas to paint, these changes would have to propagate
@@ -266,6 +350,8 @@ protected:
     // The screen that is being currently painted
     int painted_screen = -1;
 private:
+    // Areas of the screens that were covered by overlay planes in the last frame
+    QHash<int, QRegion> m_overlayAreas;
     void paintWindowThumbnails(Scene::Window *w, const QRegion &region, qreal opacity, qreal brightness, qreal saturation);
     void paintDesktopThumbnails(Scene::Window *w);
     QHash< Toplevel*, Window* > m_windows;
@@ -273,6 +359,12 @@ private:
     QVector< Window* > stacking_order;
     // how many times finalPaintScreen() has been called
     int m_paintScreenCount = 0;
+    std::array<std::chrono::nanoseconds, int(Stage::Count)> m_stageTimes = {};
+    StageTimer *m_stageTimer = nullptr;
+    bool m_stageTimingEnabled = false;
+    std::array<qint64, int(Counter::Count)> m_counters = {};
+    std::array<qint64, int(Counter::Count)> m_frameCounters = {};
+    std::array<qint64, int(Counter::Count)> m_lastFrameCounters = {};
 };
 
 /**
@@ -350,6 +442,11 @@ public:
     void updateToplevel(Deleted *deleted);
     // creates initial quad list for the window
     virtual WindowQuadList buildQuads(bool force = false) const;
+    /**
+     * Returns @c true if @p quads are the quads returned by buildQuads(), which haven't been
+     * changed since, e.g. by an effect.
+     */
+    bool isCachedQuadList(const WindowQuadList &quads) const;
     void updateShadow(Shadow* shadow);
     const Shadow* shadow() const;
     Shadow* shadow();
@@ -361,7 +458,7 @@ public:
     void addLayerRepaint(const QRegion &region);
     QRegion repaints(int screen) const;
     void resetRepaints(int screen);
-    bool wantsRepaint() const;
+    bool wantsRepaint(int screen) const;
 
     virtual QSharedPointer<GLTexture> windowTexture() {
         return {};
@@ -400,6 +497,7 @@ protected:
     Shadow *m_shadow;
 private:
     void reallocRepaints();
+    void scheduleRepaint(int screen);
 
     QScopedPointer<WindowPixmap> m_currentPixmap;
     QScopedPointer<WindowPixmap> m_previousPixmap;
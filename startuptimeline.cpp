@@ -0,0 +1,186 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "startuptimeline.h"
+#include "utils.h"
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <unistd.h>
+
+namespace KWin
+{
+
+struct StartupTimelineData
+{
+    StartupTimelineData();
+
+    QJsonObject createEvent(const QString &name, const QString &phase,
+                            std::chrono::nanoseconds timestamp) const;
+
+    QString fileName;
+    QJsonArray events;
+    QHash<QString, std::chrono::nanoseconds> pendingPhases;
+    bool startupFinished = false;
+};
+
+StartupTimelineData::StartupTimelineData()
+    : fileName(qEnvironmentVariable("KWIN_STARTUP_TRACE"))
+{
+}
+
+QJsonObject StartupTimelineData::createEvent(const QString &name, const QString &phase,
+                                             std::chrono::nanoseconds timestamp) const
+{
+    // The trace event format expects timestamps in microseconds. The timeline is only used
+    // from the main thread, whose thread id matches the process id.
+    return QJsonObject{
+        {QStringLiteral("name"), name},
+        {QStringLiteral("cat"), QStringLiteral("startup")},
+        {QStringLiteral("ph"), phase},
+        {QStringLiteral("ts"), timestamp.count() / 1000.0},
+        {QStringLiteral("pid"), qint64(getpid())},
+        {QStringLiteral("tid"), qint64(getpid())},
+    };
+}
+
+static StartupTimelineData *timelineData()
+{
+    static StartupTimelineData timeline;
+    return &timeline;
+}
+
+static std::chrono::nanoseconds now()
+{
+    return std::chrono::steady_clock::now().time_since_epoch();
+}
+
+StartupTimeline::Phase::Phase(const QString &name)
+    : m_name(name)
+    , m_begin(isEnabled() ? now() : std::chrono::nanoseconds::zero())
+{
+}
+
+StartupTimeline::Phase::~Phase()
+{
+    if (!isEnabled()) {
+        return;
+    }
+    StartupTimelineData *timeline = timelineData();
+    QJsonObject event = timeline->createEvent(m_name, QStringLiteral("X"), m_begin);
+    event.insert(QStringLiteral("dur"), (now() - m_begin).count() / 1000.0);
+    timeline->events.append(event);
+}
+
+bool StartupTimeline::isEnabled()
+{
+    return !timelineData()->fileName.isEmpty();
+}
+
+void StartupTimeline::begin(const QString &name)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    timelineData()->pendingPhases.insert(name, now());
+}
+
+void StartupTimeline::end(const QString &name)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    StartupTimelineData *timeline = timelineData();
+    const auto it = timeline->pendingPhases.find(name);
+    if (it == timeline->pendingPhases.end()) {
+        return;
+    }
+    const std::chrono::nanoseconds timestamp = now();
+
+    // Phases that span several event loop cycles don't nest with the other phases, so they
+    // are recorded as async events with their own track in the trace.
+    QJsonObject beginEvent = timeline->createEvent(name, QStringLiteral("b"), *it);
+    beginEvent.insert(QStringLiteral("id"), name);
+    timeline->events.append(beginEvent);
+
+    QJsonObject endEvent = timeline->createEvent(name, QStringLiteral("e"), timestamp);
+    endEvent.insert(QStringLiteral("id"), name);
+    timeline->events.append(endEvent);
+
+    timeline->pendingPhases.erase(it);
+}
+
+void StartupTimeline::mark(const QString &name, std::chrono::nanoseconds timestamp)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    StartupTimelineData *timeline = timelineData();
+    QJsonObject event = timeline->createEvent(name, QStringLiteral("i"), timestamp);
+    event.insert(QStringLiteral("s"), QStringLiteral("p"));
+    timeline->events.append(event);
+}
+
+void StartupTimeline::mark(const QString &name)
+{
+    mark(name, now());
+}
+
+void StartupTimeline::finishStartup()
+{
+    if (!isEnabled()) {
+        return;
+    }
+    end(QStringLiteral("Startup"));
+    timelineData()->startupFinished = true;
+}
+
+void StartupTimeline::framePresented(std::chrono::nanoseconds timestamp)
+{
+    if (!isEnabled() || !timelineData()->startupFinished) {
+        return;
+    }
+    mark(QStringLiteral("First frame presented"), timestamp);
+    write();
+}
+
+void StartupTimeline::write()
+{
+    if (!isEnabled()) {
+        return;
+    }
+    StartupTimelineData *timeline = timelineData();
+
+    // Phases that never ended, e.g. because KWin quit during the startup, are left out.
+    const QJsonObject document{
+        {QStringLiteral("traceEvents"), timeline->events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+    };
+
+    QSaveFile file(timeline->fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(KWIN_CORE) << "Failed to open" << timeline->fileName << "to write the startup timeline:"
+                             << file.errorString();
+    } else {
+        file.write(QJsonDocument(document).toJson(QJsonDocument::Compact));
+        if (!file.commit()) {
+            qCWarning(KWIN_CORE) << "Failed to write the startup timeline to" << timeline->fileName;
+        }
+    }
+
+    // The timeline is only written once, stop recording.
+    timeline->fileName.clear();
+    timeline->events = QJsonArray();
+    timeline->pendingPhases.clear();
+}
+
+} // namespace KWin
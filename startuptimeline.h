@@ -0,0 +1,83 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QString>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The StartupTimeline class records how long the phases of the startup take.
+ *
+ * The timeline is only recorded if the KWIN_STARTUP_TRACE environment variable is set to the
+ * path of the file it should be written to. The file uses the Chrome trace event format, so
+ * it can be opened with chrome://tracing or the Perfetto UI. It is written once the first
+ * frame after the end of the startup has been presented, or when KWin quits, whichever
+ * happens first.
+ *
+ * All timestamps are taken from the monotonic clock. The timeline must only be used from
+ * the main thread.
+ */
+class KWIN_EXPORT StartupTimeline
+{
+public:
+    /**
+     * The Phase class records the time spent in a scope as a phase of the startup.
+     */
+    class KWIN_EXPORT Phase
+    {
+    public:
+        explicit Phase(const QString &name);
+        ~Phase();
+
+    private:
+        QString m_name;
+        std::chrono::nanoseconds m_begin;
+    };
+
+    /**
+     * Returns @c true if the timeline is being recorded.
+     */
+    static bool isEnabled();
+
+    /**
+     * Begins the phase with the given @p name. Unlike Phase, this can be used for phases
+     * that span several event loop cycles, such as waiting for a process to start.
+     */
+    static void begin(const QString &name);
+    /**
+     * Ends the phase with the given @p name that has been started with begin().
+     */
+    static void end(const QString &name);
+    /**
+     * Records that the event with the given @p name has happened at @p timestamp.
+     */
+    static void mark(const QString &name, std::chrono::nanoseconds timestamp);
+    static void mark(const QString &name);
+
+    /**
+     * Ends the startup. The timeline is written when the next frame is presented.
+     */
+    static void finishStartup();
+    /**
+     * Notifies the timeline that a frame has been presented at @p timestamp.
+     */
+    static void framePresented(std::chrono::nanoseconds timestamp);
+    /**
+     * Writes the timeline and stops recording.
+     */
+    static void write();
+};
+
+} // namespace KWin
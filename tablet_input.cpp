@@ -57,6 +57,7 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
     if (!inited()) {
         return;
     }
+    input()->pointer()->flushMotion();
     m_lastPosition = pos;
 
     QEvent::Type t;
@@ -91,6 +92,7 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
 
 void KWin::TabletInputRedirection::tabletToolButtonEvent(uint button, bool isPressed)
 {
+    input()->pointer()->flushMotion();
     if (isPressed)
         m_toolPressedButtons.insert(button);
     else
@@ -104,6 +106,7 @@ void KWin::TabletInputRedirection::tabletToolButtonEvent(uint button, bool isPre
 
 void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPressed)
 {
+    input()->pointer()->flushMotion();
     if (isPressed) {
         m_padPressedButtons.insert(button);
     } else {
@@ -118,6 +121,7 @@ void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPres
 
 void KWin::TabletInputRedirection::tabletPadStripEvent(int number, int position, bool isFinger)
 {
+    input()->pointer()->flushMotion();
     input()->processSpies(std::bind( &InputEventSpy::tabletPadStripEvent,
                                      std::placeholders::_1, number, position, isFinger));
     input()->processFilters(std::bind( &InputEventFilter::tabletPadStripEvent,
@@ -126,6 +130,7 @@ void KWin::TabletInputRedirection::tabletPadStripEvent(int number, int position,
 
 void KWin::TabletInputRedirection::tabletPadRingEvent(int number, int position, bool isFinger)
 {
+    input()->pointer()->flushMotion();
     input()->processSpies(std::bind( &InputEventSpy::tabletPadRingEvent,
                                      std::placeholders::_1, number, position, isFinger));
     input()->processFilters(std::bind( &InputEventFilter::tabletPadRingEvent,
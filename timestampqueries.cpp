@@ -0,0 +1,141 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "timestampqueries.h"
+
+#include <config-kwin.h>
+
+#include <kwinglplatform.h>
+#include <kwinglutils.h>
+
+#include <QVector>
+
+#include <epoxy/egl.h>
+#include <epoxy/gl.h>
+#if HAVE_EPOXY_GLX
+#include <epoxy/glx.h>
+#endif
+
+namespace KWin
+{
+
+class GLTimestampQueries : public TimestampQueries
+{
+public:
+    GLTimestampQueries();
+    ~GLTimestampQueries() override;
+
+    bool isContextCurrent() const override;
+    uint issue() override;
+    bool isAvailable(uint query) override;
+    std::chrono::nanoseconds result(uint query) override;
+    void release(uint query) override;
+    std::chrono::nanoseconds currentTime() override;
+
+private:
+    static void *currentContext();
+
+    void *m_context;
+    QVector<uint> m_queries;
+    QVector<uint> m_freeQueries;
+};
+
+TimestampQueries::~TimestampQueries() = default;
+
+TimestampQueries *TimestampQueries::create()
+{
+    // GLES only has timer queries with GL_EXT_disjoint_timer_query, which isn't handled.
+    if (GLPlatform::instance()->isGLES()) {
+        return nullptr;
+    }
+    if (!hasGLVersion(3, 3) && !hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query"))) {
+        return nullptr;
+    }
+    return new GLTimestampQueries();
+}
+
+GLTimestampQueries::GLTimestampQueries()
+    : m_context(currentContext())
+{
+}
+
+GLTimestampQueries::~GLTimestampQueries()
+{
+    // The queries go away with the context if it's not current anymore.
+    if (!m_queries.isEmpty() && isContextCurrent()) {
+        glDeleteQueries(m_queries.count(), m_queries.constData());
+    }
+}
+
+void *GLTimestampQueries::currentContext()
+{
+    switch (GLPlatform::instance()->platformInterface()) {
+    case EglPlatformInterface:
+        return eglGetCurrentContext();
+    case GlxPlatformInterface:
+#if HAVE_EPOXY_GLX
+        return glXGetCurrentContext();
+#else
+        return nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+bool GLTimestampQueries::isContextCurrent() const
+{
+    return m_context && currentContext() == m_context;
+}
+
+uint GLTimestampQueries::issue()
+{
+    if (!isContextCurrent()) {
+        return 0;
+    }
+    if (m_freeQueries.isEmpty()) {
+        QVector<uint> queries(32);
+        glGenQueries(queries.count(), queries.data());
+        m_queries.append(queries);
+        m_freeQueries.append(queries);
+    }
+    const uint query = m_freeQueries.takeLast();
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+}
+
+bool GLTimestampQueries::isAvailable(uint query)
+{
+    if (!isContextCurrent()) {
+        return false;
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available;
+}
+
+std::chrono::nanoseconds GLTimestampQueries::result(uint query)
+{
+    GLuint64 timestamp = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &timestamp);
+    return std::chrono::nanoseconds(timestamp);
+}
+
+void GLTimestampQueries::release(uint query)
+{
+    m_freeQueries.append(query);
+}
+
+std::chrono::nanoseconds GLTimestampQueries::currentTime()
+{
+    GLint64 timestamp = 0;
+    glGetInteger64v(GL_TIMESTAMP, &timestamp);
+    return std::chrono::nanoseconds(timestamp);
+}
+
+} // namespace KWin
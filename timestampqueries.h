@@ -0,0 +1,65 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The TimestampQueries class records when the GPU has finished the commands submitted
+ * so far, without waiting for the GPU.
+ *
+ * The queries belong to the OpenGL context that was current when they were created. No
+ * query is issued while another context is current, e.g. the context of a QtQuick scene.
+ */
+class KWIN_EXPORT TimestampQueries
+{
+public:
+    virtual ~TimestampQueries();
+
+    /**
+     * Creates the queries for the current OpenGL context. Returns @c null if the context
+     * doesn't support timer queries, which requires OpenGL 3.3 or GL_ARB_timer_query.
+     */
+    static TimestampQueries *create();
+
+    /**
+     * Returns @c true if the OpenGL context of the queries is current.
+     */
+    virtual bool isContextCurrent() const = 0;
+
+    /**
+     * Issues a query that captures the GPU time once all previous commands have been
+     * completed. Returns @c 0 if no query can be issued because the context isn't current.
+     */
+    virtual uint issue() = 0;
+    /**
+     * Returns @c true if the result of @p query is available.
+     */
+    virtual bool isAvailable(uint query) = 0;
+    /**
+     * Returns the GPU time captured by @p query. The result must be available.
+     */
+    virtual std::chrono::nanoseconds result(uint query) = 0;
+    /**
+     * Gives @p query back so it can be issued again.
+     */
+    virtual void release(uint query) = 0;
+
+    /**
+     * Returns the current time of the GPU clock, whose epoch is unspecified.
+     */
+    virtual std::chrono::nanoseconds currentTime() = 0;
+};
+
+} // namespace KWin
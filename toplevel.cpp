@@ -23,6 +23,7 @@
 #include <KWaylandServer/surface_interface.h>
 
 #include <QDebug>
+#include <QVarLengthArray>
 
 namespace KWin
 {
@@ -341,7 +342,7 @@ bool Toplevel::compositing() const
     return Workspace::self()->compositing();
 }
 
-bool Toplevel::resetAndFetchDamage()
+bool Toplevel::resetAndFetchDamage(xcb_xfixes_region_t region)
 {
     if (!m_isDamaged)
         return false;
@@ -351,17 +352,13 @@ bool Toplevel::resetAndFetchDamage()
         return true;
     }
 
+    Q_ASSERT(region != XCB_NONE);
     xcb_connection_t *conn = connection();
 
-    // Create a new region and copy the damage region to it,
-    // resetting the damaged state.
-    xcb_xfixes_region_t region = xcb_generate_id(conn);
-    xcb_xfixes_create_region(conn, region, 0, nullptr);
-    xcb_damage_subtract(conn, damage_handle, 0, region);
-
-    // Send a fetch-region request and destroy the region
+    // Move the damage to the region, resetting the damaged state,
+    // and send a fetch-region request.
+    xcb_damage_subtract(conn, damage_handle, XCB_NONE, region);
     m_regionCookie = xcb_xfixes_fetch_region_unchecked(conn, region);
-    xcb_xfixes_destroy_region(conn, region);
 
     m_isDamaged = false;
     m_damageReplyPending = true;
@@ -369,19 +366,28 @@ bool Toplevel::resetAndFetchDamage()
     return m_damageReplyPending;
 }
 
-void Toplevel::getDamageRegionReply()
+bool Toplevel::getDamageRegionReply()
 {
     if (!m_damageReplyPending)
-        return;
+        return false;
 
     m_damageReplyPending = false;
 
-    // Get the fetch-region reply
-    xcb_xfixes_fetch_region_reply_t *reply =
-            xcb_xfixes_fetch_region_reply(connection(), m_regionCookie, nullptr);
+    // Get the fetch-region reply, the replies of the other windows usually
+    // arrive together with the first one.
+    xcb_connection_t *conn = connection();
+    void *genericReply = nullptr;
+    xcb_generic_error_t *error = nullptr;
+    bool waited = false;
+    if (!xcb_poll_for_reply(conn, m_regionCookie.sequence, &genericReply, &error)) {
+        genericReply = xcb_xfixes_fetch_region_reply(conn, m_regionCookie, nullptr);
+        waited = true;
+    }
+    free(error);
 
+    auto reply = static_cast<xcb_xfixes_fetch_region_reply_t *>(genericReply);
     if (!reply)
-        return;
+        return waited;
 
     // Convert the reply to a QRegion
     int count = xcb_xfixes_fetch_region_rectangles_length(reply);
@@ -390,11 +396,9 @@ void Toplevel::getDamageRegionReply()
     if (count > 1 && count < 16) {
         xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reply);
 
-        QVector<QRect> qrects;
-        qrects.reserve(count);
-
+        QVarLengthArray<QRect, 16> qrects;
         for (int i = 0; i < count; i++)
-            qrects << QRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+            qrects.append(QRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height));
 
         region.setRects(qrects.constData(), count);
     } else
@@ -403,6 +407,7 @@ void Toplevel::getDamageRegionReply()
     free(reply);
 
     addDamage(region);
+    return waited;
 }
 
 void Toplevel::addDamageFull()
@@ -489,12 +494,12 @@ void Toplevel::addWorkspaceRepaint(const QRegion &region)
     }
 }
 
-bool Toplevel::wantsRepaint() const
+bool Toplevel::wantsRepaint(int screen) const
 {
     if (!effectWindow() || !effectWindow()->sceneWindow()) {
         return false;
     }
-    return effectWindow()->sceneWindow()->wantsRepaint();
+    return effectWindow()->sceneWindow()->wantsRepaint(screen);
 }
 
 void Toplevel::setReadyForPainting()
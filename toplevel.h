@@ -463,7 +463,10 @@ public:
     void addWorkspaceRepaint(const QRect& r);
     void addWorkspaceRepaint(int x, int y, int w, int h);
     void addWorkspaceRepaint(const QRegion &region);
-    bool wantsRepaint() const;
+    /**
+     * Returns @c true if the window has pending repaints on the given @p screen.
+     */
+    bool wantsRepaint(int screen) const;
     QRegion damage() const;
     void resetDamage();
     EffectWindowImpl* effectWindow();
@@ -507,16 +510,21 @@ public:
      * A call to this function must be followed by a call to getDamageRegionReply(),
      * or the reply will be leaked.
      *
+     * The damage is moved to the XFixes @p region before it is fetched. All windows
+     * can share the same region as the X server handles the requests in order.
+     *
      * Returns true if the window was damaged, and false otherwise.
      */
-    bool resetAndFetchDamage();
+    bool resetAndFetchDamage(xcb_xfixes_region_t region);
 
     /**
      * Gets the reply from a previous call to resetAndFetchDamage().
      * Calling this function is a no-op if there is no pending reply.
      * Call damage() to return the fetched region.
+     *
+     * Returns @c true if the reply had not arrived yet and this call had to wait for it.
      */
-    void getDamageRegionReply();
+    bool getDamageRegionReply();
 
     bool skipsCloseAnimation() const;
     void setSkipCloseAnimation(bool set);
@@ -161,6 +161,7 @@ void TouchInputRedirection::processDown(qint32 id, const QPointF &pos, quint32 t
     if (!inited()) {
         return;
     }
+    input()->pointer()->flushMotion();
     m_lastPosition = pos;
     m_windowUpdatedInCycle = false;
     m_touches++;
@@ -178,6 +179,7 @@ void TouchInputRedirection::processUp(qint32 id, quint32 time, LibInput::Device
     if (!inited()) {
         return;
     }
+    input()->pointer()->flushMotion();
     m_windowUpdatedInCycle = false;
     input()->processSpies(std::bind(&InputEventSpy::touchUp, std::placeholders::_1, id, time));
     input()->processFilters(std::bind(&InputEventFilter::touchUp, std::placeholders::_1, id, time));
@@ -194,6 +196,7 @@ void TouchInputRedirection::processMotion(qint32 id, const QPointF &pos, quint32
     if (!inited()) {
         return;
     }
+    input()->pointer()->flushMotion();
     m_lastPosition = pos;
     m_windowUpdatedInCycle = false;
     input()->processSpies(std::bind(&InputEventSpy::touchMotion, std::placeholders::_1, id, pos, time));
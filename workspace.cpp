@@ -36,6 +36,7 @@
 #include "pluginmanager.h"
 #include "rules.h"
 #include "screenedge.h"
+#include "scene.h"
 #include "screens.h"
 #include "platform.h"
 #include "scripting/scripting.h"
@@ -66,6 +67,19 @@ namespace KWin
 extern int screen_number;
 extern bool is_multihead;
 
+/**
+ * Removes @p key from @p index, but only if it still refers to @p value. X11 window ids
+ * can be recycled, so a stale entry must not drop the entry of a newer window.
+ */
+template <typename Key, typename T>
+static void removeIndexEntry(QHash<Key, T> &index, const Key &key, T value)
+{
+    auto it = index.find(key);
+    if (it != index.end() && it.value() == value) {
+        index.erase(it);
+    }
+}
+
 X11EventFilterContainer::X11EventFilterContainer(X11EventFilter *filter)
     : m_filter(filter)
 {
@@ -594,6 +608,7 @@ void Workspace::addClient(X11Client *c)
     }
     clients.append(c);
     m_allClients.append(c);
+    indexClient(c);
     if (!unconstrained_stacking_order.contains(c))
         unconstrained_stacking_order.append(c);   // Raise if it hasn't got any stacking position yet
     if (!stacking_order.contains(c))    // It'll be updated later, and updateToolWindows() requires
@@ -618,6 +633,8 @@ void Workspace::addClient(X11Client *c)
 void Workspace::addUnmanaged(Unmanaged* c)
 {
     m_unmanaged.append(c);
+    m_unmanagedByWindow.insert(c->window(), c);
+    m_toplevelsById.insert(c->internalId(), c);
     markXStackingOrderAsDirty();
 }
 
@@ -643,6 +660,7 @@ void Workspace::removeClient(X11Client *c)
     // TODO: if marked client is removed, notify the marked list
     clients.removeAll(c);
     m_allClients.removeAll(c);
+    unindexClient(c);
     markXStackingOrderAsDirty();
     attention_chain.removeAll(c);
     Group* group = findGroup(c->window());
@@ -670,10 +688,44 @@ void Workspace::removeUnmanaged(Unmanaged* c)
 {
     Q_ASSERT(m_unmanaged.contains(c));
     m_unmanaged.removeAll(c);
+    removeIndexEntry(m_unmanagedByWindow, c->window(), c);
+    removeIndexEntry(m_toplevelsById, c->internalId(), static_cast<Toplevel *>(c));
     emit unmanagedRemoved(c);
     markXStackingOrderAsDirty();
 }
 
+void Workspace::indexClient(X11Client *c)
+{
+    m_clientsByWindow.insert(c->window(), c);
+    m_clientsByFrame.insert(c->frameId(), c);
+    m_clientsByWrapper.insert(c->wrapperId(), c);
+    if (c->inputId() != XCB_WINDOW_NONE) {
+        m_clientsByInput.insert(c->inputId(), c);
+    }
+    m_toplevelsById.insert(c->internalId(), c);
+}
+
+void Workspace::unindexClient(X11Client *c)
+{
+    removeIndexEntry(m_clientsByWindow, c->window(), c);
+    removeIndexEntry(m_clientsByFrame, c->frameId(), c);
+    removeIndexEntry(m_clientsByWrapper, c->wrapperId(), c);
+    removeIndexEntry(m_clientsByInput, c->inputId(), c);
+    removeIndexEntry(m_toplevelsById, c->internalId(), static_cast<Toplevel *>(c));
+}
+
+void Workspace::updateClientInputId(X11Client *c, xcb_window_t previous)
+{
+    // The input window may change before the client is added to the workspace.
+    if (m_clientsByWindow.value(c->window()) != c) {
+        return;
+    }
+    removeIndexEntry(m_clientsByInput, previous, c);
+    if (c->inputId() != XCB_WINDOW_NONE) {
+        m_clientsByInput.insert(c->inputId(), c);
+    }
+}
+
 void Workspace::addDeleted(Deleted* c, Toplevel *orig)
 {
     Q_ASSERT(!deleted.contains(c));
@@ -732,6 +784,7 @@ void Workspace::addShellClient(AbstractClient *client)
         }
     }
     m_allClients.append(client);
+    m_toplevelsById.insert(client->internalId(), client);
     if (!unconstrained_stacking_order.contains(client)) {
         unconstrained_stacking_order.append(client); // Raise if it hasn't got any stacking position yet
     }
@@ -768,6 +821,7 @@ void Workspace::removeShellClient(AbstractClient *client)
 {
     clientHidden(client);
     m_allClients.removeAll(client);
+    removeIndexEntry(m_toplevelsById, client->internalId(), static_cast<Toplevel *>(client));
     if (client == most_recently_raised) {
         most_recently_raised = nullptr;
     }
@@ -1480,6 +1534,12 @@ QString Workspace::supportInformation() const
     support.append(QLatin1String("themeSize: ") + QString::number(cursor->themeSize()) + QLatin1Char('\n'));
     support.append(QLatin1Char('\n'));
 
+    support.append(QStringLiteral("Window Rules\n"));
+    support.append(QStringLiteral("============\n"));
+    support.append(QStringLiteral("Rules: %1\n").arg(RuleBook::self()->ruleCount()));
+    support.append(QStringLiteral("Rule evaluations: %1\n").arg(RuleBook::self()->evaluationCount()));
+    support.append(QLatin1Char('\n'));
+
     support.append(QStringLiteral("Options\n"));
     support.append(QStringLiteral("=======\n"));
     const QMetaObject *metaOptions = options->metaObject();
@@ -1636,6 +1696,8 @@ QString Workspace::supportInformation() const
             break;
         case QPainterCompositing:
             support.append("Compositing Type: QPainter\n");
+            support.append(QStringLiteral("Copied bytes of client buffers in the last frame: %1\n")
+                               .arg(Compositor::self()->scene()->lastFrameCounter(Scene::Counter::CopiedBytes)));
             break;
         case NoCompositing:
         default:
@@ -1708,30 +1770,23 @@ Unmanaged *Workspace::findUnmanaged(std::function<bool (const Unmanaged*)> func)
 
 Unmanaged *Workspace::findUnmanaged(xcb_window_t w) const
 {
-    return findUnmanaged([w](const Unmanaged *u) {
-        return u->window() == w;
-    });
+    return m_unmanagedByWindow.value(w);
 }
 
 X11Client *Workspace::findClient(Predicate predicate, xcb_window_t w) const
 {
+    if (w == XCB_WINDOW_NONE) {
+        return nullptr;
+    }
     switch (predicate) {
     case Predicate::WindowMatch:
-        return findClient([w](const X11Client *c) {
-            return c->window() == w;
-        });
+        return m_clientsByWindow.value(w);
     case Predicate::WrapperIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->wrapperId() == w;
-        });
+        return m_clientsByWrapper.value(w);
     case Predicate::FrameIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->frameId() == w;
-        });
+        return m_clientsByFrame.value(w);
     case Predicate::InputIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->inputId() == w;
-        });
+        return m_clientsByInput.value(w);
     }
     return nullptr;
 }
@@ -1752,9 +1807,7 @@ Toplevel *Workspace::findToplevel(std::function<bool (const Toplevel*)> func) co
 
 Toplevel *Workspace::findToplevel(const QUuid &internalId) const
 {
-    return findToplevel([internalId] (const KWin::Toplevel* l) -> bool {
-        return internalId == l->internalId();
-    });
+    return m_toplevelsById.value(internalId);
 }
 
 void Workspace::forEachToplevel(std::function<void (Toplevel *)> func)
@@ -1839,6 +1892,7 @@ void Workspace::updateTabbox()
 void Workspace::addInternalClient(InternalClient *client)
 {
     m_internalClients.append(client);
+    m_toplevelsById.insert(client->internalId(), client);
 
     setupClientConnections(client);
     client->updateLayer();
@@ -1858,6 +1912,7 @@ void Workspace::addInternalClient(InternalClient *client)
 void Workspace::removeInternalClient(InternalClient *client)
 {
     m_internalClients.removeOne(client);
+    removeIndexEntry(m_toplevelsById, client->internalId(), static_cast<Toplevel *>(client));
 
     markXStackingOrderAsDirty();
     updateStackingOrder(true);
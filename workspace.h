@@ -18,7 +18,9 @@
 #include "sm.h"
 #include "utils.h"
 // Qt
+#include <QHash>
 #include <QTimer>
+#include <QUuid>
 #include <QVector>
 // std
 #include <functional>
@@ -329,6 +331,11 @@ public:
     bool showingDesktop() const;
 
     void removeClient(X11Client *);   // Only called from X11Client::destroyClient() or X11Client::releaseWindow()
+    /**
+     * Updates the window id index after the input window of @p c has been created or
+     * destroyed. @p previous is the input window id the client had before the change.
+     */
+    void updateClientInputId(X11Client *c, xcb_window_t previous);
     void setActiveClient(AbstractClient*);
     Group* findGroup(xcb_window_t leader) const;
     void addGroup(Group* group);
@@ -567,6 +574,8 @@ private:
 
     void addShellClient(AbstractClient *client);
     void removeShellClient(AbstractClient *client);
+    void indexClient(X11Client *c);
+    void unindexClient(X11Client *c);
 
     //---------------------------------------------------------------------
 
@@ -605,6 +614,15 @@ private:
     QList<Deleted *> deleted;
     QList<InternalClient *> m_internalClients;
 
+    // Window id indices kept in sync with the lists above, used by findClient(Predicate, xcb_window_t),
+    // findUnmanaged(xcb_window_t) and findToplevel(const QUuid &).
+    QHash<xcb_window_t, X11Client *> m_clientsByWindow;
+    QHash<xcb_window_t, X11Client *> m_clientsByFrame;
+    QHash<xcb_window_t, X11Client *> m_clientsByWrapper;
+    QHash<xcb_window_t, X11Client *> m_clientsByInput;
+    QHash<xcb_window_t, Unmanaged *> m_unmanagedByWindow;
+    QHash<QUuid, Toplevel *> m_toplevelsById;
+
     QList<Toplevel *> unconstrained_stacking_order; // Topmost last
     QList<Toplevel *> stacking_order; // Topmost last
     QVector<xcb_window_t> manual_overlays; //Topmost last
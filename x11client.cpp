@@ -984,7 +984,7 @@ void X11Client::updateInputWindow()
     }
 
     if (region.isEmpty()) {
-        m_decoInputExtent.reset();
+        resetDecoInputExtent();
         return;
     }
 
@@ -1009,6 +1009,7 @@ void X11Client::updateInputWindow()
         m_decoInputExtent.create(bounds, XCB_WINDOW_CLASS_INPUT_ONLY, mask, values);
         if (mapping_state == Mapped)
             m_decoInputExtent.map();
+        workspace()->updateClientInputId(this, XCB_WINDOW_NONE);
     } else {
         m_decoInputExtent.setGeometry(bounds);
     }
@@ -1089,7 +1090,17 @@ void X11Client::destroyDecoration()
             emit geometryShapeChanged(this, oldgeom);
         }
     }
+    resetDecoInputExtent();
+}
+
+void X11Client::resetDecoInputExtent()
+{
+    if (!m_decoInputExtent.isValid()) {
+        return;
+    }
+    const xcb_window_t previous = m_decoInputExtent;
     m_decoInputExtent.reset();
+    workspace()->updateClientInputId(this, previous);
 }
 
 void X11Client::layoutDecorationRects(QRect &left, QRect &top, QRect &right, QRect &bottom) const
@@ -428,6 +428,7 @@ private:
     void startupIdChanged();
 
     void updateInputWindow();
+    void resetDecoInputExtent();
 
     Xcb::Property fetchShowOnScreenEdge() const;
     void readShowOnScreenEdge(Xcb::Property &property);
@@ -10,11 +10,14 @@
 */
 #include "xwayland.h"
 #include "databridge.h"
+#include "xwaylandsocket.h"
 
 #include "main_wayland.h"
 #include "options.h"
+#include "startuptimeline.h"
 #include "utils.h"
 #include "wayland_server.h"
+#include "workspace.h"
 #include "xcbutils.h"
 #include "xwayland_logging.h"
 
@@ -69,6 +72,12 @@ Xwayland::Xwayland(ApplicationWaylandAbstract *app, QObject *parent)
     m_resetCrashCountTimer = new QTimer(this);
     m_resetCrashCountTimer->setSingleShot(true);
     connect(m_resetCrashCountTimer, &QTimer::timeout, this, &Xwayland::resetCrashCount);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    connect(m_idleTimer, &QTimer::timeout, this, &Xwayland::handleIdleTimeout);
+    connect(workspace(), &Workspace::clientRemoved, this, &Xwayland::scheduleIdleShutdown);
+    connect(workspace(), &Workspace::unmanagedRemoved, this, &Xwayland::scheduleIdleShutdown);
 }
 
 Xwayland::~Xwayland()
@@ -87,6 +96,64 @@ void Xwayland::start()
         return;
     }
 
+    if (!options->xwaylandStartOnDemand() && !m_socket) {
+        startProcess();
+        return;
+    }
+
+    if (!m_socket && !createSocket()) {
+        emit errorOccurred();
+        return;
+    }
+    setListening(true);
+    emit listening();
+}
+
+bool Xwayland::createSocket()
+{
+    QScopedPointer<XwaylandSocket> socket(new XwaylandSocket());
+    if (!socket->isValid()) {
+        return false;
+    }
+    m_socket.swap(socket);
+
+    for (int fileDescriptor : m_socket->fileDescriptors()) {
+        QSocketNotifier *notifier = new QSocketNotifier(fileDescriptor, QSocketNotifier::Read, this);
+        notifier->setEnabled(false);
+        connect(notifier, &QSocketNotifier::activated, this, &Xwayland::handleClientConnecting);
+        m_listenNotifiers.append(notifier);
+    }
+
+    // X11 clients must be able to find the display before the server is running.
+    m_displayName = m_socket->name().toUtf8();
+    qputenv("DISPLAY", m_displayName);
+    auto env = m_app->processStartupEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), m_displayName);
+    m_app->setProcessStartupEnvironment(env);
+
+    qCInfo(KWIN_XWL) << "Waiting for X11 clients on display" << m_displayName;
+    return true;
+}
+
+void Xwayland::setListening(bool listening)
+{
+    for (QSocketNotifier *notifier : qAsConst(m_listenNotifiers)) {
+        notifier->setEnabled(listening);
+    }
+}
+
+void Xwayland::handleClientConnecting()
+{
+    // The connection is accepted by Xwayland, don't wake up until the server is gone.
+    setListening(false);
+
+    qCDebug(KWIN_XWL) << "Starting Xwayland because an X11 client is connecting";
+    startProcess();
+}
+
+void Xwayland::startProcess()
+{
+    StartupTimeline::Phase phase(QStringLiteral("Xwayland::startProcess"));
     int pipeFds[2];
     if (pipe(pipeFds) != 0) {
         qCWarning(KWIN_XWL, "Failed to create pipe to start Xwayland: %s", strerror(errno));
@@ -129,21 +196,54 @@ void Xwayland::start()
     env.insert("WAYLAND_SOCKET", QByteArray::number(wlfd));
     env.insert("EGL_PLATFORM", QByteArrayLiteral("DRM"));
     m_xwaylandProcess->setProcessEnvironment(env);
-    m_xwaylandProcess->setArguments({QStringLiteral("-displayfd"),
-                           QString::number(pipeFds[1]),
-                           QStringLiteral("-rootless"),
-                           QStringLiteral("-wm"),
-                           QString::number(fd)});
+
+    QStringList arguments;
+    QVector<int> listenFds;
+    if (m_socket) {
+        // Hand the sockets over to Xwayland, dup() clears the close-on-exec flag.
+        arguments << m_socket->name();
+        for (int fileDescriptor : m_socket->fileDescriptors()) {
+            const int listenFd = dup(fileDescriptor);
+            if (listenFd < 0) {
+                qCWarning(KWIN_XWL, "Failed to pass the X11 socket to Xwayland: %s", strerror(errno));
+                continue;
+            }
+            arguments << QStringLiteral("-listen") << QString::number(listenFd);
+            listenFds.append(listenFd);
+        }
+    }
+    arguments << QStringLiteral("-displayfd")
+              << QString::number(pipeFds[1])
+              << QStringLiteral("-rootless")
+              << QStringLiteral("-wm")
+              << QString::number(fd);
+    m_xwaylandProcess->setArguments(arguments);
     connect(m_xwaylandProcess, &QProcess::errorOccurred, this, &Xwayland::handleXwaylandError);
     connect(m_xwaylandProcess, &QProcess::started, this, &Xwayland::handleXwaylandStarted);
     connect(m_xwaylandProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, &Xwayland::handleXwaylandFinished);
+    StartupTimeline::begin(QStringLiteral("Xwayland server initialization"));
     m_xwaylandProcess->start();
     close(pipeFds[1]);
+    for (int listenFd : qAsConst(listenFds)) {
+        close(listenFd);
+    }
 }
 
 void Xwayland::stop()
 {
+    stopProcess();
+
+    // X11 clients can't connect to the display anymore.
+    qDeleteAll(m_listenNotifiers);
+    m_listenNotifiers.clear();
+    m_socket.reset();
+}
+
+void Xwayland::stopProcess()
+{
+    m_idleTimer->stop();
+
     if (!m_xwaylandProcess) {
         return;
     }
@@ -176,7 +276,7 @@ void Xwayland::stop()
 
 void Xwayland::restart()
 {
-    stop();
+    stopProcess();
     start();
 }
 
@@ -301,6 +401,8 @@ void Xwayland::handleXwaylandError(QProcess::ProcessError error)
 
 void Xwayland::handleXwaylandReady()
 {
+    StartupTimeline::end(QStringLiteral("Xwayland server initialization"));
+    StartupTimeline::Phase phase(QStringLiteral("Xwayland::handleXwaylandReady"));
     m_displayName = m_watcher->result();
 
     m_watcher->deleteLater();
@@ -326,9 +428,35 @@ void Xwayland::handleXwaylandReady()
 
     emit started();
 
+    // Nobody may ever open a window if a client only started the server to query it.
+    scheduleIdleShutdown();
+
     Xcb::sync(); // Trigger possible errors, there's still a chance to abort
 }
 
+void Xwayland::scheduleIdleShutdown()
+{
+    const int timeout = options->xwaylandIdleTimeout();
+    if (!m_socket || !m_app->x11Connection() || timeout <= 0) {
+        return;
+    }
+    m_idleTimer->start(std::chrono::seconds(timeout));
+}
+
+void Xwayland::handleIdleTimeout()
+{
+    if (!m_socket || !m_app->x11Connection()) {
+        return;
+    }
+    if (!workspace()->clientList().isEmpty() || !workspace()->unmanagedList().isEmpty()) {
+        return;
+    }
+
+    qCInfo(KWIN_XWL) << "Stopping Xwayland because there are no X11 windows";
+    stopProcess();
+    setListening(true);
+}
+
 bool Xwayland::createX11Connection()
 {
     xcb_connection_t *connection = xcb_connect_to_fd(m_xcbConnectionFd, nullptr);
@@ -14,6 +14,7 @@
 
 #include <QFutureWatcher>
 #include <QProcess>
+#include <QScopedPointer>
 #include <QSocketNotifier>
 
 namespace KWin
@@ -22,6 +23,7 @@ class ApplicationWaylandAbstract;
 
 namespace Xwl
 {
+class XwaylandSocket;
 
 class Xwayland : public XwaylandInterface
 {
@@ -45,7 +47,10 @@ public Q_SLOTS:
      * be emitted. If the Xwayland server has started successfully, the started() signal will be
      * emitted.
      *
-     * @see started(), stop()
+     * If Xwayland is started on demand, this method only reserves an X11 display and emits the
+     * listening() signal. The Xwayland process is spawned when the first X11 client connects.
+     *
+     * @see started(), listening(), stop()
      */
     void start();
     /**
@@ -63,7 +68,8 @@ public Q_SLOTS:
      */
     void stop();
     /**
-     * Restarts the Xwayland server. This method is equivalent to calling stop() and start().
+     * Restarts the Xwayland server. This method is equivalent to calling stop() and start(),
+     * except that the X11 display is kept if Xwayland is started on demand.
      */
     void restart();
 
@@ -73,6 +79,11 @@ Q_SIGNALS:
      * ready to accept and manage X11 clients.
      */
     void started();
+    /**
+     * This signal is emitted when Xwayland is started on demand and X11 clients can connect
+     * to the reserved display.
+     */
+    void listening();
     /**
      * This signal is emitted when an error occurs with the Xwayland server.
      */
@@ -87,8 +98,16 @@ private Q_SLOTS:
     void handleXwaylandCrashed();
     void handleXwaylandError(QProcess::ProcessError error);
     void handleXwaylandReady();
+    void handleClientConnecting();
+    void scheduleIdleShutdown();
+    void handleIdleTimeout();
 
 private:
+    void startProcess();
+    void stopProcess();
+    bool createSocket();
+    void setListening(bool listening);
+
     void installSocketNotifier();
     void uninstallSocketNotifier();
 
@@ -102,6 +121,9 @@ private:
     QProcess *m_xwaylandProcess = nullptr;
     QSocketNotifier *m_socketNotifier = nullptr;
     QTimer *m_resetCrashCountTimer = nullptr;
+    QTimer *m_idleTimer = nullptr;
+    QScopedPointer<XwaylandSocket> m_socket;
+    QVector<QSocketNotifier *> m_listenNotifiers;
     QByteArray m_displayName;
     QFutureWatcher<QByteArray> *m_watcher = nullptr;
     ApplicationWaylandAbstract *m_app;
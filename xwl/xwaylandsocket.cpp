@@ -0,0 +1,232 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "xwaylandsocket.h"
+#include "xwayland_logging.h"
+
+#include <QFile>
+
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace KWin
+{
+namespace Xwl
+{
+
+static const int s_maxDisplayCount = 32;
+
+/**
+ * Makes sure that the directory for the X11 sockets exists and is safe to use. The directory
+ * must be owned by root or by us and have the sticky bit set, otherwise other users could
+ * replace our socket.
+ */
+static bool ensureSocketDirectory()
+{
+    const char *path = "/tmp/.X11-unix";
+
+    // The X server creates the directory during boot, but it may not exist yet.
+    if (mkdir(path, 01777) == 0) {
+        // The mode passed to mkdir() is subject to the umask.
+        if (chmod(path, 01777) == -1) {
+            qCWarning(KWIN_XWL, "Failed to change the mode of %s: %s", path, strerror(errno));
+            return false;
+        }
+        return true;
+    }
+    if (errno != EEXIST) {
+        qCWarning(KWIN_XWL, "Failed to create %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (lstat(path, &info) == -1) {
+        qCWarning(KWIN_XWL, "Failed to stat %s: %s", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        qCWarning(KWIN_XWL) << path << "is not a directory";
+        return false;
+    }
+    if (info.st_uid != 0 && info.st_uid != getuid()) {
+        qCWarning(KWIN_XWL) << path << "is neither owned by root nor by the current user";
+        return false;
+    }
+    if ((info.st_mode & 01777) != 01777) {
+        // We may fix our own directory, e.g. the one we created with a restrictive umask.
+        if (info.st_uid != getuid() || chmod(path, 01777) == -1) {
+            qCWarning(KWIN_XWL) << path << "is not world-writable with the sticky bit set";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Creates the lock file of an X11 display. A stale lock file of a process that no longer
+ * exists is taken over.
+ */
+static bool createLockFile(const QString &filePath)
+{
+    const QByteArray encodedFilePath = QFile::encodeName(filePath);
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const int fd = open(encodedFilePath.constData(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0444);
+        if (fd >= 0) {
+            // The X server expects the pid padded to ten characters.
+            const QByteArray pid = QByteArray::number(getpid()).rightJustified(10) + '\n';
+            const bool written = write(fd, pid.constData(), pid.size()) == pid.size();
+            close(fd);
+            if (!written) {
+                unlink(encodedFilePath.constData());
+                return false;
+            }
+            return true;
+        }
+        if (errno != EEXIST) {
+            return false;
+        }
+
+        QFile lockFile(filePath);
+        if (!lockFile.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        bool ok = false;
+        const pid_t owner = lockFile.readLine().trimmed().toInt(&ok);
+        lockFile.close();
+        if (!ok || owner <= 0 || kill(owner, 0) == 0 || errno != ESRCH) {
+            return false;
+        }
+        unlink(encodedFilePath.constData());
+    }
+
+    return false;
+}
+
+static int listenOnSocket(const QByteArray &path, bool abstract)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    // An abstract socket name starts with a null byte.
+    const int offset = abstract ? 1 : 0;
+    if (offset + path.size() >= int(sizeof(address.sun_path))) {
+        return -1;
+    }
+    memcpy(address.sun_path + offset, path.constData(), path.size());
+    const socklen_t size = offsetof(sockaddr_un, sun_path) + offset + path.size() + (abstract ? 0 : 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (!abstract) {
+        unlink(path.constData());
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), size) == -1 || listen(fd, 1) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+XwaylandSocket::XwaylandSocket()
+{
+    if (!ensureSocketDirectory()) {
+        return;
+    }
+
+    for (int display = 0; display < s_maxDisplayCount; ++display) {
+        if (tryDisplay(display)) {
+            qCDebug(KWIN_XWL) << "Reserved X11 display" << name();
+            return;
+        }
+    }
+    qCWarning(KWIN_XWL) << "Failed to find a free X11 display";
+}
+
+XwaylandSocket::~XwaylandSocket()
+{
+    release();
+}
+
+bool XwaylandSocket::isValid() const
+{
+    return m_display != -1;
+}
+
+QString XwaylandSocket::name() const
+{
+    return QStringLiteral(":") + QString::number(m_display);
+}
+
+QVector<int> XwaylandSocket::fileDescriptors() const
+{
+    return m_fileDescriptors;
+}
+
+bool XwaylandSocket::tryDisplay(int display)
+{
+    const QString lockFilePath = QStringLiteral("/tmp/.X%1-lock").arg(display);
+    if (!createLockFile(lockFilePath)) {
+        return false;
+    }
+    m_lockFilePath = lockFilePath;
+
+    const QString socketFilePath = QStringLiteral("/tmp/.X11-unix/X%1").arg(display);
+    const QByteArray encodedSocketFilePath = QFile::encodeName(socketFilePath);
+
+    const int unixFileDescriptor = listenOnSocket(encodedSocketFilePath, false);
+    if (unixFileDescriptor == -1) {
+        release();
+        return false;
+    }
+    m_socketFilePath = socketFilePath;
+    m_fileDescriptors.append(unixFileDescriptor);
+
+#if defined(Q_OS_LINUX)
+    const int abstractFileDescriptor = listenOnSocket(encodedSocketFilePath, true);
+    if (abstractFileDescriptor == -1) {
+        release();
+        return false;
+    }
+    m_fileDescriptors.append(abstractFileDescriptor);
+#endif
+
+    m_display = display;
+    return true;
+}
+
+void XwaylandSocket::release()
+{
+    for (int fileDescriptor : qAsConst(m_fileDescriptors)) {
+        close(fileDescriptor);
+    }
+    m_fileDescriptors.clear();
+
+    if (!m_socketFilePath.isEmpty()) {
+        unlink(QFile::encodeName(m_socketFilePath).constData());
+        m_socketFilePath.clear();
+    }
+    if (!m_lockFilePath.isEmpty()) {
+        unlink(QFile::encodeName(m_lockFilePath).constData());
+        m_lockFilePath.clear();
+    }
+    m_display = -1;
+}
+
+} // namespace Xwl
+} // namespace KWin
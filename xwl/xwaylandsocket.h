@@ -0,0 +1,61 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2020 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#ifndef KWIN_XWL_XWAYLAND_SOCKET
+#define KWIN_XWL_XWAYLAND_SOCKET
+
+#include <QString>
+#include <QVector>
+
+namespace KWin
+{
+namespace Xwl
+{
+
+/**
+ * The XwaylandSocket class reserves a free X11 display and creates the sockets on which
+ * X11 clients connect to it, so that the X server can be spawned later on and take them
+ * over.
+ *
+ * The display is reserved with a lock file in /tmp, the same way as the X server does it.
+ */
+class XwaylandSocket
+{
+public:
+    XwaylandSocket();
+    ~XwaylandSocket();
+
+    /**
+     * Returns @c true if a display has been reserved and its sockets are listening.
+     */
+    bool isValid() const;
+    /**
+     * Returns the name of the display, e.g. ":1".
+     */
+    QString name() const;
+    /**
+     * Returns the listening sockets. They remain owned by the XwaylandSocket.
+     */
+    QVector<int> fileDescriptors() const;
+
+private:
+    bool tryDisplay(int display);
+    void release();
+
+    int m_display = -1;
+    QString m_lockFilePath;
+    QString m_socketFilePath;
+    QVector<int> m_fileDescriptors;
+
+    Q_DISABLE_COPY(XwaylandSocket)
+};
+
+} // namespace Xwl
+} // namespace KWin
+
+#endif